@@ -3,96 +3,678 @@
 #include <complex.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define AMPLITUDE_24BIT ((uint32_t)0x00FFFFFF)
 
-#ifdef AUDIO_ENVELOPE
-static inline void generate_envelope(float *samples, size_t count) {
-    float aDelta = (float)M_PI / count;
+// The float engine normalizes against 20 bits of amplitude, the fixed-point
+// engines keep all 24 bits to not clip, so their bins get scaled back up
+#define FIXED_BIN_SCALE ((float)(1 << 23) / (float)0x000FFFFF)
 
-    for (size_t i = 0; i < count; i++)
-        samples[i] = sinf(i * aDelta);
+// Gain above 1 the fixed-point window tables make room for, 2^15
+#define MAX_HEADROOM 15
+
+static inline int16_t saturate_q15(int32_t value) {
+    if (value > INT16_MAX)
+        return INT16_MAX;
+
+    if (value < INT16_MIN)
+        return INT16_MIN;
+
+    return (int16_t)value;
+}
+
+static inline int32_t saturate_q31(int64_t value) {
+    if (value > INT32_MAX)
+        return INT32_MAX;
+
+    if (value < INT32_MIN)
+        return INT32_MIN;
+
+    return (int32_t)value;
+}
+
+// One sample, ring entry or table entry
+static size_t sample_size(audio_engine_t engine) {
+    return AUDIO_SAMPLE_SIZE(engine);
+}
+
+/**
+ * Cosine sum windows, a0 - a1 cos(x) + a2 cos(2x) - a3 cos(3x) + a4 cos(4x).
+ * Periodic, so they tile the hops of a sliding window.
+ */
+static const float window_coefficients[][5] = {
+    [AUDIO_WINDOW_RECTANGULAR] = {1.f},
+    [AUDIO_WINDOW_HANN] = {0.5f, 0.5f},
+    [AUDIO_WINDOW_BLACKMAN_HARRIS] = {0.35875f, 0.48829f, 0.14128f,
+                                      0.01168f},
+    [AUDIO_WINDOW_FLAT_TOP] = {0.21557895f, 0.41663158f, 0.277263158f,
+                               0.083578947f, 0.006947368f},
+};
+
+static size_t window_term_count(audio_window_t kind) {
+    size_t count = GOERTZEL_MAX_TERMS;
+
+    while (count > 1 && window_coefficients[kind][count - 1] == 0.f)
+        count--;
+
+    return count;
+}
+
+static void generate_window(float *window, size_t count,
+                            audio_window_t kind) {
+    const float *a = window_coefficients[kind];
+    float delta = 2.f * (float)M_PI / count;
+
+    for (size_t i = 0; i < count; i++) {
+        float x = i * delta;
+        float value = a[0] - a[1] * cosf(x) + a[2] * cosf(2.f * x) -
+                      a[3] * cosf(3.f * x) + a[4] * cosf(4.f * x);
+
+        // Flat-top peaks a hair over 1, keep the fixed-point tables in range
+        window[i] = value > 1.f ? 1.f : value;
+    }
+}
+
+/**
+ * @brief Fold window, normalization and gain into one factor per sample.
+ * The fixed-point tables give up a bit of precision per doubling of gain
+ * above 1 rather than overflow.
+ */
+static void build_table(audio_t *this, float gain) {
+    float *table_f = this->table;
+    int16_t *table_q15 = this->table;
+    int32_t *table_q31 = this->table;
+    float magnitude = fabsf(gain);
+    int headroom = 0;
+
+    while (magnitude > (float)(1 << headroom) && headroom < MAX_HEADROOM)
+        headroom++;
+
+    switch (this->engine) {
+    case AUDIO_ENGINE_Q15:
+        for (size_t i = 0; i < this->audio_sample_count; i++)
+            table_q15[i] = saturate_q15(
+                lrintf(this->window[i] * gain * (1 << (15 - headroom))));
+        break;
+    case AUDIO_ENGINE_Q31:
+        for (size_t i = 0; i < this->audio_sample_count; i++)
+            table_q31[i] = saturate_q31(
+                llrint((double)this->window[i] * gain *
+                       (double)(1u << (31 - headroom))));
+        break;
+    default:
+        for (size_t i = 0; i < this->audio_sample_count; i++)
+            table_f[i] = this->window[i] * (gain / (float)0x000FFFFF);
+        break;
+    }
+
+    this->table_gain = gain;
+    this->table_headroom = headroom;
+}
+
+static int init_fft(audio_t *this, arena_t *arena,
+                    size_t audio_sample_count) {
+    switch (this->engine) {
+    case AUDIO_ENGINE_Q15:
+        if (fft_init_real_q15(&this->fft_q15, arena, audio_sample_count) < 0)
+            return -1;
+
+        this->fft_q15.bin_scale = FIXED_BIN_SCALE;
+        return 1;
+    case AUDIO_ENGINE_Q31:
+        if (fft_init_real_q31(&this->fft_q31, arena, audio_sample_count) < 0)
+            return -1;
+
+        this->fft_q31.bin_scale = FIXED_BIN_SCALE;
+        return 1;
+    default:
+        return fft_init_real(&this->fft, arena, audio_sample_count);
+    }
 }
-#endif
 
-int audio_init(audio_t *this, size_t audio_sample_count) {
-    float complex *audio_sample_buffer;
-    float *frequency_bins;
-#ifdef AUDIO_ENVELOPE
-    float *envelope = NULL;
-#endif
+static void deinit_fft(audio_t *this) {
+    switch (this->engine) {
+    case AUDIO_ENGINE_Q15:
+        fft_deinit_real_q15(&this->fft_q15);
+        break;
+    case AUDIO_ENGINE_Q31:
+        fft_deinit_real_q31(&this->fft_q31);
+        break;
+    case AUDIO_ENGINE_GOERTZEL:
+        goertzel_deinit(&this->goertzel);
+        break;
+    default:
+        fft_deinit_real(&this->fft);
+        break;
+    }
+}
 
-    audio_sample_buffer =
-        (float complex *)malloc(audio_sample_count * sizeof(float complex));
+int audio_init(audio_t *this, arena_t *arena, size_t audio_sample_count,
+               audio_engine_t engine, audio_window_t window) {
+    return audio_init_stft(this, arena, audio_sample_count,
+                           audio_sample_count, engine, window);
+}
+
+int audio_init_stft(audio_t *this, arena_t *arena, size_t audio_sample_count,
+                    size_t hop_count, audio_engine_t engine,
+                    audio_window_t window) {
+    size_t ring_count = hop_count < audio_sample_count ? audio_sample_count : 0;
+    uint8_t *mem;
 
-    if (audio_sample_buffer == NULL)
+    // Whole hops only, so a hop never wraps around the ring
+    if (hop_count == 0 || hop_count > audio_sample_count ||
+        audio_sample_count % hop_count != 0)
         return -1;
 
-    frequency_bins = (float *)malloc((audio_sample_count / 2) * sizeof(float));
+    if (window < AUDIO_WINDOW_RECTANGULAR || window > AUDIO_WINDOW_FLAT_TOP)
+        return -1;
 
-    if (frequency_bins == NULL) {
-        free(audio_sample_buffer);
+    // Needs its targets, see audio_init_goertzel
+    if (engine == AUDIO_ENGINE_GOERTZEL)
         return -1;
-    }
 
-#ifdef AUDIO_ENVELOPE
-    envelope = (float *)malloc(audio_sample_count * sizeof(float));
+    this->engine = engine;
 
-    if (envelope == NULL) {
-        free(audio_sample_buffer);
-        free(frequency_bins);
+    // Q15 samples, ring and table entries are the only ones narrower than 4
+    // bytes, a power of 2 of them keeps the floats after them aligned. Without
+    // overlap every window is converted straight from the i2s words, no ring
+    mem = arena_alloc(arena,
+                      audio_sample_count * sample_size(engine) +
+                          ring_count * sample_size(engine) +
+                          (audio_sample_count / 2) * sizeof(float) +
+                          audio_sample_count * sizeof(float) +
+                          audio_sample_count * sample_size(engine),
+                      ARENA_ALIGN);
+
+    if (mem == NULL)
+        return -1;
+
+    // After mem, so deinit gives both back latest first
+    if (init_fft(this, arena, audio_sample_count) < 0) {
+        arena_free(arena, mem);
         return -1;
     }
 
-    generate_envelope(envelope, audio_sample_count);
-#endif
+    this->audio_sample_count = audio_sample_count;
+    this->hop_count = hop_count;
+    this->audio_sample_buffer = mem;
+    this->ring =
+        ring_count ? mem + audio_sample_count * sample_size(engine) : NULL;
+    this->ring_head = 0;
+    this->frequency_bins =
+        (float *)(mem + audio_sample_count * sample_size(engine) +
+                  ring_count * sample_size(engine));
+    this->window_kind = window;
+    this->window = this->frequency_bins + audio_sample_count / 2;
+    this->table = this->window + audio_sample_count;
+    this->mem = mem;
+    this->arena = arena;
+
+    if (ring_count)
+        memset(this->ring, 0, ring_count * sample_size(engine));
+
+    generate_window(this->window, audio_sample_count, window);
+    build_table(this, 1.f);
+
+    return 1;
+}
+
+/**
+ * @brief Signed 24-bit align a raw i2s word
+ */
+static inline int32_t sanitize_sample(int32_t sample) {
+    return (sample << 1) >> 8;
+}
+
+int audio_init_goertzel(audio_t *this, arena_t *arena,
+                        size_t audio_sample_count, size_t hop_count,
+                        audio_window_t window, const float *target_hz,
+                        size_t target_count, float sample_rate) {
+    // Room for every resonator the window may need, and the gain
+    size_t snapshot_size =
+        target_count * GOERTZEL_MAX_TAPS * 2 * sizeof(float) + sizeof(float);
+    uint16_t *bins;
+    uint8_t *mem;
+    long bin;
+
+    if (hop_count == 0 || hop_count > audio_sample_count ||
+        audio_sample_count % hop_count != 0 || target_count == 0 ||
+        sample_rate <= 0.f)
+        return -1;
 
-    if (!fft_init(&this->fft, audio_sample_count)) {
-        free(audio_sample_buffer);
-        free(frequency_bins);
-#ifdef AUDIO_ENVELOPE
-        free(envelope);
-#endif
+    if (window < AUDIO_WINDOW_RECTANGULAR || window > AUDIO_WINDOW_FLAT_TOP)
+        return -1;
+
+    // Snapshot, frequency bins, then the ring. The comb needs the word
+    // leaving the window even without overlap
+    mem = arena_alloc(arena,
+                      snapshot_size + target_count * sizeof(float) +
+                          audio_sample_count * sizeof(int32_t),
+                      ARENA_ALIGN);
+
+    if (mem == NULL)
+        return -1;
+
+    // The frequency bins are not written before the first frame, the bins
+    // only need to last until goertzel_init copies them
+    bins = (uint16_t *)(mem + snapshot_size);
+
+    // Nearest bin of the window, the comb only cancels whole bins
+    for (size_t i = 0; i < target_count; i++) {
+        bin = lroundf(target_hz[i] * audio_sample_count / sample_rate);
+        bins[i] = (uint16_t)(bin < 0 ? 0
+                             : (size_t)bin > audio_sample_count / 2
+                                 ? audio_sample_count / 2
+                                 : (size_t)bin);
+    }
+
+    if (goertzel_init(&this->goertzel, arena, audio_sample_count, hop_count,
+                      bins, target_count, window_coefficients[window],
+                      window_term_count(window)) < 0) {
+        arena_free(arena, mem);
         return -1;
     }
 
     this->audio_sample_count = audio_sample_count;
-    this->audio_sample_buffer = audio_sample_buffer;
-    this->frequency_bins = frequency_bins;
-#ifdef AUDIO_ENVELOPE
-    this->envelope = envelope;
-#endif
+    this->hop_count = hop_count;
+    this->engine = AUDIO_ENGINE_GOERTZEL;
+    this->audio_sample_buffer = mem;
+    this->frequency_bins = (float *)(mem + snapshot_size);
+    this->ring = this->frequency_bins + target_count;
+    this->ring_head = 0;
+    this->mem = mem;
+    this->arena = arena;
+    this->window_kind = window;
+    // Windowed in the frequency domain, nothing to multiply per sample
+    this->window = NULL;
+    this->table = NULL;
+    this->table_gain = 1.f;
+    this->table_headroom = 0;
+
+    memset(this->ring, 0, audio_sample_count * sizeof(int32_t));
 
     return 1;
 }
 
-void audio_feed_i2s(audio_t *this, const int32_t *samples) {
-    for (size_t i = 0; i < this->audio_sample_count; i++) {
-        // Extract the sample
-        int32_t sample = samples[i];
+/**
+ * @brief Bring freshly reset resonators up to date, the window in the ring
+ * goes in oldest first and without comb, nothing is leaving it yet.
+ */
+static void prime_goertzel(audio_t *this) {
+    const int32_t *ring = this->ring;
+    goertzel_t *goertzel = &this->goertzel;
+    size_t count = this->audio_sample_count, done, block;
 
-        // Signed 24-bit align
-        sample = (sample << 1) >> 8;
+    for (done = 0; done < count; done += block) {
+        block = count - done < goertzel->block_count ? count - done
+                                                     : goertzel->block_count;
 
-        // Scale and put
-        this->audio_sample_buffer[i] = (float)sample / (float)0x000FFFFF;
+        for (size_t i = 0; i < block; i++)
+            goertzel->input[i] = (float)sanitize_sample(
+                ring[(this->ring_head + done + i) % count]);
+
+        goertzel_update(goertzel, block);
     }
 }
 
-#ifdef AUDIO_ENVELOPE
-void audio_envelope(audio_t *this) {
-    for (size_t i = 0; i < this->audio_sample_count; i++)
-        this->audio_sample_buffer[i] *= this->envelope[i];
+void audio_set_window(audio_t *this, audio_window_t window) {
+    if (window < AUDIO_WINDOW_RECTANGULAR || window > AUDIO_WINDOW_FLAT_TOP)
+        return;
+
+    this->window_kind = window;
+
+    if (this->engine == AUDIO_ENGINE_GOERTZEL) {
+        goertzel_set_window(&this->goertzel, window_coefficients[window],
+                            window_term_count(window));
+        prime_goertzel(this);
+        return;
+    }
+
+    generate_window(this->window, this->audio_sample_count, window);
+    build_table(this, this->table_gain);
 }
-#endif
 
-void audio_gain(audio_t *this, float gain) {
-    for (size_t i = 0; i < this->audio_sample_count; i++)
-        this->audio_sample_buffer[i] *= gain;
+audio_window_t audio_get_window(audio_t *this) { return this->window_kind; }
+
+static fft_output_t *active_output(audio_t *this) {
+    switch (this->engine) {
+    case AUDIO_ENGINE_Q15:
+        return &this->fft_q15.output;
+    case AUDIO_ENGINE_Q31:
+        return &this->fft_q31.output;
+    case AUDIO_ENGINE_GOERTZEL:
+        return &this->goertzel.output;
+    default:
+        return &this->fft.output;
+    }
 }
 
-void audio_fft(audio_t *this) {
-    fft_rad2_dif(&this->fft, this->audio_sample_buffer, this->frequency_bins);
+void audio_set_output(audio_t *this, fft_output_mode_t mode, float floor_db) {
+    if (mode < FFT_OUTPUT_MAGNITUDE || mode > FFT_OUTPUT_LOG ||
+        !(floor_db < 0.f))
+        return;
+
+    *active_output(this) = (fft_output_t){
+        .mode = mode,
+        .floor_db = floor_db,
+    };
+}
+
+fft_output_t audio_get_output(audio_t *this) { return *active_output(this); }
+
+int audio_set_kernel(audio_t *this, fft_kernel_t kernel) {
+    if (kernel < FFT_KERNEL_RADIX2 || kernel > FFT_KERNEL_RADIX2_PLANAR)
+        return -1;
+
+    if (this->engine != AUDIO_ENGINE_FLOAT)
+        return kernel == FFT_KERNEL_RADIX2 ? 1 : -1;
+
+    this->fft.kernel = kernel;
+
+    return 1;
+}
+
+fft_kernel_t audio_get_kernel(audio_t *this) {
+    return this->engine == AUDIO_ENGINE_FLOAT ? this->fft.kernel
+                                              : FFT_KERNEL_RADIX2;
+}
+
+/**
+ * @brief Float samples for the planar kernel, even window positions to the
+ * first half of the buffer and odd ones to the second, two at a time.
+ */
+static void convert_span_planar(audio_t *this, float *sample_buffer,
+                                size_t first, const int32_t *words,
+                                size_t count) {
+    float *even = sample_buffer, *odd = even + this->audio_sample_count / 2;
+    const float *table = (const float *)this->table + first;
+    size_t pair_count;
+
+    // Start on an even position, the pairs then index both halves alike
+    if (first % 2 && count) {
+        odd[first / 2] = (float)sanitize_sample(words[0]) * table[0];
+        words++;
+        table++;
+        first++;
+        count--;
+    }
+
+    even += first / 2;
+    odd += first / 2;
+    pair_count = count / 2;
+
+    for (size_t i = 0; i < pair_count; i++) {
+        even[i] = (float)sanitize_sample(words[2 * i]) * table[2 * i];
+        odd[i] = (float)sanitize_sample(words[2 * i + 1]) * table[2 * i + 1];
+    }
+
+    if (count % 2)
+        even[pair_count] =
+            (float)sanitize_sample(words[count - 1]) * table[count - 1];
+}
+
+/**
+ * @brief The whole front end in one pass, for windows without overlap. Raw
+ * i2s words in, windowed, gained and normalized samples out, a multiply by
+ * the table per sample.
+ *
+ * @param first First sample of the window the words land on
+ */
+static void convert_span(audio_t *this, void *sample_buffer, size_t first,
+                         const int32_t *words, size_t count) {
+    int16_t *buffer_q15 = (int16_t *)sample_buffer + first;
+    int32_t *buffer_q31 = (int32_t *)sample_buffer + first;
+    float *buffer_f = (float *)sample_buffer + first;
+    const int16_t *table_q15 = (const int16_t *)this->table + first;
+    const int32_t *table_q31 = (const int32_t *)this->table + first;
+    const float *table_f = (const float *)this->table + first;
+    int shift;
+
+    switch (this->engine) {
+    case AUDIO_ENGINE_Q15:
+        // Top 16 of the 24 bits
+        shift = 15 - this->table_headroom;
+
+        for (size_t i = 0; i < count; i++)
+            buffer_q15[i] = saturate_q15(
+                ((sanitize_sample(words[i]) >> 8) * table_q15[i]) >> shift);
+        break;
+    case AUDIO_ENGINE_Q31:
+        // 24 bits left aligned, the 8 bit shift folded into the table's
+        shift = 31 - 8 - this->table_headroom;
+
+        for (size_t i = 0; i < count; i++)
+            buffer_q31[i] = saturate_q31(
+                ((int64_t)sanitize_sample(words[i]) * table_q31[i]) >> shift);
+        break;
+    default:
+        if (this->fft.kernel == FFT_KERNEL_RADIX2_PLANAR) {
+            convert_span_planar(this, sample_buffer, first, words, count);
+            break;
+        }
+
+        for (size_t i = 0; i < count; i++)
+            buffer_f[i] = (float)sanitize_sample(words[i]) * table_f[i];
+        break;
+    }
+}
+
+/**
+ * @brief Convert one hop of raw i2s words into the ring, over the oldest
+ * samples. Only the conversion the window position does not change, the
+ * table multiply is left to stage_window.
+ */
+static void push_hop(audio_t *this, const int32_t *samples) {
+    int16_t *ring_q15 = (int16_t *)this->ring + this->ring_head;
+    int32_t *ring_q31 = (int32_t *)this->ring + this->ring_head;
+    float *ring_f = (float *)this->ring + this->ring_head;
+
+    switch (this->engine) {
+    case AUDIO_ENGINE_Q15:
+        // Top 16 of the 24 bits, as convert_span
+        for (size_t i = 0; i < this->hop_count; i++)
+            ring_q15[i] = (int16_t)(sanitize_sample(samples[i]) >> 8);
+        break;
+    case AUDIO_ENGINE_Q31:
+        for (size_t i = 0; i < this->hop_count; i++)
+            ring_q31[i] = sanitize_sample(samples[i]);
+        break;
+    case AUDIO_ENGINE_GOERTZEL:
+        // The resonators take the raw words, see front_end_goertzel
+        memcpy(ring_q31, samples, this->hop_count * sizeof(int32_t));
+        break;
+    default:
+        for (size_t i = 0; i < this->hop_count; i++)
+            ring_f[i] = (float)sanitize_sample(samples[i]);
+        break;
+    }
+
+    // The head now points at the oldest sample again
+    this->ring_head = (this->ring_head + this->hop_count) %
+                      this->audio_sample_count;
+}
+
+/**
+ * @brief stage_span for the planar kernel, the same even and odd split as
+ * convert_span_planar.
+ */
+static void stage_span_planar(audio_t *this, float *sample_buffer,
+                              size_t first, const float *ring,
+                              size_t count) {
+    float *even = sample_buffer, *odd = even + this->audio_sample_count / 2;
+    const float *table = (const float *)this->table + first;
+    size_t pair_count;
+
+    if (first % 2 && count) {
+        odd[first / 2] = ring[0] * table[0];
+        ring++;
+        table++;
+        first++;
+        count--;
+    }
+
+    even += first / 2;
+    odd += first / 2;
+    pair_count = count / 2;
+
+    for (size_t i = 0; i < pair_count; i++) {
+        even[i] = ring[2 * i] * table[2 * i];
+        odd[i] = ring[2 * i + 1] * table[2 * i + 1];
+    }
+
+    if (count % 2)
+        even[pair_count] = ring[count - 1] * table[count - 1];
+}
+
+/**
+ * @brief Window, gain and normalize ring samples push_hop converted, a
+ * multiply by the table per sample and nothing else.
+ *
+ * @param first First sample of the window the ring samples land on
+ * @param offset First ring sample
+ */
+static void stage_span(audio_t *this, void *sample_buffer, size_t first,
+                       size_t offset, size_t count) {
+    int16_t *buffer_q15 = (int16_t *)sample_buffer + first;
+    int32_t *buffer_q31 = (int32_t *)sample_buffer + first;
+    float *buffer_f = (float *)sample_buffer + first;
+    const int16_t *ring_q15 = (const int16_t *)this->ring + offset;
+    const int32_t *ring_q31 = (const int32_t *)this->ring + offset;
+    const float *ring_f = (const float *)this->ring + offset;
+    const int16_t *table_q15 = (const int16_t *)this->table + first;
+    const int32_t *table_q31 = (const int32_t *)this->table + first;
+    const float *table_f = (const float *)this->table + first;
+    int shift;
+
+    switch (this->engine) {
+    case AUDIO_ENGINE_Q15:
+        shift = 15 - this->table_headroom;
+
+        for (size_t i = 0; i < count; i++)
+            buffer_q15[i] =
+                saturate_q15((ring_q15[i] * table_q15[i]) >> shift);
+        break;
+    case AUDIO_ENGINE_Q31:
+        shift = 31 - 8 - this->table_headroom;
+
+        for (size_t i = 0; i < count; i++)
+            buffer_q31[i] =
+                saturate_q31(((int64_t)ring_q31[i] * table_q31[i]) >> shift);
+        break;
+    default:
+        if (this->fft.kernel == FFT_KERNEL_RADIX2_PLANAR) {
+            stage_span_planar(this, sample_buffer, first, ring_f, count);
+            break;
+        }
+
+        for (size_t i = 0; i < count; i++)
+            buffer_f[i] = ring_f[i] * table_f[i];
+        break;
+    }
+}
+
+/**
+ * @brief Stage the window in the ring into the sample buffer, oldest sample
+ * first, in two straight runs rather than wrapping the index of every
+ * sample.
+ */
+static void stage_window(audio_t *this, void *sample_buffer) {
+    size_t count = this->audio_sample_count, head = this->ring_head;
+
+    stage_span(this, sample_buffer, 0, head, count - head);
+    stage_span(this, sample_buffer, count - head, 0, head);
+}
+
+/**
+ * @brief Advance the resonators by one hop and snapshot them. The gain is
+ * applied to the bins instead, so the comb keeps cancelling words that went
+ * in under another gain.
+ */
+static void front_end_goertzel(audio_t *this, void *sample_buffer,
+                               const int32_t *samples, float gain) {
+    const int32_t *leaving = (const int32_t *)this->ring + this->ring_head;
+    goertzel_t *goertzel = &this->goertzel;
+    float comb = goertzel->comb;
+
+    for (size_t i = 0; i < this->hop_count; i++)
+        goertzel->input[i] = (float)sanitize_sample(samples[i]) -
+                             comb * (float)sanitize_sample(leaving[i]);
+
+    goertzel_update(goertzel, this->hop_count);
+    push_hop(this, samples);
+
+    goertzel_snapshot(goertzel, sample_buffer);
+    memcpy((uint8_t *)sample_buffer + goertzel_state_size(goertzel), &gain,
+           sizeof(gain));
+}
+
+static void run_fft(audio_t *this, void *sample_buffer) {
+    float gain;
+
+    switch (this->engine) {
+    case AUDIO_ENGINE_Q15:
+        fft_rad2_dif_real_q15(&this->fft_q15, sample_buffer,
+                              this->frequency_bins);
+        break;
+    case AUDIO_ENGINE_Q31:
+        fft_rad2_dif_real_q31(&this->fft_q31, sample_buffer,
+                              this->frequency_bins);
+        break;
+    case AUDIO_ENGINE_GOERTZEL:
+        memcpy(&gain,
+               (const uint8_t *)sample_buffer +
+                   goertzel_state_size(&this->goertzel),
+               sizeof(gain));
+        // Same scale as the float engine, 20 bits of amplitude and 1/(N/2)
+        goertzel_spectrum(&this->goertzel, sample_buffer,
+                          gain * 2.f /
+                              ((float)this->audio_sample_count * 0x000FFFFF),
+                          this->frequency_bins);
+        break;
+    default:
+        fft_rad2_dif_real(&this->fft, sample_buffer, this->frequency_bins);
+        break;
+    }
+}
+
+void audio_feed_i2s(audio_t *this, const int32_t *samples, float gain) {
+    audio_front_end(this, this->audio_sample_buffer, samples, gain);
+}
+
+void audio_fft(audio_t *this) { run_fft(this, this->audio_sample_buffer); }
+
+size_t audio_required_sample_buffer_size(audio_t *this) {
+    if (this->engine == AUDIO_ENGINE_GOERTZEL)
+        return goertzel_state_size(&this->goertzel) + sizeof(float);
+
+    return this->audio_sample_count * sample_size(this->engine);
+}
+
+void audio_front_end(audio_t *this, void *sample_buffer,
+                     const int32_t *samples, float gain) {
+    if (this->engine == AUDIO_ENGINE_GOERTZEL) {
+        front_end_goertzel(this, sample_buffer, samples, gain);
+        return;
+    }
+
+    // A handful of multiplies per sample, only when the gain moves
+    if (gain != this->table_gain)
+        build_table(this, gain);
+
+    if (this->ring == NULL) {
+        convert_span(this, sample_buffer, 0, samples,
+                     this->audio_sample_count);
+        return;
+    }
+
+    // Only the new hop is converted, the rest of the window is in the ring
+    push_hop(this, samples);
+    stage_window(this, sample_buffer);
+}
+
+void audio_fft_buffer(audio_t *this, void *sample_buffer) {
+    run_fft(this, sample_buffer);
 }
 
 const float *audio_get_frequency_bins(audio_t *this) {
@@ -100,11 +682,16 @@ const float *audio_get_frequency_bins(audio_t *this) {
 }
 
 size_t audio_get_frequency_bin_count(audio_t *this) {
+    if (this->engine == AUDIO_ENGINE_GOERTZEL)
+        return this->goertzel.target_count;
+
     return this->audio_sample_count / 2;
 }
 
+size_t audio_get_hop_count(audio_t *this) { return this->hop_count; }
+
 void audio_deinit(audio_t *this) {
-    free(this->audio_sample_buffer);
-    free(this->frequency_bins);
-    fft_deinit(&this->fft);
+    // The transform came out of the arena after mem
+    deinit_fft(this);
+    arena_free(this->arena, this->mem);
 }
@@ -2,29 +2,163 @@
 #define AUDIO_H
 
 #include "fft.h"
-#include <pico/types.h>
+#include "goertzel.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Transform engine backing the analysis. The fixed-point engines avoid the
+ * soft-float routines entirely on cores without an FPU.
+ */
+typedef enum {
+    AUDIO_ENGINE_FLOAT,
+    AUDIO_ENGINE_Q15,
+    AUDIO_ENGINE_Q31,
+    // Sliding Goertzel over a few target bins rather than the whole
+    // spectrum, see audio_init_goertzel
+    AUDIO_ENGINE_GOERTZEL,
+} audio_engine_t;
+
+/**
+ * Analysis window. Hann is the all-rounder, Blackman-Harris trades a wider
+ * main lobe for sidelobes down at -92 dB, flat-top reads peak amplitudes
+ * accurately at the cost of resolution.
+ */
+typedef enum {
+    AUDIO_WINDOW_RECTANGULAR,
+    AUDIO_WINDOW_HANN,
+    AUDIO_WINDOW_BLACKMAN_HARRIS,
+    AUDIO_WINDOW_FLAT_TOP,
+} audio_window_t;
 
 typedef struct {
+    // Window length, the transform size
     size_t audio_sample_count;
-    float complex *audio_sample_buffer;
+    // New samples per frame, the window slides by this much
+    size_t hop_count;
+    audio_engine_t engine;
+    // Last audio_sample_count samples, oldest at ring_head. Sanitized but not
+    // windowed, in the table's type, raw i2s words for Goertzel. NULL when
+    // hop_count == audio_sample_count, unless the engine is Goertzel
+    void *ring;
+    size_t ring_head;
+    // Real float, Q15 or Q31 samples based on engine. Goertzel keeps a
+    // snapshot of its resonators there
+    void *audio_sample_buffer;
     float *frequency_bins;
-#ifdef AUDIO_ENVELOPE
-    float *envelope;
-#endif
-    fft_t fft;
+    audio_window_t window_kind;
+    float *window;
+    // window x normalization x gain, float, Q15 or Q31 based on engine. The
+    // fixed-point ones are scaled down by 2^table_headroom to fit the gain
+    void *table;
+    float table_gain;
+    int table_headroom;
+    union {
+        fft_real_t fft;
+        fft_real_q15_t fft_q15;
+        fft_real_q31_t fft_q31;
+        goertzel_t goertzel;
+    };
+    // Every buffer above in a single allocation
+    void *mem;
+    arena_t *arena;
 } audio_t;
 
-int audio_init(audio_t *this, size_t audio_sample_count);
-void audio_feed_i2s(audio_t *context, const int32_t *samples);
+// One real sample, ring or table entry, every engine runs a real-input
+// transform
+#define AUDIO_SAMPLE_SIZE(engine)                                              \
+    ((engine) == AUDIO_ENGINE_Q15   ? sizeof(int16_t)                          \
+     : (engine) == AUDIO_ENGINE_Q31 ? sizeof(int32_t)                          \
+                                    : sizeof(float))
 
-#ifdef AUDIO_ENVELOPE
-void audio_envelope(audio_t *this);
-#endif
+/**
+ * Arena bytes audio_init_stft takes, the transform included. audio_init
+ * takes the same with hop_count == audio_sample_count.
+ */
+#define AUDIO_FOOTPRINT(audio_sample_count, hop_count, engine)                 \
+    (ARENA_FOOTPRINT(                                                          \
+         (audio_sample_count) *                                                \
+             (2 * AUDIO_SAMPLE_SIZE(engine) + sizeof(float)) +                 \
+         ((hop_count) < (audio_sample_count) ? (audio_sample_count) : 0) *     \
+             AUDIO_SAMPLE_SIZE(engine) +                                       \
+         (audio_sample_count) / 2 * sizeof(float)) +                           \
+     ((engine) == AUDIO_ENGINE_Q15                                             \
+          ? FFT_REAL_Q15_FOOTPRINT(audio_sample_count)                         \
+      : (engine) == AUDIO_ENGINE_Q31                                           \
+          ? FFT_REAL_Q31_FOOTPRINT(audio_sample_count)                         \
+          : FFT_REAL_FOOTPRINT(audio_sample_count)))
+
+// Arena bytes audio_init_goertzel takes, the resonators included
+#define AUDIO_GOERTZEL_FOOTPRINT(audio_sample_count, hop_count, target_count)  \
+    (ARENA_FOOTPRINT((target_count) * GOERTZEL_MAX_TAPS * 2 * sizeof(float) + \
+                     sizeof(float) + (target_count) * sizeof(float) +          \
+                     (audio_sample_count) * sizeof(int32_t)) +                 \
+     GOERTZEL_FOOTPRINT(hop_count, target_count))
+
+int audio_init(audio_t *this, arena_t *arena, size_t audio_sample_count,
+               audio_engine_t engine, audio_window_t window);
 
-void audio_gain(audio_t *this, float gain);
+/**
+ * @brief Sliding window analysis. Every feed takes hop_count new samples
+ * and transforms the latest audio_sample_count of them, so the window length
+ * and the frame rate are set independently. hop_count must divide
+ * audio_sample_count, e.g. 512 and 64 for 87.5% overlap.
+ */
+int audio_init_stft(audio_t *this, arena_t *arena, size_t audio_sample_count,
+                    size_t hop_count, audio_engine_t engine,
+                    audio_window_t window);
+
+/**
+ * @brief Only the bins nearest to target_hz are worked out, one frequency
+ * bin per target in that order. The resonators advance with every sample,
+ * so a frame costs in proportion to hop_count and the number of targets,
+ * not to the window length. Cheaper than the transform for a handful of
+ * targets, see the goertzel bench for where it stops paying off.
+ */
+int audio_init_goertzel(audio_t *this, arena_t *arena,
+                        size_t audio_sample_count, size_t hop_count,
+                        audio_window_t window, const float *target_hz,
+                        size_t target_count, float sample_rate);
+
+void audio_set_window(audio_t *this, audio_window_t window);
+audio_window_t audio_get_window(audio_t *this);
+
+/**
+ * @brief What the frequency bins hold, magnitudes unless told otherwise.
+ * floor_db must be negative, only FFT_OUTPUT_LOG uses it.
+ */
+void audio_set_output(audio_t *this, fft_output_mode_t mode, float floor_db);
+fft_output_t audio_get_output(audio_t *this);
+
+/**
+ * @brief Transform kernel of the float engine, the fixed-point engines are
+ * radix-2 only. The front end writes the layout of the kernel, planar or
+ * interleaved, so set it before the first frame is staged.
+ *
+ * @return int -1 if the engine has no such kernel, 1 otherwise
+ */
+int audio_set_kernel(audio_t *this, fft_kernel_t kernel);
+fft_kernel_t audio_get_kernel(audio_t *this);
+
+/**
+ * @brief Takes hop_count raw i2s words of a single channel and converts,
+ * windows and gains the window in a single pass.
+ */
+void audio_feed_i2s(audio_t *this, const int32_t *samples, float gain);
 void audio_fft(audio_t *this);
+/**
+ * Stages on a caller owned sample buffer, so the front end of the next frame
+ * can run on one core while the other transforms the current one. Only the
+ * frequency bins of the audio are written, and only by audio_fft_buffer.
+ */
+size_t audio_required_sample_buffer_size(audio_t *this);
+void audio_front_end(audio_t *this, void *sample_buffer,
+                     const int32_t *samples, float gain);
+void audio_fft_buffer(audio_t *this, void *sample_buffer);
+
 const float *audio_get_frequency_bins(audio_t *this);
 size_t audio_get_frequency_bin_count(audio_t *this);
+size_t audio_get_hop_count(audio_t *this);
 void audio_deinit(audio_t *this);
 
 #endif
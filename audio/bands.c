@@ -0,0 +1,257 @@
+#include "bands.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+static inline float hz_to_mel(float hz) {
+    return 2595.f * log10f(1.f + hz / 700.f);
+}
+
+static inline float mel_to_hz(float mel) {
+    return 700.f * (powf(10.f, mel / 2595.f) - 1.f);
+}
+
+static inline bool is_rectangular(bands_spacing_t spacing) {
+    return spacing != BANDS_SPACING_MEL;
+}
+
+static size_t band_count(const bands_config_t *config) {
+    float octaves = log2f(config->max_hz / config->min_hz);
+
+    switch (config->spacing) {
+    case BANDS_SPACING_OCTAVE:
+        return (size_t)octaves;
+    case BANDS_SPACING_THIRD_OCTAVE:
+        return (size_t)(octaves * 3.f);
+    default:
+        return config->band_count;
+    }
+}
+
+/**
+ * @brief Frequency of band edge i, 0 <= i <= count. Mel triangles need
+ * count + 2 edges, i.e. start, center and end of every band.
+ */
+static float band_edge(const bands_config_t *config, size_t count, size_t i) {
+    float min_mel, max_mel;
+
+    switch (config->spacing) {
+    case BANDS_SPACING_OCTAVE:
+        return config->min_hz * exp2f((float)i);
+    case BANDS_SPACING_THIRD_OCTAVE:
+        return config->min_hz * exp2f(i / 3.f);
+    case BANDS_SPACING_MEL:
+        min_mel = hz_to_mel(config->min_hz);
+        max_mel = hz_to_mel(config->max_hz);
+        return mel_to_hz(min_mel + (max_mel - min_mel) * i / (count + 1));
+    default:
+        return config->min_hz *
+               powf(config->max_hz / config->min_hz, (float)i / count);
+    }
+}
+
+static size_t clamp_bin(float bin, size_t bin_count) {
+    if (bin < 0.f)
+        return 0;
+
+    if (bin >= (float)bin_count)
+        return bin_count - 1;
+
+    return (size_t)bin;
+}
+
+/**
+ * @brief Bin range of every band, the weights of the mel triangles go to
+ * weights when not NULL.
+ *
+ * @return size_t Total number of weights
+ */
+static size_t build_table(bands_t *this, const bands_config_t *config,
+                          float *weights) {
+    float bin_hz = config->sample_rate / (2.f * config->bin_count);
+    size_t total = 0;
+
+    for (size_t band = 0; band < this->band_count; band++) {
+        float low = band_edge(config, this->band_count, band) / bin_hz;
+        float high = band_edge(config, this->band_count, band + 1) / bin_hz;
+        size_t start, end;
+
+        if (!is_rectangular(config->spacing)) {
+            float center = high, sum = 0.f;
+
+            high = band_edge(config, this->band_count, band + 2) / bin_hz;
+            start = clamp_bin(ceilf(low), config->bin_count);
+            end = clamp_bin(floorf(high), config->bin_count) + 1;
+
+            // Triangle between two bins, fall back to the closest one
+            if (end <= start || ceilf(low) > floorf(high)) {
+                start = clamp_bin(roundf(center), config->bin_count);
+                end = start + 1;
+            }
+
+            if (weights != NULL) {
+                for (size_t bin = start; bin < end; bin++) {
+                    float weight = bin <= center
+                                       ? (bin - low) / (center - low)
+                                       : (high - bin) / (high - center);
+
+                    weights[total + bin - start] = weight > 0.f ? weight : 0.f;
+                    sum += weights[total + bin - start];
+                }
+
+                for (size_t bin = start; bin < end; bin++)
+                    weights[total + bin - start] =
+                        sum > 0.f ? weights[total + bin - start] / sum
+                                  : 1.f / (end - start);
+            }
+        } else {
+            start = clamp_bin(roundf(low), config->bin_count);
+            end = (size_t)roundf(high);
+
+            if (end > config->bin_count)
+                end = config->bin_count;
+
+            // Narrower than a bin
+            if (end <= start)
+                end = start + 1;
+
+            this->band_scale[band] = 1.f / (end - start);
+        }
+
+        this->band_start[band] = (uint16_t)start;
+        this->band_width[band] = (uint16_t)(end - start);
+        total += end - start;
+
+        if (end > this->used_bin_count)
+            this->used_bin_count = end;
+    }
+
+    return total;
+}
+
+int bands_init(bands_t *this, arena_t *arena, const bands_config_t *config) {
+    size_t count = band_count(config), weight_count;
+    bool rectangular = is_rectangular(config->spacing);
+    void *mem;
+    float *floats;
+
+    if (count == 0 || config->bin_count < 2 || config->bin_count > UINT16_MAX ||
+        config->min_hz <= 0.f || config->max_hz <= config->min_hz ||
+        config->sample_rate <= 0.f)
+        return -1;
+
+    // Floats first, they have the stricter alignment
+    mem = arena_alloc(arena,
+                      count * sizeof(float) +
+                          (rectangular ? count + config->bin_count + 1 : 0) *
+                              sizeof(float) +
+                          2 * count * sizeof(uint16_t),
+                      ARENA_ALIGN);
+
+    if (mem == NULL)
+        return -1;
+
+    floats = (float *)mem;
+
+    this->spacing = config->spacing;
+    this->band_count = count;
+    this->bin_count = config->bin_count;
+    this->bands = floats;
+    floats += count;
+
+    if (rectangular) {
+        this->band_scale = floats;
+        this->prefix = floats + count;
+        floats += count + config->bin_count + 1;
+    } else {
+        this->band_scale = NULL;
+        this->prefix = NULL;
+    }
+
+    this->band_start = (uint16_t *)floats;
+    this->band_width = this->band_start + count;
+    this->weights = NULL;
+    this->used_bin_count = 0;
+    this->mem = mem;
+    this->arena = arena;
+
+    // Sizing pass, then the mel weights for real
+    weight_count = build_table(this, config, NULL);
+
+    if (!rectangular) {
+        this->weights = (float *)arena_alloc(
+            arena, weight_count * sizeof(float), ARENA_ALIGN);
+
+        if (this->weights == NULL) {
+            arena_free(arena, mem);
+            return -1;
+        }
+
+        build_table(this, config, this->weights);
+    }
+
+    for (size_t band = 0; band < count; band++)
+        this->bands[band] = 0.f;
+
+    return 1;
+}
+
+size_t bands_centers(const bands_config_t *config, float *centers_hz) {
+    size_t count = band_count(config);
+
+    if (config->min_hz <= 0.f || config->max_hz <= config->min_hz)
+        return 0;
+
+    for (size_t band = 0; centers_hz != NULL && band < count; band++)
+        centers_hz[band] =
+            is_rectangular(config->spacing)
+                ? sqrtf(band_edge(config, count, band) *
+                        band_edge(config, count, band + 1))
+                : band_edge(config, count, band + 1);
+
+    return count;
+}
+
+void bands_aggregate(bands_t *this, const float *frequency_bins) {
+    const uint16_t *start = this->band_start, *width = this->band_width;
+
+    if (is_rectangular(this->spacing)) {
+        float *prefix = this->prefix, sum = 0.f;
+
+        prefix[0] = 0.f;
+
+        for (size_t bin = 0; bin < this->used_bin_count; bin++) {
+            sum += frequency_bins[bin];
+            prefix[bin + 1] = sum;
+        }
+
+        for (size_t band = 0; band < this->band_count; band++)
+            this->bands[band] =
+                (prefix[start[band] + width[band]] - prefix[start[band]]) *
+                this->band_scale[band];
+    } else {
+        const float *weight = this->weights;
+
+        for (size_t band = 0; band < this->band_count; band++) {
+            const float *bins = frequency_bins + start[band];
+            float sum = 0.f;
+
+            for (size_t i = 0; i < width[band]; i++)
+                sum += bins[i] * weight[i];
+
+            this->bands[band] = sum;
+            weight += width[band];
+        }
+    }
+}
+
+const float *bands_get(bands_t *this) { return this->bands; }
+
+size_t bands_get_count(bands_t *this) { return this->band_count; }
+
+void bands_deinit(bands_t *this) {
+    // Latest first, so an arena gets both back
+    arena_free(this->arena, this->weights);
+    arena_free(this->arena, this->mem);
+}
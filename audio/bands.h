@@ -0,0 +1,91 @@
+#ifndef BANDS_H
+#define BANDS_H
+
+#include "arena.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    // band_count bands, equal width on a log frequency axis
+    BANDS_SPACING_LOG,
+    // One band per octave, the count follows from the range
+    BANDS_SPACING_OCTAVE,
+    // Three bands per octave, the count follows from the range
+    BANDS_SPACING_THIRD_OCTAVE,
+    // band_count overlapping triangles, equal width on the mel scale
+    BANDS_SPACING_MEL,
+} bands_spacing_t;
+
+typedef struct {
+    bands_spacing_t spacing;
+    // Ignored by the octave spacings
+    size_t band_count;
+    float min_hz;
+    float max_hz;
+    float sample_rate;
+    // Frequency bins fed per frame, half the FFT window
+    size_t bin_count;
+} bands_config_t;
+
+/**
+ * Aggregates linear FFT bins into perceptual bands through a table built
+ * once at init. The rectangular spacings (log, octaves) take the mean of
+ * their bins off a prefix sum, the mel triangles a weighted sum over their
+ * few bins, either way a single pass per frame with no division.
+ *
+ * Bands narrower than a bin still get the closest bin, so every band is
+ * live even at the bottom of a small window.
+ */
+typedef struct {
+    bands_spacing_t spacing;
+    size_t band_count;
+    size_t bin_count;
+    // First bin and number of bins of every band
+    uint16_t *band_start;
+    uint16_t *band_width;
+    // Rectangular spacings, 1 / band_width
+    float *band_scale;
+    // Mel, the weights of every band back to back, normalized to sum to 1
+    float *weights;
+    // Rectangular spacings, bin_count + 1 running sums
+    float *prefix;
+    // Bins past the last band are never looked at
+    size_t used_bin_count;
+    float *bands;
+    void *mem;
+    arena_t *arena;
+} bands_t;
+
+/**
+ * Arena bytes bands_init takes at most, band_count being what the config
+ * makes. Exact but for the mel weights, every bin is under two triangles at
+ * most, plus one for a triangle between two bins.
+ */
+#define BANDS_FOOTPRINT(spacing, band_count, bin_count)                        \
+    ((spacing) == BANDS_SPACING_MEL                                            \
+         ? ARENA_FOOTPRINT((band_count) * sizeof(float) +                      \
+                           2 * (band_count) * sizeof(uint16_t)) +              \
+               ARENA_FOOTPRINT((2 * (bin_count) + (band_count)) *              \
+                               sizeof(float))                                  \
+         : ARENA_FOOTPRINT((2 * (band_count) + (bin_count) + 1) *              \
+                               sizeof(float) +                                 \
+                           2 * (band_count) * sizeof(uint16_t)))
+
+int bands_init(bands_t *this, arena_t *arena, const bands_config_t *config);
+
+/**
+ * @brief Center frequency of every band the config makes, geometric for the
+ * rectangular spacings and the triangle peak for mel. Lets an engine that
+ * only works out a few bins land one on each band. bin_count is ignored.
+ *
+ * @param centers_hz Room for the band count, NULL to only count
+ * @return size_t Number of bands, 0 if the config is invalid
+ */
+size_t bands_centers(const bands_config_t *config, float *centers_hz);
+void bands_aggregate(bands_t *this, const float *frequency_bins);
+const float *bands_get(bands_t *this);
+size_t bands_get_count(bands_t *this);
+void bands_deinit(bands_t *this);
+
+#endif
@@ -0,0 +1,241 @@
+#include "goertzel.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Rounding errors fade out over this many windows, the oldest sample of a
+// window is weighted e^(-1/256), 0.4% under the newest
+#define DAMPING_WINDOWS 256
+
+static size_t fold_bin(long bin, size_t count) {
+    size_t folded = (size_t)(((bin % (long)count) + (long)count) %
+                             (long)count);
+
+    // cos(w) is even, X[-k] and X[N - k] share the resonator of X[k]
+    return folded <= count / 2 ? folded : count - folded;
+}
+
+/**
+ * @brief Below a quarter of the rate the resonator runs on v[n] - r v[n - 1],
+ * above on v[n] + r v[n - 1]. Either way the coefficient is a small number
+ * known to full precision instead of 2r cos(w) a hair under 2r, which puts
+ * the pole right where the comb expects it.
+ */
+static inline bool is_low_bin(size_t bin, size_t count) {
+    return 4 * bin <= count;
+}
+
+static uint16_t find_resonator(goertzel_t *this, size_t bin, float damping) {
+    float half_angle = (float)M_PI * bin / this->count;
+    size_t i;
+
+    for (i = 0; i < this->resonator_count; i++)
+        if (this->resonator_bins[i] == bin)
+            return (uint16_t)i;
+
+    this->resonator_bins[i] = (uint16_t)bin;
+
+    if (is_low_bin(bin, this->count)) {
+        this->coefficients[2 * i] =
+            4.f * damping * sinf(half_angle) * sinf(half_angle);
+        this->coefficients[2 * i + 1] = damping;
+    } else {
+        this->coefficients[2 * i] =
+            -4.f * damping * cosf(half_angle) * cosf(half_angle);
+        this->coefficients[2 * i + 1] = -damping;
+    }
+
+    this->resonator_count++;
+
+    return (uint16_t)i;
+}
+
+/**
+ * @brief Resonators and taps of a window. Term l of a cosine sum spreads to
+ * bins k - l and k + l with half its weight, the sign alternating.
+ */
+static void build_taps(goertzel_t *this, const float *terms,
+                       size_t term_count) {
+    float damping = this->damping;
+    long reach = (long)term_count - 1;
+
+    this->resonator_count = 0;
+    this->taps_per_target = 2 * term_count - 1;
+
+    for (size_t target = 0; target < this->target_count; target++) {
+        goertzel_tap_t *tap = this->taps + target * this->taps_per_target;
+
+        for (long l = -reach; l <= reach; l++, tap++) {
+            long bin = (long)this->bins[target] + l;
+            size_t term = (size_t)labs(l), folded = fold_bin(bin, this->count);
+            float weight = l == 0 ? terms[0]
+                                  : (term % 2 ? -0.5f : 0.5f) * terms[term];
+            float half_angle = (float)M_PI * bin / this->count;
+            float sign = is_low_bin(folded, this->count) ? 1.f : -1.f;
+            // cos(w) - sign, off the half angle so it keeps its precision
+            float re = sign > 0.f ? -2.f * sinf(half_angle) * sinf(half_angle)
+                                  : 2.f * cosf(half_angle) * cosf(half_angle);
+
+            // r e^jw v[n] - r^2 v[n - 1] with v[n - 1] = (v[n] - d[n]) / rho
+            *tap = (goertzel_tap_t){
+                .re = weight * damping * re,
+                .im = weight * damping * sinf(2.f * half_angle),
+                .difference = weight * damping * sign,
+                .resonator = find_resonator(this, folded, damping),
+            };
+        }
+    }
+
+    goertzel_reset(this);
+}
+
+int goertzel_init(goertzel_t *this, arena_t *arena, size_t count,
+                  size_t block_count, const uint16_t *bins,
+                  size_t target_count, const float *terms,
+                  size_t term_count) {
+    size_t max_resonators = target_count * GOERTZEL_MAX_TAPS;
+    float damping;
+    void *mem;
+
+    if (count < 4 || count > UINT16_MAX || block_count == 0 ||
+        target_count == 0 || max_resonators > UINT16_MAX ||
+        term_count == 0 || term_count > GOERTZEL_MAX_TERMS)
+        return -1;
+
+    for (size_t i = 0; i < target_count; i++)
+        if (bins[i] > count / 2)
+            return -1;
+
+    // Floats first, they have the stricter alignment
+    mem = arena_alloc(arena,
+                      4 * max_resonators * sizeof(float) +
+                          block_count * sizeof(float) +
+                          max_resonators * sizeof(goertzel_tap_t) +
+                          max_resonators * sizeof(uint16_t) +
+                          target_count * sizeof(uint16_t),
+                      ARENA_ALIGN);
+
+    if (mem == NULL)
+        return -1;
+
+    damping = 1.f - 1.f / (DAMPING_WINDOWS * (float)count);
+
+    this->count = count;
+    this->target_count = target_count;
+    this->block_count = block_count;
+    this->coefficients = (float *)mem;
+    this->state = this->coefficients + 2 * max_resonators;
+    this->input = this->state + 2 * max_resonators;
+    this->taps = (goertzel_tap_t *)(this->input + block_count);
+    this->resonator_bins = (uint16_t *)(this->taps + max_resonators);
+    this->bins = this->resonator_bins + max_resonators;
+    this->damping = damping;
+    this->comb = powf(damping, (float)count);
+    this->output = fft_output_default();
+    this->mem = mem;
+    this->arena = arena;
+
+    memcpy(this->bins, bins, target_count * sizeof(uint16_t));
+    build_taps(this, terms, term_count);
+
+    return 1;
+}
+
+void goertzel_set_window(goertzel_t *this, const float *terms,
+                         size_t term_count) {
+    if (term_count == 0 || term_count > GOERTZEL_MAX_TERMS)
+        return;
+
+    build_taps(this, terms, term_count);
+}
+
+void goertzel_reset(goertzel_t *this) {
+    memset(this->state, 0, 2 * this->resonator_count * sizeof(float));
+}
+
+void goertzel_update(goertzel_t *this, size_t count) {
+    const float *input = this->input;
+    const float *c = this->coefficients;
+    float *state = this->state;
+    size_t r = 0;
+
+    // Two resonators at a time, the state stays in registers and either
+    // chain runs while the other waits on its last multiply
+    for (; r + 1 < this->resonator_count; r += 2) {
+        float mu0 = c[2 * r], rho0 = c[2 * r + 1];
+        float mu1 = c[2 * r + 2], rho1 = c[2 * r + 3];
+        float v0 = state[2 * r], d0 = state[2 * r + 1];
+        float v1 = state[2 * r + 2], d1 = state[2 * r + 3];
+
+        for (size_t i = 0; i < count; i++) {
+            d0 = input[i] - mu0 * v0 + rho0 * d0;
+            d1 = input[i] - mu1 * v1 + rho1 * d1;
+            v0 = d0 + rho0 * v0;
+            v1 = d1 + rho1 * v1;
+        }
+
+        state[2 * r] = v0;
+        state[2 * r + 1] = d0;
+        state[2 * r + 2] = v1;
+        state[2 * r + 3] = d1;
+    }
+
+    if (r < this->resonator_count) {
+        float mu = c[2 * r], rho = c[2 * r + 1];
+        float v = state[2 * r], d = state[2 * r + 1];
+
+        for (size_t i = 0; i < count; i++) {
+            d = input[i] - mu * v + rho * d;
+            v = d + rho * v;
+        }
+
+        state[2 * r] = v;
+        state[2 * r + 1] = d;
+    }
+}
+
+size_t goertzel_state_size(goertzel_t *this) {
+    return 2 * this->resonator_count * sizeof(float);
+}
+
+void goertzel_snapshot(goertzel_t *this, void *state) {
+    memcpy(state, this->state, goertzel_state_size(this));
+}
+
+void goertzel_spectrum(goertzel_t *this, const void *state, float scale,
+                       float *frequency_bins) {
+    const float *v = state;
+    const goertzel_tap_t *tap = this->taps;
+    float range = -this->output.floor_db, power, db;
+
+    for (size_t target = 0; target < this->target_count; target++) {
+        float re = 0.f, im = 0.f;
+
+        for (size_t i = 0; i < this->taps_per_target; i++, tap++) {
+            const float *resonator = v + 2 * tap->resonator;
+
+            re += tap->re * resonator[0] + tap->difference * resonator[1];
+            im += tap->im * resonator[0];
+        }
+
+        power = (re * re + im * im) * (scale * scale);
+
+        // A handful of bins, the exact conversions cost next to nothing
+        switch (this->output.mode) {
+        case FFT_OUTPUT_POWER:
+            frequency_bins[target] = power;
+            break;
+        case FFT_OUTPUT_LOG:
+            db = (10.f * log10f(power) + range) / range;
+            frequency_bins[target] = db > 0.f ? db : 0.f;
+            break;
+        default:
+            frequency_bins[target] = sqrtf(power);
+            break;
+        }
+    }
+}
+
+void goertzel_deinit(goertzel_t *this) { arena_free(this->arena, this->mem); }
@@ -0,0 +1,121 @@
+#ifndef GOERTZEL_H
+#define GOERTZEL_H
+
+#include "arena.h"
+#include "fft_output.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Cosine sum windows have up to 5 terms, a target then reads 9 bins
+#define GOERTZEL_MAX_TERMS 5
+#define GOERTZEL_MAX_TAPS (2 * GOERTZEL_MAX_TERMS - 1)
+
+/**
+ * One bin a target reads, what v[n] and d[n] of its resonator contribute,
+ * pre-multiplied by the window term it gets.
+ */
+typedef struct {
+    float re;
+    float im;
+    float difference;
+    uint16_t resonator;
+} goertzel_tap_t;
+
+/**
+ * Sliding Goertzel bank, every resonator tracks one DFT bin of the last
+ * count samples:
+ *
+ *  v[n] = x[n] - r^N x[n - N] + 2r cos(w) v[n - 1] - r^2 v[n - 2]
+ *  X[n] = r e^jw v[n] - r^2 v[n - 1]
+ *
+ * The comb in front is shared by every resonator, the caller feeds x[n] -
+ * comb * x[n - N] through input. r a hair under 1 keeps float rounding from
+ * piling up around poles sitting right on the unit circle.
+ *
+ * Written as is, 2r cos(w) rounds the low bins off their pole and the comb
+ * stops cancelling, 10% off after a few seconds. The resonators run the
+ * Reinsch form instead, three multiplies per sample rather than two:
+ *
+ *  d[n] = x[n] - mu v[n - 1] + rho d[n - 1]
+ *  v[n] = d[n] + rho v[n - 1]
+ *
+ * with rho = r, mu = 4r sin^2(w/2) below a quarter of the rate and rho = -r,
+ * mu = -4r cos^2(w/2) above.
+ *
+ * Bins are only worked out when asked for, so a spectrum is available at
+ * any block boundary. Cosine sum windows are applied in the frequency domain
+ * from the neighbor bins, Hann reads k-1..k+1, and resonators are shared
+ * between targets reading the same bin.
+ */
+typedef struct {
+    // Window length
+    size_t count;
+    size_t target_count;
+    size_t resonator_count;
+    size_t taps_per_target;
+    // Largest block update takes
+    size_t block_count;
+    // DFT bin of every target
+    uint16_t *bins;
+    // Of every resonator, mu and rho
+    float *coefficients;
+    // Of every resonator, the bin folded into 0..count/2
+    uint16_t *resonator_bins;
+    // v[n] and d[n] of every resonator
+    float *state;
+    goertzel_tap_t *taps;
+    // block_count comb outputs, filled by the caller
+    float *input;
+    // r
+    float damping;
+    // r^count
+    float comb;
+    fft_output_t output;
+    void *mem;
+    arena_t *arena;
+} goertzel_t;
+
+// Arena bytes goertzel_init takes, the most resonators a window may need
+#define GOERTZEL_FOOTPRINT(block_count, target_count)                          \
+    ARENA_FOOTPRINT((target_count) * GOERTZEL_MAX_TAPS *                       \
+                        (4 * sizeof(float) + sizeof(goertzel_tap_t) +          \
+                         sizeof(uint16_t)) +                                   \
+                    (block_count) * sizeof(float) +                            \
+                    (target_count) * sizeof(uint16_t))
+
+/**
+ * @param bins Target DFT bins, 0..count/2
+ * @param terms Cosine sum window, a0 - a1 cos(x) + a2 cos(2x) - ...
+ */
+int goertzel_init(goertzel_t *this, arena_t *arena, size_t count,
+                  size_t block_count, const uint16_t *bins,
+                  size_t target_count, const float *terms,
+                  size_t term_count);
+
+/**
+ * @brief Swap the window, the resonators needed change so the state starts
+ * over. Feed the last count samples again, without comb, to catch up.
+ */
+void goertzel_set_window(goertzel_t *this, const float *terms,
+                         size_t term_count);
+void goertzel_reset(goertzel_t *this);
+
+/**
+ * @brief Run the first count comb outputs of input through every resonator.
+ */
+void goertzel_update(goertzel_t *this, size_t count);
+
+size_t goertzel_state_size(goertzel_t *this);
+void goertzel_snapshot(goertzel_t *this, void *state);
+
+/**
+ * @brief One bin per target off a snapshot, the way this->output says.
+ *
+ * @param scale Linear factor of every bin, normalization and gain
+ */
+void goertzel_spectrum(goertzel_t *this, const void *state, float scale,
+                       float *frequency_bins);
+void goertzel_deinit(goertzel_t *this);
+
+#endif
@@ -0,0 +1,115 @@
+#include "bench.h"
+
+#include <pico/stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#if PICO_ON_DEVICE
+#include <hardware/clocks.h>
+#endif
+
+static const bench_suite_t suites[] = {
+    {.name = "fft", .run = bench_fft},
+    {.name = "fft_fixed", .run = bench_fft_fixed},
+    {.name = "fft_output", .run = bench_fft_output},
+    {.name = "fft_radix", .run = bench_fft_radix},
+    {.name = "front_end", .run = bench_front_end},
+    {.name = "goertzel", .run = bench_goertzel},
+    {.name = "swapchain", .run = bench_swapchain},
+    {.name = "bands", .run = bench_bands},
+    {.name = "palette", .run = bench_palette},
+    {.name = "bitplane", .run = bench_bitplane},
+    {.name = "output", .run = bench_output},
+    {.name = "renderer", .run = bench_renderer},
+    {.name = "show", .run = bench_show},
+    {.name = "i2s", .run = bench_i2s},
+    {.name = "i2s_dma", .run = bench_i2s_dma},
+};
+
+double bench_measure_ns(bench_fn_t fn, void *context) {
+    uint64_t start, elapsed, best;
+    size_t iterations;
+
+    // Warm up caches and lazy inits
+    fn(context);
+
+    // Double until the measurement is long enough to trust the timer
+    for (iterations = 1;; iterations <<= 1) {
+        start = time_us_64();
+
+        for (size_t i = 0; i < iterations; i++)
+            fn(context);
+
+        best = time_us_64() - start;
+
+        if (best >= BENCH_MIN_DURATION_US)
+            break;
+    }
+
+    for (size_t round = 1; round < BENCH_ROUNDS; round++) {
+        start = time_us_64();
+
+        for (size_t i = 0; i < iterations; i++)
+            fn(context);
+
+        elapsed = time_us_64() - start;
+
+        if (elapsed < best)
+            best = elapsed;
+    }
+
+    return (double)best * 1000.0 / (double)iterations;
+}
+
+double bench_ns_to_cycles(double ns) {
+#if PICO_ON_DEVICE
+    return ns * (double)clock_get_hz(clk_sys) / 1e9;
+#else
+    (void)ns;
+    return 0.0;
+#endif
+}
+
+float bench_random(void) {
+    static uint32_t state = 0x12345678;
+
+    // Numerical Recipes LCG, good enough for test signals
+    state = state * 1664525u + 1013904223u;
+
+    return (float)(int32_t)state / (float)INT32_MAX;
+}
+
+int main(int argc, char *argv[]) {
+    bool passed = true;
+
+#if PICO_ON_DEVICE
+    stdio_usb_init();
+
+    // Nobody would see the results otherwise
+    while (!stdio_usb_connected())
+        sleep_ms(100);
+#endif
+
+    for (size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++) {
+        bool selected = argc < 2;
+
+        // On the host the suites to run can be picked by name
+        for (int arg = 1; arg < argc; arg++)
+            if (strcmp(argv[arg], suites[i].name) == 0)
+                selected = true;
+
+        if (!selected)
+            continue;
+
+        printf("# suite %s\n", suites[i].name);
+
+        if (!suites[i].run()) {
+            printf("# suite %s FAILED\n", suites[i].name);
+            passed = false;
+        }
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/**
+ * Tiny benchmark harness shared by every suite. Results are printed as CSV,
+ * lines starting with '#' are comments.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Keep repeating a measurement until it spans at least this long
+#define BENCH_MIN_DURATION_US 10000
+
+// Measurements taken, the fastest one wins to filter out preemption noise
+#define BENCH_ROUNDS 5
+
+typedef void (*bench_fn_t)(void *context);
+
+/**
+ * run returns false if any check of the suite failed, the suites that only
+ * measure always pass. Nothing is skipped silently, a suite that cannot set
+ * up its checks fails.
+ */
+typedef struct {
+    const char *name;
+    bool (*run)(void);
+} bench_suite_t;
+
+/**
+ * @brief Wall time of a single call of fn, in nanoseconds. Best of
+ * BENCH_ROUNDS averages.
+ */
+double bench_measure_ns(bench_fn_t fn, void *context);
+
+/**
+ * @brief Convert a duration to CPU cycles. Only meaningful on the device,
+ * returns 0 on the host.
+ */
+double bench_ns_to_cycles(double ns);
+
+/**
+ * @brief Deterministic pseudo random value in [-1, 1], so every run and
+ * every target benchmarks the same input.
+ */
+float bench_random(void);
+
+bool bench_fft(void);
+bool bench_fft_fixed(void);
+
+/**
+ * Check of the radix-2, staged radix-2, radix-4 and split-radix float
+ * kernels against fft_rad2_dif_d, every size from 4 points up.
+ */
+bool bench_fft_radix(void);
+
+/**
+ * Accuracy and per frame cost of every output mode of every engine, the
+ * output stage alone.
+ */
+bool bench_fft_output(void);
+
+/**
+ * Per frame cost of the audio front end, i2s words to windowed samples.
+ */
+bool bench_front_end(void);
+
+/**
+ * Per frame cost and accuracy of the Goertzel engine against the float
+ * engine for a growing number of targets, and where the transform takes
+ * over.
+ */
+bool bench_goertzel(void);
+
+/**
+ * Stress test rather than a benchmark, the producer runs on core1 (a thread
+ * on the host) and the consumer checks every frame for tearing.
+ */
+bool bench_swapchain(void);
+
+/**
+ * Per frame cost of turning bins into pixels, the linear mapper against
+ * band aggregation plus the band renderer.
+ */
+bool bench_bands(void);
+
+/**
+ * Layout check of the i2s PIO programs, run by a small interpreter against
+ * a simulated bitstream for every channel selection.
+ */
+bool bench_i2s(void);
+
+/**
+ * Timing model of i2s capture under injected interrupt latency, the single
+ * channel rearmed from the interrupt against the chained ping-pong.
+ */
+bool bench_i2s_dma(void);
+
+/**
+ * Per frame cost of coloring a 300 pixel strip, float HSV per pixel against
+ * palette lookups from magnitudes and from pre quantized indices.
+ */
+bool bench_palette(void);
+
+/**
+ * Per frame cost of turning up to 8 strips of 300 pixels into the bit planes
+ * of the parallel WS2812 output, checked against a bit at a time reference.
+ */
+bool bench_bitplane(void);
+
+/**
+ * Per frame cost of gamma, brightness and the current limit on 300 and 2400
+ * pixel frames, as separate passes against the fused output stage.
+ */
+bool bench_output(void);
+
+/**
+ * Per frame cost of every built-in renderer and of switching renderer on
+ * every frame, each checked against what it should draw.
+ */
+bool bench_renderer(void);
+
+/**
+ * Round trip of the show coder, every seek against a sequential read and
+ * malformed frames and files turned down, with the decode and seek cost.
+ */
+bool bench_show(void);
+
+#endif
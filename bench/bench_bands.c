@@ -0,0 +1,132 @@
+#include "bands.h"
+#include "bench.h"
+#include "renderer.h"
+#include "visualizer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MIN_BIN_COUNT 32
+#define MAX_BIN_COUNT 512
+#define PIXEL_COUNT 300
+#define BAND_COUNT 32
+#define SAMPLE_RATE 48000.f
+#define MIN_HZ 40.f
+#define MAX_HZ 16000.f
+
+typedef struct {
+    const char *name;
+    bands_spacing_t spacing;
+} spacing_t;
+
+static const spacing_t spacings[] = {
+    {.name = "log", .spacing = BANDS_SPACING_LOG},
+    {.name = "octave", .spacing = BANDS_SPACING_OCTAVE},
+    {.name = "third_octave", .spacing = BANDS_SPACING_THIRD_OCTAVE},
+    {.name = "mel", .spacing = BANDS_SPACING_MEL},
+};
+
+typedef struct {
+    size_t bin_count;
+    float *frequency_bins;
+    uint32_t *pixels;
+    bands_t bands;
+    renderer_t renderer;
+} context_t;
+
+static void run_mapper(void *context) {
+    context_t *ctx = context;
+
+    visualizer_map_frequency_bins_to_pixels(
+        ctx->frequency_bins, ctx->bin_count, ctx->pixels, PIXEL_COUNT);
+}
+
+static void run_aggregate(void *context) {
+    context_t *ctx = context;
+
+    bands_aggregate(&ctx->bands, ctx->frequency_bins);
+}
+
+static void run_bands(void *context) {
+    context_t *ctx = context;
+
+    bands_aggregate(&ctx->bands, ctx->frequency_bins);
+    renderer_render(&ctx->renderer, bands_get(&ctx->bands), ctx->pixels);
+}
+
+static void print_row(const char *method, size_t bin_count, size_t band_count,
+                      double aggregate_ns, double total_ns) {
+    printf("bands,%s,%u,%u,%u,%.1f,%.1f,%.0f\n", method, (unsigned)bin_count,
+           (unsigned)band_count, (unsigned)PIXEL_COUNT, aggregate_ns, total_ns,
+           bench_ns_to_cycles(total_ns));
+}
+
+static void run_bin_count(size_t bin_count) {
+    context_t ctx = {.bin_count = bin_count};
+
+    ctx.frequency_bins = malloc(bin_count * sizeof(float));
+    ctx.pixels = malloc(PIXEL_COUNT * sizeof(uint32_t));
+
+    if (ctx.frequency_bins == NULL || ctx.pixels == NULL) {
+        printf("# %u bins skipped\n", (unsigned)bin_count);
+        goto cleanup;
+    }
+
+    // Magnitudes, so non-negative
+    for (size_t i = 0; i < bin_count; i++) {
+        float value = bench_random();
+        ctx.frequency_bins[i] = value < 0.f ? -value : value;
+    }
+
+    // Current linear mapper, bins straight to pixels
+    print_row("linear_mapper", bin_count, bin_count, 0.0,
+              bench_measure_ns(run_mapper, &ctx));
+
+    for (size_t i = 0; i < sizeof(spacings) / sizeof(spacings[0]); i++) {
+        bands_config_t config = {
+            .spacing = spacings[i].spacing,
+            .band_count = BAND_COUNT,
+            .min_hz = MIN_HZ,
+            .max_hz = MAX_HZ,
+            .sample_rate = SAMPLE_RATE,
+            .bin_count = bin_count,
+        };
+        renderer_geometry_t geometry = {.pixel_count = PIXEL_COUNT};
+
+        if (bands_init(&ctx.bands, NULL, &config) < 0) {
+            printf("# %s,%u skipped\n", spacings[i].name, (unsigned)bin_count);
+            continue;
+        }
+
+        geometry.band_count = bands_get_count(&ctx.bands);
+
+        if (renderer_init(&ctx.renderer, NULL, RENDERER_SPECTRUM, &geometry) <
+            0) {
+            printf("# %s,%u skipped\n", spacings[i].name, (unsigned)bin_count);
+            bands_deinit(&ctx.bands);
+            continue;
+        }
+
+        print_row(spacings[i].name, bin_count, bands_get_count(&ctx.bands),
+                  bench_measure_ns(run_aggregate, &ctx),
+                  bench_measure_ns(run_bands, &ctx));
+
+        renderer_deinit(&ctx.renderer);
+        bands_deinit(&ctx.bands);
+    }
+
+cleanup:
+    free(ctx.frequency_bins);
+    free(ctx.pixels);
+}
+
+bool bench_bands(void) {
+    printf("suite,method,bins,bands,pixels,aggregate_ns,total_ns,"
+           "cycles_per_frame\n");
+
+    for (size_t bin_count = MIN_BIN_COUNT; bin_count <= MAX_BIN_COUNT;
+         bin_count <<= 1)
+        run_bin_count(bin_count);
+
+    return true;
+}
@@ -0,0 +1,100 @@
+#include "bench.h"
+#include "bitplane.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Transpose of per strip pixel buffers into the bit planes of the parallel
+ * WS2812 output, the word-wide kernel against a bit at a time reference.
+ * Every row is checked against the reference on random pixels too, the
+ * last column reads pass or FAIL.
+ */
+
+#define PIXEL_COUNT 300
+
+// On the wire at 800 kHz, the same for any number of parallel strips
+#define WIRE_NS_PER_PIXEL 30000.0
+
+static const size_t strip_counts[] = {1, 2, 4, 8};
+
+typedef struct {
+    const uint32_t *pixels;
+    size_t strip_count;
+    uint32_t *planes;
+} context_t;
+
+static void transpose_reference(const uint32_t *pixels, size_t stride,
+                                size_t strip_count, size_t count,
+                                uint32_t *planes) {
+    memset(planes, 0, BITPLANE_SIZE(count));
+
+    for (size_t i = 0; i < count; i++)
+        for (unsigned bit = 0; bit < 24; bit++)
+            for (size_t s = 0; s < strip_count; s++)
+                if (pixels[s * stride + i] >> (31 - bit) & 1u)
+                    planes[i * BITPLANE_WORDS_PER_PIXEL + bit / 4] |=
+                        1u << (s + 8 * (3 - bit % 4));
+}
+
+static void run_reference(void *context) {
+    context_t *ctx = context;
+
+    transpose_reference(ctx->pixels, PIXEL_COUNT, ctx->strip_count,
+                        PIXEL_COUNT, ctx->planes);
+}
+
+static void run_kernel(void *context) {
+    context_t *ctx = context;
+
+    bitplane_transpose(ctx->pixels, PIXEL_COUNT, ctx->strip_count,
+                       PIXEL_COUNT, ctx->planes);
+}
+
+static void print_row(const char *kernel, size_t strip_count, double ns,
+                      bool passed) {
+    double wire_ns = WIRE_NS_PER_PIXEL * PIXEL_COUNT;
+
+    printf("bitplane,%s,%u,%u,%.1f,%.0f,%.2f,%s\n", kernel,
+           (unsigned)strip_count, (unsigned)PIXEL_COUNT, ns,
+           bench_ns_to_cycles(ns), ns * 100.0 / wire_ns,
+           passed ? "pass" : "FAIL");
+}
+
+bool bench_bitplane(void) {
+    static uint32_t pixels[BITPLANE_MAX_STRIPS * PIXEL_COUNT];
+    static uint32_t expected[BITPLANE_WORDS_PER_PIXEL * PIXEL_COUNT];
+    static uint32_t planes[BITPLANE_WORDS_PER_PIXEL * PIXEL_COUNT];
+    context_t ctx = {.pixels = pixels, .planes = planes};
+    bool passed, all_passed = true;
+
+    // Junk in the low byte too, the kernel must leave it out
+    for (size_t i = 0; i < BITPLANE_MAX_STRIPS * PIXEL_COUNT; i++)
+        pixels[i] = (uint32_t)((bench_random() + 1.f) * 32767.f) << 16 |
+                    (uint32_t)((bench_random() + 1.f) * 32767.f);
+
+    printf("# wire_percent: share of the %.0f us a frame takes on the wire\n",
+           WIRE_NS_PER_PIXEL * PIXEL_COUNT / 1000.0);
+    printf("suite,kernel,strips,pixels,ns_per_frame,cycles_per_frame,"
+           "wire_percent,check\n");
+
+    for (size_t c = 0; c < sizeof(strip_counts) / sizeof(strip_counts[0]);
+         c++) {
+        ctx.strip_count = strip_counts[c];
+
+        transpose_reference(pixels, PIXEL_COUNT, ctx.strip_count, PIXEL_COUNT,
+                            expected);
+        memset(planes, 0xA5, sizeof(planes));
+        run_kernel(&ctx);
+        passed = memcmp(planes, expected, sizeof(planes)) == 0;
+        all_passed = all_passed && passed;
+
+        print_row("reference", ctx.strip_count,
+                  bench_measure_ns(run_reference, &ctx), true);
+        print_row("transpose", ctx.strip_count,
+                  bench_measure_ns(run_kernel, &ctx), passed);
+    }
+
+    return all_passed;
+}
@@ -0,0 +1,469 @@
+#include "bench.h"
+#include "fft.h"
+
+#include <complex.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_COUNT 16
+#define MAX_COUNT 4096
+
+typedef union {
+    fft_t f;
+    fft_d_t d;
+    fft_real_t real;
+    fft_q15_t q15;
+    fft_q31_t q31;
+    fft_real_q15_t real_q15;
+    fft_real_q31_t real_q31;
+} plan_t;
+
+typedef struct {
+    const char *name;
+    size_t (*required_buffer_size)(size_t count);
+    int (*init)(plan_t *plan, size_t count);
+    void (*run)(plan_t *plan, void *samples, void *frequency_bins);
+    void (*deinit)(plan_t *plan);
+    void (*fill)(void *samples, size_t i, float value);
+    size_t sample_size;
+    size_t bin_size;
+    // Radix-2 butterflies executed by one transform of size count
+    size_t (*butterflies)(size_t count);
+} kernel_t;
+
+typedef struct {
+    const kernel_t *kernel;
+    size_t count;
+    plan_t plan;
+    void *input;
+    void *work;
+    void *frequency_bins;
+} context_t;
+
+static int init_f(plan_t *plan, size_t count) {
+    return fft_init(&plan->f, NULL, count);
+}
+
+static int init_d(plan_t *plan, size_t count) {
+    return fft_init_d(&plan->d, NULL, count);
+}
+
+static int init_real(plan_t *plan, size_t count) {
+    return fft_init_real(&plan->real, NULL, count);
+}
+
+static int init_real_planar(plan_t *plan, size_t count) {
+    if (fft_init_real(&plan->real, NULL, count) < 0)
+        return -1;
+
+    plan->real.kernel = FFT_KERNEL_RADIX2_PLANAR;
+
+    return 1;
+}
+
+static int init_q15(plan_t *plan, size_t count) {
+    return fft_init_q15(&plan->q15, NULL, count);
+}
+
+static int init_q31(plan_t *plan, size_t count) {
+    return fft_init_q31(&plan->q31, NULL, count);
+}
+
+static int init_real_q15(plan_t *plan, size_t count) {
+    return fft_init_real_q15(&plan->real_q15, NULL, count);
+}
+
+static int init_real_q31(plan_t *plan, size_t count) {
+    return fft_init_real_q31(&plan->real_q31, NULL, count);
+}
+
+static void deinit_f(plan_t *plan) { fft_deinit(&plan->f); }
+static void deinit_d(plan_t *plan) { fft_deinit_d(&plan->d); }
+static void deinit_real(plan_t *plan) { fft_deinit_real(&plan->real); }
+static void deinit_q15(plan_t *plan) { fft_deinit_q15(&plan->q15); }
+static void deinit_q31(plan_t *plan) { fft_deinit_q31(&plan->q31); }
+
+static void deinit_real_q15(plan_t *plan) {
+    fft_deinit_real_q15(&plan->real_q15);
+}
+
+static void deinit_real_q31(plan_t *plan) {
+    fft_deinit_real_q31(&plan->real_q31);
+}
+
+static void run_dit(plan_t *plan, void *samples, void *frequency_bins) {
+    fft_rad2_dit(&plan->f, samples, frequency_bins);
+}
+
+static void run_dif(plan_t *plan, void *samples, void *frequency_bins) {
+    fft_rad2_dif(&plan->f, samples, frequency_bins);
+}
+
+static void run_rad4_dif(plan_t *plan, void *samples, void *frequency_bins) {
+    fft_rad4_dif(&plan->f, samples, frequency_bins);
+}
+
+static void run_split_radix(plan_t *plan, void *samples,
+                            void *frequency_bins) {
+    fft_split_radix(&plan->f, samples, frequency_bins);
+}
+
+static void run_dit_staged(plan_t *plan, void *samples,
+                           void *frequency_bins) {
+    fft_rad2_dit_staged(&plan->f, samples, frequency_bins);
+}
+
+// The real parts first, then the imaginary ones
+static void run_dif_planar(plan_t *plan, void *samples, void *frequency_bins) {
+    fft_rad2_dif_planar(&plan->f, samples, (float *)samples + plan->f.count,
+                        frequency_bins);
+}
+
+static void run_dit_d(plan_t *plan, void *samples, void *frequency_bins) {
+    fft_rad2_dit_d(&plan->d, samples, frequency_bins);
+}
+
+static void run_dif_d(plan_t *plan, void *samples, void *frequency_bins) {
+    fft_rad2_dif_d(&plan->d, samples, frequency_bins);
+}
+
+static void run_dif_real(plan_t *plan, void *samples, void *frequency_bins) {
+    fft_rad2_dif_real(&plan->real, samples, frequency_bins);
+}
+
+static void run_dit_q15(plan_t *plan, void *samples, void *frequency_bins) {
+    fft_rad2_dit_q15(&plan->q15, samples, frequency_bins);
+}
+
+static void run_dif_q15(plan_t *plan, void *samples, void *frequency_bins) {
+    fft_rad2_dif_q15(&plan->q15, samples, frequency_bins);
+}
+
+static void run_dit_q31(plan_t *plan, void *samples, void *frequency_bins) {
+    fft_rad2_dit_q31(&plan->q31, samples, frequency_bins);
+}
+
+static void run_dif_q31(plan_t *plan, void *samples, void *frequency_bins) {
+    fft_rad2_dif_q31(&plan->q31, samples, frequency_bins);
+}
+
+static void run_dif_real_q15(plan_t *plan, void *samples,
+                             void *frequency_bins) {
+    fft_rad2_dif_real_q15(&plan->real_q15, samples, frequency_bins);
+}
+
+static void run_dif_real_q31(plan_t *plan, void *samples,
+                             void *frequency_bins) {
+    fft_rad2_dif_real_q31(&plan->real_q31, samples, frequency_bins);
+}
+
+static void fill_f(void *samples, size_t i, float value) {
+    ((float complex *)samples)[i] = value;
+}
+
+static void fill_d(void *samples, size_t i, float value) {
+    ((double complex *)samples)[i] = value;
+}
+
+// Also fills the real parts of planar samples, the input starts zeroed
+static void fill_real(void *samples, size_t i, float value) {
+    ((float *)samples)[i] = value;
+}
+
+static void fill_q15(void *samples, size_t i, float value) {
+    ((fft_q15_complex_t *)samples)[i] = (fft_q15_complex_t){
+        .re = (int16_t)lrintf(value * INT16_MAX),
+    };
+}
+
+static void fill_q31(void *samples, size_t i, float value) {
+    ((fft_q31_complex_t *)samples)[i] = (fft_q31_complex_t){
+        .re = (int32_t)lrint((double)value * INT32_MAX),
+    };
+}
+
+static void fill_real_q15(void *samples, size_t i, float value) {
+    ((int16_t *)samples)[i] = (int16_t)lrintf(value * INT16_MAX);
+}
+
+static void fill_real_q31(void *samples, size_t i, float value) {
+    ((int32_t *)samples)[i] = (int32_t)lrint((double)value * INT32_MAX);
+}
+
+static size_t log2_count(size_t count) {
+    size_t value = 0;
+
+    while ((count >>= 1) != 0)
+        value++;
+
+    return value;
+}
+
+static size_t butterflies_complex(size_t count) {
+    return count / 2 * log2_count(count);
+}
+
+static size_t butterflies_real(size_t count) {
+    // Half size complex transform, the split pass is not a butterfly
+    return butterflies_complex(count / 2);
+}
+
+static const kernel_t kernels[] = {
+    {
+        .name = "rad2_dit",
+        .required_buffer_size = fft_required_buffer_size,
+        .init = init_f,
+        .run = run_dit,
+        .deinit = deinit_f,
+        .fill = fill_f,
+        .sample_size = sizeof(float complex),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_complex,
+    },
+    {
+        .name = "rad2_dif",
+        .required_buffer_size = fft_required_buffer_size,
+        .init = init_f,
+        .run = run_dif,
+        .deinit = deinit_f,
+        .fill = fill_f,
+        .sample_size = sizeof(float complex),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_complex,
+    },
+    {
+        .name = "rad2_dit_staged",
+        .required_buffer_size = fft_required_buffer_size,
+        .init = init_f,
+        .run = run_dit_staged,
+        .deinit = deinit_f,
+        .fill = fill_f,
+        .sample_size = sizeof(float complex),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_complex,
+    },
+    // Butterflies counted as radix-2 ones, so the rates compare directly
+    {
+        .name = "rad4_dif",
+        .required_buffer_size = fft_required_buffer_size,
+        .init = init_f,
+        .run = run_rad4_dif,
+        .deinit = deinit_f,
+        .fill = fill_f,
+        .sample_size = sizeof(float complex),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_complex,
+    },
+    {
+        .name = "split_radix",
+        .required_buffer_size = fft_required_buffer_size,
+        .init = init_f,
+        .run = run_split_radix,
+        .deinit = deinit_f,
+        .fill = fill_f,
+        .sample_size = sizeof(float complex),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_complex,
+    },
+    {
+        .name = "rad2_dif_planar",
+        .required_buffer_size = fft_required_buffer_size,
+        .init = init_f,
+        .run = run_dif_planar,
+        .deinit = deinit_f,
+        .fill = fill_real,
+        .sample_size = sizeof(float complex),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_complex,
+    },
+    {
+        .name = "rad2_dit_d",
+        .required_buffer_size = fft_required_buffer_size_d,
+        .init = init_d,
+        .run = run_dit_d,
+        .deinit = deinit_d,
+        .fill = fill_d,
+        .sample_size = sizeof(double complex),
+        .bin_size = sizeof(double),
+        .butterflies = butterflies_complex,
+    },
+    {
+        .name = "rad2_dif_d",
+        .required_buffer_size = fft_required_buffer_size_d,
+        .init = init_d,
+        .run = run_dif_d,
+        .deinit = deinit_d,
+        .fill = fill_d,
+        .sample_size = sizeof(double complex),
+        .bin_size = sizeof(double),
+        .butterflies = butterflies_complex,
+    },
+    {
+        .name = "rad2_dif_real",
+        .required_buffer_size = fft_required_buffer_size_real,
+        .init = init_real,
+        .run = run_dif_real,
+        .deinit = deinit_real,
+        .fill = fill_real,
+        .sample_size = sizeof(float),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_real,
+    },
+    {
+        .name = "rad2_dif_real_planar",
+        .required_buffer_size = fft_required_buffer_size_real,
+        .init = init_real_planar,
+        .run = run_dif_real,
+        .deinit = deinit_real,
+        .fill = fill_real,
+        .sample_size = sizeof(float),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_real,
+    },
+    {
+        .name = "rad2_dit_q15",
+        .required_buffer_size = fft_required_buffer_size_q15,
+        .init = init_q15,
+        .run = run_dit_q15,
+        .deinit = deinit_q15,
+        .fill = fill_q15,
+        .sample_size = sizeof(fft_q15_complex_t),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_complex,
+    },
+    {
+        .name = "rad2_dif_q15",
+        .required_buffer_size = fft_required_buffer_size_q15,
+        .init = init_q15,
+        .run = run_dif_q15,
+        .deinit = deinit_q15,
+        .fill = fill_q15,
+        .sample_size = sizeof(fft_q15_complex_t),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_complex,
+    },
+    {
+        .name = "rad2_dit_q31",
+        .required_buffer_size = fft_required_buffer_size_q31,
+        .init = init_q31,
+        .run = run_dit_q31,
+        .deinit = deinit_q31,
+        .fill = fill_q31,
+        .sample_size = sizeof(fft_q31_complex_t),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_complex,
+    },
+    {
+        .name = "rad2_dif_q31",
+        .required_buffer_size = fft_required_buffer_size_q31,
+        .init = init_q31,
+        .run = run_dif_q31,
+        .deinit = deinit_q31,
+        .fill = fill_q31,
+        .sample_size = sizeof(fft_q31_complex_t),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_complex,
+    },
+    {
+        .name = "rad2_dif_real_q15",
+        .required_buffer_size = fft_required_buffer_size_real_q15,
+        .init = init_real_q15,
+        .run = run_dif_real_q15,
+        .deinit = deinit_real_q15,
+        .fill = fill_real_q15,
+        .sample_size = sizeof(int16_t),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_real,
+    },
+    {
+        .name = "rad2_dif_real_q31",
+        .required_buffer_size = fft_required_buffer_size_real_q31,
+        .init = init_real_q31,
+        .run = run_dif_real_q31,
+        .deinit = deinit_real_q31,
+        .fill = fill_real_q31,
+        .sample_size = sizeof(int32_t),
+        .bin_size = sizeof(float),
+        .butterflies = butterflies_real,
+    },
+};
+
+static void run_copy(void *context) {
+    context_t *ctx = context;
+
+    memcpy(ctx->work, ctx->input, ctx->count * ctx->kernel->sample_size);
+}
+
+static void run_transform(void *context) {
+    context_t *ctx = context;
+
+    run_copy(ctx);
+    ctx->kernel->run(&ctx->plan, ctx->work, NULL);
+}
+
+static void run_transform_and_magnitudes(void *context) {
+    context_t *ctx = context;
+
+    run_copy(ctx);
+    ctx->kernel->run(&ctx->plan, ctx->work, ctx->frequency_bins);
+}
+
+static void run_init(void *context) {
+    context_t *ctx = context;
+    plan_t plan;
+
+    if (ctx->kernel->init(&plan, ctx->count) > 0)
+        ctx->kernel->deinit(&plan);
+}
+
+static void run_kernel(const kernel_t *kernel, size_t count) {
+    context_t ctx = {.kernel = kernel, .count = count};
+    double init_ns, copy_ns, transform_ns, total_ns;
+    size_t butterflies;
+
+    ctx.input = calloc(count, kernel->sample_size);
+    ctx.work = malloc(count * kernel->sample_size);
+    ctx.frequency_bins = malloc((count / 2) * kernel->bin_size);
+
+    if (ctx.input == NULL || ctx.work == NULL || ctx.frequency_bins == NULL ||
+        kernel->init(&ctx.plan, count) < 0) {
+        // Most likely out of RAM on the device
+        printf("# %s,%u skipped\n", kernel->name, (unsigned)count);
+        goto cleanup;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        kernel->fill(ctx.input, i, 0.5f * bench_random());
+
+    init_ns = bench_measure_ns(run_init, &ctx);
+    copy_ns = bench_measure_ns(run_copy, &ctx);
+    transform_ns = bench_measure_ns(run_transform, &ctx) - copy_ns;
+    total_ns = bench_measure_ns(run_transform_and_magnitudes, &ctx) - copy_ns;
+    butterflies = kernel->butterflies(count);
+
+    printf("fft,%s,%u,%.0f,%u,%.1f,%.1f,%.1f,%.0f,%.0f\n", kernel->name,
+           (unsigned)count, init_ns,
+           (unsigned)kernel->required_buffer_size(count), transform_ns,
+           total_ns - transform_ns, total_ns, butterflies * 1e9 / transform_ns,
+           bench_ns_to_cycles(total_ns));
+
+    kernel->deinit(&ctx.plan);
+
+cleanup:
+    free(ctx.input);
+    free(ctx.work);
+    free(ctx.frequency_bins);
+}
+
+bool bench_fft(void) {
+    printf("suite,kernel,n,init_ns,init_bytes,transform_ns,magnitude_ns,"
+           "total_ns,butterflies_per_s,cycles_per_transform\n");
+
+    for (size_t count = MIN_COUNT; count <= MAX_COUNT; count <<= 1)
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+            run_kernel(&kernels[k], count);
+
+    return true;
+}
@@ -0,0 +1,284 @@
+#include "bench.h"
+#include "fft.h"
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_COUNT 64
+#define MAX_COUNT 1024
+
+typedef enum {
+    ENGINE_FLOAT,
+    ENGINE_Q15,
+    ENGINE_Q31,
+} engine_t;
+
+typedef struct {
+    const char *name;
+    engine_t engine;
+    bool dit;
+    // Real-input transform of the same engine, N real samples in and the
+    // magnitude bins out, the split pass being part of its output stage
+    bool real;
+} variant_t;
+
+static const variant_t variants[] = {
+    {.name = "float_dit", .engine = ENGINE_FLOAT, .dit = true},
+    {.name = "float_dif", .engine = ENGINE_FLOAT, .dit = false},
+    {.name = "q15_dit", .engine = ENGINE_Q15, .dit = true},
+    {.name = "q15_dif", .engine = ENGINE_Q15, .dit = false},
+    {.name = "q31_dit", .engine = ENGINE_Q31, .dit = true},
+    {.name = "q31_dif", .engine = ENGINE_Q31, .dit = false},
+    {.name = "float_real", .engine = ENGINE_FLOAT, .real = true},
+    {.name = "q15_real", .engine = ENGINE_Q15, .real = true},
+    {.name = "q31_real", .engine = ENGINE_Q31, .real = true},
+};
+
+typedef struct {
+    const variant_t *variant;
+    size_t count;
+    fft_t fft;
+    fft_q15_t fft_q15;
+    fft_q31_t fft_q31;
+    fft_real_t fft_real;
+    fft_real_q15_t fft_real_q15;
+    fft_real_q31_t fft_real_q31;
+    // Pristine input and the buffer transformed in place
+    void *input;
+    void *work;
+    size_t sample_size;
+    float *frequency_bins;
+} context_t;
+
+static size_t sample_size(const variant_t *variant) {
+    switch (variant->engine) {
+    case ENGINE_Q15:
+        return variant->real ? sizeof(int16_t) : sizeof(fft_q15_complex_t);
+    case ENGINE_Q31:
+        return variant->real ? sizeof(int32_t) : sizeof(fft_q31_complex_t);
+    default:
+        return variant->real ? sizeof(float) : sizeof(float complex);
+    }
+}
+
+static void run_real(context_t *ctx) {
+    switch (ctx->variant->engine) {
+    case ENGINE_Q15:
+        fft_rad2_dif_real_q15(&ctx->fft_real_q15, ctx->work,
+                              ctx->frequency_bins);
+        break;
+    case ENGINE_Q31:
+        fft_rad2_dif_real_q31(&ctx->fft_real_q31, ctx->work,
+                              ctx->frequency_bins);
+        break;
+    default:
+        fft_rad2_dif_real(&ctx->fft_real, ctx->work, ctx->frequency_bins);
+        break;
+    }
+}
+
+static void run_copy(void *context) {
+    context_t *ctx = context;
+
+    memcpy(ctx->work, ctx->input, ctx->count * ctx->sample_size);
+}
+
+static void run_transform(void *context) {
+    context_t *ctx = context;
+
+    run_copy(ctx);
+
+    if (ctx->variant->real) {
+        run_real(ctx);
+        return;
+    }
+
+    switch (ctx->variant->engine) {
+    case ENGINE_Q15:
+        if (ctx->variant->dit)
+            fft_rad2_dit_q15(&ctx->fft_q15, ctx->work, NULL);
+        else
+            fft_rad2_dif_q15(&ctx->fft_q15, ctx->work, NULL);
+        break;
+    case ENGINE_Q31:
+        if (ctx->variant->dit)
+            fft_rad2_dit_q31(&ctx->fft_q31, ctx->work, NULL);
+        else
+            fft_rad2_dif_q31(&ctx->fft_q31, ctx->work, NULL);
+        break;
+    default:
+        if (ctx->variant->dit)
+            fft_rad2_dit(&ctx->fft, ctx->work, NULL);
+        else
+            fft_rad2_dif(&ctx->fft, ctx->work, NULL);
+        break;
+    }
+}
+
+/**
+ * @brief Output sample i of the last transform, rescaled to the float
+ * domain. Every kernel leaves its output in bit-reversed order, so the
+ * physical index matches the reference as is.
+ */
+static double complex output_at(const context_t *ctx, size_t i) {
+    const fft_q15_complex_t *q15 = ctx->work;
+    const fft_q31_complex_t *q31 = ctx->work;
+    const float complex *f = ctx->work;
+    double scale;
+
+    switch (ctx->variant->engine) {
+    case ENGINE_Q15:
+        scale = ldexp(1.0, ctx->fft_q15.block_exponent - 15);
+        return (q15[i].re + q15[i].im * I) * scale;
+    case ENGINE_Q31:
+        scale = ldexp(1.0, ctx->fft_q31.block_exponent - 31);
+        return ((double)q31[i].re + (double)q31[i].im * I) * scale;
+    default:
+        return f[i];
+    }
+}
+
+/**
+ * @brief Fill the input, complex samples with a zero imaginary part or real
+ * ones, both quantized to the engine.
+ */
+static void fill_input(context_t *ctx, const double *signal) {
+    for (size_t i = 0; i < ctx->count; i++) {
+        switch (ctx->variant->engine) {
+        case ENGINE_Q15:
+            if (ctx->variant->real)
+                ((int16_t *)ctx->input)[i] =
+                    (int16_t)lrint(signal[i] * INT16_MAX);
+            else
+                ((fft_q15_complex_t *)ctx->input)[i] = (fft_q15_complex_t){
+                    .re = (int16_t)lrint(signal[i] * INT16_MAX),
+                };
+            break;
+        case ENGINE_Q31:
+            if (ctx->variant->real)
+                ((int32_t *)ctx->input)[i] =
+                    (int32_t)llrint(signal[i] * INT32_MAX);
+            else
+                ((fft_q31_complex_t *)ctx->input)[i] = (fft_q31_complex_t){
+                    .re = (int32_t)llrint(signal[i] * INT32_MAX),
+                };
+            break;
+        default:
+            if (ctx->variant->real)
+                ((float *)ctx->input)[i] = (float)signal[i];
+            else
+                ((float complex *)ctx->input)[i] = (float)signal[i];
+            break;
+        }
+    }
+}
+
+static void run_variant(const variant_t *variant, size_t count,
+                        const double *signal, const double complex *reference,
+                        const double *magnitudes, double signal_power) {
+    context_t ctx = {.variant = variant, .count = count};
+    double noise_power = 0.0, ns, copy_ns, error;
+
+    fft_init(&ctx.fft, NULL, count);
+    fft_init_q15(&ctx.fft_q15, NULL, count);
+    fft_init_q31(&ctx.fft_q31, NULL, count);
+    fft_init_real(&ctx.fft_real, NULL, count);
+    fft_init_real_q15(&ctx.fft_real_q15, NULL, count);
+    fft_init_real_q31(&ctx.fft_real_q31, NULL, count);
+
+    ctx.sample_size = sample_size(variant);
+    ctx.input = malloc(count * ctx.sample_size);
+    ctx.work = malloc(count * ctx.sample_size);
+    ctx.frequency_bins = malloc(count / 2 * sizeof(float));
+
+    fill_input(&ctx, signal);
+
+    // Accuracy, input quantization counts as noise too
+    run_transform(&ctx);
+
+    if (variant->real) {
+        // Magnitudes only, against the bins of the reference and their power
+        signal_power = 0.0;
+
+        for (size_t k = 0; k < count / 2; k++) {
+            error = ctx.frequency_bins[k] - magnitudes[k];
+            noise_power += error * error;
+            signal_power += magnitudes[k] * magnitudes[k];
+        }
+    }
+
+    for (size_t i = 0; i < count && !variant->real; i++) {
+        double complex error = output_at(&ctx, i) - reference[i];
+        noise_power +=
+            creal(error) * creal(error) + cimag(error) * cimag(error);
+    }
+
+    // Speed, minus the cost of restoring the input
+    ns = bench_measure_ns(run_transform, &ctx);
+    copy_ns = bench_measure_ns(run_copy, &ctx);
+    ns -= copy_ns;
+
+    printf("fft_fixed,%s,%u,%.2f,%.1f,%.0f\n", variant->name, (unsigned)count,
+           10.0 * log10(signal_power / noise_power), ns,
+           bench_ns_to_cycles(ns));
+
+    free(ctx.input);
+    free(ctx.work);
+    free(ctx.frequency_bins);
+    fft_deinit_real_q31(&ctx.fft_real_q31);
+    fft_deinit_real_q15(&ctx.fft_real_q15);
+    fft_deinit_real(&ctx.fft_real);
+    fft_deinit(&ctx.fft);
+    fft_deinit_q15(&ctx.fft_q15);
+    fft_deinit_q31(&ctx.fft_q31);
+}
+
+bool bench_fft_fixed(void) {
+    printf("suite,kernel,n,snr_db,ns_per_transform,cycles_per_transform\n");
+
+    for (size_t count = MIN_COUNT; count <= MAX_COUNT; count <<= 1) {
+        double *signal = malloc(count * sizeof(double));
+        double complex *reference = malloc(count * sizeof(double complex));
+        double *magnitudes = malloc(count / 2 * sizeof(double));
+        double signal_power = 0.0;
+        fft_d_t fft_d;
+
+        // A couple of tones, one off-bin, plus a little noise, kept under
+        // full scale so the fixed-point input does not clip
+        for (size_t i = 0; i < count; i++) {
+            signal[i] = 0.4 * sin(2.0 * M_PI * 5.3 * i / count) +
+                        0.2 * sin(2.0 * M_PI * (count / 8) * i / count + 1.0) +
+                        0.05 * bench_random();
+            reference[i] = signal[i];
+        }
+
+        fft_init_d(&fft_d, NULL, count);
+        fft_rad2_dif_d(&fft_d, reference, NULL);
+
+        // What the real-input transforms write, |X[k]| / (N/2) in natural
+        // order
+        for (size_t k = 0; k < count / 2; k++)
+            magnitudes[k] =
+                cabs(reference[fft_d.reversed_indices[k]]) / (count / 2);
+
+        fft_deinit_d(&fft_d);
+
+        for (size_t i = 0; i < count; i++)
+            signal_power += creal(reference[i]) * creal(reference[i]) +
+                            cimag(reference[i]) * cimag(reference[i]);
+
+        for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++)
+            run_variant(&variants[v], count, signal, reference, magnitudes,
+                        signal_power);
+
+        free(signal);
+        free(reference);
+        free(magnitudes);
+    }
+
+    return true;
+}
@@ -0,0 +1,272 @@
+#include "bench.h"
+#include "fft.h"
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_COUNT 256
+#define MAX_COUNT 1024
+
+// Magnitude errors are taken relative to bins this close to the peak, the
+// quiet ones are mostly quantization noise
+#define SIGNIFICANT_DB -40.0
+
+typedef enum {
+    ENGINE_FLOAT,
+    ENGINE_Q15,
+    ENGINE_Q31,
+} engine_t;
+
+static const char *const engine_names[] = {"float", "q15", "q31"};
+
+typedef struct {
+    const char *name;
+    fft_output_mode_t mode;
+    // cabsf(sample) / halfN over the float output, what the engines did
+    // before the output modes
+    bool legacy;
+} variant_t;
+
+static const variant_t variants[] = {
+    {.name = "cabsf", .mode = FFT_OUTPUT_MAGNITUDE, .legacy = true},
+    {.name = "magnitude", .mode = FFT_OUTPUT_MAGNITUDE},
+    {.name = "power", .mode = FFT_OUTPUT_POWER},
+    {.name = "approx", .mode = FFT_OUTPUT_APPROX_MAGNITUDE},
+    {.name = "log", .mode = FFT_OUTPUT_LOG},
+};
+
+typedef struct {
+    engine_t engine;
+    const variant_t *variant;
+    size_t count;
+    fft_t fft;
+    fft_q15_t fft_q15;
+    fft_q31_t fft_q31;
+    // Pristine input and the buffer transformed in place
+    void *input;
+    void *work;
+    size_t sample_size;
+    float *frequency_bins;
+} context_t;
+
+static size_t sample_size(engine_t engine) {
+    switch (engine) {
+    case ENGINE_Q15:
+        return sizeof(fft_q15_complex_t);
+    case ENGINE_Q31:
+        return sizeof(fft_q31_complex_t);
+    default:
+        return sizeof(float complex);
+    }
+}
+
+static void run_transform(context_t *ctx) {
+    memcpy(ctx->work, ctx->input, ctx->count * ctx->sample_size);
+
+    switch (ctx->engine) {
+    case ENGINE_Q15:
+        fft_rad2_dif_q15(&ctx->fft_q15, ctx->work, NULL);
+        break;
+    case ENGINE_Q31:
+        fft_rad2_dif_q31(&ctx->fft_q31, ctx->work, NULL);
+        break;
+    default:
+        fft_rad2_dif(&ctx->fft, ctx->work, NULL);
+        break;
+    }
+}
+
+/**
+ * @brief The output stage alone, over the transform left in work. The work
+ * buffer is only read, so it can be repeated as is.
+ */
+static void run_output(void *context) {
+    context_t *ctx = context;
+    const float complex *samples = ctx->work;
+    size_t halfN = ctx->count / 2;
+
+    switch (ctx->engine) {
+    case ENGINE_Q15:
+        fft_output_bins_q15(&ctx->fft_q15, ctx->work, ctx->frequency_bins);
+        break;
+    case ENGINE_Q31:
+        fft_output_bins_q31(&ctx->fft_q31, ctx->work, ctx->frequency_bins);
+        break;
+    default:
+        if (!ctx->variant->legacy) {
+            fft_output_bins(&ctx->fft, ctx->work, ctx->frequency_bins);
+            break;
+        }
+
+        for (size_t i = 0; i < halfN; i++)
+            ctx->frequency_bins[i] =
+                cabsf(samples[ctx->fft.reversed_indices[i]]) / halfN;
+        break;
+    }
+}
+
+/**
+ * @brief Exact value of bin i in the domain of the mode, from the raw
+ * output of the last transform. Only the output stage is measured this way,
+ * not the transform.
+ */
+static double exact_bin(const context_t *ctx, size_t i, float floor_db) {
+    const fft_q15_complex_t *q15 = ctx->work;
+    const fft_q31_complex_t *q31 = ctx->work;
+    const float complex *f = ctx->work;
+    double scale = 2.0 / ctx->count, power, db;
+    size_t index;
+
+    switch (ctx->engine) {
+    case ENGINE_Q15:
+        index = ctx->fft_q15.reversed_indices[i];
+        scale = ldexp(scale, ctx->fft_q15.block_exponent - 15);
+        power = (double)q15[index].re * q15[index].re +
+                (double)q15[index].im * q15[index].im;
+        break;
+    case ENGINE_Q31:
+        index = ctx->fft_q31.reversed_indices[i];
+        scale = ldexp(scale, ctx->fft_q31.block_exponent - 31);
+        power = (double)q31[index].re * q31[index].re +
+                (double)q31[index].im * q31[index].im;
+        break;
+    default:
+        index = ctx->fft.reversed_indices[i];
+        power = (double)crealf(f[index]) * crealf(f[index]) +
+                (double)cimagf(f[index]) * cimagf(f[index]);
+        break;
+    }
+
+    power *= scale * scale;
+
+    switch (ctx->variant->mode) {
+    case FFT_OUTPUT_POWER:
+        return power;
+    case FFT_OUTPUT_LOG:
+        db = power > 0.0 ? 10.0 * log10(power) : -1000.0;
+        db = (db - floor_db) / -floor_db;
+        return db > 0.0 ? db : 0.0;
+    default:
+        return sqrt(power);
+    }
+}
+
+/**
+ * @brief Worst error of the last output. Percent of the exact value over
+ * the significant bins for the linear modes, dB for the log one.
+ */
+static double max_error(const context_t *ctx) {
+    size_t halfN = ctx->count / 2;
+    double peak = 0.0, threshold, exact, error, worst = 0.0;
+    float floor_db = ctx->fft.output.floor_db;
+
+    for (size_t i = 0; i < halfN; i++) {
+        exact = exact_bin(ctx, i, floor_db);
+        peak = exact > peak ? exact : peak;
+    }
+
+    threshold = ctx->variant->mode == FFT_OUTPUT_POWER
+                    ? peak * pow(10.0, SIGNIFICANT_DB / 10.0)
+                    : peak * pow(10.0, SIGNIFICANT_DB / 20.0);
+
+    for (size_t i = 0; i < halfN; i++) {
+        exact = exact_bin(ctx, i, floor_db);
+
+        if (ctx->variant->mode == FFT_OUTPUT_LOG)
+            error = fabs(ctx->frequency_bins[i] - exact) * -floor_db;
+        else if (exact >= threshold && exact > 0.0)
+            error = fabs(ctx->frequency_bins[i] - exact) / exact * 100.0;
+        else
+            continue;
+
+        worst = error > worst ? error : worst;
+    }
+
+    return worst;
+}
+
+static void run_variant(engine_t engine, const variant_t *variant,
+                        size_t count, const double *signal) {
+    context_t ctx = {.engine = engine, .variant = variant, .count = count};
+    double ns;
+
+    fft_init(&ctx.fft, NULL, count);
+    fft_init_q15(&ctx.fft_q15, NULL, count);
+    fft_init_q31(&ctx.fft_q31, NULL, count);
+
+    ctx.fft.output.mode = variant->mode;
+    ctx.fft_q15.output.mode = variant->mode;
+    ctx.fft_q31.output.mode = variant->mode;
+
+    ctx.sample_size = sample_size(engine);
+    ctx.input = malloc(count * ctx.sample_size);
+    ctx.work = malloc(count * ctx.sample_size);
+    ctx.frequency_bins = malloc((count / 2) * sizeof(float));
+
+    for (size_t i = 0; i < count; i++) {
+        switch (engine) {
+        case ENGINE_Q15:
+            ((fft_q15_complex_t *)ctx.input)[i] = (fft_q15_complex_t){
+                .re = (int16_t)lrint(signal[i] * INT16_MAX),
+            };
+            break;
+        case ENGINE_Q31:
+            ((fft_q31_complex_t *)ctx.input)[i] = (fft_q31_complex_t){
+                .re = (int32_t)llrint(signal[i] * INT32_MAX),
+            };
+            break;
+        default:
+            ((float complex *)ctx.input)[i] = (float)signal[i];
+            break;
+        }
+    }
+
+    run_transform(&ctx);
+    ns = bench_measure_ns(run_output, &ctx);
+
+    printf("fft_output,%s,%s,%u,%.4f,%s,%.1f,%.0f\n", engine_names[engine],
+           variant->name, (unsigned)count, max_error(&ctx),
+           variant->mode == FFT_OUTPUT_LOG ? "db" : "percent", ns,
+           bench_ns_to_cycles(ns));
+
+    free(ctx.input);
+    free(ctx.work);
+    free(ctx.frequency_bins);
+    fft_deinit(&ctx.fft);
+    fft_deinit_q15(&ctx.fft_q15);
+    fft_deinit_q31(&ctx.fft_q31);
+}
+
+bool bench_fft_output(void) {
+    printf("# max_error: percent over bins within %.0f dB of the peak, dB "
+           "error above the floor for log\n",
+           -SIGNIFICANT_DB);
+    printf("suite,engine,mode,n,max_error,error_unit,ns_per_frame,"
+           "cycles_per_frame\n");
+
+    for (size_t count = MIN_COUNT; count <= MAX_COUNT; count <<= 1) {
+        double *signal = malloc(count * sizeof(double));
+
+        // Tones over a wide dynamic range, so the log mode sees more than
+        // the floor, plus a little noise
+        for (size_t i = 0; i < count; i++)
+            signal[i] = 0.5 * sin(2.0 * M_PI * 5.3 * i / count) +
+                        0.05 * sin(2.0 * M_PI * (count / 8) * i / count) +
+                        0.005 * sin(2.0 * M_PI * (count / 3.1) * i / count) +
+                        0.001 * bench_random();
+
+        for (engine_t engine = ENGINE_FLOAT; engine <= ENGINE_Q31; engine++)
+            for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]);
+                 v++)
+                if (engine == ENGINE_FLOAT || !variants[v].legacy)
+                    run_variant(engine, &variants[v], count, signal);
+
+        free(signal);
+    }
+
+    return true;
+}
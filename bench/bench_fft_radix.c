@@ -0,0 +1,127 @@
+#include "bench.h"
+#include "fft.h"
+
+#include <complex.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Correctness check rather than a benchmark. Every float kernel transforms
+ * the same input as fft_rad2_dif_d, the raw outputs are compared bin by bin,
+ * both in bit-reversed order. Odd powers of two exercise the radix-2
+ * cleanup of the radix-4 kernel.
+ */
+
+#define MIN_COUNT 4
+#define MAX_COUNT 4096
+
+// Worst error allowed, relative to the largest output, float rounding grows
+// with log2(N) so this leaves plenty of room
+#define MAX_RELATIVE_ERROR 1e-5
+
+typedef struct {
+    const char *name;
+    void (*run)(fft_t *this, float complex *samples, float *frequency_bins);
+} kernel_t;
+
+/**
+ * @brief The planar kernel behind the interleaved signature, split up
+ * before and interleaved again after.
+ */
+static void rad2_dif_planar(fft_t *this, float complex *samples,
+                            float *frequency_bins) {
+    float *re = malloc(2 * this->count * sizeof(float)), *im;
+
+    im = re + this->count;
+
+    for (size_t i = 0; i < this->count; i++) {
+        re[i] = crealf(samples[i]);
+        im[i] = cimagf(samples[i]);
+    }
+
+    fft_rad2_dif_planar(this, re, im, frequency_bins);
+
+    for (size_t i = 0; i < this->count; i++)
+        samples[i] = re[i] + im[i] * I;
+
+    free(re);
+}
+
+static const kernel_t kernels[] = {
+    {.name = "rad2_dif", .run = fft_rad2_dif},
+    {.name = "rad4_dif", .run = fft_rad4_dif},
+    {.name = "split_radix", .run = fft_split_radix},
+    {.name = "rad2_dit_staged", .run = fft_rad2_dit_staged},
+    {.name = "rad2_dif_planar", .run = rad2_dif_planar},
+};
+
+static bool run_kernel(const kernel_t *kernel, size_t count,
+                       const double complex *input,
+                       const double complex *reference, double peak) {
+    float complex *samples = malloc(count * sizeof(float complex));
+    double error, worst = 0.0;
+    fft_t fft;
+
+    if (samples == NULL || fft_init(&fft, NULL, count) < 0) {
+        printf("# %s,%u skipped\n", kernel->name, (unsigned)count);
+        free(samples);
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        samples[i] = (float complex)input[i];
+
+    kernel->run(&fft, samples, NULL);
+
+    for (size_t i = 0; i < count; i++) {
+        error = cabs((double complex)samples[i] - reference[i]) / peak;
+        // A NaN sticks, it must not slip past the check
+        worst = !(error <= worst) ? error : worst;
+    }
+
+    printf("fft_radix,%s,%u,%.2e,%s\n", kernel->name, (unsigned)count, worst,
+           worst <= MAX_RELATIVE_ERROR ? "pass" : "FAIL");
+
+    fft_deinit(&fft);
+    free(samples);
+
+    return worst <= MAX_RELATIVE_ERROR;
+}
+
+bool bench_fft_radix(void) {
+    bool passed = true;
+
+    printf("suite,kernel,n,max_relative_error,result\n");
+
+    for (size_t count = MIN_COUNT; count <= MAX_COUNT; count <<= 1) {
+        double complex *input = malloc(count * sizeof(double complex));
+        double complex *reference = malloc(count * sizeof(double complex));
+        double peak = 0.0;
+        fft_d_t fft_d;
+
+        // Complex noise, every bin and every twiddle matters
+        for (size_t i = 0; i < count; i++) {
+            float re = bench_random(), im = bench_random();
+            input[i] = re + im * I;
+            reference[i] = input[i];
+        }
+
+        fft_init_d(&fft_d, NULL, count);
+        fft_rad2_dif_d(&fft_d, reference, NULL);
+        fft_deinit_d(&fft_d);
+
+        for (size_t i = 0; i < count; i++)
+            peak = cabs(reference[i]) > peak ? cabs(reference[i]) : peak;
+
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+            passed = run_kernel(&kernels[k], count, input, reference, peak) &&
+                     passed;
+
+        free(input);
+        free(reference);
+    }
+
+    return passed;
+}
@@ -0,0 +1,89 @@
+#include "audio.h"
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SAMPLE_COUNT 256
+#define GAIN 1.5f
+
+typedef struct {
+    const char *name;
+    audio_engine_t engine;
+    // Picks the sample layout of the float engine
+    fft_kernel_t kernel;
+} engine_t;
+
+static const engine_t engines[] = {
+    {.name = "float", .engine = AUDIO_ENGINE_FLOAT},
+    {.name = "float_planar",
+     .engine = AUDIO_ENGINE_FLOAT,
+     .kernel = FFT_KERNEL_RADIX2_PLANAR},
+    {.name = "q15", .engine = AUDIO_ENGINE_Q15},
+    {.name = "q31", .engine = AUDIO_ENGINE_Q31},
+};
+
+// Without overlap, and the 75% overlap main runs with
+static const size_t hop_counts[] = {SAMPLE_COUNT, SAMPLE_COUNT / 4};
+
+typedef struct {
+    audio_t audio;
+    void *sample_buffer;
+    int32_t *words;
+} context_t;
+
+static void run_front_end(void *context) {
+    context_t *ctx = context;
+
+    audio_front_end(&ctx->audio, ctx->sample_buffer, ctx->words, GAIN);
+}
+
+bool bench_front_end(void) {
+    static int32_t words[SAMPLE_COUNT];
+    context_t ctx = {.words = words};
+
+    // Raw i2s words, 24 bits below a junk MSB
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        words[i] =
+            (int32_t)((uint32_t)(int32_t)(bench_random() * 0x7fffff) << 7) &
+            0x7fffff80;
+
+    printf("suite,engine,samples,hop,ns_per_frame,cycles_per_frame\n");
+
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+        for (size_t h = 0; h < sizeof(hop_counts) / sizeof(hop_counts[0]);
+             h++) {
+            double ns;
+
+            if (audio_init_stft(&ctx.audio, NULL, SAMPLE_COUNT, hop_counts[h],
+                                engines[e].engine, AUDIO_WINDOW_HANN) < 0) {
+                printf("# %s,%u skipped\n", engines[e].name,
+                       (unsigned)hop_counts[h]);
+                continue;
+            }
+
+            audio_set_kernel(&ctx.audio, engines[e].kernel);
+
+            ctx.sample_buffer =
+                malloc(audio_required_sample_buffer_size(&ctx.audio));
+
+            if (ctx.sample_buffer == NULL) {
+                printf("# %s,%u skipped\n", engines[e].name,
+                       (unsigned)hop_counts[h]);
+                audio_deinit(&ctx.audio);
+                continue;
+            }
+
+            ns = bench_measure_ns(run_front_end, &ctx);
+
+            printf("front_end,%s,%u,%u,%.1f,%.0f\n", engines[e].name,
+                   (unsigned)SAMPLE_COUNT, (unsigned)hop_counts[h], ns,
+                   bench_ns_to_cycles(ns));
+
+            free(ctx.sample_buffer);
+            audio_deinit(&ctx.audio);
+        }
+    }
+
+    return true;
+}
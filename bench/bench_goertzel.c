@@ -0,0 +1,184 @@
+#include "audio.h"
+#include "bench.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * Goertzel against the float engine, a full frame each (front end, transform
+ * and output). The transform costs the same whatever is looked at, the
+ * resonators cost in proportion to the bins they track, so past some number
+ * of targets the transform wins. That crossover is printed per config.
+ */
+
+#define SAMPLE_RATE 48000.f
+#define MIN_HZ 40.f
+#define MAX_HZ 16000.f
+#define GAIN 1.5f
+
+// Windows fed before comparing, the resonators need one to fill up and
+// rounding takes a few hundred to settle
+#define WARM_UP_WINDOWS 400
+
+#define MAX_TARGETS 64
+
+static const size_t sample_counts[] = {256, 1024};
+
+static const audio_window_t windows[] = {AUDIO_WINDOW_RECTANGULAR,
+                                         AUDIO_WINDOW_HANN};
+static const char *const window_names[] = {"rect", "hann"};
+
+static const size_t target_counts[] = {1, 2, 4, 8, 16, 32, MAX_TARGETS};
+
+typedef struct {
+    audio_t audio;
+    int32_t *words;
+    size_t word_count;
+    size_t position;
+} context_t;
+
+/**
+ * @brief One frame off a looping stream of words, so the comb keeps seeing
+ * fresh samples leave the window.
+ */
+static void run_frame(void *context) {
+    context_t *ctx = context;
+    size_t hop = audio_get_hop_count(&ctx->audio);
+
+    audio_feed_i2s(&ctx->audio, ctx->words + ctx->position, GAIN);
+    audio_fft(&ctx->audio);
+
+    ctx->position += hop;
+
+    if (ctx->position + hop > ctx->word_count)
+        ctx->position = 0;
+}
+
+static void fill_targets(float *target_hz, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        target_hz[i] =
+            count == 1 ? 1000.f
+                       : MIN_HZ * powf(MAX_HZ / MIN_HZ, (float)i / (count - 1));
+}
+
+/**
+ * @brief Worst difference between the Goertzel bins and the bins of the
+ * transform nearest to the same targets, percent of the largest one. Both
+ * get the same stream from the start.
+ */
+static double max_error(context_t *goertzel, context_t *fft,
+                        const float *target_hz, size_t target_count,
+                        size_t count) {
+    const float *expected = audio_get_frequency_bins(&fft->audio);
+    const float *actual = audio_get_frequency_bins(&goertzel->audio);
+    size_t frames = WARM_UP_WINDOWS * count / audio_get_hop_count(&fft->audio);
+    double peak = 0.0, worst = 0.0, error;
+    long bin;
+
+    goertzel->position = fft->position = 0;
+
+    for (size_t i = 0; i < frames; i++) {
+        run_frame(goertzel);
+        run_frame(fft);
+    }
+
+    for (size_t i = 0; i < target_count; i++) {
+        bin = lroundf(target_hz[i] * count / SAMPLE_RATE);
+        peak = expected[bin] > peak ? expected[bin] : peak;
+    }
+
+    for (size_t i = 0; i < target_count; i++) {
+        bin = lroundf(target_hz[i] * count / SAMPLE_RATE);
+        error = fabs((double)actual[i] - expected[bin]);
+        worst = error > worst ? error : worst;
+    }
+
+    return peak > 0.0 ? worst / peak * 100.0 : 0.0;
+}
+
+static void run_config(size_t count, size_t w, const int32_t *words,
+                       size_t word_count) {
+    context_t fft = {.words = (int32_t *)words, .word_count = word_count};
+    context_t goertzel = fft;
+    float target_hz[MAX_TARGETS];
+    size_t hop = count / 4, crossover = 0;
+    double fft_ns, ns, error;
+
+    if (audio_init_stft(&fft.audio, NULL, count, hop, AUDIO_ENGINE_FLOAT,
+                        windows[w]) < 0) {
+        printf("# %s,%u skipped\n", window_names[w], (unsigned)count);
+        return;
+    }
+
+    // The fastest float kernel, the fairest opponent
+    audio_set_kernel(&fft.audio, FFT_KERNEL_RADIX4);
+    fft_ns = bench_measure_ns(run_frame, &fft);
+
+    printf("goertzel,fft,%s,%u,%u,%u,,%.1f,%.0f\n", window_names[w],
+           (unsigned)count, (unsigned)hop, (unsigned)(count / 2), fft_ns,
+           bench_ns_to_cycles(fft_ns));
+
+    for (size_t t = 0; t < sizeof(target_counts) / sizeof(target_counts[0]);
+         t++) {
+        fill_targets(target_hz, target_counts[t]);
+
+        if (audio_init_goertzel(&goertzel.audio, NULL, count, hop,
+                                windows[w], target_hz, target_counts[t],
+                                SAMPLE_RATE) < 0) {
+            printf("# goertzel,%s,%u,%u skipped\n", window_names[w],
+                   (unsigned)count, (unsigned)target_counts[t]);
+            continue;
+        }
+
+        error = max_error(&goertzel, &fft, target_hz, target_counts[t], count);
+        ns = bench_measure_ns(run_frame, &goertzel);
+
+        printf("goertzel,goertzel,%s,%u,%u,%u,%.3f,%.1f,%.0f\n",
+               window_names[w], (unsigned)count, (unsigned)hop,
+               (unsigned)target_counts[t], error, ns,
+               bench_ns_to_cycles(ns));
+
+        if (crossover == 0 && ns >= fft_ns)
+            crossover = target_counts[t];
+
+        audio_deinit(&goertzel.audio);
+    }
+
+    if (crossover)
+        printf("# crossover %s,%u: the transform wins from %u targets\n",
+               window_names[w], (unsigned)count, (unsigned)crossover);
+    else
+        printf("# crossover %s,%u: goertzel wins up to %u targets\n",
+               window_names[w], (unsigned)count, MAX_TARGETS);
+
+    audio_deinit(&fft.audio);
+}
+
+bool bench_goertzel(void) {
+    size_t word_count = 8 * sample_counts[1];
+    int32_t *words = malloc(word_count * sizeof(int32_t));
+
+    // Raw i2s words, 24 bits below a junk MSB
+    for (size_t i = 0; i < word_count; i++)
+        words[i] =
+            (int32_t)((uint32_t)(int32_t)(bench_random() * 0x7fffff) << 7) &
+            0x7fffff80;
+
+    printf("# targets log spaced over %.0f..%.0f Hz at %.0f Hz, hop of a "
+           "quarter window\n",
+           MIN_HZ, MAX_HZ, SAMPLE_RATE);
+    printf("# max_error: percent of the largest target bin of the float "
+           "engine\n");
+    printf("suite,engine,window,samples,hop,targets,max_error,ns_per_frame,"
+           "cycles_per_frame\n");
+
+    for (size_t c = 0; c < sizeof(sample_counts) / sizeof(sample_counts[0]);
+         c++)
+        for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++)
+            run_config(sample_counts[c], w, words, word_count);
+
+    free(words);
+
+    return true;
+}
@@ -0,0 +1,207 @@
+#include "bench.h"
+#include "i2s.h"
+#include "i2s_programs.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Layout check rather than a benchmark. A tiny PIO interpreter runs the
+ * i2s programs against a simulated microphone pair and the words that reach
+ * the RX FIFO are compared to what the driver promises for each channel
+ * selection. The programs are assembled from drivers/i2s/i2s.pio at build
+ * time (gen_pio.py), so the check always runs what the driver loads.
+ */
+
+#define SAMPLE_COUNT 64
+
+typedef struct {
+    const char *name;
+    i2s_channel_t channel;
+} selection_t;
+
+static const selection_t selections[] = {
+    {.name = "left", .channel = I2S_CHANNEL_LEFT},
+    {.name = "right", .channel = I2S_CHANNEL_RIGHT},
+    {.name = "both", .channel = I2S_CHANNEL_BOTH},
+};
+
+/**
+ * Standard I2S transmitter, a stereo pair sharing the data line. Bits change
+ * on the SCK falling edge, the MSB one clock after WS changes, 24 bits then
+ * zeros until the next WS edge.
+ */
+typedef struct {
+    const int32_t *left;
+    const int32_t *right;
+    size_t index[2];
+    int bit;
+    bool ws;
+    bool data;
+} microphone_t;
+
+static void microphone_falling_edge(microphone_t *this, bool ws) {
+    const int32_t *samples;
+
+    if (ws != this->ws) {
+        // The word of the channel that just ended is done
+        if (this->bit > -1)
+            this->index[this->ws]++;
+
+        this->ws = ws;
+        this->bit = -1;
+    } else {
+        this->bit++;
+    }
+
+    samples = this->ws ? this->right : this->left;
+
+    if (this->bit >= 0 && this->bit < 24 &&
+        this->index[this->ws] < SAMPLE_COUNT)
+        this->data = (samples[this->index[this->ws]] >> (23 - this->bit)) & 1;
+    else
+        this->data = false;
+}
+
+/**
+ * @brief Run a program until it pushed word_count words, the subset of PIO
+ * the i2s programs use: set x, in pins, jmp x--, nop and a 2 bit side-set
+ * of SCK and WS.
+ */
+static size_t run_program(const uint16_t *instructions, size_t length,
+                          bool invert_ws, microphone_t *microphone,
+                          int32_t *words, size_t word_count) {
+    uint32_t isr = 0, x = 0, shift_count = 0, pc = 0;
+    size_t pushed = 0;
+    // As the end of the previous frame left it
+    bool sck = true;
+    // Way more cycles than the words need, stops a broken program
+    size_t budget = word_count * 64 * 4 + 256;
+
+    while (pushed < word_count && budget-- > 0) {
+        uint16_t instruction = instructions[pc];
+        uint32_t side = (instruction >> 11) & 0x3;
+        bool next_sck = side & 1, ws = ((side >> 1) & 1) ^ invert_ws;
+        uint32_t next_pc = (pc + 1) % length;
+
+        // Side-set lands at the start of the cycle, before any sampling
+        if (sck && !next_sck)
+            microphone_falling_edge(microphone, ws);
+
+        sck = next_sck;
+
+        switch (instruction >> 13) {
+        case 0: // jmp
+            if (((instruction >> 5) & 0x7) == 2) {
+                if (x-- != 0)
+                    next_pc = instruction & 0x1f;
+            } else if (((instruction >> 5) & 0x7) == 0) {
+                next_pc = instruction & 0x1f;
+            }
+            break;
+        case 2: // in pins, shifting left with autopush at 32
+            for (uint32_t bit = 0; bit < (instruction & 0x1fu); bit++) {
+                isr = (isr << 1) | microphone->data;
+
+                if (++shift_count == 32) {
+                    words[pushed++] = (int32_t)isr;
+                    isr = 0;
+                    shift_count = 0;
+                }
+            }
+            break;
+        case 5: // mov y, y
+            break;
+        case 7: // set x
+            x = instruction & 0x1f;
+            break;
+        default:
+            // Outside the subset, gen_pio.py should not have let it through
+            return pushed;
+        }
+
+        pc = next_pc;
+    }
+
+    return pushed;
+}
+
+static bool check_plane(const int32_t *words, const int32_t *expected) {
+    for (size_t i = 0; i < SAMPLE_COUNT; i++)
+        if (i2s_sanitize_sample(words[i]) != expected[i])
+            return false;
+
+    return true;
+}
+
+static bool run_selection(const selection_t *selection, const int32_t *left,
+                          const int32_t *right) {
+    static int32_t words[2 * SAMPLE_COUNT];
+    static int32_t planes[2 * SAMPLE_COUNT];
+    const int32_t *layout = words;
+    // WS about to change, so the first frame starts cleanly
+    microphone_t microphone = {
+        .left = left,
+        .right = right,
+        .bit = -1,
+        .ws = selection->channel != I2S_CHANNEL_RIGHT,
+    };
+    bool mono = selection->channel != I2S_CHANNEL_BOTH;
+    size_t word_count = i2s_required_buffer_size(SAMPLE_COUNT,
+                                                 selection->channel) /
+                        sizeof(uint32_t);
+    size_t pushed;
+    bool pass;
+
+    pushed = run_program(
+        mono ? i2s_mono_instructions : i2s_instructions,
+        mono ? sizeof(i2s_mono_instructions) / sizeof(uint16_t)
+             : sizeof(i2s_instructions) / sizeof(uint16_t),
+        selection->channel == I2S_CHANNEL_RIGHT, &microphone, words,
+        word_count);
+
+    // What the driver publishes
+    if (selection->channel == I2S_CHANNEL_BOTH) {
+        i2s_deinterleave(planes, words, SAMPLE_COUNT);
+        layout = planes;
+    }
+
+    switch (selection->channel) {
+    case I2S_CHANNEL_LEFT:
+        pass = check_plane(layout, left);
+        break;
+    case I2S_CHANNEL_RIGHT:
+        pass = check_plane(layout, right);
+        break;
+    default:
+        pass = check_plane(layout, left) &&
+               check_plane(layout + SAMPLE_COUNT, right);
+        break;
+    }
+
+    pass = pass && pushed == word_count;
+
+    printf("i2s,%s,%u,%u,%.1f,%s\n", selection->name, (unsigned)SAMPLE_COUNT,
+           (unsigned)pushed, (float)pushed / SAMPLE_COUNT,
+           pass ? "pass" : "FAIL");
+
+    return pass;
+}
+
+bool bench_i2s(void) {
+    static int32_t left[SAMPLE_COUNT], right[SAMPLE_COUNT];
+    bool passed = true;
+
+    // Full scale signed 24 bit, so the sign bit is exercised too
+    for (size_t i = 0; i < SAMPLE_COUNT; i++) {
+        left[i] = (int32_t)(bench_random() * 0x7fffff);
+        right[i] = (int32_t)(bench_random() * 0x7fffff);
+    }
+
+    printf("suite,channel,samples,words,words_per_sample,layout\n");
+
+    for (size_t i = 0; i < sizeof(selections) / sizeof(selections[0]); i++)
+        passed = run_selection(&selections[i], left, right) && passed;
+
+    return passed;
+}
@@ -0,0 +1,164 @@
+#include "bench.h"
+#include "i2s.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Timing model rather than a benchmark. The PIO pushes one word per word
+ * period into the joined RX FIFO, the DMA drains it into buffers and every
+ * finished buffer raises an interrupt that is serviced after an injected
+ * latency. The single channel driver has to rearm from the interrupt, the
+ * chained one only publishes.
+ */
+
+// Joined RX FIFO
+#define FIFO_DEPTH 8
+// Words per buffer, as main captures them
+#define HOP_WORDS 64
+#define HOP_COUNT 4000
+
+#define WORD_US (1000000.0 / I2S_SAMPLE_RATE)
+
+typedef enum {
+    MODE_SINGLE,
+    MODE_CHAINED,
+} dma_mode_t;
+
+static const char *const mode_names[] = {"single", "chained"};
+
+// Worst case interrupt latency, uniformly jittered below it
+static const uint32_t latencies_us[] = {0,   40,   100,  200,  500,
+                                        1000, 1250, 1500, 3000};
+
+typedef struct {
+    // Words left in the current transfer, 0 when idle
+    uint32_t remaining;
+    bool irq_pending;
+    uint64_t irq_at;
+} channel_t;
+
+typedef struct {
+    dma_mode_t mode;
+    uint32_t max_latency;
+    channel_t channels[2];
+    size_t active;
+    uint32_t fifo_level;
+    // Words the microphone produced and the ones the stalled PIO missed
+    uint64_t samples;
+    uint64_t dropped_samples;
+    uint32_t published;
+    uint32_t overruns;
+} model_t;
+
+static uint32_t random_latency(const model_t *this) {
+    return (uint32_t)((bench_random() + 1.f) * 0.5f * this->max_latency +
+                      0.5f);
+}
+
+static void service_interrupts(model_t *this, uint64_t now) {
+    for (size_t i = 0; i < 2; i++) {
+        channel_t *channel = &this->channels[i];
+
+        if (!channel->irq_pending || channel->irq_at > now)
+            continue;
+
+        channel->irq_pending = false;
+
+        if (this->mode == MODE_SINGLE) {
+            // Publish, then rearm, the FIFO covers the time in between
+            this->published++;
+            channel->remaining = HOP_WORDS;
+        } else if (channel->remaining > 0) {
+            // Chained back in and overwriting, see publish in i2s.c
+            this->overruns++;
+        } else {
+            this->published++;
+        }
+    }
+}
+
+static void finish_transfer(model_t *this, uint64_t now) {
+    channel_t *channel = &this->channels[this->active];
+
+    // A second completion before the first was serviced folds into it, that
+    // buffer is gone
+    if (channel->irq_pending)
+        this->overruns++;
+
+    channel->irq_pending = true;
+    channel->irq_at = now + random_latency(this);
+
+    if (this->mode == MODE_CHAINED) {
+        this->active ^= 1;
+        this->channels[this->active].remaining = HOP_WORDS;
+    }
+}
+
+static void run(model_t *this) {
+    uint64_t end = (uint64_t)HOP_COUNT * HOP_WORDS;
+
+    this->channels[0].remaining = HOP_WORDS;
+
+    for (uint64_t now = 0; now < end; now++) {
+        service_interrupts(this, now);
+
+        // A full FIFO stalls autopush, the word never makes it in
+        this->samples++;
+
+        if (this->fifo_level == FIFO_DEPTH)
+            this->dropped_samples++;
+        else
+            this->fifo_level++;
+
+        // The DMA is way faster than the word rate, drain all there is
+        while (this->fifo_level > 0 &&
+               this->channels[this->active].remaining > 0) {
+            this->fifo_level--;
+
+            if (--this->channels[this->active].remaining == 0)
+                finish_transfer(this, now);
+        }
+    }
+}
+
+bool bench_i2s_dma(void) {
+    bool passed = true;
+
+    printf("suite,mode,hop_us,max_latency_us,samples,dropped_samples,"
+           "published,overruns,result\n");
+
+    for (size_t i = 0; i < sizeof(latencies_us) / sizeof(latencies_us[0]);
+         i++) {
+        for (dma_mode_t mode = MODE_SINGLE; mode <= MODE_CHAINED; mode++) {
+            model_t model = {
+                .mode = mode,
+                .max_latency = (uint32_t)(latencies_us[i] / WORD_US),
+            };
+            const char *result = "-";
+
+            run(&model);
+
+            // Anything under a buffer of latency must not lose a sample
+            if (mode == MODE_CHAINED && model.max_latency < HOP_WORDS) {
+                result = "pass";
+
+                if (model.dropped_samples != 0 || model.overruns != 0) {
+                    result = "FAIL";
+                    passed = false;
+                }
+            }
+
+            printf("i2s_dma,%s,%.0f,%u,%llu,%llu,%u,%u,%s\n",
+                   mode_names[mode], HOP_WORDS * WORD_US,
+                   (unsigned)latencies_us[i],
+                   (unsigned long long)model.samples,
+                   (unsigned long long)model.dropped_samples,
+                   (unsigned)model.published, (unsigned)model.overruns,
+                   result);
+        }
+    }
+
+    return passed;
+}
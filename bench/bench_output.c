@@ -0,0 +1,221 @@
+#include "bench.h"
+#include "output.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Gamma, brightness and current limit over a whole frame, each as a pass of
+ * its own against the fused output stage. Every run starts from a copy of
+ * the same random frame, the copy alone is timed too. The fused stage is
+ * checked against a plain per channel reference, and every limited frame
+ * against its budget, the last column reads pass or FAIL. A budget under
+ * what the dark LEDs draw can only be met as far as that.
+ */
+
+#define MAX_PIXEL_COUNT 2400
+
+#define GAMMA 2.5f
+#define BRIGHTNESS 192
+
+static const size_t pixel_counts[] = {300, 2400};
+// Unlimited, then 5 V supplies of 2 A and 10 A
+static const uint32_t budgets_ma[] = {0, 2000, 10000};
+
+typedef struct {
+    const uint32_t *source;
+    uint32_t *pixels;
+    size_t count;
+    output_t *output;
+    // Gamma alone, for the separate passes
+    const uint8_t *gamma_lut;
+    uint32_t current_ma;
+} context_t;
+
+static void run_copy(void *context) {
+    context_t *ctx = context;
+
+    memcpy(ctx->pixels, ctx->source, ctx->count * sizeof(uint32_t));
+}
+
+static uint32_t scale_channel(uint32_t pixel, unsigned shift, uint32_t scale) {
+    return ((pixel >> shift & 0xFF) * scale >> 8) << shift;
+}
+
+static void run_separate(void *context) {
+    context_t *ctx = context;
+    const uint8_t *lut = ctx->gamma_lut;
+    uint32_t *pixels = ctx->pixels, levels = 0, pixel, idle_ma, scale;
+    uint64_t channel_ma, allowed_ma;
+    output_t *output = ctx->output;
+
+    memcpy(pixels, ctx->source, ctx->count * sizeof(uint32_t));
+
+    for (size_t i = 0; i < ctx->count; i++) {
+        pixel = pixels[i];
+        pixels[i] = (uint32_t)lut[pixel >> 24] << 24 |
+                    (uint32_t)lut[pixel >> 16 & 0xFF] << 16 |
+                    (uint32_t)lut[pixel >> 8 & 0xFF] << 8;
+    }
+
+    for (size_t i = 0; i < ctx->count; i++)
+        pixels[i] = scale_channel(pixels[i], 24, BRIGHTNESS + 1) |
+                    scale_channel(pixels[i], 16, BRIGHTNESS + 1) |
+                    scale_channel(pixels[i], 8, BRIGHTNESS + 1);
+
+    for (size_t i = 0; i < ctx->count; i++)
+        levels += (pixels[i] >> 24) + (pixels[i] >> 16 & 0xFF) +
+                  (pixels[i] >> 8 & 0xFF);
+
+    idle_ma = output->idle_ma * (uint32_t)ctx->count;
+    channel_ma = (uint64_t)levels * output->channel_ma;
+    allowed_ma = output->budget_ma > idle_ma ? output->budget_ma - idle_ma : 0;
+
+    if (output->budget_ma == 0 || channel_ma <= allowed_ma * 255) {
+        ctx->current_ma = idle_ma + (uint32_t)(channel_ma / 255);
+        return;
+    }
+
+    scale = (uint32_t)((allowed_ma * 255 << 8) / channel_ma);
+
+    for (size_t i = 0; i < ctx->count; i++)
+        pixels[i] = scale_channel(pixels[i], 24, scale) |
+                    scale_channel(pixels[i], 16, scale) |
+                    scale_channel(pixels[i], 8, scale);
+
+    ctx->current_ma = idle_ma + (uint32_t)((channel_ma * scale >> 8) / 255);
+}
+
+static void run_fused(void *context) {
+    context_t *ctx = context;
+
+    memcpy(ctx->pixels, ctx->source, ctx->count * sizeof(uint32_t));
+    ctx->current_ma = output_apply(ctx->output, ctx->pixels, ctx->count);
+}
+
+/**
+ * @brief What output_apply must come to, a channel at a time.
+ */
+static void apply_reference(const output_t *output, const uint32_t *source,
+                            uint32_t *pixels, size_t count) {
+    uint32_t levels = 0, idle_ma = output->idle_ma * (uint32_t)count, scale;
+    uint64_t channel_ma, allowed_ma;
+
+    for (size_t i = 0; i < count; i++) {
+        pixels[i] = (uint32_t)output->lut_g[source[i] >> 24] << 24 |
+                    (uint32_t)output->lut_r[source[i] >> 16 & 0xFF] << 16 |
+                    (uint32_t)output->lut_b[source[i] >> 8 & 0xFF] << 8;
+        levels += (pixels[i] >> 24) + (pixels[i] >> 16 & 0xFF) +
+                  (pixels[i] >> 8 & 0xFF);
+    }
+
+    channel_ma = (uint64_t)levels * output->channel_ma;
+    allowed_ma = output->budget_ma > idle_ma ? output->budget_ma - idle_ma : 0;
+
+    if (output->budget_ma == 0 || channel_ma <= allowed_ma * 255)
+        return;
+
+    scale = (uint32_t)(allowed_ma * 255 * 256 / channel_ma);
+
+    for (size_t i = 0; i < count; i++)
+        pixels[i] = scale_channel(pixels[i], 24, scale) |
+                    scale_channel(pixels[i], 16, scale) |
+                    scale_channel(pixels[i], 8, scale);
+}
+
+static bool within_budget(const context_t *ctx, uint32_t budget_ma) {
+    uint32_t idle_ma = ctx->output->idle_ma * (uint32_t)ctx->count;
+
+    return budget_ma == 0 ||
+           ctx->current_ma <= (budget_ma > idle_ma ? budget_ma : idle_ma);
+}
+
+static void print_row(const char *variant, const context_t *ctx,
+                      uint32_t budget_ma, double ns, bool passed) {
+    printf("output,%s,%u,%u,%.1f,%.2f,%.1f,%u,%s\n", variant,
+           (unsigned)ctx->count, (unsigned)budget_ma, ns, ns / ctx->count,
+           bench_ns_to_cycles(ns) / ctx->count, (unsigned)ctx->current_ma,
+           passed ? "pass" : "FAIL");
+}
+
+bool bench_output(void) {
+    static uint32_t source[MAX_PIXEL_COUNT];
+    static uint32_t pixels[MAX_PIXEL_COUNT];
+    static uint32_t expected[MAX_PIXEL_COUNT];
+    static uint8_t gamma_lut[OUTPUT_LEVEL_COUNT];
+    output_config_t config = output_default_config();
+    output_t output, gamma_only;
+    context_t ctx = {
+        .source = source,
+        .pixels = pixels,
+        .output = &output,
+        .gamma_lut = gamma_lut,
+    };
+    bool passed, all_passed = true;
+    double ns;
+
+    config.gamma_r = config.gamma_g = config.gamma_b = GAMMA;
+
+    // The gamma table of the separate passes, at full brightness
+    if (output_init(&gamma_only, NULL, &config) < 0) {
+        printf("# output: could not initialize\n");
+        return false;
+    }
+
+    memcpy(gamma_lut, gamma_only.lut_g, sizeof(gamma_lut));
+    output_deinit(&gamma_only);
+
+    config.brightness = BRIGHTNESS;
+
+    if (output_init(&output, NULL, &config) < 0) {
+        printf("# output: could not initialize\n");
+        return false;
+    }
+
+    // Junk in the low byte too, the stage must clear it
+    for (size_t i = 0; i < MAX_PIXEL_COUNT; i++)
+        source[i] = (uint32_t)((bench_random() + 1.f) * 32767.f) << 16 |
+                    (uint32_t)((bench_random() + 1.f) * 32767.f);
+
+    printf("# gamma %.1f, brightness %u, %u mA per channel, %u mA per LED "
+           "idle, budget 0 is unlimited\n",
+           GAMMA, (unsigned)BRIGHTNESS, (unsigned)output.channel_ma,
+           (unsigned)output.idle_ma);
+    printf("suite,variant,pixels,budget_ma,ns_per_frame,ns_per_pixel,"
+           "cycles_per_pixel,current_ma,check\n");
+
+    for (size_t c = 0; c < sizeof(pixel_counts) / sizeof(pixel_counts[0]);
+         c++) {
+        ctx.count = pixel_counts[c];
+
+        for (size_t b = 0; b < sizeof(budgets_ma) / sizeof(budgets_ma[0]);
+             b++) {
+            config.budget_ma = budgets_ma[b];
+            output_configure(&output, &config);
+
+            ctx.current_ma = 0;
+            print_row("copy", &ctx, config.budget_ma,
+                      bench_measure_ns(run_copy, &ctx), true);
+
+            ns = bench_measure_ns(run_separate, &ctx);
+            passed = within_budget(&ctx, config.budget_ma);
+            all_passed = all_passed && passed;
+            print_row("separate", &ctx, config.budget_ma, ns, passed);
+
+            apply_reference(&output, source, expected, ctx.count);
+            run_fused(&ctx);
+            passed = memcmp(pixels, expected, ctx.count * sizeof(uint32_t)) ==
+                         0 &&
+                     within_budget(&ctx, config.budget_ma);
+            all_passed = all_passed && passed;
+
+            print_row("fused", &ctx, config.budget_ma,
+                      bench_measure_ns(run_fused, &ctx), passed);
+        }
+    }
+
+    output_deinit(&output);
+
+    return all_passed;
+}
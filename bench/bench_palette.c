@@ -0,0 +1,84 @@
+#include "bench.h"
+#include "color.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PIXEL_COUNT 300
+
+typedef struct {
+    const float *magnitudes;
+    const uint16_t *indices;
+    uint32_t *pixels;
+    color_palette_t palette;
+} context_t;
+
+// What the visualizer did before palettes, float HSV per pixel
+static void run_hsv(void *context) {
+    context_t *ctx = context;
+
+    for (size_t i = 0; i < PIXEL_COUNT; i++) {
+        float magnitude = ctx->magnitudes[i];
+
+        if (magnitude < 0.f)
+            magnitude = 0.f;
+
+        if (magnitude > 1.f)
+            magnitude = 1.f;
+
+        ctx->pixels[i] =
+            color_neopixel_from_hsv_f(magnitude * 360.f, 1.f, 1.f).value;
+    }
+}
+
+static void run_map_f(void *context) {
+    context_t *ctx = context;
+
+    color_palette_map_f(&ctx->palette, ctx->magnitudes, ctx->pixels,
+                        PIXEL_COUNT);
+}
+
+static void run_map(void *context) {
+    context_t *ctx = context;
+
+    color_palette_map(&ctx->palette, ctx->indices, ctx->pixels, PIXEL_COUNT);
+}
+
+static void print_row(const char *method, size_t size, double ns) {
+    printf("palette,%s,%u,%u,%.1f,%.0f\n", method, (unsigned)size,
+           (unsigned)PIXEL_COUNT, ns, bench_ns_to_cycles(ns));
+}
+
+bool bench_palette(void) {
+    static const size_t sizes[] = {COLOR_PALETTE_SIZE_SMALL,
+                                   COLOR_PALETTE_SIZE_LARGE};
+    static color_neopixel_t entries[COLOR_PALETTE_SIZE_LARGE];
+    static float magnitudes[PIXEL_COUNT];
+    static uint16_t indices[PIXEL_COUNT];
+    static uint32_t pixels[PIXEL_COUNT];
+    context_t ctx = {
+        .magnitudes = magnitudes, .indices = indices, .pixels = pixels};
+
+    printf("suite,method,entries,pixels,ns_per_frame,cycles_per_frame\n");
+
+    for (size_t i = 0; i < PIXEL_COUNT; i++) {
+        float value = bench_random();
+        magnitudes[i] = value < 0.f ? -value : value;
+    }
+
+    print_row("hsv_f", 0, bench_measure_ns(run_hsv, &ctx));
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        color_palette_init(&ctx.palette, entries, sizes[i]);
+        color_palette_from_hsv(&ctx.palette, 0.f, 360.f, 1.f, 1.f);
+
+        for (size_t pixel = 0; pixel < PIXEL_COUNT; pixel++)
+            indices[pixel] =
+                color_palette_quantize(&ctx.palette, magnitudes[pixel]);
+
+        print_row("palette_map_f", sizes[i], bench_measure_ns(run_map_f, &ctx));
+        print_row("palette_map", sizes[i], bench_measure_ns(run_map, &ctx));
+    }
+
+    return true;
+}
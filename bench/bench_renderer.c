@@ -0,0 +1,181 @@
+#include "bench.h"
+#include "renderer.h"
+#include "visualizer.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Per frame cost of every built-in renderer, and of switching to the next
+ * one on every frame through a renderer set. Each renderer is checked
+ * against a property of its own: the spectrum against the per band division
+ * it replaces, mirrored and pulse for symmetry, the VU bar for its length.
+ * Every switched frame must match what the renderer draws on its own. The
+ * last column reads pass or FAIL.
+ */
+
+#define MAX_PIXEL_COUNT 2400
+#define BAND_COUNT 32
+
+static const size_t pixel_counts[] = {300, 2400};
+
+typedef struct {
+    const float *bands;
+    uint32_t *pixels;
+    renderer_t *renderer;
+    renderer_set_t *set;
+} context_t;
+
+static void run_renderer(void *context) {
+    context_t *ctx = context;
+
+    renderer_render(ctx->renderer, ctx->bands, ctx->pixels);
+}
+
+static void run_switch(void *context) {
+    context_t *ctx = context;
+    renderer_kind_t next = (renderer_kind_t)(
+        (renderer_set_selected(ctx->set) + 1) % RENDERER_COUNT);
+
+    renderer_set_select(ctx->set, next);
+    renderer_set_render(ctx->set, ctx->bands, ctx->pixels);
+}
+
+/**
+ * @brief The spectrum the way it used to be drawn, a division per band.
+ */
+static bool check_spectrum(const float *bands, const uint32_t *pixels,
+                           size_t count) {
+    const color_palette_t *colors = visualizer_get_palette();
+    size_t pixel = 0;
+
+    for (size_t band = 0; band < BAND_COUNT; band++) {
+        size_t end = (band + 1) * count / BAND_COUNT;
+        uint32_t color = color_palette_lookup(colors, bands[band]).value;
+
+        for (; pixel < end; pixel++)
+            if (pixels[pixel] != color)
+                return false;
+    }
+
+    return true;
+}
+
+static bool check_symmetric(const uint32_t *pixels, size_t count) {
+    for (size_t i = 0; i < count / 2; i++)
+        if (pixels[i] != pixels[count - 1 - i])
+            return false;
+
+    return true;
+}
+
+static bool check_vu(const float *bands, const uint32_t *pixels,
+                     size_t count) {
+    float level = 0.f;
+    size_t lit = 0;
+
+    for (size_t band = 0; band < BAND_COUNT; band++)
+        level += bands[band];
+
+    // The bar is lit up to its length and dark past it, the first pixel
+    // takes the bottom of the palette
+    while (lit < count && pixels[lit] != 0)
+        lit++;
+
+    for (size_t i = lit; i < count; i++)
+        if (pixels[i] != 0)
+            return false;
+
+    level = level / BAND_COUNT * count;
+
+    return lit + 1 >= level && lit <= level + 1;
+}
+
+static bool check(renderer_kind_t kind, const float *bands,
+                  const uint32_t *pixels, size_t count) {
+    switch (kind) {
+    case RENDERER_SPECTRUM:
+        return check_spectrum(bands, pixels, count);
+    case RENDERER_MIRRORED_SPECTRUM:
+    case RENDERER_PULSE:
+        return check_symmetric(pixels, count);
+    case RENDERER_VU:
+        return check_vu(bands, pixels, count);
+    default:
+        return false;
+    }
+}
+
+static void print_row(const char *variant, size_t count, double ns,
+                      bool passed) {
+    printf("renderer,%s,%u,%u,%.1f,%.2f,%.1f,%s\n", variant, (unsigned)count,
+           (unsigned)BAND_COUNT, ns, ns / count,
+           bench_ns_to_cycles(ns) / count, passed ? "pass" : "FAIL");
+}
+
+static bool run_pixel_count(const float *bands, size_t count) {
+    static uint32_t pixels[MAX_PIXEL_COUNT];
+    static uint32_t expected[RENDERER_COUNT][MAX_PIXEL_COUNT];
+    renderer_geometry_t geometry = {
+        .pixel_count = count,
+        .band_count = BAND_COUNT,
+    };
+    renderer_set_t set;
+    context_t ctx = {.bands = bands, .pixels = pixels, .set = &set};
+    renderer_kind_t kind;
+    bool passed, all_passed = true;
+    double ns;
+
+    if (renderer_set_init(&set, NULL, &geometry) < 0) {
+        printf("# %u pixels skipped\n", (unsigned)count);
+        return false;
+    }
+
+    for (size_t i = 0; i < RENDERER_COUNT; i++) {
+        ctx.renderer = &set.renderers[i];
+        run_renderer(&ctx);
+        memcpy(expected[i], pixels, count * sizeof(uint32_t));
+        passed = check((renderer_kind_t)i, bands, pixels, count);
+        all_passed = all_passed && passed;
+
+        print_row(renderer_get_ops((renderer_kind_t)i)->name, count,
+                  bench_measure_ns(run_renderer, &ctx), passed);
+    }
+
+    ns = bench_measure_ns(run_switch, &ctx);
+
+    // Twice around, every frame as drawn by the renderer alone
+    passed = true;
+
+    for (size_t i = 0; i < 2 * RENDERER_COUNT; i++) {
+        run_switch(&ctx);
+        kind = renderer_set_selected(&set);
+        passed = passed &&
+                 memcmp(pixels, expected[kind], count * sizeof(uint32_t)) == 0;
+    }
+
+    print_row("switch", count, ns, passed);
+
+    renderer_set_deinit(&set);
+
+    return all_passed && passed;
+}
+
+bool bench_renderer(void) {
+    float bands[BAND_COUNT];
+    bool passed = true;
+
+    // Magnitudes in [0, 1], loud enough to light most of the VU bar
+    for (size_t i = 0; i < BAND_COUNT; i++)
+        bands[i] = (bench_random() + 1.f) * 0.5f;
+
+    printf("suite,renderer,pixels,bands,ns_per_frame,ns_per_pixel,"
+           "cycles_per_pixel,check\n");
+
+    for (size_t c = 0; c < sizeof(pixel_counts) / sizeof(pixel_counts[0]);
+         c++)
+        passed = run_pixel_count(bands, pixel_counts[c]) && passed;
+
+    return passed;
+}
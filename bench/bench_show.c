@@ -0,0 +1,407 @@
+#include "bench.h"
+#include "show.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Check of the show format. Frames built to hit every kind of run, the
+ * 63/64/65 pixel edges of the run length included, go through the encoder
+ * and back, the reader then has to match them sequentially and after a seek
+ * to every frame. Malformed input has to be turned down without reading
+ * past the bytes it was given. The last column reads pass or FAIL.
+ */
+
+// Long enough for runs over the 64 pixel cap, small enough for the device
+#define LED_COUNT 130
+#define FRAME_COUNT 96
+
+// Padding byte of a pixel, not part of the show
+#define GRB_MASK 0xFFFFFF00u
+
+// Every exact block count and a partial last block, 96 = 1.5 x 64
+static const uint32_t block_frame_counts[] = {1, 16,
+                                              SHOW_DEFAULT_BLOCK_FRAMES};
+
+// Lengths the runs of a frame cycle through
+static const size_t run_lengths[] = {1, 63, 64, 65, 2, 129};
+
+typedef struct {
+    show_reader_t reader;
+} context_t;
+
+static uint32_t random_pixel(void) {
+    // Junk in the padding byte, the coder must leave it out
+    return (uint32_t)((bench_random() + 1.f) * 8388607.f) << 8 |
+           (uint32_t)((bench_random() + 1.f) * 127.f);
+}
+
+static size_t run_length(size_t run, size_t left) {
+    size_t length = run_lengths[run % (sizeof(run_lengths) /
+                                       sizeof(run_lengths[0]))];
+
+    return length < left ? length : left;
+}
+
+static bool same_frame(const uint32_t *a, const uint32_t *b) {
+    for (size_t i = 0; i < LED_COUNT; i++)
+        if ((a[i] ^ b[i]) & GRB_MASK)
+            return false;
+
+    return true;
+}
+
+/**
+ * @brief Frame f of the show, cycling through random pixels, an unchanged
+ * frame and runs of fills, skips and literals of run_lengths.
+ */
+static void make_frame(uint32_t *frame, const uint32_t *previous, size_t f) {
+    size_t i, run = 0, length;
+    uint32_t pixel;
+
+    for (i = 0; i < LED_COUNT; i++)
+        frame[i] = random_pixel();
+
+    switch (f % 6) {
+    case 1:
+        // Nothing changed, a frame of skips only
+        if (previous != NULL)
+            memcpy(frame, previous, LED_COUNT * sizeof(uint32_t));
+        break;
+    case 2:
+        for (i = 0; i < LED_COUNT; i += length) {
+            length = run_length(run++, LED_COUNT - i);
+            pixel = random_pixel();
+
+            for (size_t j = 0; j < length; j++)
+                frame[i + j] = pixel;
+        }
+        break;
+    case 3:
+        // Unchanged stretches split by a single new pixel
+        for (i = 0; previous != NULL && i < LED_COUNT; i += length + 1) {
+            length = run_length(run++, LED_COUNT - i);
+            memcpy(frame + i, previous + i, length * sizeof(uint32_t));
+        }
+        break;
+    case 4:
+        // Literal stretches ended by a pair, which codes as a fill
+        for (i = 0; i + 1 < LED_COUNT; i += 2) {
+            i += run_length(run++, LED_COUNT - i);
+
+            if (i + 1 < LED_COUNT)
+                frame[i + 1] = frame[i];
+        }
+        break;
+    case 5:
+        // One color over the whole strip, with a different padding byte
+        // in every pixel
+        pixel = random_pixel() & GRB_MASK;
+
+        for (i = 0; i < LED_COUNT; i++)
+            frame[i] = pixel | (frame[i] & ~GRB_MASK);
+        break;
+    default:
+        break;
+    }
+}
+
+static void write_u64(uint8_t *bytes, uint64_t value) {
+    for (size_t i = 0; i < 8; i++)
+        bytes[i] = (uint8_t)(value >> (8 * i));
+}
+
+/**
+ * @brief Encode the frames into a show, checking every frame decodes back
+ * on its own on the way.
+ *
+ * @return size_t Size of the show, 0 if a frame did not round-trip
+ */
+static size_t build_show(uint8_t *show, const uint32_t *frames,
+                         uint32_t block_frames) {
+    static uint32_t decoded[LED_COUNT];
+    static uint64_t offsets[FRAME_COUNT];
+    show_header_t header = {
+        .led_count = LED_COUNT,
+        .frame_rate_mhz = 60000,
+        .frame_count = FRAME_COUNT,
+        .block_frames = block_frames,
+        .block_count = (FRAME_COUNT + block_frames - 1) / block_frames,
+    };
+    size_t position = SHOW_HEADER_SIZE, size;
+    const uint32_t *previous;
+    bool passed = true;
+
+    for (size_t f = 0; f < FRAME_COUNT; f++) {
+        previous = f % block_frames ? frames + (f - 1) * LED_COUNT : NULL;
+
+        // A block's first frame must not lean on what came before it
+        if (previous == NULL) {
+            memset(decoded, 0xA5, sizeof(decoded));
+            offsets[f / block_frames] = position;
+        }
+
+        size = show_encode_frame(frames + f * LED_COUNT, previous, LED_COUNT,
+                                 show + position);
+        passed = passed && size <= SHOW_MAX_FRAME_SIZE(LED_COUNT) &&
+                 show_decode_frame(show + position, size, decoded,
+                                   LED_COUNT) == size &&
+                 same_frame(decoded, frames + f * LED_COUNT);
+        position += size;
+    }
+
+    // The index sits right after the blocks
+    header.index_offset = position;
+
+    for (size_t b = 0; b < header.block_count; b++)
+        write_u64(show + position + 8 * b, offsets[b]);
+
+    show_write_header(show, &header);
+
+    return passed ? position + 8 * header.block_count : 0;
+}
+
+static bool check_sequential(show_reader_t *reader, const uint32_t *frames) {
+    const uint32_t *pixels;
+
+    if (show_reader_seek(reader, 0) < 0)
+        return false;
+
+    for (size_t f = 0; f < FRAME_COUNT; f++)
+        if ((pixels = show_reader_next(reader)) == NULL ||
+            !same_frame(pixels, frames + f * LED_COUNT))
+            return false;
+
+    return show_reader_next(reader) == NULL;
+}
+
+/**
+ * @brief Seek to every frame, last one first so no seek gets the state of
+ * a sequential read for free, and one past the end and beyond.
+ */
+static bool check_seek(show_reader_t *reader, const uint32_t *frames) {
+    const uint32_t *pixels;
+
+    if (show_reader_seek(reader, FRAME_COUNT) < 0 ||
+        show_reader_next(reader) != NULL ||
+        show_reader_seek(reader, FRAME_COUNT + 1) >= 0)
+        return false;
+
+    for (size_t f = FRAME_COUNT; f-- > 0;)
+        if (show_reader_seek(reader, (uint32_t)f) < 0 ||
+            (pixels = show_reader_next(reader)) == NULL ||
+            !same_frame(pixels, frames + f * LED_COUNT))
+            return false;
+
+    return true;
+}
+
+static void run_sequential(void *context) {
+    context_t *ctx = context;
+
+    show_reader_seek(&ctx->reader, 0);
+
+    while (show_reader_next(&ctx->reader) != NULL)
+        ;
+}
+
+static void run_seek(void *context) {
+    context_t *ctx = context;
+
+    for (uint32_t f = 0; f < FRAME_COUNT; f++)
+        show_reader_seek(&ctx->reader, f);
+}
+
+static void print_row(const char *check, uint32_t block_frames,
+                      double bytes_per_frame, double ns, bool passed) {
+    printf("show,%s,%u,%u,%.1f,%.1f,%.0f,%s\n", check, (unsigned)block_frames,
+           (unsigned)FRAME_COUNT, bytes_per_frame, ns, bench_ns_to_cycles(ns),
+           passed ? "pass" : "FAIL");
+}
+
+/**
+ * @brief Decode a copy of bytes in a buffer of exactly size, so a read past
+ * the end hits the allocation's edge rather than more valid data.
+ */
+static size_t decode_exact(const uint8_t *bytes, size_t size,
+                           size_t led_count) {
+    static uint32_t pixels[LED_COUNT];
+    uint8_t *copy = malloc(size ? size : 1);
+    size_t used;
+
+    if (copy == NULL)
+        return (size_t)-1;
+
+    memcpy(copy, bytes, size);
+    used = show_decode_frame(copy, size, pixels, led_count);
+    free(copy);
+
+    return used;
+}
+
+/**
+ * @brief Frames the decoder must turn down, every one would read or write
+ * past what it was given if taken at face value.
+ */
+static bool check_malformed_frames(const uint8_t *frame, size_t size) {
+    static const uint8_t long_skip[] = {SHOW_OP_SKIP << 6 | 9, 0};
+    static const uint8_t long_fill[] = {SHOW_OP_FILL << 6 | 10, 1, 2, 3};
+    static const uint8_t short_literal[] = {SHOW_OP_LITERAL << 6 | 1, 1, 2, 3,
+                                            4, 5};
+    static const uint8_t short_fill[] = {SHOW_OP_FILL << 6 | 3, 1, 2};
+    static const uint8_t bad_op[] = {3 << 6 | 3};
+    bool passed = true;
+
+    // Runs one pixel longer than the LEDs left
+    passed = passed && decode_exact(long_skip, sizeof(long_skip), 9) == 0;
+    passed = passed && decode_exact(long_fill, sizeof(long_fill), 10) == 0;
+    // A pixel short
+    passed = passed &&
+             decode_exact(short_literal, sizeof(short_literal), 4) == 0;
+    passed = passed && decode_exact(short_fill, sizeof(short_fill), 4) == 0;
+    passed = passed && decode_exact(bad_op, sizeof(bad_op), 4) == 0;
+
+    // A real frame cut anywhere short of its end
+    for (size_t cut = 0; cut < size; cut++)
+        passed = passed && decode_exact(frame, cut, LED_COUNT) == 0;
+
+    return passed && decode_exact(frame, size, LED_COUNT) == size;
+}
+
+/**
+ * @brief Shows the reader must turn down at init or fail on at seek, with
+ * a bad header, a truncated index or block offsets outside the blocks.
+ */
+static bool check_malformed_show(const uint8_t *show, size_t size) {
+    static uint32_t pixels[LED_COUNT];
+    uint8_t *copy = malloc(size);
+    show_header_t header;
+    show_reader_t reader;
+    bool passed = true;
+
+    if (copy == NULL || show_read_header(&header, show, size) < 0) {
+        free(copy);
+        return false;
+    }
+
+    // Cut into the index, and into the header
+    passed = passed && show_reader_init(&reader, NULL, show, size - 1) < 0;
+    passed = passed && show_reader_init(&reader, NULL, show,
+                                        SHOW_HEADER_SIZE - 1) < 0;
+
+    // Block count not matching the frames
+    memcpy(copy, show, size);
+    copy[20]++;
+    passed = passed && show_reader_init(&reader, NULL, copy, size) < 0;
+
+    // Index past the end of the file
+    memcpy(copy, show, size);
+    write_u64(copy + 24, size + 1);
+    passed = passed && show_reader_init(&reader, NULL, copy, size) < 0;
+
+    // Last block starting inside the index, then inside the header
+    memcpy(copy, show, size);
+    write_u64(copy + header.index_offset + 8 * (header.block_count - 1),
+              header.index_offset);
+
+    if (show_reader_init(&reader, NULL, copy, size) < 0)
+        passed = false;
+    else {
+        passed = passed && show_reader_seek(&reader, FRAME_COUNT - 1) < 0;
+        write_u64(copy + header.index_offset + 8 * (header.block_count - 1),
+                  SHOW_HEADER_SIZE - 1);
+        passed = passed && show_reader_seek(&reader, FRAME_COUNT - 1) < 0;
+        show_reader_deinit(&reader);
+    }
+
+    // A bad op in the second frame, the first still decodes
+    memcpy(copy, show, size);
+    copy[SHOW_HEADER_SIZE + show_decode_frame(show + SHOW_HEADER_SIZE,
+                                              size - SHOW_HEADER_SIZE, pixels,
+                                              LED_COUNT)] = 3 << 6;
+
+    if (show_reader_init(&reader, NULL, copy, size) < 0)
+        passed = false;
+    else {
+        passed = passed && show_reader_next(&reader) != NULL &&
+                 show_reader_next(&reader) == NULL;
+        show_reader_deinit(&reader);
+    }
+
+    free(copy);
+
+    return passed;
+}
+
+bool bench_show(void) {
+    // Every frame at its worst, and an index entry per frame for one frame
+    // blocks
+    size_t capacity = SHOW_HEADER_SIZE +
+                      FRAME_COUNT * SHOW_MAX_FRAME_SIZE(LED_COUNT) +
+                      8 * FRAME_COUNT;
+    uint32_t *frames = malloc(FRAME_COUNT * LED_COUNT * sizeof(uint32_t));
+    uint8_t *show = malloc(capacity);
+    bool passed, all_passed = true;
+    context_t ctx;
+    size_t size;
+
+    if (frames == NULL || show == NULL) {
+        printf("# show skipped\n");
+        free(frames);
+        free(show);
+        return false;
+    }
+
+    for (size_t f = 0; f < FRAME_COUNT; f++)
+        make_frame(frames + f * LED_COUNT,
+                   f ? frames + (f - 1) * LED_COUNT : NULL, f);
+
+    printf("suite,check,block_frames,frames,bytes_per_frame,ns_per_frame,"
+           "cycles_per_frame,result\n");
+
+    for (size_t b = 0;
+         b < sizeof(block_frame_counts) / sizeof(block_frame_counts[0]);
+         b++) {
+        uint32_t block_frames = block_frame_counts[b];
+
+        size = build_show(show, frames, block_frames);
+
+        if (size == 0 ||
+            show_reader_init(&ctx.reader, NULL, show, size) < 0) {
+            print_row("round_trip", block_frames, 0.0, 0.0, false);
+            all_passed = false;
+            continue;
+        }
+
+        passed = check_sequential(&ctx.reader, frames);
+        all_passed = all_passed && passed;
+        print_row("round_trip", block_frames, (double)size / FRAME_COUNT,
+                  bench_measure_ns(run_sequential, &ctx) / FRAME_COUNT,
+                  passed);
+
+        passed = check_seek(&ctx.reader, frames);
+        all_passed = all_passed && passed;
+        print_row("seek", block_frames, (double)size / FRAME_COUNT,
+                  bench_measure_ns(run_seek, &ctx) / FRAME_COUNT, passed);
+
+        show_reader_deinit(&ctx.reader);
+
+        passed = check_malformed_show(show, size);
+        all_passed = all_passed && passed;
+        print_row("malformed_show", block_frames, (double)size / FRAME_COUNT,
+                  0.0, passed);
+    }
+
+    // The first frame of the show, coded alone
+    size = show_encode_frame(frames, NULL, LED_COUNT, show);
+    passed = check_malformed_frames(show, size);
+    all_passed = all_passed && passed;
+    print_row("malformed_frame", 1, (double)size, 0.0, passed);
+
+    free(frames);
+    free(show);
+
+    return all_passed;
+}
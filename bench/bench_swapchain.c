@@ -0,0 +1,159 @@
+#include "bench.h"
+#include "swapchain.h"
+
+#include <pico/multicore.h>
+#include <pico/stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#if !PICO_ON_DEVICE
+#include <sched.h>
+#endif
+
+// Words per buffer, enough for a partial write to be caught in the act
+#define FRAME_WORDS 64
+#define FRAME_COUNT 100000
+
+// Words written or checked between forced preemptions on the host
+#define YIELD_WORDS 16
+
+typedef struct {
+    const char *name;
+    // Busy loop iterations after every publish and every consume, to skew
+    // the rates towards drops or reuses
+    uint32_t producer_delay;
+    uint32_t consumer_delay;
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+    {.name = "free_running"},
+    {.name = "slow_producer", .producer_delay = 2000},
+    {.name = "slow_consumer", .consumer_delay = 2000},
+};
+
+typedef struct {
+    const scenario_t *scenario;
+    swapchain_t swapchain;
+    uint64_t producer_us;
+    uint32_t done;
+} context_t;
+
+// multicore_launch_core1 takes no argument
+static context_t *active = NULL;
+
+static void spin(uint32_t iterations) {
+    for (volatile uint32_t i = 0; i < iterations; i++)
+        ;
+}
+
+/**
+ * The cores really run side by side, a host with a single CPU would run the
+ * producer through whole time slices instead. Give the other thread a go in
+ * the middle of every frame so writes and reads actually interleave.
+ */
+static inline void preempt(size_t word) {
+#if PICO_ON_DEVICE
+    (void)word;
+#else
+    if (word % YIELD_WORDS == YIELD_WORDS - 1)
+        sched_yield();
+#endif
+}
+
+/**
+ * Stamps every word of a frame with its number, one store at a time, so a
+ * consumer reading a buffer still being written sees a mix.
+ */
+static void producer_entry() {
+    context_t *ctx = active;
+    uint64_t start = time_us_64();
+
+    for (uint32_t frame = 1; frame <= FRAME_COUNT; frame++) {
+        volatile uint32_t *words = swapchain_producer_buffer(&ctx->swapchain);
+
+        for (size_t i = 0; i < FRAME_WORDS; i++) {
+            words[i] = frame;
+            preempt(i);
+        }
+
+        swapchain_producer_swap(&ctx->swapchain);
+        spin(ctx->scenario->producer_delay);
+    }
+
+    ctx->producer_us = time_us_64() - start;
+    __atomic_store_n(&ctx->done, 1, __ATOMIC_SEQ_CST);
+}
+
+static bool run_scenario(const scenario_t *scenario) {
+    context_t ctx = {.scenario = scenario};
+    uint32_t fresh = 0, torn = 0, out_of_order = 0, last = 0;
+    bool finished = false, passed;
+
+    if (swapchain_init(&ctx.swapchain, NULL,
+                       FRAME_WORDS * sizeof(uint32_t)) < 0) {
+        printf("# %s skipped\n", scenario->name);
+        return false;
+    }
+
+    active = &ctx;
+    multicore_launch_core1(producer_entry);
+
+    // One more swap once the producer is done, to pick up the last frame
+    while (!finished) {
+        const volatile uint32_t *words;
+
+        finished = __atomic_load_n(&ctx.done, __ATOMIC_SEQ_CST) != 0;
+
+        if (!swapchain_consumer_swap(&ctx.swapchain))
+            continue;
+
+        words = swapchain_consumer_buffer(&ctx.swapchain);
+        fresh++;
+
+        for (size_t i = 1; i < FRAME_WORDS; i++) {
+            if (words[i] != words[0]) {
+                torn++;
+                break;
+            }
+
+            preempt(i);
+        }
+
+        if (words[0] <= last)
+            out_of_order++;
+
+        last = words[0];
+        spin(scenario->consumer_delay);
+    }
+
+    multicore_reset_core1();
+    active = NULL;
+
+    // Every frame is either seen or accounted for as dropped, and the last
+    // one always makes it
+    passed = torn == 0 && out_of_order == 0 && last == FRAME_COUNT &&
+             fresh + swapchain_dropped_count(&ctx.swapchain) == FRAME_COUNT;
+
+    printf("swapchain,%s,%u,%u,%u,%u,%u,%u,%.1f,%s\n", scenario->name,
+           (unsigned)FRAME_COUNT, (unsigned)fresh,
+           (unsigned)swapchain_dropped_count(&ctx.swapchain),
+           (unsigned)swapchain_reused_count(&ctx.swapchain), (unsigned)torn,
+           (unsigned)out_of_order, ctx.producer_us * 1000.0 / FRAME_COUNT,
+           passed ? "pass" : "FAIL");
+
+    swapchain_deinit(&ctx.swapchain);
+
+    return passed;
+}
+
+bool bench_swapchain(void) {
+    bool passed = true;
+
+    printf("suite,scenario,published,fresh,dropped,reused,torn,out_of_order,"
+           "ns_per_publish,result\n");
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+        passed = run_scenario(&scenarios[i]) && passed;
+
+    return passed;
+}
@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+"""
+Assembles the programs of a .pio file into C arrays for the bench, which
+runs them in an interpreter on the host where there is no pioasm. Only the
+subset the interpreters model is accepted: jmp, in, set and nop with a
+plain side-set and delays. Anything else fails the build rather than being
+left out of the check.
+
+usage: gen_pio.py <output.h> <input.pio>
+"""
+
+import re
+import sys
+
+JMP_CONDITIONS = {"": 0, "!x": 1, "x--": 2, "!y": 3, "y--": 4, "x!=y": 5,
+                  "pin": 6, "!osre": 7}
+IN_SOURCES = {"pins": 0, "x": 1, "y": 2, "null": 3, "isr": 6, "osr": 7}
+SET_DESTINATIONS = {"pins": 0, "x": 1, "y": 2, "pindirs": 4}
+
+# mov y, y
+NOP = 0xa042
+
+
+class PioError(Exception):
+    pass
+
+
+def parse_number(text):
+    text = text.strip()
+
+    if re.fullmatch(r"0b[01]+", text):
+        return int(text[2:], 2)
+
+    if re.fullmatch(r"0x[0-9a-fA-F]+|\d+", text):
+        return int(text, 0)
+
+    raise PioError(f"not a number: {text}")
+
+
+class Program:
+    def __init__(self, name):
+        self.name = name
+        self.side_set = 0
+        self.labels = {}
+        # (line number, mnemonic, operands, side, delay)
+        self.lines = []
+
+    def encode(self, mnemonic, operands, side, delay):
+        delay_bits = 5 - self.side_set
+
+        if side is None and self.side_set:
+            raise PioError("side-set missing")
+
+        if side is not None and not self.side_set:
+            raise PioError("side-set without .side_set")
+
+        if delay >= 1 << delay_bits:
+            raise PioError(f"delay {delay} does not fit")
+
+        side_delay = (side or 0) << delay_bits | delay
+
+        if mnemonic == "nop" and not operands:
+            return NOP | side_delay << 8
+
+        if mnemonic == "jmp":
+            parts = [part.strip() for part in operands.split(",")]
+            condition = parts[0] if len(parts) == 2 else ""
+            target = parts[-1]
+
+            if condition not in JMP_CONDITIONS:
+                raise PioError(f"jmp condition {condition}")
+
+            address = (self.labels[target] if target in self.labels
+                       else parse_number(target))
+
+            return (side_delay << 8 | JMP_CONDITIONS[condition] << 5 |
+                    address)
+
+        if mnemonic == "in":
+            source, count = [part.strip() for part in operands.split(",")]
+
+            if source not in IN_SOURCES or not 1 <= parse_number(count) <= 32:
+                raise PioError(f"in {operands}")
+
+            return (0x4000 | side_delay << 8 | IN_SOURCES[source] << 5 |
+                    parse_number(count) % 32)
+
+        if mnemonic == "set":
+            destination, value = [part.strip() for part in operands.split(",")]
+
+            if destination not in SET_DESTINATIONS or parse_number(value) > 31:
+                raise PioError(f"set {operands}")
+
+            return (0xe000 | side_delay << 8 |
+                    SET_DESTINATIONS[destination] << 5 | parse_number(value))
+
+        raise PioError(f"{mnemonic} is not in the subset the bench models")
+
+    def assemble(self):
+        words = []
+
+        for line_number, mnemonic, operands, side, delay in self.lines:
+            try:
+                words.append((self.encode(mnemonic, operands, side, delay),
+                              f"{mnemonic} {operands}".strip()))
+            except (PioError, KeyError, ValueError) as error:
+                raise PioError(f"line {line_number}: {error}") from error
+
+        return words
+
+
+def parse(text):
+    programs = []
+    program = None
+    in_block = False
+
+    for line_number, line in enumerate(text.splitlines(), 1):
+        # Code blocks for the SDK, the bench has no use for them
+        if line.startswith("%"):
+            in_block = "}" not in line
+            continue
+
+        if in_block:
+            in_block = not line.startswith("%}")
+            continue
+
+        line = re.split(r";|//", line)[0].strip()
+
+        if not line:
+            continue
+
+        if line.startswith("."):
+            directive, _, argument = line.partition(" ")
+            argument = argument.strip()
+
+            if directive == ".program":
+                program = Program(argument)
+                programs.append(program)
+            elif directive == ".side_set":
+                if not re.fullmatch(r"\d+", argument):
+                    raise PioError(f"line {line_number}: .side_set "
+                                   f"{argument} is not modelled")
+                program.side_set = int(argument)
+            elif directive != ".define":
+                raise PioError(f"line {line_number}: {directive} is not "
+                               "modelled")
+            continue
+
+        if program is None:
+            raise PioError(f"line {line_number}: outside of a program")
+
+        label = re.fullmatch(r"(public\s+)?(\w+):", line)
+
+        if label:
+            program.labels[label.group(2)] = len(program.lines)
+            continue
+
+        match = re.fullmatch(
+            r"(\w+)\s*(.*?)\s*(?:side\s+(\S+))?\s*(?:\[(\d+)\])?", line)
+
+        if match is None:
+            raise PioError(f"line {line_number}: cannot parse {line}")
+
+        mnemonic, operands, side, delay = match.groups()
+        program.lines.append((line_number, mnemonic, operands,
+                              parse_number(side) if side else None,
+                              int(delay) if delay else 0))
+
+    return programs
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__.strip().splitlines()[-1], file=sys.stderr)
+        return 1
+
+    output_path, input_path = sys.argv[1:]
+    guard = re.sub(r"\W", "_", output_path.rsplit("/", 1)[-1]).upper()
+
+    with open(input_path) as file:
+        try:
+            programs = parse(file.read())
+            assembled = [(program, program.assemble()) for program in programs]
+        except PioError as error:
+            print(f"{input_path}: {error}", file=sys.stderr)
+            return 1
+
+    with open(output_path, "w") as file:
+        file.write(f"#ifndef {guard}\n#define {guard}\n\n")
+        file.write(f"// Generated from {input_path.rsplit('/', 1)[-1]} by "
+                   "gen_pio.py\n\n#include <stdint.h>\n")
+
+        for program, words in assembled:
+            file.write(f"\nstatic const uint16_t {program.name}_instructions"
+                       "[] = {\n")
+
+            for address, (word, source) in enumerate(words):
+                file.write(f"    0x{word:04x}, // {address:2}: {source}\n")
+
+            file.write("};\n")
+
+        file.write("\n#endif\n")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
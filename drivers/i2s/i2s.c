@@ -5,15 +5,32 @@
 #include "pico/stdlib.h"
 #include "pico/sync.h"
 #include "swapchain.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define SWAPCHAIN_LENGTH 3
 
+// Two DMA channels chained into each other, one fills while the other one's
+// buffer is published
+#define DMA_CHANNEL_COUNT 2
+
 typedef struct {
-    // Number of samples each buffer will contain
+    // Number of samples each buffer will contain, per channel
     size_t sample_count;
 
+    // Which channels end up in the buffers
+    i2s_channel_t channel;
+
+    // Bytes of one DMA buffer, a power of two
+    size_t buffer_size;
+
+    // The DMA buffers, each aligned to its size so the write ring wraps it
+    void *buffers[DMA_CHANNEL_COUNT];
+    void *mem;
+    arena_t *arena;
+
     // Selected PIO bank
     PIO pio;
 
@@ -23,8 +40,11 @@ typedef struct {
     // Offset inside PIO instruction bank
     uint pio_offset;
 
-    // DMA channel used to burst buffers to PIO
-    uint dma_channel;
+    // DMA channels taking turns, each one triggers the other when done
+    uint dma_channels[DMA_CHANNEL_COUNT];
+
+    // Buffers overwritten before the interrupt got to publish them
+    volatile uint32_t overrun_count;
 
     // GPIO connected to the SCK(Serial ClocK) pin
     uint sck_pin;
@@ -47,30 +67,103 @@ typedef struct {
 
 static i2s_t driver = {
     .swapchain = NULL,
+    .mem = NULL,
     .is_init = false,
     .is_sampling = false,
 };
 
 static size_t irq_hit = 0;
 
-static void dma_irq_handler() {
+/**
+ * @brief Name the buffer of channel index after the time its last word came
+ * in. The other channel took over right then, whatever it wrote since is
+ * how late the interrupt is.
+ */
+static void trace_capture(size_t index) {
+    uint other = driver.dma_channels[(index + 1) % DMA_CHANNEL_COUNT];
+    uint32_t written = driver.buffer_size / sizeof(uint32_t) -
+                       dma_channel_hw_addr(other)->transfer_count;
+    uint32_t word_rate = I2S_SAMPLE_RATE * i2s_words_per_sample(driver.channel);
+    uint32_t latency = (uint32_t)((uint64_t)written * 1000000u / word_rate);
+    uint32_t capture_us = time_us_32() - latency;
+
+    trace_irq_latency(latency);
+    trace_event_frame(TRACE_CAPTURE, capture_us);
+    swapchain_producer_set_tag(driver.swapchain, capture_us);
+}
+
+/**
+ * @brief Hand a finished DMA buffer over to the swapchain. Nothing to rearm,
+ * the other channel is already filling and the write ring brings this one
+ * back to the start of its buffer.
+ */
+static void publish(size_t index) {
+    void *destination = swapchain_producer_buffer(driver.swapchain);
+
+    TRACE(trace_capture(index));
+
+    if (driver.channel == I2S_CHANNEL_BOTH)
+        i2s_deinterleave(destination, driver.buffers[index],
+                         driver.sample_count);
+    else
+        memcpy(destination, driver.buffers[index], driver.buffer_size);
+
+    // Running again means the other channel finished too and chained back,
+    // so the copy may hold newer words. Better no frame than a torn one
+    if (dma_channel_is_busy(driver.dma_channels[index])) {
+        driver.overrun_count++;
+        TRACE(trace_count(TRACE_COUNTER_DMA_OVERRUN, 1));
+        return;
+    }
+
     swapchain_producer_swap(driver.swapchain);
+
+    // Wakes a consumer waiting in __wfe, on either core
+    __sev();
+}
+
+static void dma_irq_handler() {
     irq_hit++;
-    dma_channel_acknowledge_irq0(driver.dma_channel);
-    dma_channel_set_write_addr(
-        driver.dma_channel, swapchain_producer_buffer(driver.swapchain), true);
+
+    for (size_t i = 0; i < DMA_CHANNEL_COUNT; i++) {
+        if (!dma_channel_get_irq0_status(driver.dma_channels[i]))
+            continue;
+
+        dma_channel_acknowledge_irq0(driver.dma_channels[i]);
+        publish(i);
+    }
 }
 
-size_t i2s_required_buffer_size(size_t sample_count) {
-    return sample_count * sizeof(uint32_t);
+static void configure_channel(size_t index, bool chain) {
+    uint channel = driver.dma_channels[index];
+    dma_channel_config dma_config = dma_channel_get_default_config(channel);
+
+    channel_config_set_read_increment(&dma_config, false);
+    channel_config_set_write_increment(&dma_config, true);
+    // Wrap the write address back to the start of the buffer every time
+    channel_config_set_ring(&dma_config, true,
+                            (uint)__builtin_ctz(driver.buffer_size));
+    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_32);
+    channel_config_set_dreq(&dma_config,
+                            pio_get_dreq(driver.pio, driver.pio_sm, false));
+    channel_config_set_irq_quiet(&dma_config, false);
+    // Chaining to itself is how chaining is turned off
+    channel_config_set_chain_to(
+        &dma_config,
+        chain ? driver.dma_channels[(index + 1) % DMA_CHANNEL_COUNT] : channel);
+    dma_channel_configure(channel, &dma_config, driver.buffers[index],
+                          &driver.pio->rxf[driver.pio_sm],
+                          driver.buffer_size / sizeof(uint32_t), false);
 }
 
-int i2s_init(swapchain_t *swapchain, size_t sample_count, uint sck_pin,
-             uint ws_pin, uint data_pin) {
+int i2s_init(arena_t *arena, swapchain_t *swapchain, size_t sample_count,
+             i2s_channel_t channel, uint sck_pin, uint ws_pin, uint data_pin) {
     PIO pio;
-    int pio_sm, dma_channel;
+    int pio_sm, dma_channels[DMA_CHANNEL_COUNT];
     uint pio_offset;
-    dma_channel_config dma_config;
+    const pio_program_t *program;
+    size_t buffer_size = i2s_required_buffer_size(sample_count, channel);
+    void *mem;
 
     if (driver.is_init)
         return -1;
@@ -84,15 +177,23 @@ int i2s_init(swapchain_t *swapchain, size_t sample_count, uint sck_pin,
     if (sck_pin + 1 != ws_pin)
         return -1;
 
+    // The DMA write ring wraps at a power of two, 32KB at most
+    if (sample_count == 0 || (buffer_size & (buffer_size - 1)) != 0 ||
+        buffer_size > (1u << 15))
+        return -1;
+
+    // A mono stream never shifts the other channel in
+    program = channel == I2S_CHANNEL_BOTH ? &i2s_program : &i2s_mono_program;
+
     // Start with PIO0
     pio = pio0;
 
     // Check if the program can be loaded in the pio
-    if (!pio_can_add_program(pio, &i2s_program)) {
+    if (!pio_can_add_program(pio, program)) {
         // Try the next, PIO1
         pio = pio1;
 
-        if (!pio_can_add_program(pio, &i2s_program)) {
+        if (!pio_can_add_program(pio, program)) {
             // Guard if not
             return -1;
         }
@@ -102,42 +203,64 @@ int i2s_init(swapchain_t *swapchain, size_t sample_count, uint sck_pin,
     if ((pio_sm = pio_claim_unused_sm(pio, false)) == -1)
         return -1;
 
-    // Check if an unused dma channel is available
-    if ((dma_channel = dma_claim_unused_channel(false)) == -1) {
+    // Check if unused dma channels are available
+    if ((dma_channels[0] = dma_claim_unused_channel(false)) == -1) {
         // Give up the State Machine claimed before returning
         pio_sm_unclaim(pio, pio_sm);
         // Guard if not
         return -1;
     }
 
-    // Load the PIO program in memory and initialize it
-    pio_offset = pio_add_program(pio, &i2s_program);
-    i2s_program_init(pio, pio_sm, pio_offset, sck_pin, ws_pin, data_pin);
+    if ((dma_channels[1] = dma_claim_unused_channel(false)) == -1) {
+        dma_channel_unclaim(dma_channels[0]);
+        pio_sm_unclaim(pio, pio_sm);
+        return -1;
+    }
 
-    // Setup the DMA for data bursts
-    dma_config = dma_channel_get_default_config(dma_channel);
-    channel_config_set_read_increment(&dma_config, false);
-    channel_config_set_write_increment(&dma_config, true);
-    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_32);
-    channel_config_set_dreq(&dma_config, pio_get_dreq(pio, pio_sm, false));
-    channel_config_set_irq_quiet(&dma_config, false);
-    dma_channel_configure(dma_channel, &dma_config, NULL, &pio->rxf[pio_sm],
-                          sample_count, false);
+    // Aligned to the buffer size, the second buffer follows the first
+    if ((mem = arena_alloc(arena, DMA_CHANNEL_COUNT * buffer_size,
+                           buffer_size)) == NULL) {
+        dma_channel_unclaim(dma_channels[1]);
+        dma_channel_unclaim(dma_channels[0]);
+        pio_sm_unclaim(pio, pio_sm);
+        return -1;
+    }
 
-    // Setup interrupts
-    dma_channel_set_irq0_enabled(dma_channel, true);
-    irq_set_exclusive_handler(DMA_IRQ_0, dma_irq_handler);
-    irq_set_enabled(DMA_IRQ_0, true);
+    // Load the PIO program in memory and initialize it
+    pio_offset = pio_add_program(pio, program);
+    i2s_program_init(pio, pio_sm, pio_offset, sck_pin, ws_pin, data_pin,
+                     channel != I2S_CHANNEL_BOTH,
+                     channel == I2S_CHANNEL_RIGHT);
 
     driver.sample_count = sample_count;
+    driver.channel = channel;
+    driver.buffer_size = buffer_size;
+    driver.mem = mem;
+    driver.arena = arena;
+    driver.buffers[0] = mem;
+    driver.buffers[1] = (void *)((size_t)mem + buffer_size);
+    driver.overrun_count = 0;
     driver.pio = pio;
     driver.pio_sm = (uint)pio_sm;
     driver.pio_offset = pio_offset;
-    driver.dma_channel = (uint)dma_channel;
     driver.swapchain = swapchain;
     driver.sck_pin = sck_pin;
     driver.ws_pin = ws_pin;
     driver.data_pin = data_pin;
+
+    for (size_t i = 0; i < DMA_CHANNEL_COUNT; i++)
+        driver.dma_channels[i] = (uint)dma_channels[i];
+
+    // Setup the DMA for gapless data bursts
+    for (size_t i = 0; i < DMA_CHANNEL_COUNT; i++) {
+        configure_channel(i, true);
+        dma_channel_set_irq0_enabled(driver.dma_channels[i], true);
+    }
+
+    // Setup interrupts
+    irq_set_exclusive_handler(DMA_IRQ_0, dma_irq_handler);
+    irq_set_enabled(DMA_IRQ_0, true);
+
     driver.is_init = true;
 
     return 1;
@@ -149,8 +272,11 @@ void i2s_start_sampling() {
     if (!driver.is_init || driver.is_sampling)
         return;
 
-    dma_channel_set_write_addr(
-        driver.dma_channel, swapchain_producer_buffer(driver.swapchain), true);
+    // The second channel starts once the first one is done
+    for (size_t i = 0; i < DMA_CHANNEL_COUNT; i++)
+        configure_channel(i, true);
+
+    dma_channel_start(driver.dma_channels[0]);
 
     driver.is_sampling = true;
 }
@@ -159,14 +285,23 @@ void i2s_stop_sampling() {
     if (!driver.is_init || !driver.is_sampling)
         return;
 
-    dma_channel_set_irq0_enabled(driver.dma_channel, false);
-    dma_channel_abort(driver.dma_channel);
-    dma_channel_acknowledge_irq0(driver.dma_channel);
-    dma_channel_set_irq0_enabled(driver.dma_channel, true);
+    // Unchain first, an aborted channel must not start the other one
+    for (size_t i = 0; i < DMA_CHANNEL_COUNT; i++) {
+        dma_channel_set_irq0_enabled(driver.dma_channels[i], false);
+        configure_channel(i, false);
+    }
+
+    for (size_t i = 0; i < DMA_CHANNEL_COUNT; i++) {
+        dma_channel_abort(driver.dma_channels[i]);
+        dma_channel_acknowledge_irq0(driver.dma_channels[i]);
+        dma_channel_set_irq0_enabled(driver.dma_channels[i], true);
+    }
 
     driver.is_sampling = false;
 }
 
+uint32_t i2s_overrun_count() { return driver.overrun_count; }
+
 void i2s_print_irq_hits() {
     printf("IRQ hits %d\n", irq_hit);
     irq_hit = 0;
@@ -179,12 +314,22 @@ void i2s_deinit() {
 
     i2s_stop_sampling();
 
-    i2s_program_deinit(driver.pio, driver.pio_sm);
+    i2s_program_deinit(driver.pio, driver.pio_sm, driver.ws_pin);
     // This also unclaims the State Machine
-    pio_remove_program(driver.pio, &i2s_program, driver.pio_offset);
+    pio_remove_program(driver.pio,
+                       driver.channel == I2S_CHANNEL_BOTH ? &i2s_program
+                                                          : &i2s_mono_program,
+                       driver.pio_offset);
+    for (size_t i = 0; i < DMA_CHANNEL_COUNT; i++) {
+        dma_channel_set_irq0_enabled(driver.dma_channels[i], false);
+        dma_channel_unclaim(driver.dma_channels[i]);
+    }
+
+    arena_free(driver.arena, driver.mem);
 
     driver = (i2s_t){
         .swapchain = NULL,
+        .mem = NULL,
         .is_init = false,
         .is_sampling = false,
     };
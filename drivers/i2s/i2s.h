@@ -5,21 +5,71 @@
  * PIO based i2s Stereo
  */
 
+#include "arena.h"
 #include "swapchain.h"
 #include <pico/types.h>
+#include <stdint.h>
 
 #define I2S_UNUSED_MSB_BITS 1
 #define I2S_UNUSED_LSB_BITS 7
 #define I2S_MAX_AMP 0x00FFFFFFUL
 #define I2S_MAX_AMP_F ((float)I2S_MAX_AMP)
 
+// Words clocked per second, left and right interleaved. 6.4 MHz PIO clock,
+// two instructions per bit, 32 bits per word
+#define I2S_WORD_RATE 100000
+
+// Samples per second of a single channel
+#define I2S_SAMPLE_RATE (I2S_WORD_RATE / 2)
+
 #define i2s_sanitize_sample(sample) ((sample << 1) >> 8)
 #define i2s_normalize_sample(sample) ((float)sample / I2S_MAX_AMP_F)
 
-size_t i2s_required_buffer_size(size_t sample_count);
+typedef enum {
+    // One word per sample, the other channel is dropped in PIO
+    I2S_CHANNEL_LEFT,
+    I2S_CHANNEL_RIGHT,
+    // sample_count left words followed by sample_count right words
+    I2S_CHANNEL_BOTH,
+} i2s_channel_t;
+
+/**
+ * @brief Split sample_count interleaved L/R pairs, all the left words first
+ * then all the right ones.
+ */
+static inline void i2s_deinterleave(int32_t *planes, const int32_t *words,
+                                    size_t sample_count) {
+    for (size_t i = 0; i < sample_count; i++) {
+        planes[i] = words[2 * i];
+        planes[sample_count + i] = words[2 * i + 1];
+    }
+}
+
+static inline size_t i2s_words_per_sample(i2s_channel_t channel) {
+    return channel == I2S_CHANNEL_BOTH ? 2 : 1;
+}
+
+#define I2S_BUFFER_SIZE(sample_count, channel)                                 \
+    ((size_t)(sample_count) * ((channel) == I2S_CHANNEL_BOTH ? 2 : 1) *        \
+     sizeof(uint32_t))
 
-int i2s_init(swapchain_t *swapchain, size_t sample_count, uint sck_pin,
-             uint ws_pin, uint data_pin);
+// Arena bytes i2s_init takes, both DMA buffers aligned to their size
+#define I2S_FOOTPRINT(sample_count, channel)                                   \
+    ARENA_FOOTPRINT_ALIGNED(2 * I2S_BUFFER_SIZE(sample_count, channel),        \
+                            I2S_BUFFER_SIZE(sample_count, channel))
+
+static inline size_t i2s_required_buffer_size(size_t sample_count,
+                                              i2s_channel_t channel) {
+    return I2S_BUFFER_SIZE(sample_count, channel);
+}
+
+/**
+ * Capture is gapless, two chained DMA channels take turns and the interrupt
+ * only publishes the finished buffer. It has a whole buffer of time to do
+ * so, the buffer size must be a power of two for the DMA write ring.
+ */
+int i2s_init(arena_t *arena, swapchain_t *swapchain, size_t sample_count,
+             i2s_channel_t channel, uint sck_pin, uint ws_pin, uint data_pin);
 
 size_t i2s_sample_count();
 
@@ -27,6 +77,12 @@ void i2s_start_sampling();
 
 void i2s_stop_sampling();
 
+/**
+ * @brief Buffers overwritten before the interrupt published them, each one
+ * a lost hop of audio.
+ */
+uint32_t i2s_overrun_count();
+
 void i2s_print_irq_hits();
 
 void i2s_deinit();
@@ -1,16 +1,34 @@
 #include "neopixel.h"
+#include "bitplane.h"
 #include "hardware/dma.h"
 #include "hardware/pio.h"
+#include "hardware/timer.h"
 #include "neopixel.pio.h"
 #include "pico/stdlib.h"
 #include "swapchain.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+// How often an idle strip looks for a new frame
+#define IDLE_POLL_US 1000
+
+// On the wire, GRB
+#define BYTES_PER_PIXEL 3
+
+// Time one FIFO word takes on the wire, 24 bits of one pixel at 1.25us, or
+// 4 bit slots of every strip in parallel
+#define WORD_US 30
+#define PARALLEL_WORD_US 5
 
 typedef struct {
-    // Number of LEDs
+    // Number of LEDs, per strip
     size_t count;
 
+    // Strips driven in parallel, on consecutive pins
+    size_t strip_count;
+
     // The PIO block
     PIO pio;
 
@@ -20,9 +38,41 @@ typedef struct {
     // Offset inside PIO block codemem
     uint pio_offset;
 
+    // Loaded program, one strip or parallel, and where its sync pulse is
+    const pio_program_t *program;
+    uint sync_offset;
+
+    // WORD_US or PARALLEL_WORD_US
+    uint32_t word_us;
+
     // DMA channel used to receive burst data
     uint dma_channel;
 
+    // Hardware alarm that polls for frames while nothing is transmitted
+    uint alarm;
+
+    // What the strips currently show, WS2812s hold their last value
+    uint32_t *shown;
+
+    // What the parallel program shifts out, NULL with one strip
+    uint32_t *planes;
+    void *mem;
+    arena_t *arena;
+
+    // Whether shown matches the strip, false until the first full frame
+    bool is_shown_valid;
+
+    // Counters, written by the interrupts only
+    volatile uint32_t frame_count;
+    volatile uint32_t skipped_count;
+    volatile uint32_t partial_count;
+    volatile uint64_t bytes_saved;
+
+    // Capture time of the frame on the wire, see trace.h
+    uint32_t transmit_frame;
+    // Swapchain drops already counted as stale
+    uint32_t traced_dropped_count;
+
     // The swapchain to use
     swapchain_t *swapchain;
 
@@ -35,27 +85,168 @@ typedef struct {
 
 static neopixel_t driver = {
     .swapchain = NULL,
+    .shown = NULL,
+    .planes = NULL,
     .is_init = false,
     .is_transmitting = false,
 };
 
+/**
+ * @brief Number of leading pixels that differ from what the strips show,
+ * anything past the last dirty one can stay as it is. In parallel every
+ * strip goes out as long as the longest.
+ */
+static size_t dirty_prefix(const uint32_t *pixels) {
+    size_t longest = 0, count;
+    const uint32_t *shown = driver.shown;
+
+    if (!driver.is_shown_valid)
+        return driver.count;
+
+    for (size_t strip = 0; strip < driver.strip_count; strip++) {
+        count = driver.count;
+
+        while (count > longest && pixels[count - 1] == shown[count - 1])
+            count--;
+
+        longest = count;
+        pixels += driver.count;
+        shown += driver.count;
+    }
+
+    return longest;
+}
+
+/**
+ * @brief Trace the frame just taken for transmission, and every frame the
+ * swapchain dropped since the last one.
+ */
+static void trace_transmit() {
+    uint32_t dropped = swapchain_dropped_count(driver.swapchain);
+
+    trace_count(TRACE_COUNTER_STALE_FRAME,
+                dropped - driver.traced_dropped_count);
+    driver.traced_dropped_count = dropped;
+
+    driver.transmit_frame = swapchain_consumer_tag(driver.swapchain);
+    trace_event_frame(TRACE_TRANSMIT_BEGIN, driver.transmit_frame);
+}
+
+/**
+ * @brief Whether the last frame is all on the wire, the FIFO empty and the
+ * state machine stalled pulling the next word. Jumping to the sync before
+ * would send the tail of the frame after it, every later pixel one LED off
+ * and shown no longer what the strip holds.
+ */
+static bool is_drained() {
+    return pio_sm_is_tx_fifo_empty(driver.pio, driver.pio_sm) &&
+           (driver.pio->fdebug &
+            (1u << (PIO_FDEBUG_TXSTALL_LSB + driver.pio_sm)));
+}
+
+static void transmit_next() {
+    const uint32_t *pixels = NULL;
+    size_t count = 0, word_count;
+
+    // Still shifting out, look again once the words left should be out. Up
+    // to 8 words and the OSR, no spinning that long in an interrupt
+    if (!is_drained()) {
+        hardware_alarm_set_target(
+            driver.alarm,
+            make_timeout_time_us(
+                (pio_sm_get_tx_fifo_level(driver.pio, driver.pio_sm) + 1) *
+                driver.word_us));
+        return;
+    }
+
+    if (swapchain_consumer_swap(driver.swapchain)) {
+        pixels = swapchain_consumer_buffer(driver.swapchain);
+        count = dirty_prefix(pixels);
+
+        for (size_t strip = 0; strip < driver.strip_count; strip++)
+            memcpy(driver.shown + strip * driver.count,
+                   pixels + strip * driver.count, count * sizeof(uint32_t));
+
+        driver.is_shown_valid = true;
+
+        driver.bytes_saved +=
+            (driver.count - count) * BYTES_PER_PIXEL * driver.strip_count;
+
+        if (count == 0)
+            driver.skipped_count++;
+    }
+
+    // Stale or identical, the strip already shows it. Nothing will raise
+    // the DMA interrupt, so look again in a bit
+    if (count == 0) {
+        hardware_alarm_set_target(driver.alarm,
+                                  make_timeout_time_us(IDLE_POLL_US));
+        return;
+    }
+
+    if (count < driver.count)
+        driver.partial_count++;
+
+    driver.frame_count++;
+    word_count = count;
+
+    TRACE(trace_transmit());
+
+    // The strips share every bit slot, a few us of interrupt time against
+    // the ms the frame takes on the wire
+    if (driver.planes != NULL) {
+        bitplane_transpose(pixels, driver.count, driver.strip_count, count,
+                           driver.planes);
+        pixels = driver.planes;
+        word_count = count * BITPLANE_WORDS_PER_PIXEL;
+    }
+
+    pio_sm_exec(driver.pio, driver.pio_sm,
+                pio_encode_jmp(driver.pio_offset + driver.sync_offset));
+    // Off the stalled pull now, the DMA fills the FIFO long before the 63us
+    // sync is over, so the flag next sets once this frame is out
+    driver.pio->fdebug = 1u << (PIO_FDEBUG_TXSTALL_LSB + driver.pio_sm);
+    dma_channel_set_trans_count(driver.dma_channel, word_count, false);
+    dma_channel_set_read_addr(driver.dma_channel, pixels, true);
+}
+
 static void dma_irq_handler() {
-    swapchain_consumer_swap(driver.swapchain);
     dma_channel_acknowledge_irq1(driver.dma_channel);
-    pio_sm_exec(driver.pio, driver.pio_sm,
-                pio_encode_jmp(driver.pio_offset + neopixel_offset_sync));
-    dma_channel_set_read_addr(
-        driver.dma_channel, swapchain_consumer_buffer(driver.swapchain), true);
+
+    // The last words are still in the FIFO, close enough to the latch.
+    // transmit_next waits for them before the sync
+    TRACE(trace_event_frame(TRACE_TRANSMIT_END, driver.transmit_frame));
+    TRACE(trace_latency(driver.transmit_frame));
+
+    transmit_next();
+}
+
+static void alarm_handler(uint alarm) {
+    (void)alarm;
+
+    if (driver.is_transmitting)
+        transmit_next();
 }
 
 size_t neopixel_required_buffer_size(size_t led_count) {
-    return led_count * sizeof(uint32_t);
+    return NEOPIXEL_BUFFER_SIZE(led_count);
 }
 
-int neopixel_init(swapchain_t *swapchain, size_t count, uint pin) {
+size_t neopixel_required_parallel_buffer_size(size_t led_count,
+                                              size_t strip_count) {
+    return NEOPIXEL_PARALLEL_BUFFER_SIZE(led_count, strip_count);
+}
+
+static int init_driver(arena_t *arena, swapchain_t *swapchain, size_t count,
+                       uint pin, size_t strip_count) {
+    const pio_program_t *program =
+        strip_count > 1 ? &neopixel_parallel_program : &neopixel_program;
     PIO pio;
-    int pio_sm, dma_channel;
+    int pio_sm, dma_channel, alarm;
     uint pio_offset;
+    uint32_t *shown, *planes = NULL;
+    size_t planes_size = strip_count > 1 ? BITPLANE_SIZE(count) : 0;
+    void *mem;
     dma_channel_config dma_config;
 
     if (driver.is_init)
@@ -65,11 +256,11 @@ int neopixel_init(swapchain_t *swapchain, size_t count, uint pin) {
     pio = pio0;
 
     // Check if the program can be loaded in the pio
-    if (!pio_can_add_program(pio, &neopixel_program)) {
+    if (!pio_can_add_program(pio, program)) {
         // Try the next, PIO1
         pio = pio1;
 
-        if (!pio_can_add_program(pio, &neopixel_program)) {
+        if (!pio_can_add_program(pio, program)) {
             // Guard if not
             return -1;
         }
@@ -85,9 +276,36 @@ int neopixel_init(swapchain_t *swapchain, size_t count, uint pin) {
         return -1;
     }
 
+    if ((alarm = hardware_alarm_claim_unused(false)) == -1) {
+        dma_channel_unclaim(dma_channel);
+        pio_sm_unclaim(pio, pio_sm);
+        return -1;
+    }
+
+    // The planes, then the copy of what the strips show
+    if ((mem = arena_alloc(arena,
+                           planes_size + NEOPIXEL_PARALLEL_BUFFER_SIZE(
+                                             count, strip_count),
+                           ARENA_ALIGN)) == NULL) {
+        hardware_alarm_unclaim(alarm);
+        dma_channel_unclaim(dma_channel);
+        pio_sm_unclaim(pio, pio_sm);
+        return -1;
+    }
+
+    if (planes_size)
+        planes = mem;
+
+    shown = (uint32_t *)mem + planes_size / sizeof(uint32_t);
+
     // Load the PIO program in memory and initialize it
-    pio_offset = pio_add_program(pio, &neopixel_program);
-    neopixel_program_init(pio, pio_sm, pio_offset, pin);
+    pio_offset = pio_add_program(pio, program);
+
+    if (strip_count > 1)
+        neopixel_parallel_program_init(pio, pio_sm, pio_offset, pin,
+                                       strip_count);
+    else
+        neopixel_program_init(pio, pio_sm, pio_offset, pin);
 
     // Setup the DMA for data bursts
     dma_config = dma_channel_get_default_config(dma_channel);
@@ -103,17 +321,50 @@ int neopixel_init(swapchain_t *swapchain, size_t count, uint pin) {
     irq_set_exclusive_handler(DMA_IRQ_1, dma_irq_handler);
     irq_set_enabled(DMA_IRQ_1, true);
 
+    // Its interrupt lands on this core too, so it never races the DMA one
+    hardware_alarm_set_callback(alarm, alarm_handler);
+
     driver.pio = pio;
     driver.pio_sm = (uint)pio_sm;
     driver.pio_offset = pio_offset;
+    driver.program = program;
+    driver.sync_offset = strip_count > 1 ? neopixel_parallel_offset_sync
+                                         : neopixel_offset_sync;
+    driver.word_us = strip_count > 1 ? PARALLEL_WORD_US : WORD_US;
     driver.count = count;
+    driver.strip_count = strip_count;
     driver.dma_channel = (uint)dma_channel;
+    driver.alarm = (uint)alarm;
+    driver.shown = shown;
+    driver.planes = planes;
+    driver.mem = mem;
+    driver.arena = arena;
+    driver.is_shown_valid = false;
+    driver.frame_count = 0;
+    driver.skipped_count = 0;
+    driver.partial_count = 0;
+    driver.bytes_saved = 0;
+    driver.transmit_frame = 0;
+    driver.traced_dropped_count = swapchain_dropped_count(swapchain);
     driver.swapchain = swapchain;
     driver.is_init = true;
 
     return 1;
 }
 
+int neopixel_init(arena_t *arena, swapchain_t *swapchain, size_t count,
+                  uint pin) {
+    return init_driver(arena, swapchain, count, pin, 1);
+}
+
+int neopixel_init_parallel(arena_t *arena, swapchain_t *swapchain,
+                           size_t count, uint pin_base, size_t strip_count) {
+    if (strip_count == 0 || strip_count > NEOPIXEL_MAX_STRIPS)
+        return -1;
+
+    return init_driver(arena, swapchain, count, pin_base, strip_count);
+}
+
 bool neopixel_is_init() { return driver.is_init; }
 
 size_t neopixel_led_count() { return driver.count; }
@@ -122,24 +373,42 @@ void neopixel_start_transmission() {
     if (!driver.is_init || driver.is_transmitting)
         return;
 
-    dma_channel_set_read_addr(
-        driver.dma_channel, swapchain_consumer_buffer(driver.swapchain), true);
+    // The strip may have been touched while stopped, start over in full
+    driver.is_shown_valid = false;
     driver.is_transmitting = true;
+    transmit_next();
 }
 
 void neopixel_stop_transmission() {
     if (!driver.is_init || !driver.is_transmitting)
         return;
 
+    driver.is_transmitting = false;
+    hardware_alarm_cancel(driver.alarm);
+
     dma_channel_set_irq1_enabled(driver.dma_channel, false);
     dma_channel_abort(driver.dma_channel);
     dma_channel_acknowledge_irq1(driver.dma_channel);
     dma_channel_set_irq1_enabled(driver.dma_channel, true);
+}
 
-    driver.is_transmitting = false;
+size_t neopixel_get_pixel_count() {
+    return driver.count * driver.strip_count;
 }
 
-size_t neopixel_get_pixel_count() { return driver.count; }
+void neopixel_get_stats(neopixel_stats_t *stats) {
+    uint64_t bytes_saved;
+
+    // 64 bits take two loads, read again if an interrupt got in between
+    do {
+        bytes_saved = driver.bytes_saved;
+        stats->frame_count = driver.frame_count;
+        stats->skipped_count = driver.skipped_count;
+        stats->partial_count = driver.partial_count;
+    } while (bytes_saved != driver.bytes_saved);
+
+    stats->bytes_saved = bytes_saved;
+}
 
 void neopixel_deinit() {
     if (!driver.is_init)
@@ -150,10 +419,17 @@ void neopixel_deinit() {
     // PIO ciao
     neopixel_program_deinit(driver.pio, driver.pio_sm);
     // This also unclaims the State Machine
-    pio_remove_program(driver.pio, &neopixel_program, driver.pio_offset);
+    pio_remove_program(driver.pio, driver.program, driver.pio_offset);
+
+    hardware_alarm_set_callback(driver.alarm, NULL);
+    hardware_alarm_unclaim(driver.alarm);
+    dma_channel_unclaim(driver.dma_channel);
+    arena_free(driver.arena, driver.mem);
 
     driver = (neopixel_t){
         .swapchain = NULL,
+        .shown = NULL,
+        .planes = NULL,
         .is_init = false,
         .is_transmitting = false,
     };
@@ -1,13 +1,67 @@
 #ifndef WS2812_PIO_H
 #define WS2812_PIO_H
 
+#include "arena.h"
+#include "bitplane.h"
 #include "swapchain.h"
 #include <pico/types.h>
 
+/**
+ * Frames are diffed against what the strip already shows. WS2812s keep
+ * their last value, so only the prefix up to the last changed pixel goes
+ * out and stale or identical frames are not sent at all.
+ */
+typedef struct {
+    // Frames transmitted, in full or in part
+    uint32_t frame_count;
+    // New frames identical to what the strip shows, not sent
+    uint32_t skipped_count;
+    // Frames sent as a prefix only
+    uint32_t partial_count;
+    // Bytes on the wire not sent compared to every new frame in full
+    uint64_t bytes_saved;
+} neopixel_stats_t;
+
+#define NEOPIXEL_BUFFER_SIZE(led_count) ((size_t)(led_count) * sizeof(uint32_t))
+
+#define NEOPIXEL_MAX_STRIPS BITPLANE_MAX_STRIPS
+
+// Strips back to back, led_count pixels each
+#define NEOPIXEL_PARALLEL_BUFFER_SIZE(led_count, strip_count)                  \
+    (NEOPIXEL_BUFFER_SIZE(led_count) * (size_t)(strip_count))
+
+// Arena bytes neopixel_init takes, a copy of what the strip shows
+#define NEOPIXEL_FOOTPRINT(led_count)                                          \
+    ARENA_FOOTPRINT(NEOPIXEL_BUFFER_SIZE(led_count))
+
+// Same for neopixel_init_parallel, the bit planes on top
+#define NEOPIXEL_PARALLEL_FOOTPRINT(led_count, strip_count)                    \
+    ((strip_count) > 1                                                         \
+         ? ARENA_FOOTPRINT(BITPLANE_SIZE(led_count) +                          \
+                           NEOPIXEL_PARALLEL_BUFFER_SIZE(led_count,            \
+                                                         strip_count))         \
+         : NEOPIXEL_FOOTPRINT(led_count))
+
 size_t neopixel_required_buffer_size(size_t led_count);
+size_t neopixel_required_parallel_buffer_size(size_t led_count,
+                                              size_t strip_count);
 
-int neopixel_init(swapchain_t *swapchain, size_t count, uint pin);
+int neopixel_init(arena_t *arena, swapchain_t *swapchain, size_t count,
+                  uint pin);
 
+/**
+ * @brief Drive up to NEOPIXEL_MAX_STRIPS strips of count LEDs off pins
+ * pin_base on, all from one state machine. The swapchain buffers hold the
+ * strips back to back (neopixel_required_parallel_buffer_size), the frame
+ * rate stays that of a single strip of count LEDs. One strip is the same as
+ * neopixel_init.
+ */
+int neopixel_init_parallel(arena_t *arena, swapchain_t *swapchain,
+                           size_t count, uint pin_base, size_t strip_count);
+
+/**
+ * @brief LEDs over all strips.
+ */
 size_t neopixel_get_pixel_count();
 
 void neopixel_start_transmission();
@@ -16,6 +70,8 @@ void neopixel_stop_transmission();
 
 void neopixel_print_irq_hits();
 
+void neopixel_get_stats(neopixel_stats_t *stats);
+
 void neopixel_deinit();
 
 #endif
\ No newline at end of file
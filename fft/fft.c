@@ -1,75 +1,24 @@
 #include "fft.h"
+#include "fft_tables.h"
+#include "fft_util.h"
 
 #include <complex.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-/**
- * @brief Ultra fast log base-2 of only 2^n numbers. For others, the
- * result/behavior is invalid/undefined.
- *
- * Since 2^n numbers will have only one '1' bit, we just need to shift
- * right until we find it, and that's log2N
- *
- * @param N The input. *MUST BE A POWER OF 2*
- * @return The log base-2 result, -1 if not a power of two
- */
-static inline int log2N(unsigned int N) {
-    int value, n;
-
-    // Keep shifting right until we find a '1' at the LSB
-    // and that's when we know we hit the jackpot!
-    for (value = 0, n = N; (n & 0b1) == 0; n >>= 1, value++)
-        ;
-
-    if (n == 1)
-        return value;
-
-    return -1;
-}
-
-/**
- * @brief O(n) order reverse bits.
- *
- * @param N Value to be bit-reversed
- * @param bit_depth Number of bits to be reversed
- * @return unsigned int Bit-reversed number
- */
-static inline unsigned int reverse_bits(unsigned int N,
-                                        unsigned int bit_depth) {
-    unsigned int output, i;
-
-    // Simple, left shift one, right shift the other, bleh!
-    for (output = 0, i = 0; i < bit_depth; i++, N >>= 1)
-        output = (output << 1) | (N & 0b1);
-
-    return output;
-}
-
-static void fill_reversed_indices(unsigned int *reversed_indices,
-                                  unsigned int N) {
-    unsigned int bit_depth, i;
-
-    // Number of bits required
-    bit_depth = log2N(N);
-
-    for (i = 0; i < N; i++)
-        reversed_indices[i] = reverse_bits(i, bit_depth);
-}
-
-static void fill_twiddles(float complex *twiddles, unsigned int N) {
-    float angle_per_sample;
+static void fill_twiddles(float *twiddles, unsigned int N) {
+    double angle_per_sample;
     unsigned int i;
 
-    // -2pi/N, constant, reducing the calculations
-    angle_per_sample = -2.0f * (float)M_PI / N;
+    // 2pi/N, constant, reducing the calculations
+    angle_per_sample = 2.0 * M_PI / N;
 
-    // Cache the twiddle factors
+    // Only a quarter of the circle, the rest is symmetry
     // Compromise some space for HUGE performance gain
     // Cache locality baby!
-    for (i = 0; i < N; i++)
-        twiddles[i] = cexp(angle_per_sample * i * I);
+    for (i = 0; i <= N / 4; i++)
+        twiddles[i] = (float)sin(angle_per_sample * i);
 }
 
 static void fill_twiddles_d(double complex *twiddles, unsigned int N) {
@@ -79,43 +28,148 @@ static void fill_twiddles_d(double complex *twiddles, unsigned int N) {
     // -2pi/N, constant, reducing the calculations
     angle_per_sample = -2.0 * M_PI / N;
 
-    // Cache the twiddle factors
+    // Cache the twiddle factors, only the first half of the circle is ever
+    // used by the butterflies
     // Compromise some space for HUGE performance gain
     // Cache locality baby!
-    for (i = 0; i < N; i++)
+    for (i = 0; i < N / 2; i++)
         twiddles[i] = cexp(angle_per_sample * i * I);
 }
 
-int fft_init(fft_t *this, unsigned int count) {
-    unsigned int *reversed_indices;
-    float complex *twiddles;
+size_t fft_required_buffer_size(size_t count) {
+    // Nothing to allocate when the tables were generated for this size
+    if (fft_find_static_tables(count) != NULL)
+        return 0;
 
-    reversed_indices = (unsigned int *)malloc(count * sizeof(unsigned int));
+    return (count / 4 + 1) * sizeof(float) + count * sizeof(fft_index_t);
+}
 
-    if (reversed_indices == NULL)
+int fft_init(fft_t *this, arena_t *arena, size_t count) {
+    const fft_tables_t *tables;
+    fft_index_t *reversed_indices;
+    float *twiddles;
+    void *mem;
+
+    if (!is_valid_count(count))
         return -1;
 
-    twiddles = (float complex *)malloc((count / 2) * sizeof(float complex));
+    this->count = count;
+    this->output = fft_output_default();
+    this->arena = arena;
+
+    // Straight from flash, no RAM and no boot time
+    if ((tables = fft_find_static_tables(count)) != NULL) {
+        this->reversed_indices = tables->reversed_indices;
+        this->twiddles = tables->twiddles;
+        this->mem = NULL;
 
-    if (twiddles == NULL) {
-        free(reversed_indices);
-        return -1;
+        return 1;
     }
 
+    mem = arena_alloc(arena, fft_required_buffer_size(count), ARENA_ALIGN);
+
+    if (mem == NULL)
+        return -1;
+
+    // Twiddles first, they have the stricter alignment
+    twiddles = (float *)mem;
+    reversed_indices = (fft_index_t *)(twiddles + count / 4 + 1);
+
     fill_reversed_indices(reversed_indices, count);
-    fill_twiddles(twiddles, count / 2);
+    fill_twiddles(twiddles, count);
 
-    this->count = count;
     this->reversed_indices = reversed_indices;
     this->twiddles = twiddles;
+    this->mem = mem;
 
     return 1;
 }
 
+/**
+ * @brief Decimation in time butterfly, the twiddle pre-multiplies the
+ * bottom half. Samples are viewed as interleaved re/im floats, a complex is
+ * laid out exactly like two floats, so the complex multiply helpers stay out.
+ */
+static inline void butterfly_dit(float *samples, unsigned int top,
+                                 unsigned int bottom, float twiddle_re,
+                                 float twiddle_im) {
+    float top_re = samples[2 * top];
+    float top_im = samples[2 * top + 1];
+    float bottom_re = samples[2 * bottom] * twiddle_re -
+                      samples[2 * bottom + 1] * twiddle_im;
+    float bottom_im = samples[2 * bottom] * twiddle_im +
+                      samples[2 * bottom + 1] * twiddle_re;
+
+    samples[2 * top] = top_re + bottom_re;
+    samples[2 * top + 1] = top_im + bottom_im;
+    samples[2 * bottom] = top_re - bottom_re;
+    samples[2 * bottom + 1] = top_im - bottom_im;
+}
+
+/**
+ * @brief Decimation in frequency butterfly, the twiddle post-multiplies the
+ * difference.
+ */
+static inline void butterfly_dif(float *samples, unsigned int top,
+                                 unsigned int bottom, float twiddle_re,
+                                 float twiddle_im) {
+    float top_re = samples[2 * top];
+    float top_im = samples[2 * top + 1];
+    float bottom_re = samples[2 * bottom];
+    float bottom_im = samples[2 * bottom + 1];
+    float diff_re = top_re - bottom_re;
+    float diff_im = top_im - bottom_im;
+
+    samples[2 * top] = top_re + bottom_re;
+    samples[2 * top + 1] = top_im + bottom_im;
+    samples[2 * bottom] = diff_re * twiddle_re - diff_im * twiddle_im;
+    samples[2 * bottom + 1] = diff_re * twiddle_im + diff_im * twiddle_re;
+}
+
+static FFT_ALWAYS_INLINE void output_bins_mode(fft_t *this, const float *data,
+                                               float *frequency_bins,
+                                               const output_stage_t *stage,
+                                               fft_output_mode_t mode) {
+    size_t halfN = this->count / 2;
+
+    for (size_t i = 0; i < halfN; i++) {
+        // Output lands in bit-reversed order
+        const float *sample = data + 2 * this->reversed_indices[i];
+        frequency_bins[i] = output_bin(stage, mode, sample[0], sample[1]);
+    }
+}
+
+void fft_output_bins(fft_t *this, const float complex *samples,
+                     float *frequency_bins) {
+    const float *data = (const float *)samples;
+    // 1/(N/2) normalization
+    output_stage_t stage = output_stage(&this->output, 2.f / this->count);
+
+    switch (stage.mode) {
+    case FFT_OUTPUT_POWER:
+        output_bins_mode(this, data, frequency_bins, &stage,
+                         FFT_OUTPUT_POWER);
+        break;
+    case FFT_OUTPUT_APPROX_MAGNITUDE:
+        output_bins_mode(this, data, frequency_bins, &stage,
+                         FFT_OUTPUT_APPROX_MAGNITUDE);
+        break;
+    case FFT_OUTPUT_LOG:
+        output_bins_mode(this, data, frequency_bins, &stage, FFT_OUTPUT_LOG);
+        break;
+    default:
+        output_bins_mode(this, data, frequency_bins, &stage,
+                         FFT_OUTPUT_MAGNITUDE);
+        break;
+    }
+}
+
 void fft_rad2_dit(fft_t *this, float complex *samples, float *frequency_bins) {
-    unsigned int halfN, set_count, ops_per_set, set, start, butterfly,
-        butterfly_top_idx, butterfly_bottom_idx;
-    float complex twiddle, butterfly_top, butterfly_bottom;
+    unsigned int halfN, quarterN, set_count, ops_per_set, split, set, start,
+        butterfly, twiddle_idx;
+    const fft_index_t *reversed_indices;
+    const float *twiddles;
+    float *data;
 
     // Don't mess with me
     if (samples == NULL)
@@ -123,6 +177,10 @@ void fft_rad2_dit(fft_t *this, float complex *samples, float *frequency_bins) {
 
     // Mr. Clean
     halfN = this->count / 2;
+    quarterN = this->count / 4;
+    reversed_indices = this->reversed_indices;
+    twiddles = this->twiddles;
+    data = (float *)samples;
 
     // Perform the stages
     // i is the number of sets to perform
@@ -133,6 +191,10 @@ void fft_rad2_dit(fft_t *this, float complex *samples, float *frequency_bins) {
         // ops_per_set = 1,2,4
         ops_per_set = halfN / set_count;
 
+        // Butterflies before this one take their twiddle from the first
+        // quarter of the circle, the rest from the second
+        split = quarter_split(ops_per_set);
+
         // Loop over sets
         // j is the set #
         for (set = 0; set < set_count; set++) {
@@ -140,38 +202,33 @@ void fft_rad2_dit(fft_t *this, float complex *samples, float *frequency_bins) {
             start = set * ops_per_set * 2;
 
             // Loop over butterflies
-            for (butterfly = 0; butterfly < ops_per_set; butterfly++) {
-                butterfly_top_idx = this->reversed_indices[start + butterfly];
-                butterfly_bottom_idx =
-                    this->reversed_indices[start + butterfly + ops_per_set];
-
-                // Determine the twiddle to pre-multiply the lower
-                // half of the butterfly
-                twiddle =
-                    this->twiddles[butterfly * set_count]; // Cache hit baby!
-                butterfly_top = samples[butterfly_top_idx];
-                butterfly_bottom = twiddle * samples[butterfly_bottom_idx];
+            for (butterfly = 0; butterfly < split; butterfly++) {
+                twiddle_idx = butterfly * set_count; // Cache hit baby!
+                butterfly_dit(
+                    data, reversed_indices[start + butterfly],
+                    reversed_indices[start + butterfly + ops_per_set],
+                    twiddles[quarterN - twiddle_idx], -twiddles[twiddle_idx]);
+            }
 
-                // Finally the butterfly
-                samples[butterfly_top_idx] = butterfly_top + butterfly_bottom;
-                samples[butterfly_bottom_idx] =
-                    butterfly_top - butterfly_bottom;
+            for (; butterfly < ops_per_set; butterfly++) {
+                twiddle_idx = butterfly * set_count - quarterN;
+                butterfly_dit(
+                    data, reversed_indices[start + butterfly],
+                    reversed_indices[start + butterfly + ops_per_set],
+                    -twiddles[twiddle_idx], -twiddles[quarterN - twiddle_idx]);
             }
         }
     }
 
-    if (frequency_bins != NULL) {
-        for (size_t i = 0; i < halfN; i++) {
-            float complex sample = samples[i];
-            frequency_bins[i] = cabsf(sample) / halfN;
-        }
-    }
+    if (frequency_bins != NULL)
+        fft_output_bins(this, samples, frequency_bins);
 }
 
 void fft_rad2_dif(fft_t *this, float complex *samples, float *frequency_bins) {
-    unsigned int halfN, set_count, ops_per_set, set, start, butterfly,
-        butterfly_top_idx, butterfly_bottom_idx;
-    float complex twiddle, butterfly_top, butterfly_bottom;
+    unsigned int halfN, quarterN, set_count, ops_per_set, split, set, start,
+        butterfly, twiddle_idx;
+    const float *twiddles;
+    float *data;
 
     // Don't mess with me
     if (samples == NULL)
@@ -179,6 +236,9 @@ void fft_rad2_dif(fft_t *this, float complex *samples, float *frequency_bins) {
 
     // Mr. Clean!
     halfN = this->count / 2;
+    quarterN = this->count / 4;
+    twiddles = this->twiddles;
+    data = (float *)samples;
 
     // Perform the stages
     // i is the number of sets to perform
@@ -189,66 +249,331 @@ void fft_rad2_dif(fft_t *this, float complex *samples, float *frequency_bins) {
         // ops_per_set = 4,2,1
         ops_per_set = halfN / set_count;
 
+        // Butterflies before this one take their twiddle from the first
+        // quarter of the circle, the rest from the second
+        split = quarter_split(ops_per_set);
+
         // Loop over sets
         for (set = 0; set < set_count; set++) {
             // Start the butterflies
             start = set * ops_per_set * 2;
 
             // Loop over butterflies
-            for (butterfly = 0; butterfly < ops_per_set; butterfly++) {
-                butterfly_top_idx = start + butterfly;
-                butterfly_bottom_idx = start + butterfly + ops_per_set;
-
-                // Determine the twiddle to pre-multiply the lower
-                // half of the butterfly
-                // Cache hit baby!
-                twiddle = this->twiddles[butterfly * set_count];
-                butterfly_top = samples[butterfly_top_idx];
-                butterfly_bottom = samples[butterfly_bottom_idx];
+            for (butterfly = 0; butterfly < split; butterfly++) {
+                twiddle_idx = butterfly * set_count; // Cache hit baby!
+                butterfly_dif(data, start + butterfly,
+                              start + butterfly + ops_per_set,
+                              twiddles[quarterN - twiddle_idx],
+                              -twiddles[twiddle_idx]);
+            }
 
-                // Finally the butterfly
-                samples[butterfly_top_idx] = butterfly_top + butterfly_bottom;
-                samples[butterfly_bottom_idx] =
-                    twiddle * (butterfly_top - butterfly_bottom);
+            for (; butterfly < ops_per_set; butterfly++) {
+                twiddle_idx = butterfly * set_count - quarterN;
+                butterfly_dif(data, start + butterfly,
+                              start + butterfly + ops_per_set,
+                              -twiddles[twiddle_idx],
+                              -twiddles[quarterN - twiddle_idx]);
             }
         }
     }
 
-    if (frequency_bins != NULL) {
-        for (size_t i = 0; i < halfN; i++) {
-            float complex sample = samples[this->reversed_indices[i]];
-            frequency_bins[i] = cabsf(sample) / halfN;
+    if (frequency_bins != NULL)
+        fft_output_bins(this, samples, frequency_bins);
+}
+
+/**
+ * @brief Radix-4 decimation in frequency butterfly over a, b, c, d spaced a
+ * quarter of the group apart, two radix-2 stages fused:
+ *
+ *  a' = a + b + c + d
+ *  b' = (a - b + c - d) * W^2j
+ *  c' = (a - c - j(b - d)) * W^j
+ *  d' = (a - c + j(b - d)) * W^3j
+ *
+ * Everything lands where the two radix-2 stages would have put it, so the
+ * output stays bit-reversed. 3 twiddle multiplies where radix-2 needs 4.
+ */
+static inline void butterfly_rad4(float *samples, unsigned int a,
+                                  unsigned int q, float w1_re, float w1_im,
+                                  float w2_re, float w2_im, float w3_re,
+                                  float w3_im) {
+    float *x0 = samples + 2 * a, *x1 = x0 + 2 * q, *x2 = x1 + 2 * q,
+          *x3 = x2 + 2 * q;
+    float sum_ac_re = x0[0] + x2[0], sum_ac_im = x0[1] + x2[1];
+    float sum_bd_re = x1[0] + x3[0], sum_bd_im = x1[1] + x3[1];
+    float diff_ac_re = x0[0] - x2[0], diff_ac_im = x0[1] - x2[1];
+    float diff_bd_re = x1[0] - x3[0], diff_bd_im = x1[1] - x3[1];
+    float re, im;
+
+    x0[0] = sum_ac_re + sum_bd_re;
+    x0[1] = sum_ac_im + sum_bd_im;
+
+    re = sum_ac_re - sum_bd_re;
+    im = sum_ac_im - sum_bd_im;
+    x1[0] = re * w2_re - im * w2_im;
+    x1[1] = re * w2_im + im * w2_re;
+
+    // -j(b - d) = (diff_bd_im, -diff_bd_re)
+    re = diff_ac_re + diff_bd_im;
+    im = diff_ac_im - diff_bd_re;
+    x2[0] = re * w1_re - im * w1_im;
+    x2[1] = re * w1_im + im * w1_re;
+
+    re = diff_ac_re - diff_bd_im;
+    im = diff_ac_im + diff_bd_re;
+    x3[0] = re * w3_re - im * w3_im;
+    x3[1] = re * w3_im + im * w3_re;
+}
+
+/**
+ * @brief Radix-2 stage of 2 point groups, all twiddles are 1.
+ */
+static void last_stage_rad2(float *samples, unsigned int N) {
+    float re, im;
+
+    for (unsigned int i = 0; i < 2 * N; i += 4) {
+        re = samples[i] - samples[i + 2];
+        im = samples[i + 1] - samples[i + 3];
+        samples[i] += samples[i + 2];
+        samples[i + 1] += samples[i + 3];
+        samples[i + 2] = re;
+        samples[i + 3] = im;
+    }
+}
+
+void fft_rad4_dif(fft_t *this, float complex *samples, float *frequency_bins) {
+    unsigned int N, quarterN, length, q, stride, start, j;
+    float w1_re, w1_im, w2_re, w2_im, w3_re, w3_im;
+    const float *twiddles;
+    float *data;
+
+    // Don't mess with me
+    if (samples == NULL)
+        return;
+
+    N = this->count;
+    quarterN = this->count / 4;
+    twiddles = this->twiddles;
+    data = (float *)samples;
+
+    for (length = N; length > 4; length >>= 2) {
+        q = length / 4;
+        stride = N / length;
+
+        // Twiddles only depend on the position inside the group, look them
+        // up once for every group
+        for (j = 0; j < q; j++) {
+            quarter_twiddle(twiddles, quarterN, j * stride, &w1_re, &w1_im);
+            quarter_twiddle(twiddles, quarterN, 2 * j * stride, &w2_re,
+                            &w2_im);
+            quarter_twiddle(twiddles, quarterN, 3 * j * stride, &w3_re,
+                            &w3_im);
+
+            for (start = j; start < N; start += length)
+                butterfly_rad4(data, start, q, w1_re, w1_im, w2_re, w2_im,
+                               w3_re, w3_im);
         }
     }
+
+    if (length == 4) {
+        // 4 point groups, no twiddles left
+        for (start = 0; start < N; start += 4)
+            butterfly_rad4(data, start, 1, 1.f, 0.f, 1.f, 0.f, 1.f, 0.f);
+    } else {
+        // Odd power of two, one radix-2 stage to clean up
+        last_stage_rad2(data, N);
+    }
+
+    if (frequency_bins != NULL)
+        fft_output_bins(this, samples, frequency_bins);
 }
 
-void fft_deinit(fft_t *this) {
-    free(this->twiddles);
-    free(this->reversed_indices);
+/**
+ * @brief The two outer stages of the staged kernel in one pass. Their
+ * twiddles are 1 and -j, so no multiplies at all:
+ *
+ *  a' = (a + c) + (b + d)     b' = (a + c) - (b + d)
+ *  c' = (a - c) - j(b - d)    d' = (a - c) + j(b - d)
+ */
+static void first_stages_staged(float *samples, unsigned int N) {
+    unsigned int q = N / 4;
+
+    for (unsigned int n = 0; n < q; n++) {
+        float *x0 = samples + 2 * n, *x1 = x0 + 2 * q, *x2 = x1 + 2 * q,
+              *x3 = x2 + 2 * q;
+        float sum_ac_re = x0[0] + x2[0], sum_ac_im = x0[1] + x2[1];
+        float sum_bd_re = x1[0] + x3[0], sum_bd_im = x1[1] + x3[1];
+        float diff_ac_re = x0[0] - x2[0], diff_ac_im = x0[1] - x2[1];
+        float diff_bd_re = x1[0] - x3[0], diff_bd_im = x1[1] - x3[1];
+
+        x0[0] = sum_ac_re + sum_bd_re;
+        x0[1] = sum_ac_im + sum_bd_im;
+        x1[0] = sum_ac_re - sum_bd_re;
+        x1[1] = sum_ac_im - sum_bd_im;
+        // -j(b - d) = (diff_bd_im, -diff_bd_re)
+        x2[0] = diff_ac_re + diff_bd_im;
+        x2[1] = diff_ac_im - diff_bd_re;
+        x3[0] = diff_ac_re - diff_bd_im;
+        x3[1] = diff_ac_im + diff_bd_re;
+    }
 }
 
-int fft_init_d(fft_d_t *this, unsigned int count) {
-    unsigned int *reversed_indices;
-    double complex *twiddles;
+void fft_rad2_dit_staged(fft_t *this, float complex *samples,
+                         float *frequency_bins) {
+    unsigned int N, quarterN, group_count, span, group, start, butterfly;
+    const fft_index_t *reversed_indices;
+    const float *twiddles;
+    float twiddle_re, twiddle_im;
+    float *data;
 
-    reversed_indices = (unsigned int *)malloc(count * sizeof(unsigned int));
+    // Don't mess with me
+    if (samples == NULL)
+        return;
+
+    N = this->count;
+    quarterN = this->count / 4;
+    reversed_indices = this->reversed_indices;
+    twiddles = this->twiddles;
+    data = (float *)samples;
+
+    if (N < 4) {
+        // A lone butterfly, its twiddle is 1
+        last_stage_rad2(data, N);
+    } else {
+        first_stages_staged(data, N);
+    }
 
-    if (reversed_indices == NULL)
+    // Every butterfly of a group shares its twiddle, W^rev(group) with the
+    // group index reversed over N/2 points, i.e. reversed_indices[2 group]
+    for (group_count = 4; group_count < N; group_count <<= 1) {
+        span = N / (2 * group_count);
+
+        for (group = 0; group < group_count; group++) {
+            quarter_twiddle(twiddles, quarterN, reversed_indices[2 * group],
+                            &twiddle_re, &twiddle_im);
+            start = 2 * group * span;
+
+            for (butterfly = start; butterfly < start + span; butterfly++)
+                butterfly_dit(data, butterfly, butterfly + span, twiddle_re,
+                              twiddle_im);
+        }
+    }
+
+    if (frequency_bins != NULL)
+        fft_output_bins(this, samples, frequency_bins);
+}
+
+/**
+ * @brief Split-radix L butterfly. The even outputs stay a half size
+ * transform, only the odd quarters get twiddled:
+ *
+ *  a' = a + c                      b' = b + d
+ *  c' = (a - c - j(b - d)) * W^j   d' = (a - c + j(b - d)) * W^3j
+ */
+static inline void butterfly_split(float *samples, unsigned int a,
+                                   unsigned int q, float w1_re, float w1_im,
+                                   float w3_re, float w3_im) {
+    float *x0 = samples + 2 * a, *x1 = x0 + 2 * q, *x2 = x1 + 2 * q,
+          *x3 = x2 + 2 * q;
+    float diff_ac_re = x0[0] - x2[0], diff_ac_im = x0[1] - x2[1];
+    float diff_bd_re = x1[0] - x3[0], diff_bd_im = x1[1] - x3[1];
+    float re, im;
+
+    x0[0] += x2[0];
+    x0[1] += x2[1];
+    x1[0] += x3[0];
+    x1[1] += x3[1];
+
+    re = diff_ac_re + diff_bd_im;
+    im = diff_ac_im - diff_bd_re;
+    x2[0] = re * w1_re - im * w1_im;
+    x2[1] = re * w1_im + im * w1_re;
+
+    re = diff_ac_re - diff_bd_im;
+    im = diff_ac_im + diff_bd_re;
+    x3[0] = re * w3_re - im * w3_im;
+    x3[1] = re * w3_im + im * w3_re;
+}
+
+/**
+ * @brief One split-radix transform of length points, then the half and the
+ * two quarters it leaves behind. stride is N/length, W_length^j is W_N^(j *
+ * stride).
+ */
+static void split_radix(float *data, unsigned int length, unsigned int stride,
+                        const float *twiddles, unsigned int quarterN) {
+    unsigned int q, j;
+    float w1_re, w1_im, w3_re, w3_im;
+
+    // The half of a 4 point L butterfly is a radix-2, together a plain
+    // radix-4 without twiddles
+    if (length == 4) {
+        butterfly_rad4(data, 0, 1, 1.f, 0.f, 1.f, 0.f, 1.f, 0.f);
+        return;
+    }
+
+    if (length == 2) {
+        last_stage_rad2(data, 2);
+        return;
+    }
+
+    q = length / 4;
+
+    for (j = 0; j < q; j++) {
+        quarter_twiddle(twiddles, quarterN, j * stride, &w1_re, &w1_im);
+        quarter_twiddle(twiddles, quarterN, 3 * j * stride, &w3_re, &w3_im);
+        butterfly_split(data, j, q, w1_re, w1_im, w3_re, w3_im);
+    }
+
+    split_radix(data, 2 * q, 2 * stride, twiddles, quarterN);
+    split_radix(data + 4 * q, q, 4 * stride, twiddles, quarterN);
+    split_radix(data + 6 * q, q, 4 * stride, twiddles, quarterN);
+}
+
+void fft_split_radix(fft_t *this, float complex *samples,
+                     float *frequency_bins) {
+    // Don't mess with me
+    if (samples == NULL)
+        return;
+
+    split_radix((float *)samples, this->count, 1, this->twiddles,
+                this->count / 4);
+
+    if (frequency_bins != NULL)
+        fft_output_bins(this, samples, frequency_bins);
+}
+
+void fft_deinit(fft_t *this) { arena_free(this->arena, this->mem); }
+
+size_t fft_required_buffer_size_d(size_t count) {
+    return (count / 2) * sizeof(double complex) + count * sizeof(fft_index_t);
+}
+
+int fft_init_d(fft_d_t *this, arena_t *arena, size_t count) {
+    fft_index_t *reversed_indices;
+    double complex *twiddles;
+    void *mem;
+
+    if (!is_valid_count(count))
         return -1;
 
-    twiddles = (double complex *)malloc((count / 2) * sizeof(double complex));
+    mem = arena_alloc(arena, fft_required_buffer_size_d(count), ARENA_ALIGN);
 
-    if (twiddles == NULL) {
-        free(reversed_indices);
+    if (mem == NULL)
         return -1;
-    }
+
+    // Twiddles first, they have the stricter alignment
+    twiddles = (double complex *)mem;
+    reversed_indices = (fft_index_t *)(twiddles + count / 2);
 
     fill_reversed_indices(reversed_indices, count);
-    fill_twiddles_d(twiddles, count / 2);
+    fill_twiddles_d(twiddles, count);
 
     this->count = count;
     this->reversed_indices = reversed_indices;
     this->twiddles = twiddles;
+    this->mem = mem;
+    this->arena = arena;
 
     return 1;
 }
@@ -304,7 +629,8 @@ void fft_rad2_dit_d(fft_d_t *this, double complex *samples,
 
     if (frequency_bins != NULL) {
         for (size_t i = 0; i < halfN; i++) {
-            double complex sample = samples[i];
+            // Output lands in bit-reversed order
+            double complex sample = samples[this->reversed_indices[i]];
             frequency_bins[i] = cabs(sample) / halfN;
         }
     }
@@ -365,7 +691,4 @@ void fft_rad2_dif_d(fft_d_t *this, double complex *samples,
     }
 }
 
-void fft_deinit_d(fft_d_t *this) {
-    free(this->twiddles);
-    free(this->reversed_indices);
-}
\ No newline at end of file
+void fft_deinit_d(fft_d_t *this) { arena_free(this->arena, this->mem); }
@@ -1,31 +1,275 @@
 #ifndef FFT_H
 #define FFT_H
 
+#include "arena.h"
+#include "fft_output.h"
+#include "fft_static_sizes.h"
+
 #include <complex.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#ifndef FFT_MAX_COUNT
+#define FFT_MAX_COUNT 4096
+#endif
+
+// Smallest type able to index every sample of the largest transform
+#if FFT_MAX_COUNT <= 256
+typedef uint8_t fft_index_t;
+#elif FFT_MAX_COUNT <= 65536
+typedef uint16_t fft_index_t;
+#else
+#error "FFT_MAX_COUNT must not exceed 65536"
+#endif
+
+/**
+ * Arena bytes the init of a size takes, a constant expression so the SRAM of
+ * a configuration is known at compile time. Sizes generated into flash take
+ * none.
+ */
+#define FFT_TABLES_FOOTPRINT(count, twiddle_size)                              \
+    (FFT_IS_STATIC_SIZE(count)                                                 \
+         ? 0                                                                   \
+         : ARENA_FOOTPRINT(((count) / 4 + 1) * (twiddle_size) +                \
+                           (count) * sizeof(fft_index_t)))
+#define FFT_FOOTPRINT(count) FFT_TABLES_FOOTPRINT(count, sizeof(float))
+#define FFT_REAL_FOOTPRINT(count)                                              \
+    (FFT_FOOTPRINT((count) / 2) +                                              \
+     (FFT_IS_STATIC_SIZE(count)                                                \
+          ? 0                                                                  \
+          : ARENA_FOOTPRINT(((count) / 4 + 1) * sizeof(float))))
+#define FFT_Q15_FOOTPRINT(count) FFT_TABLES_FOOTPRINT(count, sizeof(int16_t))
+#define FFT_Q31_FOOTPRINT(count) FFT_TABLES_FOOTPRINT(count, sizeof(int32_t))
+#define FFT_REAL_Q15_FOOTPRINT(count)                                          \
+    (FFT_Q15_FOOTPRINT((count) / 2) +                                          \
+     (FFT_IS_STATIC_SIZE(count)                                                \
+          ? 0                                                                  \
+          : ARENA_FOOTPRINT(((count) / 4 + 1) * sizeof(int16_t))))
+#define FFT_REAL_Q31_FOOTPRINT(count)                                          \
+    (FFT_Q31_FOOTPRINT((count) / 2) +                                          \
+     (FFT_IS_STATIC_SIZE(count)                                                \
+          ? 0                                                                  \
+          : ARENA_FOOTPRINT(((count) / 4 + 1) * sizeof(int32_t))))
+
+/**
+ * Float complex kernels. All of them take natural order input and leave
+ * their output in bit-reversed order, so they share the plan and the output
+ * stage. Radix-4 and split-radix need about a quarter fewer twiddle
+ * multiplies than radix-2, and radix-4 makes half as many passes over the
+ * samples. The staged radix-2 keeps the plain butterflies but does the two
+ * outer stages without multiplies and looks a twiddle up once per group.
+ *
+ * The planar radix-2 takes split-complex samples instead, see
+ * fft_rad2_dif_planar. In a real-input transform the even samples go first
+ * and the odd ones second, rather than interleaved.
+ */
+typedef enum {
+    FFT_KERNEL_RADIX2,
+    FFT_KERNEL_RADIX4,
+    FFT_KERNEL_SPLIT_RADIX,
+    FFT_KERNEL_RADIX2_STAGED,
+    FFT_KERNEL_RADIX2_PLANAR,
+} fft_kernel_t;
+
+/**
+ * The tables either live in flash, generated at build time for the sizes in
+ * FFT_STATIC_SIZES, or in mem, taken from the arena given to init, when the
+ * size was not generated.
+ *
+ * Twiddles are stored as a quarter wave, sin(2*pi*k/N) for k <= N/4, the
+ * rest of the circle follows by symmetry.
+ */
 typedef struct {
-    unsigned int *reversed_indices;
-    float complex *twiddles;
+    const fft_index_t *reversed_indices;
+    const float *twiddles;
     size_t count;
+    // How frequency_bins are written, magnitudes by default
+    fft_output_t output;
+    void *mem;
+    arena_t *arena;
 } fft_t;
 
 typedef struct {
-    unsigned int *reversed_indices;
+    const fft_index_t *reversed_indices;
     double complex *twiddles;
     size_t count;
+    void *mem;
+    arena_t *arena;
 } fft_d_t;
 
-int fft_init(fft_t *this, size_t count);
+/**
+ * Real-input transform. The N real samples are packed into an N/2 point
+ * complex transform, a split pass then untangles the even and odd halves.
+ */
+typedef struct {
+    fft_t fft;
+    // Quarter wave of W_N, used by the split pass
+    const float *twiddles;
+    size_t count;
+    // Runs the inner transform, radix-2 by default
+    fft_kernel_t kernel;
+    fft_output_t output;
+    void *mem;
+    arena_t *arena;
+} fft_real_t;
+
+typedef struct {
+    int16_t re;
+    int16_t im;
+} fft_q15_complex_t;
+
+typedef struct {
+    int32_t re;
+    int32_t im;
+} fft_q31_complex_t;
+
+/**
+ * Fixed-point engines for cores without an FPU. Every stage is block scaled,
+ * the total number of right shifts applied by the last transform is kept in
+ * block_exponent, i.e. true output = samples * 2^block_exponent.
+ *
+ * bin_scale is folded into the magnitude pass, so callers that pre-scale
+ * their input to gain headroom can undo it for free. Defaults to 1.
+ *
+ * Tables follow the same rules as fft_t.
+ */
+typedef struct {
+    const fft_index_t *reversed_indices;
+    const int16_t *twiddles;
+    size_t count;
+    int block_exponent;
+    float bin_scale;
+    fft_output_t output;
+    void *mem;
+    arena_t *arena;
+} fft_q15_t;
+
+typedef struct {
+    const fft_index_t *reversed_indices;
+    const int32_t *twiddles;
+    size_t count;
+    int block_exponent;
+    float bin_scale;
+    fft_output_t output;
+    void *mem;
+    arena_t *arena;
+} fft_q31_t;
+
+/**
+ * Real-input fixed-point transforms, fft_real_t for the Q15 and Q31 engines.
+ * The N real samples are packed into an N/2 point transform of the same
+ * engine, even samples in the real parts and odd ones in the imaginary
+ * parts. The split pass is integer arithmetic, run by the output stage, and
+ * block scales on its own on top of fft.block_exponent.
+ */
+typedef struct {
+    fft_q15_t fft;
+    // Quarter wave of W_N, used by the split pass
+    const int16_t *twiddles;
+    size_t count;
+    float bin_scale;
+    fft_output_t output;
+    void *mem;
+    arena_t *arena;
+} fft_real_q15_t;
+
+typedef struct {
+    fft_q31_t fft;
+    const int32_t *twiddles;
+    size_t count;
+    float bin_scale;
+    fft_output_t output;
+    void *mem;
+    arena_t *arena;
+} fft_real_q31_t;
+
+size_t fft_required_buffer_size(size_t count);
+int fft_init(fft_t *this, arena_t *arena, size_t count);
 void fft_rad2_dit(fft_t *this, float complex *samples, float *frequency_bins);
 void fft_rad2_dif(fft_t *this, float complex *samples, float *frequency_bins);
+// Odd powers of two finish with a radix-2 stage
+void fft_rad4_dif(fft_t *this, float complex *samples, float *frequency_bins);
+void fft_split_radix(fft_t *this, float complex *samples,
+                     float *frequency_bins);
+/**
+ * @brief Decimation in time straight off natural order input. Every
+ * butterfly of a group shares one twiddle, the bit reversal is applied to
+ * the twiddle of the group instead of to every sample load.
+ */
+void fft_rad2_dit_staged(fft_t *this, float complex *samples,
+                         float *frequency_bins);
+/**
+ * @brief The output stage on its own, writes the frequency bins of an
+ * already transformed buffer the way this->output says. The transforms run
+ * it themselves when given frequency_bins.
+ */
+void fft_output_bins(fft_t *this, const float complex *samples,
+                     float *frequency_bins);
+/**
+ * @brief Split-complex (planar) samples, the real parts in re and the
+ * imaginary parts in im, both natural order in and bit-reversed out. Same
+ * plan as the interleaved kernels. The butterflies are plain real
+ * arithmetic over contiguous runs of both arrays, which the compiler
+ * vectorizes where the core has SIMD.
+ */
+void fft_rad2_dif_planar(fft_t *this, float *re, float *im,
+                         float *frequency_bins);
+void fft_output_bins_planar(fft_t *this, const float *re, const float *im,
+                            float *frequency_bins);
 void fft_deinit(fft_t *this);
 
-int fft_init_d(fft_d_t *this, size_t count);
+size_t fft_required_buffer_size_real(size_t count);
+int fft_init_real(fft_real_t *this, arena_t *arena, size_t count);
+// FFT_KERNEL_RADIX2_PLANAR expects the even samples first, then the odd ones
+void fft_rad2_dif_real(fft_real_t *this, float *samples, float *frequency_bins);
+// Includes the split pass, samples as the inner transform left them
+void fft_output_bins_real(fft_real_t *this, const float *samples,
+                          float *frequency_bins);
+void fft_deinit_real(fft_real_t *this);
+
+size_t fft_required_buffer_size_d(size_t count);
+int fft_init_d(fft_d_t *this, arena_t *arena, size_t count);
 void fft_rad2_dit_d(fft_d_t *this, double complex *samples,
                     double *frequency_bins);
 void fft_rad2_dif_d(fft_d_t *this, double complex *samples,
                     double *frequency_bins);
 void fft_deinit_d(fft_d_t *this);
 
+size_t fft_required_buffer_size_q15(size_t count);
+int fft_init_q15(fft_q15_t *this, arena_t *arena, size_t count);
+void fft_rad2_dit_q15(fft_q15_t *this, fft_q15_complex_t *samples,
+                      float *frequency_bins);
+void fft_rad2_dif_q15(fft_q15_t *this, fft_q15_complex_t *samples,
+                      float *frequency_bins);
+void fft_output_bins_q15(fft_q15_t *this, const fft_q15_complex_t *samples,
+                         float *frequency_bins);
+void fft_deinit_q15(fft_q15_t *this);
+
+size_t fft_required_buffer_size_q31(size_t count);
+int fft_init_q31(fft_q31_t *this, arena_t *arena, size_t count);
+void fft_rad2_dit_q31(fft_q31_t *this, fft_q31_complex_t *samples,
+                      float *frequency_bins);
+void fft_rad2_dif_q31(fft_q31_t *this, fft_q31_complex_t *samples,
+                      float *frequency_bins);
+void fft_output_bins_q31(fft_q31_t *this, const fft_q31_complex_t *samples,
+                         float *frequency_bins);
+void fft_deinit_q31(fft_q31_t *this);
+
+size_t fft_required_buffer_size_real_q15(size_t count);
+int fft_init_real_q15(fft_real_q15_t *this, arena_t *arena, size_t count);
+void fft_rad2_dif_real_q15(fft_real_q15_t *this, int16_t *samples,
+                           float *frequency_bins);
+// Includes the split pass, samples as the inner transform left them
+void fft_output_bins_real_q15(fft_real_q15_t *this, const int16_t *samples,
+                              float *frequency_bins);
+void fft_deinit_real_q15(fft_real_q15_t *this);
+
+size_t fft_required_buffer_size_real_q31(size_t count);
+int fft_init_real_q31(fft_real_q31_t *this, arena_t *arena, size_t count);
+void fft_rad2_dif_real_q31(fft_real_q31_t *this, int32_t *samples,
+                           float *frequency_bins);
+void fft_output_bins_real_q31(fft_real_q31_t *this, const int32_t *samples,
+                              float *frequency_bins);
+void fft_deinit_real_q31(fft_real_q31_t *this);
+
 #endif
\ No newline at end of file
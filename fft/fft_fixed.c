@@ -0,0 +1,1015 @@
+#include "fft.h"
+#include "fft_tables.h"
+#include "fft_util.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// A radix-2 butterfly grows a component by at most 2 * sqrt(2), so a stage
+// whose inputs stay below a quarter of full scale can never overflow
+#define Q15_HEADROOM_LIMIT ((uint32_t)1 << 13)
+#define Q31_HEADROOM_LIMIT ((uint32_t)1 << 29)
+
+#define Q15_ONE_HALF ((int32_t)1 << 14)
+#define Q31_ONE_HALF ((int64_t)1 << 30)
+
+/**
+ * @brief Bit-by-bit integer square root, no FPU required.
+ *
+ * @param value The radicand
+ * @return uint32_t floor(sqrt(value))
+ */
+static inline uint32_t isqrt32(uint32_t value) {
+    uint32_t root = 0, bit = (uint32_t)1 << 30;
+
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+static inline uint64_t isqrt64(uint64_t value) {
+    uint64_t root = 0, bit = (uint64_t)1 << 62;
+
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+
+        bit >>= 2;
+    }
+
+    return root;
+}
+
+/**
+ * @brief Number of right shifts needed to bring a block back under the
+ * headroom limit.
+ *
+ * @param bits Bitwise OR of the absolute values of every component, an
+ * upper bound of the highest set bit without needing a compare per sample
+ * @param limit The headroom limit of the format
+ * @return unsigned int Shift to apply on the next stage's loads
+ */
+static inline unsigned int stage_shift(uint32_t bits, uint32_t limit) {
+    unsigned int shift = 0;
+
+    while ((bits >> shift) >= limit)
+        shift++;
+
+    return shift;
+}
+
+static inline uint32_t abs32(int32_t value) {
+    return value < 0 ? -(uint32_t)value : (uint32_t)value;
+}
+
+static uint32_t block_bits_q15(const fft_q15_complex_t *samples,
+                               size_t count) {
+    uint32_t bits = 0;
+
+    for (size_t i = 0; i < count; i++)
+        bits |= abs32(samples[i].re) | abs32(samples[i].im);
+
+    return bits;
+}
+
+static uint32_t block_bits_q31(const fft_q31_complex_t *samples,
+                               size_t count) {
+    uint32_t bits = 0;
+
+    for (size_t i = 0; i < count; i++)
+        bits |= abs32(samples[i].re) | abs32(samples[i].im);
+
+    return bits;
+}
+
+static void fill_twiddles_q15(int16_t *twiddles, unsigned int N) {
+    double angle_per_sample;
+    unsigned int i;
+
+    // 2pi/N, only computed once at init so double is fine
+    angle_per_sample = 2.0 * M_PI / N;
+
+    // Quarter wave, 1.0 is not representable, so scale to the largest
+    // positive value
+    for (i = 0; i <= N / 4; i++)
+        twiddles[i] = (int16_t)lrint(sin(angle_per_sample * i) * INT16_MAX);
+}
+
+static void fill_twiddles_q31(int32_t *twiddles, unsigned int N) {
+    double angle_per_sample;
+    unsigned int i;
+
+    angle_per_sample = 2.0 * M_PI / N;
+
+    for (i = 0; i <= N / 4; i++)
+        twiddles[i] = (int32_t)llrint(sin(angle_per_sample * i) * INT32_MAX);
+}
+
+/**
+ * @brief Q15 decimation in time butterfly, the stage shift is applied while
+ * loading.
+ *
+ * @return uint32_t OR of the absolute values written, for the next stage's
+ * block scaling
+ */
+static inline uint32_t butterfly_dit_q15(fft_q15_complex_t *samples,
+                                         unsigned int top_idx,
+                                         unsigned int bottom_idx,
+                                         int32_t twiddle_re,
+                                         int32_t twiddle_im,
+                                         unsigned int shift) {
+    int32_t top_re, top_im, bottom_re, bottom_im, product_re, product_im;
+
+    top_re = samples[top_idx].re >> shift;
+    top_im = samples[top_idx].im >> shift;
+    bottom_re = samples[bottom_idx].re >> shift;
+    bottom_im = samples[bottom_idx].im >> shift;
+
+    // Q15 x Q15 = Q30, round back down to Q15
+    product_re =
+        (bottom_re * twiddle_re - bottom_im * twiddle_im + Q15_ONE_HALF) >> 15;
+    product_im =
+        (bottom_re * twiddle_im + bottom_im * twiddle_re + Q15_ONE_HALF) >> 15;
+
+    samples[top_idx].re = top_re + product_re;
+    samples[top_idx].im = top_im + product_im;
+    samples[bottom_idx].re = top_re - product_re;
+    samples[bottom_idx].im = top_im - product_im;
+
+    return abs32(top_re + product_re) | abs32(top_im + product_im) |
+           abs32(top_re - product_re) | abs32(top_im - product_im);
+}
+
+static inline uint32_t butterfly_dif_q15(fft_q15_complex_t *samples,
+                                         unsigned int top_idx,
+                                         unsigned int bottom_idx,
+                                         int32_t twiddle_re,
+                                         int32_t twiddle_im,
+                                         unsigned int shift) {
+    int32_t top_re, top_im, bottom_re, bottom_im, diff_re, diff_im, sum_re,
+        sum_im, product_re, product_im;
+
+    top_re = samples[top_idx].re >> shift;
+    top_im = samples[top_idx].im >> shift;
+    bottom_re = samples[bottom_idx].re >> shift;
+    bottom_im = samples[bottom_idx].im >> shift;
+
+    sum_re = top_re + bottom_re;
+    sum_im = top_im + bottom_im;
+    diff_re = top_re - bottom_re;
+    diff_im = top_im - bottom_im;
+
+    // Q15 x Q15 = Q30, round back down to Q15
+    product_re =
+        (diff_re * twiddle_re - diff_im * twiddle_im + Q15_ONE_HALF) >> 15;
+    product_im =
+        (diff_re * twiddle_im + diff_im * twiddle_re + Q15_ONE_HALF) >> 15;
+
+    samples[top_idx].re = sum_re;
+    samples[top_idx].im = sum_im;
+    samples[bottom_idx].re = product_re;
+    samples[bottom_idx].im = product_im;
+
+    return abs32(sum_re) | abs32(sum_im) | abs32(product_re) |
+           abs32(product_im);
+}
+
+static inline uint32_t butterfly_dit_q31(fft_q31_complex_t *samples,
+                                         unsigned int top_idx,
+                                         unsigned int bottom_idx,
+                                         int32_t twiddle_re,
+                                         int32_t twiddle_im,
+                                         unsigned int shift) {
+    int32_t top_re, top_im, bottom_re, bottom_im, product_re, product_im;
+
+    top_re = samples[top_idx].re >> shift;
+    top_im = samples[top_idx].im >> shift;
+    bottom_re = samples[bottom_idx].re >> shift;
+    bottom_im = samples[bottom_idx].im >> shift;
+
+    // Q31 x Q31 = Q62, round back down to Q31
+    product_re = (int32_t)(((int64_t)bottom_re * twiddle_re -
+                            (int64_t)bottom_im * twiddle_im + Q31_ONE_HALF) >>
+                           31);
+    product_im = (int32_t)(((int64_t)bottom_re * twiddle_im +
+                            (int64_t)bottom_im * twiddle_re + Q31_ONE_HALF) >>
+                           31);
+
+    samples[top_idx].re = top_re + product_re;
+    samples[top_idx].im = top_im + product_im;
+    samples[bottom_idx].re = top_re - product_re;
+    samples[bottom_idx].im = top_im - product_im;
+
+    return abs32(top_re + product_re) | abs32(top_im + product_im) |
+           abs32(top_re - product_re) | abs32(top_im - product_im);
+}
+
+static inline uint32_t butterfly_dif_q31(fft_q31_complex_t *samples,
+                                         unsigned int top_idx,
+                                         unsigned int bottom_idx,
+                                         int32_t twiddle_re,
+                                         int32_t twiddle_im,
+                                         unsigned int shift) {
+    int32_t top_re, top_im, bottom_re, bottom_im, diff_re, diff_im, sum_re,
+        sum_im, product_re, product_im;
+
+    top_re = samples[top_idx].re >> shift;
+    top_im = samples[top_idx].im >> shift;
+    bottom_re = samples[bottom_idx].re >> shift;
+    bottom_im = samples[bottom_idx].im >> shift;
+
+    sum_re = top_re + bottom_re;
+    sum_im = top_im + bottom_im;
+    diff_re = top_re - bottom_re;
+    diff_im = top_im - bottom_im;
+
+    // Q31 x Q31 = Q62, round back down to Q31
+    product_re = (int32_t)(((int64_t)diff_re * twiddle_re -
+                            (int64_t)diff_im * twiddle_im + Q31_ONE_HALF) >>
+                           31);
+    product_im = (int32_t)(((int64_t)diff_re * twiddle_im +
+                            (int64_t)diff_im * twiddle_re + Q31_ONE_HALF) >>
+                           31);
+
+    samples[top_idx].re = sum_re;
+    samples[top_idx].im = sum_im;
+    samples[bottom_idx].re = product_re;
+    samples[bottom_idx].im = product_im;
+
+    return abs32(sum_re) | abs32(sum_im) | abs32(product_re) |
+           abs32(product_im);
+}
+
+size_t fft_required_buffer_size_q15(size_t count) {
+    // Nothing to allocate when the tables were generated for this size
+    if (fft_find_static_tables(count) != NULL)
+        return 0;
+
+    return (count / 4 + 1) * sizeof(int16_t) + count * sizeof(fft_index_t);
+}
+
+int fft_init_q15(fft_q15_t *this, arena_t *arena, size_t count) {
+    const fft_tables_t *tables;
+    fft_index_t *reversed_indices;
+    int16_t *twiddles;
+    void *mem;
+
+    if (!is_valid_count(count))
+        return -1;
+
+    this->count = count;
+    this->block_exponent = 0;
+    this->bin_scale = 1.f;
+    this->output = fft_output_default();
+    this->arena = arena;
+
+    // Straight from flash, no RAM and no boot time
+    if ((tables = fft_find_static_tables(count)) != NULL) {
+        this->reversed_indices = tables->reversed_indices;
+        this->twiddles = tables->twiddles_q15;
+        this->mem = NULL;
+
+        return 1;
+    }
+
+    mem = arena_alloc(arena, fft_required_buffer_size_q15(count),
+                      ARENA_ALIGN);
+
+    if (mem == NULL)
+        return -1;
+
+    // Twiddles first, they have the stricter alignment
+    twiddles = (int16_t *)mem;
+    reversed_indices = (fft_index_t *)(twiddles + count / 4 + 1);
+
+    fill_reversed_indices(reversed_indices, count);
+    fill_twiddles_q15(twiddles, count);
+
+    this->reversed_indices = reversed_indices;
+    this->twiddles = twiddles;
+    this->mem = mem;
+
+    return 1;
+}
+
+/**
+ * @brief One Q15 bin, integer all the way until the final multiply.
+ */
+static FFT_ALWAYS_INLINE float output_bin_q15(const output_stage_t *stage,
+                                              fft_output_mode_t mode,
+                                              int32_t re, int32_t im) {
+    uint32_t power = (uint32_t)(re * re) + (uint32_t)(im * im), high, low;
+
+    switch (mode) {
+    case FFT_OUTPUT_POWER:
+        return (float)power * stage->power_scale;
+    case FFT_OUTPUT_APPROX_MAGNITUDE:
+        high = abs32(re);
+        low = abs32(im);
+
+        // Components stay under 2^15, the sum fits in 32 bits
+        return (float)(high > low
+                           ? high * APPROX_ALPHA_Q16 + low * APPROX_BETA_Q16
+                           : low * APPROX_ALPHA_Q16 + high * APPROX_BETA_Q16) *
+               stage->approx_q16_scale;
+    case FFT_OUTPUT_LOG:
+        return output_log(stage, log2_u32(power));
+    default:
+        return (float)isqrt32(power) * stage->scale;
+    }
+}
+
+static FFT_ALWAYS_INLINE void bins_q15_mode(fft_q15_t *this,
+                                            const fft_q15_complex_t *samples,
+                                            float *frequency_bins,
+                                            const output_stage_t *stage,
+                                            fft_output_mode_t mode) {
+    size_t halfN = this->count / 2;
+
+    for (size_t i = 0; i < halfN; i++) {
+        fft_q15_complex_t sample = samples[this->reversed_indices[i]];
+        frequency_bins[i] = output_bin_q15(stage, mode, sample.re, sample.im);
+    }
+}
+
+void fft_output_bins_q15(fft_q15_t *this, const fft_q15_complex_t *samples,
+                         float *frequency_bins) {
+    output_stage_t stage;
+
+    // Undo the block scaling, the Q15 format and the 1/(N/2) normalization
+    // in one go, a single float multiply per bin
+    stage = output_stage(&this->output,
+                         ldexpf(this->bin_scale / (this->count / 2),
+                                this->block_exponent - 15));
+
+    switch (stage.mode) {
+    case FFT_OUTPUT_POWER:
+        bins_q15_mode(this, samples, frequency_bins, &stage,
+                      FFT_OUTPUT_POWER);
+        break;
+    case FFT_OUTPUT_APPROX_MAGNITUDE:
+        bins_q15_mode(this, samples, frequency_bins, &stage,
+                      FFT_OUTPUT_APPROX_MAGNITUDE);
+        break;
+    case FFT_OUTPUT_LOG:
+        bins_q15_mode(this, samples, frequency_bins, &stage, FFT_OUTPUT_LOG);
+        break;
+    default:
+        bins_q15_mode(this, samples, frequency_bins, &stage,
+                      FFT_OUTPUT_MAGNITUDE);
+        break;
+    }
+}
+
+void fft_rad2_dit_q15(fft_q15_t *this, fft_q15_complex_t *samples,
+                      float *frequency_bins) {
+    unsigned int halfN, quarterN, set_count, ops_per_set, split, set, start,
+        butterfly, twiddle_idx, shift;
+    const fft_index_t *reversed_indices;
+    const int16_t *twiddles;
+    uint32_t bits;
+
+    // Don't mess with me
+    if (samples == NULL)
+        return;
+
+    halfN = this->count / 2;
+    quarterN = this->count / 4;
+    reversed_indices = this->reversed_indices;
+    twiddles = this->twiddles;
+    this->block_exponent = 0;
+    bits = block_bits_q15(samples, this->count);
+
+    for (set_count = halfN; set_count >= 1; set_count >>= 1) {
+        ops_per_set = halfN / set_count;
+        split = quarter_split(ops_per_set);
+
+        // Block scaling, the shift is applied while loading the butterflies
+        shift = stage_shift(bits, Q15_HEADROOM_LIMIT);
+        this->block_exponent += shift;
+        bits = 0;
+
+        for (set = 0; set < set_count; set++) {
+            start = set * ops_per_set * 2;
+
+            // First quarter of the circle
+            for (butterfly = 0; butterfly < split; butterfly++) {
+                twiddle_idx = butterfly * set_count;
+                bits |= butterfly_dit_q15(
+                    samples, reversed_indices[start + butterfly],
+                    reversed_indices[start + butterfly + ops_per_set],
+                    twiddles[quarterN - twiddle_idx], -twiddles[twiddle_idx],
+                    shift);
+            }
+
+            // Second quarter
+            for (; butterfly < ops_per_set; butterfly++) {
+                twiddle_idx = butterfly * set_count - quarterN;
+                bits |= butterfly_dit_q15(
+                    samples, reversed_indices[start + butterfly],
+                    reversed_indices[start + butterfly + ops_per_set],
+                    -twiddles[twiddle_idx], -twiddles[quarterN - twiddle_idx],
+                    shift);
+            }
+        }
+    }
+
+    if (frequency_bins != NULL)
+        fft_output_bins_q15(this, samples, frequency_bins);
+}
+
+void fft_rad2_dif_q15(fft_q15_t *this, fft_q15_complex_t *samples,
+                      float *frequency_bins) {
+    unsigned int halfN, quarterN, set_count, ops_per_set, split, set, start,
+        butterfly, twiddle_idx, shift;
+    const int16_t *twiddles;
+    uint32_t bits;
+
+    // Don't mess with me
+    if (samples == NULL)
+        return;
+
+    halfN = this->count / 2;
+    quarterN = this->count / 4;
+    twiddles = this->twiddles;
+    this->block_exponent = 0;
+    bits = block_bits_q15(samples, this->count);
+
+    for (set_count = 1; set_count <= halfN; set_count <<= 1) {
+        ops_per_set = halfN / set_count;
+        split = quarter_split(ops_per_set);
+
+        // Block scaling, the shift is applied while loading the butterflies
+        shift = stage_shift(bits, Q15_HEADROOM_LIMIT);
+        this->block_exponent += shift;
+        bits = 0;
+
+        for (set = 0; set < set_count; set++) {
+            start = set * ops_per_set * 2;
+
+            // First quarter of the circle
+            for (butterfly = 0; butterfly < split; butterfly++) {
+                twiddle_idx = butterfly * set_count;
+                bits |= butterfly_dif_q15(
+                    samples, start + butterfly, start + butterfly + ops_per_set,
+                    twiddles[quarterN - twiddle_idx], -twiddles[twiddle_idx],
+                    shift);
+            }
+
+            // Second quarter
+            for (; butterfly < ops_per_set; butterfly++) {
+                twiddle_idx = butterfly * set_count - quarterN;
+                bits |= butterfly_dif_q15(
+                    samples, start + butterfly, start + butterfly + ops_per_set,
+                    -twiddles[twiddle_idx], -twiddles[quarterN - twiddle_idx],
+                    shift);
+            }
+        }
+    }
+
+    if (frequency_bins != NULL)
+        fft_output_bins_q15(this, samples, frequency_bins);
+}
+
+void fft_deinit_q15(fft_q15_t *this) {
+    arena_free(this->arena, this->mem);
+}
+
+size_t fft_required_buffer_size_q31(size_t count) {
+    if (fft_find_static_tables(count) != NULL)
+        return 0;
+
+    return (count / 4 + 1) * sizeof(int32_t) + count * sizeof(fft_index_t);
+}
+
+int fft_init_q31(fft_q31_t *this, arena_t *arena, size_t count) {
+    const fft_tables_t *tables;
+    fft_index_t *reversed_indices;
+    int32_t *twiddles;
+    void *mem;
+
+    if (!is_valid_count(count))
+        return -1;
+
+    this->count = count;
+    this->block_exponent = 0;
+    this->bin_scale = 1.f;
+    this->output = fft_output_default();
+    this->arena = arena;
+
+    if ((tables = fft_find_static_tables(count)) != NULL) {
+        this->reversed_indices = tables->reversed_indices;
+        this->twiddles = tables->twiddles_q31;
+        this->mem = NULL;
+
+        return 1;
+    }
+
+    mem = arena_alloc(arena, fft_required_buffer_size_q31(count),
+                      ARENA_ALIGN);
+
+    if (mem == NULL)
+        return -1;
+
+    twiddles = (int32_t *)mem;
+    reversed_indices = (fft_index_t *)(twiddles + count / 4 + 1);
+
+    fill_reversed_indices(reversed_indices, count);
+    fill_twiddles_q31(twiddles, count);
+
+    this->reversed_indices = reversed_indices;
+    this->twiddles = twiddles;
+    this->mem = mem;
+
+    return 1;
+}
+
+static FFT_ALWAYS_INLINE float output_bin_q31(const output_stage_t *stage,
+                                              fft_output_mode_t mode,
+                                              int32_t re, int32_t im) {
+    uint64_t power = (uint64_t)((int64_t)re * re) +
+                     (uint64_t)((int64_t)im * im),
+             high, low;
+
+    switch (mode) {
+    case FFT_OUTPUT_POWER:
+        return (float)power * stage->power_scale;
+    case FFT_OUTPUT_APPROX_MAGNITUDE:
+        high = abs32(re);
+        low = abs32(im);
+
+        return (float)(high > low
+                           ? high * APPROX_ALPHA_Q16 + low * APPROX_BETA_Q16
+                           : low * APPROX_ALPHA_Q16 + high * APPROX_BETA_Q16) *
+               stage->approx_q16_scale;
+    case FFT_OUTPUT_LOG:
+        return output_log(stage, log2_u64(power));
+    default:
+        return (float)isqrt64(power) * stage->scale;
+    }
+}
+
+static FFT_ALWAYS_INLINE void bins_q31_mode(fft_q31_t *this,
+                                            const fft_q31_complex_t *samples,
+                                            float *frequency_bins,
+                                            const output_stage_t *stage,
+                                            fft_output_mode_t mode) {
+    size_t halfN = this->count / 2;
+
+    for (size_t i = 0; i < halfN; i++) {
+        fft_q31_complex_t sample = samples[this->reversed_indices[i]];
+        frequency_bins[i] = output_bin_q31(stage, mode, sample.re, sample.im);
+    }
+}
+
+void fft_output_bins_q31(fft_q31_t *this, const fft_q31_complex_t *samples,
+                         float *frequency_bins) {
+    output_stage_t stage;
+
+    stage = output_stage(&this->output,
+                         ldexpf(this->bin_scale / (this->count / 2),
+                                this->block_exponent - 31));
+
+    switch (stage.mode) {
+    case FFT_OUTPUT_POWER:
+        bins_q31_mode(this, samples, frequency_bins, &stage,
+                      FFT_OUTPUT_POWER);
+        break;
+    case FFT_OUTPUT_APPROX_MAGNITUDE:
+        bins_q31_mode(this, samples, frequency_bins, &stage,
+                      FFT_OUTPUT_APPROX_MAGNITUDE);
+        break;
+    case FFT_OUTPUT_LOG:
+        bins_q31_mode(this, samples, frequency_bins, &stage, FFT_OUTPUT_LOG);
+        break;
+    default:
+        bins_q31_mode(this, samples, frequency_bins, &stage,
+                      FFT_OUTPUT_MAGNITUDE);
+        break;
+    }
+}
+
+void fft_rad2_dit_q31(fft_q31_t *this, fft_q31_complex_t *samples,
+                      float *frequency_bins) {
+    unsigned int halfN, quarterN, set_count, ops_per_set, split, set, start,
+        butterfly, twiddle_idx, shift;
+    const fft_index_t *reversed_indices;
+    const int32_t *twiddles;
+    uint32_t bits;
+
+    // Don't mess with me
+    if (samples == NULL)
+        return;
+
+    halfN = this->count / 2;
+    quarterN = this->count / 4;
+    reversed_indices = this->reversed_indices;
+    twiddles = this->twiddles;
+    this->block_exponent = 0;
+    bits = block_bits_q31(samples, this->count);
+
+    for (set_count = halfN; set_count >= 1; set_count >>= 1) {
+        ops_per_set = halfN / set_count;
+        split = quarter_split(ops_per_set);
+
+        // Block scaling, the shift is applied while loading the butterflies
+        shift = stage_shift(bits, Q31_HEADROOM_LIMIT);
+        this->block_exponent += shift;
+        bits = 0;
+
+        for (set = 0; set < set_count; set++) {
+            start = set * ops_per_set * 2;
+
+            for (butterfly = 0; butterfly < split; butterfly++) {
+                twiddle_idx = butterfly * set_count;
+                bits |= butterfly_dit_q31(
+                    samples, reversed_indices[start + butterfly],
+                    reversed_indices[start + butterfly + ops_per_set],
+                    twiddles[quarterN - twiddle_idx], -twiddles[twiddle_idx],
+                    shift);
+            }
+
+            for (; butterfly < ops_per_set; butterfly++) {
+                twiddle_idx = butterfly * set_count - quarterN;
+                bits |= butterfly_dit_q31(
+                    samples, reversed_indices[start + butterfly],
+                    reversed_indices[start + butterfly + ops_per_set],
+                    -twiddles[twiddle_idx], -twiddles[quarterN - twiddle_idx],
+                    shift);
+            }
+        }
+    }
+
+    if (frequency_bins != NULL)
+        fft_output_bins_q31(this, samples, frequency_bins);
+}
+
+void fft_rad2_dif_q31(fft_q31_t *this, fft_q31_complex_t *samples,
+                      float *frequency_bins) {
+    unsigned int halfN, quarterN, set_count, ops_per_set, split, set, start,
+        butterfly, twiddle_idx, shift;
+    const int32_t *twiddles;
+    uint32_t bits;
+
+    // Don't mess with me
+    if (samples == NULL)
+        return;
+
+    halfN = this->count / 2;
+    quarterN = this->count / 4;
+    twiddles = this->twiddles;
+    this->block_exponent = 0;
+    bits = block_bits_q31(samples, this->count);
+
+    for (set_count = 1; set_count <= halfN; set_count <<= 1) {
+        ops_per_set = halfN / set_count;
+        split = quarter_split(ops_per_set);
+
+        // Block scaling, the shift is applied while loading the butterflies
+        shift = stage_shift(bits, Q31_HEADROOM_LIMIT);
+        this->block_exponent += shift;
+        bits = 0;
+
+        for (set = 0; set < set_count; set++) {
+            start = set * ops_per_set * 2;
+
+            for (butterfly = 0; butterfly < split; butterfly++) {
+                twiddle_idx = butterfly * set_count;
+                bits |= butterfly_dif_q31(
+                    samples, start + butterfly, start + butterfly + ops_per_set,
+                    twiddles[quarterN - twiddle_idx], -twiddles[twiddle_idx],
+                    shift);
+            }
+
+            for (; butterfly < ops_per_set; butterfly++) {
+                twiddle_idx = butterfly * set_count - quarterN;
+                bits |= butterfly_dif_q31(
+                    samples, start + butterfly, start + butterfly + ops_per_set,
+                    -twiddles[twiddle_idx], -twiddles[quarterN - twiddle_idx],
+                    shift);
+            }
+        }
+    }
+
+    if (frequency_bins != NULL)
+        fft_output_bins_q31(this, samples, frequency_bins);
+}
+
+void fft_deinit_q31(fft_q31_t *this) {
+    arena_free(this->arena, this->mem);
+}
+
+size_t fft_required_buffer_size_real_q15(size_t count) {
+    size_t size = fft_required_buffer_size_q15(count / 2);
+
+    if (fft_find_static_tables(count) == NULL)
+        size += (count / 4 + 1) * sizeof(int16_t);
+
+    return size;
+}
+
+int fft_init_real_q15(fft_real_q15_t *this, arena_t *arena, size_t count) {
+    const fft_tables_t *tables;
+    int16_t *twiddles;
+
+    // The inner transform needs at least 4 points
+    if (!is_valid_count(count) || count < 8)
+        return -1;
+
+    if (fft_init_q15(&this->fft, arena, count / 2) < 0)
+        return -1;
+
+    this->count = count;
+    this->bin_scale = 1.f;
+    this->output = fft_output_default();
+    this->arena = arena;
+
+    if ((tables = fft_find_static_tables(count)) != NULL) {
+        this->twiddles = tables->twiddles_q15;
+        this->mem = NULL;
+
+        return 1;
+    }
+
+    twiddles = (int16_t *)arena_alloc(arena, (count / 4 + 1) * sizeof(int16_t),
+                                      ARENA_ALIGN);
+
+    if (twiddles == NULL) {
+        fft_deinit_q15(&this->fft);
+        return -1;
+    }
+
+    fill_twiddles_q15(twiddles, count);
+
+    this->twiddles = twiddles;
+    this->mem = twiddles;
+
+    return 1;
+}
+
+/**
+ * @brief Untangle Z[k] and Z[N/2 - k] into X[k], the same split as the
+ * float one but halved, so X stays in range. The halving cancels the factor
+ * of 2 the split leaves on X, it is not counted as a shift.
+ */
+static inline void split_bin_q15(fft_q15_complex_t top,
+                                 fft_q15_complex_t bottom, int32_t twiddle_re,
+                                 int32_t twiddle_im, unsigned int shift,
+                                 int32_t *re, int32_t *im) {
+    int32_t top_re = top.re >> shift, top_im = top.im >> shift,
+            bottom_re = bottom.re >> shift, bottom_im = bottom.im >> shift;
+    int32_t even_re = top_re + bottom_re, even_im = top_im - bottom_im,
+            odd_re = top_im + bottom_im, odd_im = bottom_re - top_re;
+
+    // Q15 x Q15 = Q30, round back down to Q15
+    int32_t product_re =
+        (odd_re * twiddle_re - odd_im * twiddle_im + Q15_ONE_HALF) >> 15;
+    int32_t product_im =
+        (odd_re * twiddle_im + odd_im * twiddle_re + Q15_ONE_HALF) >> 15;
+
+    *re = (even_re + product_re) >> 1;
+    *im = (even_im + product_im) >> 1;
+}
+
+static FFT_ALWAYS_INLINE void
+split_bins_q15_mode(fft_real_q15_t *this, const fft_q15_complex_t *samples,
+                    float *frequency_bins, const output_stage_t *stage,
+                    fft_output_mode_t mode, unsigned int shift) {
+    const fft_index_t *reversed_indices = this->fft.reversed_indices;
+    const int16_t *twiddles = this->twiddles;
+    size_t halfN = this->count / 2, quarterN = this->count / 4,
+           mask = halfN - 1, k;
+    int32_t re, im;
+
+    // Z[k] and Z[N/2 - k], the inner transform is in bit-reversed order.
+    // The twiddle comes from the first quarter of the circle for k < N/4
+    for (k = 0; k < quarterN; k++) {
+        split_bin_q15(samples[reversed_indices[k]],
+                      samples[reversed_indices[(halfN - k) & mask]],
+                      twiddles[quarterN - k], -twiddles[k], shift, &re, &im);
+        frequency_bins[k] = output_bin_q15(stage, mode, re, im);
+    }
+
+    for (; k < halfN; k++) {
+        split_bin_q15(samples[reversed_indices[k]],
+                      samples[reversed_indices[halfN - k]],
+                      -twiddles[k - quarterN], -twiddles[halfN - k], shift,
+                      &re, &im);
+        frequency_bins[k] = output_bin_q15(stage, mode, re, im);
+    }
+}
+
+void fft_output_bins_real_q15(fft_real_q15_t *this, const int16_t *samples,
+                              float *frequency_bins) {
+    const fft_q15_complex_t *packed = (const fft_q15_complex_t *)samples;
+    output_stage_t stage;
+    unsigned int shift;
+
+    // The split adds up to two bins, back under the headroom limit first
+    shift = stage_shift(block_bits_q15(packed, this->count / 2),
+                        Q15_HEADROOM_LIMIT);
+    stage = output_stage(&this->output,
+                         ldexpf(this->bin_scale / (this->count / 2),
+                                this->fft.block_exponent + shift - 15));
+
+    switch (stage.mode) {
+    case FFT_OUTPUT_POWER:
+        split_bins_q15_mode(this, packed, frequency_bins, &stage,
+                            FFT_OUTPUT_POWER, shift);
+        break;
+    case FFT_OUTPUT_APPROX_MAGNITUDE:
+        split_bins_q15_mode(this, packed, frequency_bins, &stage,
+                            FFT_OUTPUT_APPROX_MAGNITUDE, shift);
+        break;
+    case FFT_OUTPUT_LOG:
+        split_bins_q15_mode(this, packed, frequency_bins, &stage,
+                            FFT_OUTPUT_LOG, shift);
+        break;
+    default:
+        split_bins_q15_mode(this, packed, frequency_bins, &stage,
+                            FFT_OUTPUT_MAGNITUDE, shift);
+        break;
+    }
+}
+
+void fft_rad2_dif_real_q15(fft_real_q15_t *this, int16_t *samples,
+                           float *frequency_bins) {
+    // Don't mess with me
+    if (samples == NULL)
+        return;
+
+    // Even samples become the real parts, odd ones the imaginary parts, the
+    // complex type is laid out exactly like two of them
+    fft_rad2_dif_q15(&this->fft, (fft_q15_complex_t *)samples, NULL);
+
+    if (frequency_bins != NULL)
+        fft_output_bins_real_q15(this, samples, frequency_bins);
+}
+
+void fft_deinit_real_q15(fft_real_q15_t *this) {
+    arena_free(this->arena, this->mem);
+    fft_deinit_q15(&this->fft);
+}
+
+size_t fft_required_buffer_size_real_q31(size_t count) {
+    size_t size = fft_required_buffer_size_q31(count / 2);
+
+    if (fft_find_static_tables(count) == NULL)
+        size += (count / 4 + 1) * sizeof(int32_t);
+
+    return size;
+}
+
+int fft_init_real_q31(fft_real_q31_t *this, arena_t *arena, size_t count) {
+    const fft_tables_t *tables;
+    int32_t *twiddles;
+
+    if (!is_valid_count(count) || count < 8)
+        return -1;
+
+    if (fft_init_q31(&this->fft, arena, count / 2) < 0)
+        return -1;
+
+    this->count = count;
+    this->bin_scale = 1.f;
+    this->output = fft_output_default();
+    this->arena = arena;
+
+    if ((tables = fft_find_static_tables(count)) != NULL) {
+        this->twiddles = tables->twiddles_q31;
+        this->mem = NULL;
+
+        return 1;
+    }
+
+    twiddles = (int32_t *)arena_alloc(arena, (count / 4 + 1) * sizeof(int32_t),
+                                      ARENA_ALIGN);
+
+    if (twiddles == NULL) {
+        fft_deinit_q31(&this->fft);
+        return -1;
+    }
+
+    fill_twiddles_q31(twiddles, count);
+
+    this->twiddles = twiddles;
+    this->mem = twiddles;
+
+    return 1;
+}
+
+static inline void split_bin_q31(fft_q31_complex_t top,
+                                 fft_q31_complex_t bottom, int32_t twiddle_re,
+                                 int32_t twiddle_im, unsigned int shift,
+                                 int32_t *re, int32_t *im) {
+    int32_t top_re = top.re >> shift, top_im = top.im >> shift,
+            bottom_re = bottom.re >> shift, bottom_im = bottom.im >> shift;
+    int32_t even_re = top_re + bottom_re, even_im = top_im - bottom_im,
+            odd_re = top_im + bottom_im, odd_im = bottom_re - top_re;
+
+    // Q31 x Q31 = Q62, round back down to Q31
+    int64_t product_re = ((int64_t)odd_re * twiddle_re -
+                          (int64_t)odd_im * twiddle_im + Q31_ONE_HALF) >>
+                         31;
+    int64_t product_im = ((int64_t)odd_re * twiddle_im +
+                          (int64_t)odd_im * twiddle_re + Q31_ONE_HALF) >>
+                         31;
+
+    // The sum may not fit 32 bits before the halving
+    *re = (int32_t)((even_re + product_re) >> 1);
+    *im = (int32_t)((even_im + product_im) >> 1);
+}
+
+static FFT_ALWAYS_INLINE void
+split_bins_q31_mode(fft_real_q31_t *this, const fft_q31_complex_t *samples,
+                    float *frequency_bins, const output_stage_t *stage,
+                    fft_output_mode_t mode, unsigned int shift) {
+    const fft_index_t *reversed_indices = this->fft.reversed_indices;
+    const int32_t *twiddles = this->twiddles;
+    size_t halfN = this->count / 2, quarterN = this->count / 4,
+           mask = halfN - 1, k;
+    int32_t re, im;
+
+    for (k = 0; k < quarterN; k++) {
+        split_bin_q31(samples[reversed_indices[k]],
+                      samples[reversed_indices[(halfN - k) & mask]],
+                      twiddles[quarterN - k], -twiddles[k], shift, &re, &im);
+        frequency_bins[k] = output_bin_q31(stage, mode, re, im);
+    }
+
+    for (; k < halfN; k++) {
+        split_bin_q31(samples[reversed_indices[k]],
+                      samples[reversed_indices[halfN - k]],
+                      -twiddles[k - quarterN], -twiddles[halfN - k], shift,
+                      &re, &im);
+        frequency_bins[k] = output_bin_q31(stage, mode, re, im);
+    }
+}
+
+void fft_output_bins_real_q31(fft_real_q31_t *this, const int32_t *samples,
+                              float *frequency_bins) {
+    const fft_q31_complex_t *packed = (const fft_q31_complex_t *)samples;
+    output_stage_t stage;
+    unsigned int shift;
+
+    shift = stage_shift(block_bits_q31(packed, this->count / 2),
+                        Q31_HEADROOM_LIMIT);
+    stage = output_stage(&this->output,
+                         ldexpf(this->bin_scale / (this->count / 2),
+                                this->fft.block_exponent + shift - 31));
+
+    switch (stage.mode) {
+    case FFT_OUTPUT_POWER:
+        split_bins_q31_mode(this, packed, frequency_bins, &stage,
+                            FFT_OUTPUT_POWER, shift);
+        break;
+    case FFT_OUTPUT_APPROX_MAGNITUDE:
+        split_bins_q31_mode(this, packed, frequency_bins, &stage,
+                            FFT_OUTPUT_APPROX_MAGNITUDE, shift);
+        break;
+    case FFT_OUTPUT_LOG:
+        split_bins_q31_mode(this, packed, frequency_bins, &stage,
+                            FFT_OUTPUT_LOG, shift);
+        break;
+    default:
+        split_bins_q31_mode(this, packed, frequency_bins, &stage,
+                            FFT_OUTPUT_MAGNITUDE, shift);
+        break;
+    }
+}
+
+void fft_rad2_dif_real_q31(fft_real_q31_t *this, int32_t *samples,
+                           float *frequency_bins) {
+    // Don't mess with me
+    if (samples == NULL)
+        return;
+
+    fft_rad2_dif_q31(&this->fft, (fft_q31_complex_t *)samples, NULL);
+
+    if (frequency_bins != NULL)
+        fft_output_bins_real_q31(this, samples, frequency_bins);
+}
+
+void fft_deinit_real_q31(fft_real_q31_t *this) {
+    arena_free(this->arena, this->mem);
+    fft_deinit_q31(&this->fft);
+}
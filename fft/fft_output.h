@@ -0,0 +1,37 @@
+#ifndef FFT_OUTPUT_H
+#define FFT_OUTPUT_H
+
+/**
+ * What the transforms write into frequency_bins. Whatever the mode, the
+ * normalization (1/(N/2), the block exponent and bin_scale of the fixed-point
+ * engines) is folded into a constant once per transform, so a bin costs at
+ * most one multiply on top of the conversion itself.
+ */
+typedef enum {
+    // |X|, a square root per bin
+    FFT_OUTPUT_MAGNITUDE,
+    // |X|^2, no root at all
+    FFT_OUTPUT_POWER,
+    // Alpha max plus beta min, within 4% of |X| and no root either
+    FFT_OUTPUT_APPROX_MAGNITUDE,
+    // Perceptual, dB mapped from floor_db to 0 dBFS onto [0, 1], clamped at
+    // 0. A table lookup per bin, no log call
+    FFT_OUTPUT_LOG,
+} fft_output_mode_t;
+
+#define FFT_OUTPUT_DEFAULT_FLOOR_DB -60.f
+
+typedef struct {
+    fft_output_mode_t mode;
+    // FFT_OUTPUT_LOG only, must be negative
+    float floor_db;
+} fft_output_t;
+
+static inline fft_output_t fft_output_default(void) {
+    return (fft_output_t){
+        .mode = FFT_OUTPUT_MAGNITUDE,
+        .floor_db = FFT_OUTPUT_DEFAULT_FLOOR_DB,
+    };
+}
+
+#endif
@@ -0,0 +1,143 @@
+#include "fft.h"
+#include "fft_tables.h"
+#include "fft_util.h"
+
+// Twiddles looked up per block of butterflies, reused by every set of the
+// stage. Small enough for the stack of either core
+#define TWIDDLE_BLOCK 64
+
+/**
+ * @brief A run of decimation in frequency butterflies sharing nothing but
+ * their position, the twiddles come in as arrays of their own. No strides
+ * and no complex types, a straight loop the compiler can vectorize.
+ */
+static inline void butterflies_dif(float *top_re, float *top_im,
+                                   float *bottom_re, float *bottom_im,
+                                   const float *twiddle_re,
+                                   const float *twiddle_im,
+                                   unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        float diff_re = top_re[i] - bottom_re[i];
+        float diff_im = top_im[i] - bottom_im[i];
+
+        top_re[i] += bottom_re[i];
+        top_im[i] += bottom_im[i];
+        bottom_re[i] = diff_re * twiddle_re[i] - diff_im * twiddle_im[i];
+        bottom_im[i] = diff_re * twiddle_im[i] + diff_im * twiddle_re[i];
+    }
+}
+
+/**
+ * @brief W_N^t for t = (first + i) * stride, off the quarter wave.
+ */
+static void gather_twiddles(const float *twiddles, unsigned int quarterN,
+                            unsigned int first, unsigned int stride,
+                            unsigned int count, float *twiddle_re,
+                            float *twiddle_im) {
+    for (unsigned int i = 0; i < count; i++)
+        quarter_twiddle(twiddles, quarterN, (first + i) * stride,
+                        twiddle_re + i, twiddle_im + i);
+}
+
+/**
+ * @brief The two inner stages fused, four points at a time. The twiddles
+ * are 1 and -j, so no multiplies at all.
+ */
+static void last_stages_planar(float *re, float *im, unsigned int N) {
+    for (unsigned int i = 0; i < N; i += 4) {
+        // Butterflies 4 apart first, the second one takes -j
+        float sum0_re = re[i] + re[i + 2], sum0_im = im[i] + im[i + 2];
+        float diff0_re = re[i] - re[i + 2], diff0_im = im[i] - im[i + 2];
+        float sum1_re = re[i + 1] + re[i + 3];
+        float sum1_im = im[i + 1] + im[i + 3];
+        float diff1_re = im[i + 1] - im[i + 3];
+        float diff1_im = re[i + 3] - re[i + 1];
+
+        re[i] = sum0_re + sum1_re;
+        im[i] = sum0_im + sum1_im;
+        re[i + 1] = sum0_re - sum1_re;
+        im[i + 1] = sum0_im - sum1_im;
+        re[i + 2] = diff0_re + diff1_re;
+        im[i + 2] = diff0_im + diff1_im;
+        re[i + 3] = diff0_re - diff1_re;
+        im[i + 3] = diff0_im - diff1_im;
+    }
+}
+
+static FFT_ALWAYS_INLINE void
+output_bins_planar_mode(fft_t *this, const float *re, const float *im,
+                        float *frequency_bins, const output_stage_t *stage,
+                        fft_output_mode_t mode) {
+    size_t halfN = this->count / 2;
+
+    for (size_t i = 0; i < halfN; i++) {
+        // Output lands in bit-reversed order
+        fft_index_t index = this->reversed_indices[i];
+        frequency_bins[i] = output_bin(stage, mode, re[index], im[index]);
+    }
+}
+
+void fft_output_bins_planar(fft_t *this, const float *re, const float *im,
+                            float *frequency_bins) {
+    // 1/(N/2) normalization
+    output_stage_t stage = output_stage(&this->output, 2.f / this->count);
+
+    switch (stage.mode) {
+    case FFT_OUTPUT_POWER:
+        output_bins_planar_mode(this, re, im, frequency_bins, &stage,
+                                FFT_OUTPUT_POWER);
+        break;
+    case FFT_OUTPUT_APPROX_MAGNITUDE:
+        output_bins_planar_mode(this, re, im, frequency_bins, &stage,
+                                FFT_OUTPUT_APPROX_MAGNITUDE);
+        break;
+    case FFT_OUTPUT_LOG:
+        output_bins_planar_mode(this, re, im, frequency_bins, &stage,
+                                FFT_OUTPUT_LOG);
+        break;
+    default:
+        output_bins_planar_mode(this, re, im, frequency_bins, &stage,
+                                FFT_OUTPUT_MAGNITUDE);
+        break;
+    }
+}
+
+void fft_rad2_dif_planar(fft_t *this, float *re, float *im,
+                         float *frequency_bins) {
+    unsigned int N, quarterN, set_count, ops_per_set, first, block, set,
+        top;
+    float twiddle_re[TWIDDLE_BLOCK], twiddle_im[TWIDDLE_BLOCK];
+
+    // Don't mess with me
+    if (re == NULL || im == NULL)
+        return;
+
+    N = this->count;
+    quarterN = N / 4;
+
+    // Outer stages, down to sets of four butterflies. Butterfly i of a set
+    // takes W_N^(i * set_count)
+    for (set_count = 1, ops_per_set = N / 2; ops_per_set >= 4;
+         set_count <<= 1, ops_per_set >>= 1) {
+        for (first = 0; first < ops_per_set; first += block) {
+            block = ops_per_set - first < TWIDDLE_BLOCK ? ops_per_set - first
+                                                        : TWIDDLE_BLOCK;
+
+            gather_twiddles(this->twiddles, quarterN, first, set_count, block,
+                            twiddle_re, twiddle_im);
+
+            for (set = 0; set < set_count; set++) {
+                top = set * 2 * ops_per_set + first;
+
+                butterflies_dif(re + top, im + top, re + top + ops_per_set,
+                                im + top + ops_per_set, twiddle_re,
+                                twiddle_im, block);
+            }
+        }
+    }
+
+    last_stages_planar(re, im, N);
+
+    if (frequency_bins != NULL)
+        fft_output_bins_planar(this, re, im, frequency_bins);
+}
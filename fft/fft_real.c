@@ -0,0 +1,195 @@
+#include "fft.h"
+#include "fft_tables.h"
+#include "fft_util.h"
+
+#include <complex.h>
+#include <math.h>
+#include <stdlib.h>
+
+static void fill_split_twiddles(float *twiddles, unsigned int N) {
+    double angle_per_sample;
+    unsigned int i;
+
+    // 2pi/N, a full N-point circle although the inner transform is N/2
+    angle_per_sample = 2.0 * M_PI / N;
+
+    for (i = 0; i <= N / 4; i++)
+        twiddles[i] = (float)sin(angle_per_sample * i);
+}
+
+size_t fft_required_buffer_size_real(size_t count) {
+    size_t size = fft_required_buffer_size(count / 2);
+
+    if (fft_find_static_tables(count) == NULL)
+        size += (count / 4 + 1) * sizeof(float);
+
+    return size;
+}
+
+int fft_init_real(fft_real_t *this, arena_t *arena, size_t count) {
+    const fft_tables_t *tables;
+    float *twiddles;
+
+    // The inner transform needs at least 4 points
+    if (!is_valid_count(count) || count < 8)
+        return -1;
+
+    if (fft_init(&this->fft, arena, count / 2) < 0)
+        return -1;
+
+    this->count = count;
+    this->arena = arena;
+    this->kernel = FFT_KERNEL_RADIX2;
+    this->output = fft_output_default();
+
+    if ((tables = fft_find_static_tables(count)) != NULL) {
+        this->twiddles = tables->twiddles;
+        this->mem = NULL;
+
+        return 1;
+    }
+
+    twiddles = (float *)arena_alloc(arena, (count / 4 + 1) * sizeof(float),
+                                    ARENA_ALIGN);
+
+    if (twiddles == NULL) {
+        fft_deinit(&this->fft);
+        return -1;
+    }
+
+    fill_split_twiddles(twiddles, count);
+
+    this->twiddles = twiddles;
+    this->mem = twiddles;
+
+    return 1;
+}
+
+/**
+ * @brief Untangle Z[k] and Z[N/2 - k] into X[k].
+ */
+static inline void split_bin(float top_re, float top_im, float bottom_re,
+                             float bottom_im, float twiddle_re,
+                             float twiddle_im, float *re, float *im) {
+    // even = Z[k] + conj(Z[N/2 - k])
+    // odd = -j * (Z[k] - conj(Z[N/2 - k]))
+    float even_re = top_re + bottom_re;
+    float even_im = top_im - bottom_im;
+    float odd_re = top_im + bottom_im;
+    float odd_im = bottom_re - top_re;
+
+    // X[k] = even + W^k * odd, plain real arithmetic so no complex
+    // multiply helpers get pulled in
+    *re = even_re + twiddle_re * odd_re - twiddle_im * odd_im;
+    *im = even_im + twiddle_re * odd_im + twiddle_im * odd_re;
+}
+
+/**
+ * @brief Z[i] is re[stride * i] + j*im[stride * i], stride being 2 for
+ * interleaved samples and 1 for planar ones. Expected to be a constant.
+ */
+static FFT_ALWAYS_INLINE void
+split_bins_mode(fft_real_t *this, const float *re, const float *im,
+                size_t stride, float *frequency_bins,
+                const output_stage_t *stage, fft_output_mode_t mode) {
+    const fft_index_t *reversed_indices = this->fft.reversed_indices;
+    const float *twiddles = this->twiddles;
+    size_t halfN = this->count / 2, quarterN = this->count / 4,
+           mask = halfN - 1, k, top, bottom;
+    float bin_re, bin_im;
+
+    // Z[k] and Z[N/2 - k], the inner transform is in bit-reversed order.
+    // The twiddle comes from the first quarter of the circle for k < N/4
+    for (k = 0; k < quarterN; k++) {
+        top = stride * reversed_indices[k];
+        bottom = stride * reversed_indices[(halfN - k) & mask];
+        split_bin(re[top], im[top], re[bottom], im[bottom],
+                  twiddles[quarterN - k], -twiddles[k], &bin_re, &bin_im);
+        frequency_bins[k] = output_bin(stage, mode, bin_re, bin_im);
+    }
+
+    for (; k < halfN; k++) {
+        top = stride * reversed_indices[k];
+        bottom = stride * reversed_indices[halfN - k];
+        split_bin(re[top], im[top], re[bottom], im[bottom],
+                  -twiddles[k - quarterN], -twiddles[halfN - k], &bin_re,
+                  &bin_im);
+        frequency_bins[k] = output_bin(stage, mode, bin_re, bin_im);
+    }
+}
+
+static FFT_ALWAYS_INLINE void split_bins(fft_real_t *this, const float *re,
+                                         const float *im, size_t stride,
+                                         float *frequency_bins,
+                                         const output_stage_t *stage) {
+    switch (stage->mode) {
+    case FFT_OUTPUT_POWER:
+        split_bins_mode(this, re, im, stride, frequency_bins, stage,
+                        FFT_OUTPUT_POWER);
+        break;
+    case FFT_OUTPUT_APPROX_MAGNITUDE:
+        split_bins_mode(this, re, im, stride, frequency_bins, stage,
+                        FFT_OUTPUT_APPROX_MAGNITUDE);
+        break;
+    case FFT_OUTPUT_LOG:
+        split_bins_mode(this, re, im, stride, frequency_bins, stage,
+                        FFT_OUTPUT_LOG);
+        break;
+    default:
+        split_bins_mode(this, re, im, stride, frequency_bins, stage,
+                        FFT_OUTPUT_MAGNITUDE);
+        break;
+    }
+}
+
+void fft_output_bins_real(fft_real_t *this, const float *samples,
+                          float *frequency_bins) {
+    output_stage_t stage;
+
+    // Both halves of the split carry a 1/2, fold it with the 1/(N/2)
+    stage = output_stage(&this->output, 1.f / this->count);
+
+    // The planar kernel keeps the even samples, the real parts, in the
+    // first half and the odd ones in the second
+    if (this->kernel == FFT_KERNEL_RADIX2_PLANAR)
+        split_bins(this, samples, samples + this->count / 2, 1,
+                   frequency_bins, &stage);
+    else
+        split_bins(this, samples, samples + 1, 2, frequency_bins, &stage);
+}
+
+void fft_rad2_dif_real(fft_real_t *this, float *samples,
+                       float *frequency_bins) {
+    // Don't mess with me
+    if (samples == NULL)
+        return;
+
+    // Even samples become the real parts, odd ones the imaginary parts. A
+    // complex is laid out exactly like two floats, so no copy needed
+    switch (this->kernel) {
+    case FFT_KERNEL_RADIX4:
+        fft_rad4_dif(&this->fft, (float complex *)samples, NULL);
+        break;
+    case FFT_KERNEL_SPLIT_RADIX:
+        fft_split_radix(&this->fft, (float complex *)samples, NULL);
+        break;
+    case FFT_KERNEL_RADIX2_STAGED:
+        fft_rad2_dit_staged(&this->fft, (float complex *)samples, NULL);
+        break;
+    case FFT_KERNEL_RADIX2_PLANAR:
+        fft_rad2_dif_planar(&this->fft, samples, samples + this->count / 2,
+                            NULL);
+        break;
+    default:
+        fft_rad2_dif(&this->fft, (float complex *)samples, NULL);
+        break;
+    }
+
+    if (frequency_bins != NULL)
+        fft_output_bins_real(this, samples, frequency_bins);
+}
+
+void fft_deinit_real(fft_real_t *this) {
+    arena_free(this->arena, this->mem);
+    fft_deinit(&this->fft);
+}
@@ -0,0 +1,41 @@
+#ifndef FFT_TABLES_H
+#define FFT_TABLES_H
+
+#include "fft.h"
+
+/**
+ * Flash resident tables of one transform size, emitted by gen_tables.py for
+ * every size in FFT_STATIC_SIZES. Not part of the public API.
+ */
+typedef struct {
+    size_t count;
+    const fft_index_t *reversed_indices;
+    // Quarter wave, sin(2*pi*k/count) for k <= count/4
+    const float *twiddles;
+    const int16_t *twiddles_q15;
+    const int32_t *twiddles_q31;
+} fft_tables_t;
+
+// Terminated by an entry with a count of 0
+extern const fft_tables_t fft_static_tables[];
+
+// log2 of the mantissa, indexed by its top bits, at the middle of each step
+#define FFT_LOG2_TABLE_BITS 8
+extern const float fft_log2_mantissa[1 << FFT_LOG2_TABLE_BITS];
+
+/**
+ * @brief Look up the generated tables of a size.
+ *
+ * @return const fft_tables_t* The tables, NULL if the size was not generated
+ */
+static inline const fft_tables_t *fft_find_static_tables(size_t count) {
+    const fft_tables_t *tables;
+
+    for (tables = fft_static_tables; tables->count != 0; tables++)
+        if (tables->count == count)
+            return tables;
+
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef FFT_UTIL_H
+#define FFT_UTIL_H
+
+#include "fft.h"
+#include "fft_tables.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * Helpers shared by the fft engines, not part of the public API
+ */
+
+/**
+ * @brief Ultra fast log base-2 of only 2^n numbers. For others, the
+ * result/behavior is invalid/undefined.
+ *
+ * Since 2^n numbers will have only one '1' bit, we just need to shift
+ * right until we find it, and that's log2N
+ *
+ * @param N The input. *MUST BE A POWER OF 2*
+ * @return The log base-2 result, -1 if not a power of two
+ */
+static inline int log2N(unsigned int N) {
+    int value, n;
+
+    // Keep shifting right until we find a '1' at the LSB
+    // and that's when we know we hit the jackpot!
+    for (value = 0, n = N; (n & 0b1) == 0; n >>= 1, value++)
+        ;
+
+    if (n == 1)
+        return value;
+
+    return -1;
+}
+
+/**
+ * @brief O(n) order reverse bits.
+ *
+ * @param N Value to be bit-reversed
+ * @param bit_depth Number of bits to be reversed
+ * @return unsigned int Bit-reversed number
+ */
+static inline unsigned int reverse_bits(unsigned int N,
+                                        unsigned int bit_depth) {
+    unsigned int output, i;
+
+    // Simple, left shift one, right shift the other, bleh!
+    for (output = 0, i = 0; i < bit_depth; i++, N >>= 1)
+        output = (output << 1) | (N & 0b1);
+
+    return output;
+}
+
+/**
+ * @brief Whether the tables of a transform size can be built. Quarter wave
+ * twiddles need at least a quarter of a circle.
+ */
+static inline bool is_valid_count(size_t count) {
+    return count >= 4 && count <= FFT_MAX_COUNT && (count & (count - 1)) == 0;
+}
+
+static inline void fill_reversed_indices(fft_index_t *reversed_indices,
+                                         unsigned int N) {
+    unsigned int bit_depth, i;
+
+    // Number of bits required
+    bit_depth = log2N(N);
+
+    for (i = 0; i < N; i++)
+        reversed_indices[i] = (fft_index_t)reverse_bits(i, bit_depth);
+}
+
+/**
+ * Quarter wave twiddles. With q[i] = sin(2*pi*i/N) for i <= N/4 and
+ * W_N^t = cos(2*pi*t/N) - j*sin(2*pi*t/N):
+ *
+ *  t < N/4         W = q[N/4 - t] - j*q[t]
+ *  t = N/4 + m     W = -q[m] - j*q[N/4 - m]
+ *
+ * A butterfly loop running ops_per_set butterflies with a twiddle stride of
+ * set_count (ops_per_set * set_count = N/2) crosses from the first quarter
+ * into the second at this butterfly, so the loop can be split in two
+ * branch-free halves.
+ */
+static inline unsigned int quarter_split(unsigned int ops_per_set) {
+    return (ops_per_set + 1) / 2;
+}
+
+/**
+ * @brief W_N^t for t < 3N/4 off the quarter wave. The radix-4 and split-radix
+ * butterflies reach W^3j, so past the half circle too:
+ *
+ *  t = N/2 + m     W = -q[N/4 - m] + j*q[m]
+ */
+static inline void quarter_twiddle(const float *twiddles,
+                                   unsigned int quarterN, unsigned int t,
+                                   float *re, float *im) {
+    if (t < quarterN) {
+        *re = twiddles[quarterN - t];
+        *im = -twiddles[t];
+    } else if (t < 2 * quarterN) {
+        t -= quarterN;
+        *re = -twiddles[t];
+        *im = -twiddles[quarterN - t];
+    } else {
+        t -= 2 * quarterN;
+        *re = -twiddles[quarterN - t];
+        *im = twiddles[t];
+    }
+}
+
+// The per-bin output converters take the mode as a constant, this makes sure
+// every mode gets its own loop with the switch folded away
+#define FFT_ALWAYS_INLINE inline __attribute__((always_inline))
+
+// Alpha max plus beta min, the pair with the smallest peak error, 3.96%
+#define APPROX_ALPHA 0.96043387f
+#define APPROX_BETA 0.39782473f
+// Same in Q16 for the fixed-point engines
+#define APPROX_ALPHA_Q16 62943u
+#define APPROX_BETA_Q16 26072u
+
+// 10 * log10(2), dB per octave of power
+#define DB_PER_LOG2 3.01029996f
+
+/**
+ * Output stage constants of one transform, every normalization folded in.
+ * With v the raw |X| of a bin:
+ *
+ *  magnitude   v * scale
+ *  power       v^2 * power_scale
+ *  approx      alpha * max(|re|, |im|) + beta * min(|re|, |im|), scaled
+ *  log         log2(v^2) * log_scale + log_offset, clamped at 0
+ */
+typedef struct {
+    fft_output_mode_t mode;
+    float scale;
+    float power_scale;
+    // APPROX_ALPHA and APPROX_BETA times scale
+    float alpha;
+    float beta;
+    // scale / 2^16, for the Q16 coefficients
+    float approx_q16_scale;
+    float log_scale;
+    float log_offset;
+} output_stage_t;
+
+static inline output_stage_t output_stage(const fft_output_t *output,
+                                          float scale) {
+    float range = -output->floor_db;
+
+    // A floor at or above full scale leaves nothing to show
+    if (!(range > 0.f))
+        range = -FFT_OUTPUT_DEFAULT_FLOOR_DB;
+
+    // dB = 10 * log10(v^2 * scale^2), then floor..0 dB maps onto 0..1
+    return (output_stage_t){
+        .mode = output->mode,
+        .scale = scale,
+        .power_scale = scale * scale,
+        .alpha = APPROX_ALPHA * scale,
+        .beta = APPROX_BETA * scale,
+        .approx_q16_scale = scale / 65536.f,
+        .log_scale = DB_PER_LOG2 / range,
+        .log_offset = 1.f + 2.f * DB_PER_LOG2 * log2f(scale) / range,
+    };
+}
+
+/**
+ * @brief log2 off the float bits, the exponent is the integer part and the
+ * top mantissa bits index the table for the rest. Within 0.003 of log2f,
+ * 0.01 dB. Zero lands around -127, way under any floor.
+ */
+static inline float fast_log2f(float value) {
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    return (float)((int32_t)(bits >> 23) - 127) +
+           fft_log2_mantissa[(bits >> (23 - FFT_LOG2_TABLE_BITS)) &
+                             ((1u << FFT_LOG2_TABLE_BITS) - 1)];
+}
+
+/**
+ * @brief Same for integers, the highest set bit is the integer part, no
+ * float conversion needed.
+ */
+static inline float log2_u32(uint32_t value) {
+    int msb;
+
+    if (value == 0)
+        return -128.f;
+
+    msb = 31 - __builtin_clz(value);
+    value = msb >= FFT_LOG2_TABLE_BITS
+                ? value >> (msb - FFT_LOG2_TABLE_BITS)
+                : value << (FFT_LOG2_TABLE_BITS - msb);
+
+    return (float)msb +
+           fft_log2_mantissa[value & ((1u << FFT_LOG2_TABLE_BITS) - 1)];
+}
+
+static inline float log2_u64(uint64_t value) {
+    int msb;
+
+    if (value == 0)
+        return -128.f;
+
+    msb = 63 - __builtin_clzll(value);
+    value = msb >= FFT_LOG2_TABLE_BITS
+                ? value >> (msb - FFT_LOG2_TABLE_BITS)
+                : value << (FFT_LOG2_TABLE_BITS - msb);
+
+    return (float)msb +
+           fft_log2_mantissa[value & ((1u << FFT_LOG2_TABLE_BITS) - 1)];
+}
+
+static inline float output_log(const output_stage_t *stage, float log2_power) {
+    float value = log2_power * stage->log_scale + stage->log_offset;
+
+    return value > 0.f ? value : 0.f;
+}
+
+/**
+ * @brief One float bin, mode is expected to be a constant.
+ */
+static FFT_ALWAYS_INLINE float output_bin(const output_stage_t *stage,
+                                          fft_output_mode_t mode, float re,
+                                          float im) {
+    float power = re * re + im * im, high, low;
+
+    switch (mode) {
+    case FFT_OUTPUT_POWER:
+        return power * stage->power_scale;
+    case FFT_OUTPUT_APPROX_MAGNITUDE:
+        high = fabsf(re);
+        low = fabsf(im);
+
+        return high > low ? high * stage->alpha + low * stage->beta
+                          : low * stage->alpha + high * stage->beta;
+    case FFT_OUTPUT_LOG:
+        return output_log(stage, fast_log2f(power));
+    default:
+        return sqrtf(power) * stage->scale;
+    }
+}
+
+#endif
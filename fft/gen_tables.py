@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""
+Emits the const (flash resident) fft tables for the configured sizes.
+
+Every size gets its bit-reversed indices plus quarter-wave sine tables for
+the float, Q15 and Q31 engines. Half sizes are emitted too, the real-input
+transform runs a complex one of N/2 under the hood. The mantissa log2 table
+of the log output mode comes along, it does not depend on the size.
+
+usage: gen_tables.py <output.c> <max count> [size...]
+"""
+
+import math
+import sys
+
+# Keep in sync with FFT_LOG2_TABLE_BITS in fft_tables.h
+LOG2_TABLE_BITS = 8
+
+
+def reverse_bits(value, bit_depth):
+    output = 0
+
+    for _ in range(bit_depth):
+        output = (output << 1) | (value & 1)
+        value >>= 1
+
+    return output
+
+
+def quarter_sines(count):
+    return [math.sin(2.0 * math.pi * i / count) for i in range(count // 4 + 1)]
+
+
+def format_float(value):
+    text = f"{value:.9g}"
+
+    # 0f and 1f are not valid C literals
+    if "." not in text and "e" not in text:
+        text += ".0"
+
+    return text + "f"
+
+
+def format_array(kind, name, values, per_line):
+    lines = [f"static const {kind} {name}[{len(values)}] = {{"]
+
+    for start in range(0, len(values), per_line):
+        chunk = ", ".join(values[start:start + per_line])
+        lines.append(f"    {chunk},")
+
+    lines.append("};")
+
+    return "\n".join(lines)
+
+
+def emit_size(count):
+    bit_depth = count.bit_length() - 1
+    sines = quarter_sines(count)
+    blocks = [
+        format_array("fft_index_t", f"reversed_indices_{count}",
+                     [str(reverse_bits(i, bit_depth)) for i in range(count)],
+                     12),
+        format_array("float", f"twiddles_{count}",
+                     [format_float(value) for value in sines], 4),
+        # 1.0 is not representable, so scale to the largest positive value
+        format_array("int16_t", f"twiddles_q15_{count}",
+                     [str(round(value * 32767)) for value in sines], 8),
+        format_array("int32_t", f"twiddles_q31_{count}",
+                     [str(round(value * 2147483647)) for value in sines], 4),
+    ]
+
+    return "\n\n".join(blocks)
+
+
+def emit_log2_table():
+    steps = 1 << LOG2_TABLE_BITS
+    values = [math.log2(1.0 + (i + 0.5) / steps) for i in range(steps)]
+
+    return (f"#if FFT_LOG2_TABLE_BITS != {LOG2_TABLE_BITS}\n"
+            f'#error "gen_tables.py is out of sync with fft_tables.h"\n'
+            f"#endif\n\n" +
+            format_array("float", "fft_log2_mantissa",
+                         [format_float(value) for value in values],
+                         4).replace("static const", "const", 1))
+
+
+def emit_entry(count):
+    return (f"    {{\n"
+            f"        .count = {count},\n"
+            f"        .reversed_indices = reversed_indices_{count},\n"
+            f"        .twiddles = twiddles_{count},\n"
+            f"        .twiddles_q15 = twiddles_q15_{count},\n"
+            f"        .twiddles_q31 = twiddles_q31_{count},\n"
+            f"    }},")
+
+
+def main(argv):
+    if len(argv) < 3:
+        sys.stderr.write(__doc__)
+        return 1
+
+    output, max_count = argv[1], int(argv[2])
+    sizes = set()
+
+    for size in argv[3:]:
+        count = int(size)
+
+        if count < 4 or count & (count - 1) != 0 or count > max_count:
+            sys.stderr.write(f"invalid static fft size {count}\n")
+            return 1
+
+        sizes.add(count)
+
+        if count // 2 >= 4:
+            sizes.add(count // 2)
+
+    sizes = sorted(sizes)
+    parts = [
+        "// Generated by gen_tables.py, do not edit",
+        '#include "fft_tables.h"',
+    ]
+    parts += [emit_size(count) for count in sizes]
+    parts.append(emit_log2_table())
+    parts.append("\n".join(
+        ["const fft_tables_t fft_static_tables[] = {"] +
+        [emit_entry(count) for count in sizes] +
+        ["    // Sentinel", "    {.count = 0},", "};"]))
+
+    with open(output, "w") as file:
+        file.write("\n\n".join(parts) + "\n")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
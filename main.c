@@ -1,166 +1,361 @@
-#include "async.h"
+#include "arena.h"
 #include "audio.h"
-#include "color.h"
+#include "bands.h"
 #include "i2s.h"
 #include "neopixel.h"
+#include "output.h"
+#include "pipeline.h"
+#include "renderer.h"
 #include "swapchain.h"
+#include "trace.h"
 
+#include <hardware/sync.h>
 #include <pico/stdlib.h>
 #include <pico/types.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-#define AUDIO_SAMPLE_COUNT 64
+// FFT window, slides by one i2s DMA block of AUDIO_HOP_COUNT per frame
+#define AUDIO_SAMPLE_COUNT 256
+#define AUDIO_HOP_COUNT 64
+#define AUDIO_ENGINE AUDIO_ENGINE_Q15
+#define AUDIO_WINDOW AUDIO_WINDOW_HANN
+#define AUDIO_GAIN 1.5f
+// FFT_OUTPUT_LOG with the floor reads quiet rooms better, no root per bin
+#define AUDIO_OUTPUT FFT_OUTPUT_MAGNITUDE
+#define AUDIO_FLOOR_DB FFT_OUTPUT_DEFAULT_FLOOR_DB
+
+#define BAND_SPACING BANDS_SPACING_MEL
+#define BAND_COUNT 32
+#define BAND_MIN_HZ 40.f
+#define BAND_MAX_HZ 16000.f
+// Per strip, strips on consecutive pins from LED_DATA_PIN. More than one
+// are driven in parallel, the visualizer sees them end to end
 #define LED_COUNT 300
+#define STRIP_COUNT 1
+#define PIXEL_COUNT (LED_COUNT * STRIP_COUNT)
+
+// Capture and the front end on core0, FFT, mapping and the LEDs on core1
+#define PIPELINED
 
 #define MIC_SCK_PIN 27
 #define MIC_WS_PIN 28
 #define MIC_DATA_PIN 29
+// The INMP441 talks on the left channel with its L/R pin low
+#define MIC_CHANNEL I2S_CHANNEL_LEFT
 
 #define LED_DATA_PIN 8
 
-static color_neopixel_t magnitude_to_color(float magnitude) {
-    if (magnitude < 0.f) {
-        magnitude = 0.f;
-    }
+// Output stage, see visualizer/output.h. A WS2812 at full white draws
+// 60 mA, far more than a USB supply gives a 300 LED strip
+#define LED_GAMMA 2.5f
+#define LED_BRIGHTNESS 255
+#define LED_BUDGET_MA 2000
+
+// What the strip starts out drawing, see visualizer/renderer.h. Keys 1 to 4
+// over USB switch between the renderers while it runs
+#define RENDERER_DEFAULT RENDERER_SPECTRUM
+
+// Frames between trace drains over USB, well inside TRACE_RING_SIZE. Only
+// with LIGHT_PAINTING_TRACE, the printing stalls core0 for a while
+#define TRACE_DRAIN_INTERVAL 32
+
+// What every init takes out of the arena, worked out from the config above
+#define AUDIO_SWAPCHAIN_FOOTPRINT                                              \
+    SWAPCHAIN_FOOTPRINT(I2S_BUFFER_SIZE(AUDIO_HOP_COUNT, MIC_CHANNEL))
+#define LED_SWAPCHAIN_FOOTPRINT                                                \
+    SWAPCHAIN_FOOTPRINT(NEOPIXEL_PARALLEL_BUFFER_SIZE(LED_COUNT, STRIP_COUNT))
+#define MIC_FOOTPRINT I2S_FOOTPRINT(AUDIO_HOP_COUNT, MIC_CHANNEL)
+#define LED_FOOTPRINT NEOPIXEL_PARALLEL_FOOTPRINT(LED_COUNT, STRIP_COUNT)
+#define ANALYSIS_FOOTPRINT                                                     \
+    AUDIO_FOOTPRINT(AUDIO_SAMPLE_COUNT, AUDIO_HOP_COUNT, AUDIO_ENGINE)
+#define BAND_FOOTPRINT                                                         \
+    BANDS_FOOTPRINT(BAND_SPACING, BAND_COUNT, AUDIO_SAMPLE_COUNT / 2)
+#define LED_OUTPUT_FOOTPRINT OUTPUT_FOOTPRINT
+#define VISUALIZER_FOOTPRINT RENDERER_SET_FOOTPRINT(PIXEL_COUNT, BAND_COUNT)
+#ifdef PIPELINED
+#define SLOT_FOOTPRINT                                                         \
+    PIPELINE_FOOTPRINT(AUDIO_SAMPLE_COUNT * AUDIO_SAMPLE_SIZE(AUDIO_ENGINE))
+#else
+#define SLOT_FOOTPRINT 0
+#endif
+
+#define MAIN_ARENA_SIZE                                                        \
+    (AUDIO_SWAPCHAIN_FOOTPRINT + LED_SWAPCHAIN_FOOTPRINT + MIC_FOOTPRINT +     \
+     LED_FOOTPRINT + ANALYSIS_FOOTPRINT + BAND_FOOTPRINT +                    \
+     LED_OUTPUT_FOOTPRINT + VISUALIZER_FOOTPRINT + SLOT_FOOTPRINT)
+
+// Of the 264KB of SRAM, the rest goes to the stacks, .data and .bss
+#define MAIN_ARENA_BUDGET (192 * 1024)
+
+_Static_assert(MAIN_ARENA_SIZE <= MAIN_ARENA_BUDGET,
+               "PIXEL_COUNT and AUDIO_SAMPLE_COUNT do not fit in SRAM");
+
+ARENA_DEFINE(sram_arena, MAIN_ARENA_SIZE);
+
+// Whichever core renders runs the frames through it before the swap
+static output_t led_output;
+// Selected from core0, drawn with on whichever core renders
+static renderer_set_t renderers;
+
+static void print_footprint() {
+    printf("SRAM footprint, %u bytes of %u:\n", (unsigned)MAIN_ARENA_SIZE,
+           (unsigned)MAIN_ARENA_BUDGET);
+    printf("  audio swapchain %u\n", (unsigned)AUDIO_SWAPCHAIN_FOOTPRINT);
+    printf("  LED swapchain %u\n", (unsigned)LED_SWAPCHAIN_FOOTPRINT);
+    printf("  i2s %u\n", (unsigned)MIC_FOOTPRINT);
+    printf("  WS2812 %u\n", (unsigned)LED_FOOTPRINT);
+    printf("  audio %u\n", (unsigned)ANALYSIS_FOOTPRINT);
+    printf("  bands %u\n", (unsigned)BAND_FOOTPRINT);
+    printf("  output %u\n", (unsigned)LED_OUTPUT_FOOTPRINT);
+    printf("  renderers %u\n", (unsigned)VISUALIZER_FOOTPRINT);
+    printf("  pipeline %u\n", (unsigned)SLOT_FOOTPRINT);
+}
 
-    if (magnitude > 1.f) {
-        magnitude = 1.f;
-    }
+static void trace_frame_done() {
+    static uint32_t frame_count = 0;
 
-    return color_neopixel_from_hsv_f(magnitude * 360.f, 1.f, 1.f);
+    if (++frame_count % TRACE_DRAIN_INTERVAL == 0)
+        trace_drain();
 }
 
-static void visualizer_map_frequency_bins_to_pixels(const float *frequency_bins,
-                                                    size_t frequency_bin_count,
-                                                    uint32_t *pixel_buffer,
-                                                    size_t pixel_count) {
-    if (frequency_bin_count > pixel_count) {
-        float pitch = (float)frequency_bin_count / pixel_count;
-
-        for (size_t pixel = 0; pixel < pixel_count; pixel++) {
-            float index = pixel * pitch;
-            size_t index_i = (size_t)index;
-            float index_f = index - index_i;
-
-            pixel_buffer[pixel] =
-                color_neopixel_add(
-                    magnitude_to_color((1.f - index_f) *
-                                       frequency_bins[index_i]),
-                    magnitude_to_color(index_f * frequency_bins[index_i + 1]))
-                    .value;
-        }
-    } else if (frequency_bin_count < pixel_count) {
-        float pitch = (float)frequency_bin_count / pixel_count;
-
-        for (size_t i = 0; i < pixel_count; i++) {
-            size_t bin = i * pitch;
-            pixel_buffer[i] = magnitude_to_color(frequency_bins[bin]).value;
-        }
-    } else {
-        for (size_t i = 0; i < pixel_count; i++)
-            pixel_buffer[i] = magnitude_to_color(frequency_bins[i]).value;
+/**
+ * @brief Switch renderer on a key from 1 on, never waits for one. The
+ * renderer core picks it up at its next frame.
+ */
+static void poll_renderer_key() {
+    int key = getchar_timeout_us(0);
+
+    if (key >= '1' && key < '1' + RENDERER_COUNT) {
+        renderer_set_select(&renderers, (renderer_kind_t)(key - '1'));
+        printf("Renderer %s\n",
+               renderer_get_ops(renderer_set_selected(&renderers))->name);
     }
 }
 
+/**
+ * @brief Sleep until the i2s interrupt publishes the next hop and take it.
+ * The interrupt sends an event, so does taking any other interrupt, hence
+ * the check after every wake up. Nothing ever transforms the same window
+ * twice.
+ */
+static void wait_for_audio(swapchain_t *swapchain) {
+    while (!swapchain_consumer_poll(swapchain))
+        __wfe();
+
+    swapchain_consumer_swap(swapchain);
+}
+
+static int led_init(swapchain_t *swapchain) {
+    return neopixel_init_parallel(&sram_arena, swapchain, LED_COUNT,
+                                  LED_DATA_PIN, STRIP_COUNT);
+}
+
+#ifdef PIPELINED
+/**
+ * Runs on core1, so the LED DMA interrupt is serviced by the core that
+ * renders the frames and core0 is left to capture.
+ */
+static void led_start(void *context) {
+    if (led_init(context) < 0)
+        panic("Could not initialize WS2812 driver");
+
+    neopixel_start_transmission();
+}
+
+static uint32_t *led_acquire_pixels(void *context) {
+    return swapchain_producer_buffer(context);
+}
+
+static void led_present_pixels(void *context) {
+    output_apply(&led_output, swapchain_producer_buffer(context), PIXEL_COUNT);
+    TRACE(swapchain_producer_set_tag(context, trace_frame()));
+    swapchain_producer_swap(context);
+}
+#endif
+
 int main() {
     audio_t audio;
+    bands_t bands;
+    bands_config_t bands_config = {
+        .spacing = BAND_SPACING,
+        .band_count = BAND_COUNT,
+        .min_hz = BAND_MIN_HZ,
+        .max_hz = BAND_MAX_HZ,
+        .sample_rate = I2S_SAMPLE_RATE,
+        .bin_count = AUDIO_SAMPLE_COUNT / 2,
+    };
+    output_config_t output_config;
+    renderer_geometry_t geometry = {
+        .pixel_count = PIXEL_COUNT,
+        .band_count = BAND_COUNT,
+    };
     swapchain_t audio_swapchain;
     swapchain_t led_swapchain;
+#ifdef PIPELINED
+    pipeline_t pipeline;
+    pipeline_sink_t led_sink = {
+        .start = led_start,
+        .acquire_pixels = led_acquire_pixels,
+        .present_pixels = led_present_pixels,
+        .context = &led_swapchain,
+    };
+#endif
 
     stdio_usb_init();
+    print_footprint();
+
+    // Before the drivers, their interrupts trace
+    TRACE(trace_init());
 
-    if (!swapchain_init(&audio_swapchain,
-                        i2s_required_buffer_size(AUDIO_SAMPLE_COUNT))) {
+    if (swapchain_init(&audio_swapchain, &sram_arena,
+                       i2s_required_buffer_size(AUDIO_HOP_COUNT,
+                                                MIC_CHANNEL)) < 0) {
         printf("Could not initialize audio swapchain\n");
         return EXIT_FAILURE;
     }
 
     printf("Audio swapchain init!\n");
 
-    if (!swapchain_init(&led_swapchain,
-                        neopixel_required_buffer_size(LED_COUNT))) {
+    if (swapchain_init(&led_swapchain, &sram_arena,
+                       neopixel_required_parallel_buffer_size(
+                           LED_COUNT, STRIP_COUNT)) < 0) {
         printf("Could not initialize LED swapchain\n");
         return EXIT_FAILURE;
     }
 
     printf("LED swapchain init!\n");
 
-    if (!i2s_init(&audio_swapchain, AUDIO_SAMPLE_COUNT, MIC_SCK_PIN, MIC_WS_PIN,
-                  MIC_DATA_PIN)) {
+    if (i2s_init(&sram_arena, &audio_swapchain, AUDIO_HOP_COUNT, MIC_CHANNEL,
+                 MIC_SCK_PIN, MIC_WS_PIN, MIC_DATA_PIN) < 0) {
         printf("Could not initialize i2s driver");
         return EXIT_FAILURE;
     }
 
     printf("INMP init!\n");
 
-    if (!neopixel_init(&led_swapchain, LED_COUNT, LED_DATA_PIN)) {
+#ifndef PIPELINED
+    if (led_init(&led_swapchain) < 0) {
         printf("Could not initialize WS2812 driver");
         return EXIT_FAILURE;
     }
 
     printf("WS2812 init!\n");
+#endif
 
-    if (!audio_init(&audio, AUDIO_SAMPLE_COUNT)) {
+    if (audio_init_stft(&audio, &sram_arena, AUDIO_SAMPLE_COUNT,
+                        AUDIO_HOP_COUNT, AUDIO_ENGINE, AUDIO_WINDOW) < 0) {
         printf("Could not initialize audio");
         return EXIT_FAILURE;
     }
 
+    audio_set_output(&audio, AUDIO_OUTPUT, AUDIO_FLOOR_DB);
+
     printf("Audio init!\n");
 
+    if (bands_init(&bands, &sram_arena, &bands_config) < 0) {
+        printf("Could not initialize bands");
+        return EXIT_FAILURE;
+    }
+
+    printf("Bands init!\n");
+
+    output_config = output_default_config();
+    output_config.gamma_r = output_config.gamma_g = output_config.gamma_b =
+        LED_GAMMA;
+    output_config.brightness = LED_BRIGHTNESS;
+    output_config.budget_ma = LED_BUDGET_MA;
+
+    if (output_init(&led_output, &sram_arena, &output_config) < 0) {
+        printf("Could not initialize output stage");
+        return EXIT_FAILURE;
+    }
+
+    printf("Output init!\n");
+
+    if (renderer_set_init(&renderers, &sram_arena, &geometry) < 0) {
+        printf("Could not initialize renderers");
+        return EXIT_FAILURE;
+    }
+
+    renderer_set_select(&renderers, RENDERER_DEFAULT);
+
+    printf("Renderers init!\n");
+
+#ifdef PIPELINED
+    if (pipeline_init(&pipeline, &sram_arena, &audio, &bands, AUDIO_GAIN,
+                      &renderers, &led_sink) < 0) {
+        printf("Could not initialize pipeline");
+        return EXIT_FAILURE;
+    }
+
+    // The WS2812 driver comes up on core1
+    pipeline_start(&pipeline);
+
+    printf("Pipeline init!\n");
+
+    // The WS2812 buffer may not be in yet, core1 takes it at its own pace
+    arena_print_report(&sram_arena, "SRAM");
+
     i2s_start_sampling();
-    neopixel_start_transmission();
 
     printf("Started sampling\n");
 
-    // Scratch buffers
-    int32_t scratch_int[8];
-    float scratch_float[8];
+    while (true) {
+        wait_for_audio(&audio_swapchain);
+
+        TRACE(trace_begin_frame(swapchain_consumer_tag(&audio_swapchain)));
 
-    uint32_t max = 0;
+        pipeline_submit(&pipeline,
+                        swapchain_consumer_buffer(&audio_swapchain));
+
+        TRACE(trace_frame_done());
+        poll_renderer_key();
+    }
+#else
+    i2s_start_sampling();
+    neopixel_start_transmission();
+
+    arena_print_report(&sram_arena, "SRAM");
+
+    printf("Started sampling\n");
 
     while (true) {
-        synchronized(swapchain_consumer_swap(&audio_swapchain));
+        wait_for_audio(&audio_swapchain);
+
+        TRACE(trace_begin_frame(swapchain_consumer_tag(&audio_swapchain)));
+        TRACE(trace_event(TRACE_FRONT_END_BEGIN));
+
+        audio_feed_i2s(&audio, swapchain_consumer_buffer(&audio_swapchain),
+                       AUDIO_GAIN);
+
+        TRACE(trace_event(TRACE_FRONT_END_END));
+        TRACE(trace_event(TRACE_FFT_BEGIN));
 
-        audio_feed_i2s(&audio, swapchain_consumer_buffer(&audio_swapchain));
-        audio_envelope(&audio);
-        audio_gain(&audio, 1.5f);
         audio_fft(&audio);
 
-        visualizer_map_frequency_bins_to_pixels(
-            audio_get_frequency_bins(&audio),
-            audio_get_frequency_bin_count(&audio),
-            swapchain_producer_buffer(&led_swapchain),
-            neopixel_get_pixel_count());
-
-        synchronized(swapchain_producer_swap(&led_swapchain));
-
-        // const int32_t *source =
-        //     (const int32_t *)swapchain_consumer_buffer(&audio_swapchain);
-        // uint32_t *dest = swapchain_producer_buffer(&led_swapchain);
-
-        // for (size_t i = 0; i < 8; i++) {
-        //     int32_t int_value = ((source[2 * i + 1]) << 1) >> 8;
-        //     uint32_t abs_value = (uint32_t)abs(int_value);
-        //     if (abs_value > max) {
-        //         max = abs_value;
-        //         printf("Highest %u\n", max);
-        //     }
-        //     // scratch_float[i] = (float)int_value;
-        // }
-
-        // printf("%d\n%d\n%d\n%d\n%d\n%d\n%d\n%d\n", scratch_int[0],
-        //        scratch_int[1], scratch_int[2], scratch_int[3],
-        //        scratch_int[4], scratch_int[5], scratch_int[6],
-        //        scratch_int[7]);
-
-        // printf("%.2f\n%.2f\n%.2f\n%.2f\n%.2f\n%.2f\n%.2f\n%.2f\n",
-        //        scratch_float[0], scratch_float[1], scratch_float[2],
-        //        scratch_float[3], scratch_float[4], scratch_float[5],
-        //        scratch_float[6], scratch_float[7]);
-
-        // sleep_ms(500);
+        TRACE(trace_event(TRACE_FFT_END));
+        TRACE(trace_event(TRACE_MAP_BEGIN));
+
+        bands_aggregate(&bands, audio_get_frequency_bins(&audio));
+
+        renderer_set_render(&renderers, bands_get(&bands),
+                            swapchain_producer_buffer(&led_swapchain));
+
+        TRACE(trace_event(TRACE_MAP_END));
+        TRACE(trace_event(TRACE_LED_SWAP));
+
+        output_apply(&led_output, swapchain_producer_buffer(&led_swapchain),
+                     PIXEL_COUNT);
+
+        TRACE(swapchain_producer_set_tag(&led_swapchain, trace_frame()));
+
+        swapchain_producer_swap(&led_swapchain);
+
+        TRACE(trace_frame_done());
+        poll_renderer_key();
     }
+#endif
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,144 @@
+#include "pipeline.h"
+#include "trace.h"
+
+#include <pico/multicore.h>
+#include <pico/stdlib.h>
+
+// Not a slot index, tells core1 to wrap up. Echoed back once it has
+#define PIPELINE_STOP ((uint32_t)0xFFFFFFFF)
+
+// multicore_launch_core1 takes no argument
+static pipeline_t *active = NULL;
+
+static void core1_entry() {
+    pipeline_t *this = active;
+    uint32_t slot;
+
+    if (this->sink.start != NULL)
+        this->sink.start(this->sink.context);
+
+    // Every slot starts out free
+    for (slot = 0; slot < PIPELINE_SLOT_COUNT; slot++)
+        multicore_fifo_push_blocking(slot);
+
+    while ((slot = multicore_fifo_pop_blocking()) != PIPELINE_STOP) {
+        uint64_t start = time_us_64(), end;
+
+        TRACE(trace_begin_frame(this->slot_frame[slot]));
+        TRACE(trace_event(TRACE_FFT_BEGIN));
+
+        audio_fft_buffer(this->audio, this->slots[slot]);
+
+        TRACE(trace_event(TRACE_FFT_END));
+        TRACE(trace_event(TRACE_MAP_BEGIN));
+
+        if (this->bands != NULL) {
+            bands_aggregate(this->bands,
+                            audio_get_frequency_bins(this->audio));
+
+            renderer_set_render(this->renderers, bands_get(this->bands),
+                                this->sink.acquire_pixels(this->sink.context));
+        } else {
+            // The engine already worked out one bin per band
+            renderer_set_render(this->renderers,
+                                audio_get_frequency_bins(this->audio),
+                                this->sink.acquire_pixels(this->sink.context));
+        }
+
+        TRACE(trace_event(TRACE_MAP_END));
+        TRACE(trace_event(TRACE_LED_SWAP));
+
+        this->sink.present_pixels(this->sink.context);
+
+        end = time_us_64();
+        this->back_end_us += end - start;
+        this->latency_us += end - this->slot_start_us[slot];
+
+        if (end - this->slot_start_us[slot] > this->max_latency_us)
+            this->max_latency_us = end - this->slot_start_us[slot];
+
+        this->frame_count++;
+
+        // Done with the samples, core0 may refill the slot
+        multicore_fifo_push_blocking(slot);
+    }
+
+    multicore_fifo_push_blocking(PIPELINE_STOP);
+}
+
+int pipeline_init(pipeline_t *this, arena_t *arena, audio_t *audio,
+                  bands_t *bands, float gain, renderer_set_t *renderers,
+                  const pipeline_sink_t *sink) {
+    size_t slot_size = audio_required_sample_buffer_size(audio);
+    void *mem;
+
+    if (sink->acquire_pixels == NULL || sink->present_pixels == NULL)
+        return -1;
+
+    mem = arena_alloc(arena, PIPELINE_SLOT_COUNT * slot_size, ARENA_ALIGN);
+
+    if (mem == NULL)
+        return -1;
+
+    *this = (pipeline_t){
+        .audio = audio,
+        .bands = bands,
+        .sink = *sink,
+        .renderers = renderers,
+        .gain = gain,
+        .mem = mem,
+        .arena = arena,
+    };
+
+    for (size_t i = 0; i < PIPELINE_SLOT_COUNT; i++)
+        this->slots[i] = (void *)((size_t)mem + i * slot_size);
+
+    return 1;
+}
+
+void pipeline_start(pipeline_t *this) {
+    if (active != NULL)
+        return;
+
+    active = this;
+    multicore_launch_core1(core1_entry);
+}
+
+void pipeline_submit(pipeline_t *this, const int32_t *samples) {
+    uint32_t slot;
+    uint64_t start;
+
+    // Wait for core1 to give a slot back
+    slot = multicore_fifo_pop_blocking();
+    start = time_us_64();
+
+    this->slot_start_us[slot] = start;
+    TRACE(this->slot_frame[slot] = trace_frame());
+    TRACE(trace_event(TRACE_FRONT_END_BEGIN));
+
+    audio_front_end(this->audio, this->slots[slot], samples, this->gain);
+
+    TRACE(trace_event(TRACE_FRONT_END_END));
+    this->front_end_us += time_us_64() - start;
+
+    multicore_fifo_push_blocking(slot);
+}
+
+void pipeline_stop(pipeline_t *this) {
+    if (active != this)
+        return;
+
+    multicore_fifo_push_blocking(PIPELINE_STOP);
+
+    // Swallow the slots handed back until core1 acknowledges
+    while (multicore_fifo_pop_blocking() != PIPELINE_STOP)
+        ;
+
+    multicore_reset_core1();
+    active = NULL;
+}
+
+void pipeline_deinit(pipeline_t *this) {
+    pipeline_stop(this);
+    arena_free(this->arena, this->mem);
+}
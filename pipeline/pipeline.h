@@ -0,0 +1,86 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "audio.h"
+#include "bands.h"
+#include "renderer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sample buffers in flight, one being filled by core0 while core1
+// transforms the other
+#define PIPELINE_SLOT_COUNT 2
+
+/**
+ * Where core1 puts the frames. start runs on core1 before the first frame,
+ * so interrupts enabled there (e.g. the LED DMA) belong to core1 as well.
+ */
+typedef struct {
+    void (*start)(void *context);
+    uint32_t *(*acquire_pixels)(void *context);
+    void (*present_pixels)(void *context);
+    void *context;
+} pipeline_sink_t;
+
+/**
+ * Two stage pipeline across the cores. Core0 runs the audio front end into a
+ * free slot and hands its index over the inter-core FIFO, core1 runs the FFT,
+ * the band aggregation and the pixel mapping, then hands the slot back. The front end of frame
+ * N + 1 overlaps the FFT of frame N, at the cost of up to one extra frame of
+ * latency.
+ *
+ * Only one pipeline can run at a time, there is only one core1.
+ */
+typedef struct {
+    audio_t *audio;
+    // NULL when the frequency bins already are the bands, e.g. Goertzel
+    bands_t *bands;
+    pipeline_sink_t sink;
+    // Geometry of the bands, or of the bins when bands is NULL
+    renderer_set_t *renderers;
+    float gain;
+    void *mem;
+    arena_t *arena;
+    void *slots[PIPELINE_SLOT_COUNT];
+    // When each slot entered the front end, for the latency figures
+    uint64_t slot_start_us[PIPELINE_SLOT_COUNT];
+    // Capture time of the samples in each slot, names the frame in traces
+    uint32_t slot_frame[PIPELINE_SLOT_COUNT];
+
+    // Statistics, core0 writes the front end time, core1 the rest. Only
+    // coherent after pipeline_stop
+    uint32_t frame_count;
+    uint64_t front_end_us;
+    uint64_t back_end_us;
+    uint64_t latency_us;
+    uint64_t max_latency_us;
+} pipeline_t;
+
+// Arena bytes pipeline_init takes, see audio_required_sample_buffer_size
+#define PIPELINE_FOOTPRINT(sample_buffer_size)                                 \
+    ARENA_FOOTPRINT(PIPELINE_SLOT_COUNT * (size_t)(sample_buffer_size))
+
+int pipeline_init(pipeline_t *this, arena_t *arena, audio_t *audio,
+                  bands_t *bands, float gain, renderer_set_t *renderers,
+                  const pipeline_sink_t *sink);
+
+/**
+ * @brief Launch core1, from core0.
+ */
+void pipeline_start(pipeline_t *this);
+
+/**
+ * @brief Run the front end on one frame of raw i2s words and hand it to
+ * core1. Blocks while both slots are in flight.
+ */
+void pipeline_submit(pipeline_t *this, const int32_t *samples);
+
+/**
+ * @brief Flush the frames in flight and park core1.
+ */
+void pipeline_stop(pipeline_t *this);
+
+void pipeline_deinit(pipeline_t *this);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef HOST_PICO_CRITICAL_SECTION_H
+#define HOST_PICO_CRITICAL_SECTION_H
+
+#include <pico/types.h>
+
+/**
+ * There are no interrupts to mask on the host. A single process-wide lock
+ * gives the same guarantee: nothing else inside a critical section runs
+ * concurrently.
+ */
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+// Across both cores on the device, the same lock here
+typedef struct {
+    uint32_t saved;
+} critical_section_t;
+
+static inline void critical_section_init(critical_section_t *crit_sec) {
+    crit_sec->saved = 0;
+}
+
+static inline void
+critical_section_enter_blocking(critical_section_t *crit_sec) {
+    crit_sec->saved = save_and_disable_interrupts();
+}
+
+static inline void critical_section_exit(critical_section_t *crit_sec) {
+    restore_interrupts(crit_sec->saved);
+}
+
+#endif
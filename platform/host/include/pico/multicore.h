@@ -0,0 +1,22 @@
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+#include <pico/types.h>
+
+/**
+ * Core1 is a thread. The inter-core FIFOs keep the RP2040 semantics: one
+ * queue per direction, 8 words deep, pushes block while full and pops block
+ * while empty. Whichever thread did not launch core1 counts as core0.
+ */
+void multicore_launch_core1(void (*entry)(void));
+
+/**
+ * Waits for the core1 entry to return, there is no way to stop a thread
+ * from the outside. Also drains both FIFOs.
+ */
+void multicore_reset_core1(void);
+
+void multicore_fifo_push_blocking(uint32_t data);
+uint32_t multicore_fifo_pop_blocking(void);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef HOST_PICO_PLATFORM_H
+#define HOST_PICO_PLATFORM_H
+
+#include <pico/types.h>
+
+/**
+ * @brief 1 on the core1 thread of pico/multicore.h, 0 on any other.
+ */
+uint get_core_num(void);
+
+#endif
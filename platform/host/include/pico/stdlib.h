@@ -0,0 +1,8 @@
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <pico/platform.h>
+#include <pico/time.h>
+#include <pico/types.h>
+
+#endif
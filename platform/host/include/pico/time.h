@@ -0,0 +1,28 @@
+#ifndef HOST_PICO_TIME_H
+#define HOST_PICO_TIME_H
+
+#include <pico/types.h>
+#include <time.h>
+
+static inline uint64_t time_us_64(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000u + (uint64_t)now.tv_nsec / 1000u;
+}
+
+static inline uint32_t time_us_32(void) { return (uint32_t)time_us_64(); }
+
+static inline void sleep_us(uint64_t us) {
+    struct timespec duration = {
+        .tv_sec = (time_t)(us / 1000000u),
+        .tv_nsec = (long)(us % 1000000u) * 1000,
+    };
+
+    nanosleep(&duration, NULL);
+}
+
+static inline void sleep_ms(uint32_t ms) { sleep_us((uint64_t)ms * 1000u); }
+
+#endif
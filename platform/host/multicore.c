@@ -0,0 +1,95 @@
+#include <pico/multicore.h>
+#include <pico/platform.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Same depth as the SIO FIFOs
+#define FIFO_DEPTH 8
+
+typedef struct {
+    uint32_t words[FIFO_DEPTH];
+    unsigned int head;
+    unsigned int count;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} fifo_t;
+
+// fifos[n] is written by core n and read by the other one
+static fifo_t fifos[2] = {
+    {.not_empty = PTHREAD_COND_INITIALIZER,
+     .not_full = PTHREAD_COND_INITIALIZER},
+    {.not_empty = PTHREAD_COND_INITIALIZER,
+     .not_full = PTHREAD_COND_INITIALIZER},
+};
+
+static pthread_mutex_t fifo_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t core1_thread;
+static bool core1_running = false;
+static _Thread_local unsigned int core_num = 0;
+
+static void *core1_main(void *entry) {
+    core_num = 1;
+    ((void (*)(void))entry)();
+
+    return NULL;
+}
+
+uint get_core_num(void) { return core_num; }
+
+void multicore_launch_core1(void (*entry)(void)) {
+    if (core1_running)
+        return;
+
+    if (pthread_create(&core1_thread, NULL, core1_main, (void *)entry) != 0)
+        abort();
+
+    core1_running = true;
+}
+
+void multicore_reset_core1(void) {
+    if (!core1_running)
+        return;
+
+    pthread_join(core1_thread, NULL);
+    core1_running = false;
+
+    pthread_mutex_lock(&fifo_lock);
+    fifos[0].head = fifos[0].count = 0;
+    fifos[1].head = fifos[1].count = 0;
+    pthread_mutex_unlock(&fifo_lock);
+}
+
+void multicore_fifo_push_blocking(uint32_t data) {
+    fifo_t *fifo = &fifos[core_num];
+
+    pthread_mutex_lock(&fifo_lock);
+
+    while (fifo->count == FIFO_DEPTH)
+        pthread_cond_wait(&fifo->not_full, &fifo_lock);
+
+    fifo->words[(fifo->head + fifo->count) % FIFO_DEPTH] = data;
+    fifo->count++;
+
+    pthread_cond_signal(&fifo->not_empty);
+    pthread_mutex_unlock(&fifo_lock);
+}
+
+uint32_t multicore_fifo_pop_blocking(void) {
+    fifo_t *fifo = &fifos[core_num ^ 1];
+    uint32_t data;
+
+    pthread_mutex_lock(&fifo_lock);
+
+    while (fifo->count == 0)
+        pthread_cond_wait(&fifo->not_empty, &fifo_lock);
+
+    data = fifo->words[fifo->head];
+    fifo->head = (fifo->head + 1) % FIFO_DEPTH;
+    fifo->count--;
+
+    pthread_cond_signal(&fifo->not_full);
+    pthread_mutex_unlock(&fifo_lock);
+
+    return data;
+}
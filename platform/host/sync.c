@@ -0,0 +1,14 @@
+#include <pico/critical_section.h>
+#include <pthread.h>
+
+static pthread_mutex_t interrupt_lock = PTHREAD_MUTEX_INITIALIZER;
+
+uint32_t save_and_disable_interrupts(void) {
+    pthread_mutex_lock(&interrupt_lock);
+    return 0;
+}
+
+void restore_interrupts(uint32_t status) {
+    (void)status;
+    pthread_mutex_unlock(&interrupt_lock);
+}
@@ -0,0 +1,245 @@
+#include "show.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+// The low byte of a pixel is padding
+#define GRB_MASK 0xFFFFFF00u
+
+static inline void write_u32(uint8_t *bytes, uint32_t value) {
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+static inline uint32_t read_u32(const uint8_t *bytes) {
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+           ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static inline uint64_t read_u64(const uint8_t *bytes) {
+    return read_u32(bytes) | (uint64_t)read_u32(bytes + 4) << 32;
+}
+
+static inline bool same_pixel(uint32_t a, uint32_t b) {
+    return ((a ^ b) & GRB_MASK) == 0;
+}
+
+static inline uint8_t *put_pixel(uint8_t *out, uint32_t pixel) {
+    out[0] = (uint8_t)(pixel >> 24);
+    out[1] = (uint8_t)(pixel >> 16);
+    out[2] = (uint8_t)(pixel >> 8);
+
+    return out + 3;
+}
+
+static inline uint32_t get_pixel(const uint8_t *bytes) {
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 |
+           (uint32_t)bytes[2] << 8;
+}
+
+static inline uint8_t run_header(show_op_t op, size_t count) {
+    return (uint8_t)((unsigned)op << 6 | (unsigned)(count - 1));
+}
+
+void show_write_header(uint8_t *bytes, const show_header_t *header) {
+    memcpy(bytes, SHOW_MAGIC, 4);
+    write_u32(bytes + 4, header->led_count);
+    write_u32(bytes + 8, header->frame_rate_mhz);
+    write_u32(bytes + 12, header->frame_count);
+    write_u32(bytes + 16, header->block_frames);
+    write_u32(bytes + 20, header->block_count);
+    write_u32(bytes + 24, (uint32_t)header->index_offset);
+    write_u32(bytes + 28, (uint32_t)(header->index_offset >> 32));
+}
+
+int show_read_header(show_header_t *header, const uint8_t *bytes,
+                     size_t size) {
+    if (size < SHOW_HEADER_SIZE || memcmp(bytes, SHOW_MAGIC, 4) != 0)
+        return -1;
+
+    *header = (show_header_t){
+        .led_count = read_u32(bytes + 4),
+        .frame_rate_mhz = read_u32(bytes + 8),
+        .frame_count = read_u32(bytes + 12),
+        .block_frames = read_u32(bytes + 16),
+        .block_count = read_u32(bytes + 20),
+        .index_offset = read_u64(bytes + 24),
+    };
+
+    if (header->led_count == 0 || header->block_frames == 0 ||
+        header->block_count !=
+            (header->frame_count + (uint64_t)header->block_frames - 1) /
+                header->block_frames ||
+        header->index_offset < SHOW_HEADER_SIZE)
+        return -1;
+
+    return 1;
+}
+
+size_t show_encode_frame(const uint32_t *pixels, const uint32_t *previous,
+                         size_t led_count, uint8_t *out) {
+    uint8_t *start = out;
+    size_t i = 0, left, run;
+
+    while (i < led_count) {
+        left = led_count - i < SHOW_MAX_RUN ? led_count - i : SHOW_MAX_RUN;
+
+        if (previous != NULL && same_pixel(pixels[i], previous[i])) {
+            for (run = 1;
+                 run < left && same_pixel(pixels[i + run], previous[i + run]);
+                 run++)
+                ;
+
+            *out++ = run_header(SHOW_OP_SKIP, run);
+        } else if (left > 1 && same_pixel(pixels[i], pixels[i + 1])) {
+            for (run = 2; run < left && same_pixel(pixels[i + run], pixels[i]);
+                 run++)
+                ;
+
+            *out++ = run_header(SHOW_OP_FILL, run);
+            out = put_pixel(out, pixels[i]);
+        } else {
+            // Up to where a skip or a fill would do better
+            for (run = 1; run < left; run++) {
+                if (previous != NULL &&
+                    same_pixel(pixels[i + run], previous[i + run]))
+                    break;
+
+                if (run + 1 < led_count - i &&
+                    same_pixel(pixels[i + run], pixels[i + run + 1]))
+                    break;
+            }
+
+            *out++ = run_header(SHOW_OP_LITERAL, run);
+
+            for (size_t j = 0; j < run; j++)
+                out = put_pixel(out, pixels[i + j]);
+        }
+
+        i += run;
+    }
+
+    return (size_t)(out - start);
+}
+
+size_t show_decode_frame(const uint8_t *bytes, size_t size, uint32_t *pixels,
+                         size_t led_count) {
+    size_t position = 0, i = 0, count;
+    uint32_t pixel;
+    uint8_t header;
+
+    while (i < led_count) {
+        if (position >= size)
+            return 0;
+
+        header = bytes[position++];
+        count = (size_t)(header & (SHOW_MAX_RUN - 1)) + 1;
+
+        if (count > led_count - i)
+            return 0;
+
+        switch (header >> 6) {
+        case SHOW_OP_SKIP:
+            break;
+        case SHOW_OP_FILL:
+            if (size - position < 3)
+                return 0;
+
+            pixel = get_pixel(bytes + position);
+            position += 3;
+
+            for (size_t j = 0; j < count; j++)
+                pixels[i + j] = pixel;
+            break;
+        case SHOW_OP_LITERAL:
+            if (size - position < 3 * count)
+                return 0;
+
+            for (size_t j = 0; j < count; j++, position += 3)
+                pixels[i + j] = get_pixel(bytes + position);
+            break;
+        default:
+            return 0;
+        }
+
+        i += count;
+    }
+
+    return position;
+}
+
+int show_reader_init(show_reader_t *this, arena_t *arena, const uint8_t *data,
+                     size_t size) {
+    if (show_read_header(&this->header, data, size) < 0 ||
+        this->header.index_offset > size ||
+        (size - this->header.index_offset) / 8 < this->header.block_count)
+        return -1;
+
+    this->pixels =
+        arena_calloc(arena, this->header.led_count * sizeof(uint32_t),
+                     ARENA_ALIGN);
+
+    if (this->pixels == NULL)
+        return -1;
+
+    this->data = data;
+    this->size = size;
+    this->position = SHOW_HEADER_SIZE;
+    this->next_frame = 0;
+    this->mem = this->pixels;
+    this->arena = arena;
+
+    return 1;
+}
+
+int show_reader_seek(show_reader_t *this, uint32_t frame) {
+    uint32_t block = frame / this->header.block_frames;
+    uint64_t offset;
+
+    if (frame > this->header.frame_count)
+        return -1;
+
+    // Past the last frame, nothing to decode
+    if (frame == this->header.frame_count) {
+        this->next_frame = frame;
+        return 1;
+    }
+
+    offset = read_u64(this->data + this->header.index_offset + 8 * block);
+
+    if (offset < SHOW_HEADER_SIZE || offset >= this->header.index_offset)
+        return -1;
+
+    this->position = (size_t)offset;
+    this->next_frame = block * this->header.block_frames;
+
+    while (this->next_frame < frame)
+        if (show_reader_next(this) == NULL)
+            return -1;
+
+    return 1;
+}
+
+const uint32_t *show_reader_next(show_reader_t *this) {
+    size_t end = (size_t)this->header.index_offset, used;
+
+    if (this->next_frame >= this->header.frame_count || this->position >= end)
+        return NULL;
+
+    used = show_decode_frame(this->data + this->position, end - this->position,
+                             this->pixels, this->header.led_count);
+
+    if (used == 0)
+        return NULL;
+
+    this->position += used;
+    this->next_frame++;
+
+    return this->pixels;
+}
+
+void show_reader_deinit(show_reader_t *this) {
+    arena_free(this->arena, this->mem);
+}
@@ -0,0 +1,130 @@
+#ifndef SHOW_H
+#define SHOW_H
+
+#include "arena.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Pre-rendered LED show: the frames of a whole track compressed so an hour of
+ * it fits in flash, where the firmware plays it back straight out of XIP.
+ *
+ * File layout, all integers little endian:
+ *
+ *  offset  size  field
+ *  0       4     magic "LPSH"
+ *  4       4     LED count
+ *  8       4     frame rate in mHz
+ *  12      4     frame count
+ *  16      4     frames per block
+ *  20      4     block count
+ *  24      8     offset of the block index
+ *  32      ...   blocks
+ *  index   8 x block count, offset of every block from the start of the file
+ *
+ * Blocks stand on their own: the first frame of a block is coded alone, the
+ * others against the frame before, so seeking is a jump to the block holding
+ * the frame and decoding forward from its start.
+ *
+ * A frame is a sequence of runs, each one header byte, the op in the top two
+ * bits and the pixel count minus one in the low six:
+ *
+ *  SKIP     n pixels unchanged since the previous frame
+ *  FILL     one (g, r, b) pixel repeated n times
+ *  LITERAL  n (g, r, b) pixels
+ */
+
+#define SHOW_MAGIC "LPSH"
+#define SHOW_HEADER_SIZE 32
+#define SHOW_DEFAULT_BLOCK_FRAMES 64
+
+// Longest run a header byte holds
+#define SHOW_MAX_RUN 64
+
+// Worst case bytes of a coded frame, every pixel a literal
+#define SHOW_MAX_FRAME_SIZE(led_count)                                         \
+    (3 * (size_t)(led_count) +                                                 \
+     ((size_t)(led_count) + SHOW_MAX_RUN - 1) / SHOW_MAX_RUN)
+
+#define SHOW_READER_FOOTPRINT(led_count)                                       \
+    ARENA_FOOTPRINT((size_t)(led_count) * sizeof(uint32_t))
+
+typedef enum {
+    SHOW_OP_SKIP = 0,
+    SHOW_OP_FILL = 1,
+    SHOW_OP_LITERAL = 2,
+} show_op_t;
+
+typedef struct {
+    uint32_t led_count;
+    uint32_t frame_rate_mhz;
+    uint32_t frame_count;
+    uint32_t block_frames;
+    uint32_t block_count;
+    uint64_t index_offset;
+} show_header_t;
+
+void show_write_header(uint8_t *bytes, const show_header_t *header);
+
+/**
+ * @param size Bytes available at bytes, at least SHOW_HEADER_SIZE
+ */
+int show_read_header(show_header_t *header, const uint8_t *bytes,
+                     size_t size);
+
+/**
+ * @brief Code one frame of pixels (GRB in the top three bytes, see
+ * color_neopixel_t).
+ *
+ * @param previous Frame before, NULL for the first frame of a block
+ * @param out At least SHOW_MAX_FRAME_SIZE(led_count) bytes
+ * @return size_t Bytes written to out
+ */
+size_t show_encode_frame(const uint32_t *pixels, const uint32_t *previous,
+                         size_t led_count, uint8_t *out);
+
+/**
+ * @brief Apply one coded frame on top of the previous one held in pixels.
+ *
+ * @return size_t Bytes consumed, 0 if the frame is malformed
+ */
+size_t show_decode_frame(const uint8_t *bytes, size_t size, uint32_t *pixels,
+                         size_t led_count);
+
+/**
+ * Plays a show back out of memory, flash on the device or a mapped file on
+ * the host. Holds the current frame only.
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    show_header_t header;
+    uint32_t *pixels;
+    // Byte offset of the next coded frame
+    size_t position;
+    uint32_t next_frame;
+    void *mem;
+    arena_t *arena;
+} show_reader_t;
+
+int show_reader_init(show_reader_t *this, arena_t *arena, const uint8_t *data,
+                     size_t size);
+
+/**
+ * @brief Make frame the next one show_reader_next returns, decoding from the
+ * start of its block.
+ */
+int show_reader_seek(show_reader_t *this, uint32_t frame);
+
+/**
+ * @brief Decode the next frame.
+ *
+ * @return const uint32_t* The pixels, valid until the next call, NULL at the
+ * end of the show or on a malformed file
+ */
+const uint32_t *show_reader_next(show_reader_t *this);
+
+void show_reader_deinit(show_reader_t *this);
+
+#endif
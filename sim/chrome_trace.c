@@ -0,0 +1,105 @@
+#include "chrome_trace.h"
+
+// Track of the LED transmission, after the cores
+#define TRANSMIT_TRACK 2
+
+typedef struct {
+    const char *name;
+    // Chrome phase: B begins a slice, E ends it, i is an instant
+    char phase;
+} event_info_t;
+
+static const event_info_t events[TRACE_EVENT_COUNT] = {
+    [TRACE_CAPTURE] = {"capture", 'i'},
+    [TRACE_FRONT_END_BEGIN] = {"front end", 'B'},
+    [TRACE_FRONT_END_END] = {"front end", 'E'},
+    [TRACE_FFT_BEGIN] = {"fft", 'B'},
+    [TRACE_FFT_END] = {"fft", 'E'},
+    [TRACE_MAP_BEGIN] = {"map", 'B'},
+    [TRACE_MAP_END] = {"map", 'E'},
+    [TRACE_LED_SWAP] = {"LED swap", 'i'},
+    [TRACE_TRANSMIT_BEGIN] = {"transmit", 'B'},
+    [TRACE_TRANSMIT_END] = {"transmit", 'E'},
+};
+
+static const char *const track_names[] = {"core0", "core1", "LEDs"};
+
+int chrome_trace_open(chrome_trace_t *this, const char *path) {
+    *this = (chrome_trace_t){
+        .file = fopen(path, "w"),
+    };
+
+    if (this->file == NULL)
+        return -1;
+
+    fprintf(this->file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    // Every event after these opens with the comma of the one before
+    for (size_t i = 0; i < sizeof(track_names) / sizeof(*track_names); i++)
+        fprintf(this->file,
+                "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                "\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                i == 0 ? "" : ",", (unsigned)i, track_names[i]);
+
+    return 1;
+}
+
+void chrome_trace_write(chrome_trace_t *this, const trace_record_t *records,
+                        size_t count) {
+    const event_info_t *info;
+    unsigned track;
+
+    for (size_t i = 0; i < count; i++) {
+        if (records[i].event >= TRACE_EVENT_COUNT)
+            continue;
+
+        // Records are stamped before they take the lock, so one core may
+        // land a few us behind the other. Signed steps keep that right
+        if (!this->has_events)
+            this->time_us = records[i].time_us;
+        else
+            this->time_us += (int32_t)(records[i].time_us - this->last_us);
+
+        this->last_us = records[i].time_us;
+        this->has_events = true;
+
+        info = &events[records[i].event];
+        track = records[i].event == TRACE_TRANSMIT_BEGIN ||
+                        records[i].event == TRACE_TRANSMIT_END
+                    ? TRANSMIT_TRACK
+                    : records[i].core;
+
+        // Instants span their track only, not the whole process
+        fprintf(this->file,
+                ",\n{\"name\":\"%s\",\"ph\":\"%c\",%s\"ts\":%lld,"
+                "\"pid\":0,\"tid\":%u,\"args\":{\"frame\":%u}}",
+                info->name, info->phase,
+                info->phase == 'i' ? "\"s\":\"t\"," : "",
+                (long long)this->time_us, track, (unsigned)records[i].frame);
+    }
+}
+
+int chrome_trace_close(chrome_trace_t *this, const trace_summary_t *summary) {
+    int status;
+
+    fprintf(this->file,
+            "\n],\"otherData\":{\"frames\":%u,\"dma_overruns\":%u,"
+            "\"stale_frames\":%u,\"lost_records\":%u,\"latency_p50_us\":%u,"
+            "\"latency_p90_us\":%u,\"latency_p99_us\":%u,"
+            "\"latency_max_us\":%u,\"irq_latency_mean_us\":%u,"
+            "\"irq_latency_max_us\":%u}}\n",
+            summary->frame_count,
+            summary->counters[TRACE_COUNTER_DMA_OVERRUN],
+            summary->counters[TRACE_COUNTER_STALE_FRAME],
+            summary->counters[TRACE_COUNTER_LOST], summary->latency_p50_us,
+            summary->latency_p90_us, summary->latency_p99_us,
+            summary->latency_max_us, summary->irq_latency_mean_us,
+            summary->irq_latency_max_us);
+
+    status = ferror(this->file) ? -1 : 1;
+
+    if (fclose(this->file) != 0)
+        status = -1;
+
+    return status;
+}
@@ -0,0 +1,37 @@
+#ifndef CHROME_TRACE_H
+#define CHROME_TRACE_H
+
+#include "trace.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Writes trace records as a Chrome trace event file, which chrome://tracing
+ * and ui.perfetto.dev open as is. Every stage is a slice on the track of the
+ * core it ran on, LED transmission on a track of its own since it runs in an
+ * interrupt across whatever the core is doing. Captures and LED swaps are
+ * instants, every event carries the frame it belongs to.
+ */
+typedef struct {
+    FILE *file;
+    // The 32-bit device clock, unwrapped
+    int64_t time_us;
+    uint32_t last_us;
+    bool has_events;
+} chrome_trace_t;
+
+int chrome_trace_open(chrome_trace_t *this, const char *path);
+
+void chrome_trace_write(chrome_trace_t *this, const trace_record_t *records,
+                        size_t count);
+
+/**
+ * @brief Close the event list, the summary goes along as metadata.
+ *
+ * @return int -1 if anything failed to write
+ */
+int chrome_trace_close(chrome_trace_t *this, const trace_summary_t *summary);
+
+#endif
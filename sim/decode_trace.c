@@ -0,0 +1,166 @@
+/**
+ * Turns the trace the firmware drains over USB (see trace_drain) into a
+ * Chrome trace, the same file the simulator writes with -t. Capture the
+ * serial port to a file, or pipe it in:
+ *
+ *  cat /dev/ttyACM0 | light-painting-trace - trace.json
+ *
+ * Lines other than trace records and summaries are skipped, the boot
+ * messages share the port. The last summary goes into the file and out on
+ * stderr.
+ */
+
+#include "chrome_trace.h"
+#include "trace.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LINE_SIZE 256
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s <drain.log|-> <trace.json>\n", name);
+}
+
+static int base64_value(char c) {
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '+')
+        return 62;
+    if (c == '/')
+        return 63;
+
+    return -1;
+}
+
+/**
+ * @return size_t Bytes decoded, stops at the padding or anything else that
+ * is not base64
+ */
+static size_t decode_base64(const char *text, uint8_t *bytes, size_t size) {
+    uint32_t bits = 0;
+    size_t count = 0;
+    int value, bit_count = 0;
+
+    for (; (value = base64_value(*text)) >= 0; text++) {
+        bits = bits << 6 | (uint32_t)value;
+        bit_count += 6;
+
+        if (bit_count >= 8) {
+            bit_count -= 8;
+
+            if (count == size)
+                break;
+
+            bytes[count++] = (uint8_t)(bits >> bit_count);
+        }
+    }
+
+    return count;
+}
+
+static uint32_t read_u32(const uint8_t *bytes) {
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+           ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static bool parse_summary(const char *line, trace_summary_t *summary) {
+    return sscanf(line,
+                  "S frames=%u overruns=%u stale=%u lost=%u p50=%u p90=%u "
+                  "p99=%u max=%u irq_mean=%u irq_max=%u",
+                  &summary->frame_count,
+                  &summary->counters[TRACE_COUNTER_DMA_OVERRUN],
+                  &summary->counters[TRACE_COUNTER_STALE_FRAME],
+                  &summary->counters[TRACE_COUNTER_LOST],
+                  &summary->latency_p50_us, &summary->latency_p90_us,
+                  &summary->latency_p99_us, &summary->latency_max_us,
+                  &summary->irq_latency_mean_us,
+                  &summary->irq_latency_max_us) == 10;
+}
+
+int main(int argc, char *argv[]) {
+    FILE *input;
+    chrome_trace_t trace;
+    trace_summary_t summary = {0};
+    trace_record_t records[TRACE_DRAIN_RECORDS];
+    uint8_t bytes[TRACE_DRAIN_RECORDS * sizeof(trace_record_t)];
+    char line[LINE_SIZE];
+    size_t count, record_count = 0;
+    bool has_summary = false;
+
+    if (argc != 3) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    input = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "r");
+
+    if (input == NULL) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (chrome_trace_open(&trace, argv[2]) < 0) {
+        fprintf(stderr, "Could not open %s\n", argv[2]);
+        if (input != stdin)
+            fclose(input);
+        return EXIT_FAILURE;
+    }
+
+    while (fgets(line, sizeof(line), input) != NULL) {
+        if (strncmp(line, "S ", 2) == 0) {
+            has_summary |= parse_summary(line, &summary);
+            continue;
+        }
+
+        if (strncmp(line, "T ", 2) != 0)
+            continue;
+
+        // A torn record is of no use, the rest of the line is
+        count = decode_base64(line + 2, bytes, sizeof(bytes)) /
+                sizeof(trace_record_t);
+
+        for (size_t i = 0; i < count; i++)
+            records[i] = (trace_record_t){
+                .time_us = read_u32(bytes + 8 * i),
+                .frame = (uint16_t)(bytes[8 * i + 4] | bytes[8 * i + 5] << 8),
+                .event = bytes[8 * i + 6],
+                .core = bytes[8 * i + 7],
+            };
+
+        chrome_trace_write(&trace, records, count);
+        record_count += count;
+    }
+
+    if (input != stdin)
+        fclose(input);
+
+    if (chrome_trace_close(&trace, &summary) < 0) {
+        fprintf(stderr, "Could not write %s\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "%zu records\n", record_count);
+
+    if (has_summary)
+        fprintf(stderr,
+                "%u frames, sound to light p50 %u us, p90 %u us, p99 %u us, "
+                "%u us max\n"
+                "%u DMA overruns, %u stale frames, %u records lost, IRQ "
+                "latency %u us mean, %u us max\n",
+                summary.frame_count, summary.latency_p50_us,
+                summary.latency_p90_us, summary.latency_p99_us,
+                summary.latency_max_us,
+                summary.counters[TRACE_COUNTER_DMA_OVERRUN],
+                summary.counters[TRACE_COUNTER_STALE_FRAME],
+                summary.counters[TRACE_COUNTER_LOST],
+                summary.irq_latency_mean_us, summary.irq_latency_max_us);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+#include "parse.h"
+
+#include <string.h>
+
+int parse_engine(const char *name, audio_engine_t *engine) {
+    if (strcmp(name, "float") == 0)
+        *engine = AUDIO_ENGINE_FLOAT;
+    else if (strcmp(name, "q15") == 0)
+        *engine = AUDIO_ENGINE_Q15;
+    else if (strcmp(name, "q31") == 0)
+        *engine = AUDIO_ENGINE_Q31;
+    else if (strcmp(name, "goertzel") == 0)
+        *engine = AUDIO_ENGINE_GOERTZEL;
+    else
+        return -1;
+
+    return 1;
+}
+
+int parse_window(const char *name, audio_window_t *window) {
+    if (strcmp(name, "rect") == 0)
+        *window = AUDIO_WINDOW_RECTANGULAR;
+    else if (strcmp(name, "hann") == 0)
+        *window = AUDIO_WINDOW_HANN;
+    else if (strcmp(name, "blackman-harris") == 0)
+        *window = AUDIO_WINDOW_BLACKMAN_HARRIS;
+    else if (strcmp(name, "flat-top") == 0)
+        *window = AUDIO_WINDOW_FLAT_TOP;
+    else
+        return -1;
+
+    return 1;
+}
+
+int parse_kernel(const char *name, fft_kernel_t *kernel) {
+    if (strcmp(name, "radix2") == 0)
+        *kernel = FFT_KERNEL_RADIX2;
+    else if (strcmp(name, "radix4") == 0)
+        *kernel = FFT_KERNEL_RADIX4;
+    else if (strcmp(name, "split") == 0)
+        *kernel = FFT_KERNEL_SPLIT_RADIX;
+    else if (strcmp(name, "staged") == 0)
+        *kernel = FFT_KERNEL_RADIX2_STAGED;
+    else if (strcmp(name, "planar") == 0)
+        *kernel = FFT_KERNEL_RADIX2_PLANAR;
+    else
+        return -1;
+
+    return 1;
+}
+
+int parse_output(const char *name, fft_output_mode_t *output) {
+    if (strcmp(name, "magnitude") == 0)
+        *output = FFT_OUTPUT_MAGNITUDE;
+    else if (strcmp(name, "power") == 0)
+        *output = FFT_OUTPUT_POWER;
+    else if (strcmp(name, "approx") == 0)
+        *output = FFT_OUTPUT_APPROX_MAGNITUDE;
+    else if (strcmp(name, "log") == 0)
+        *output = FFT_OUTPUT_LOG;
+    else
+        return -1;
+
+    return 1;
+}
+
+int parse_spacing(const char *name, bands_spacing_t *spacing) {
+    if (strcmp(name, "log") == 0)
+        *spacing = BANDS_SPACING_LOG;
+    else if (strcmp(name, "octave") == 0)
+        *spacing = BANDS_SPACING_OCTAVE;
+    else if (strcmp(name, "third") == 0)
+        *spacing = BANDS_SPACING_THIRD_OCTAVE;
+    else if (strcmp(name, "mel") == 0)
+        *spacing = BANDS_SPACING_MEL;
+    else
+        return -1;
+
+    return 1;
+}
@@ -0,0 +1,17 @@
+#ifndef PARSE_H
+#define PARSE_H
+
+#include "audio.h"
+#include "bands.h"
+
+/**
+ * Option values shared by the host tools, by name. Each returns -1 on a name
+ * it does not know and leaves the value alone.
+ */
+int parse_engine(const char *name, audio_engine_t *engine);
+int parse_window(const char *name, audio_window_t *window);
+int parse_kernel(const char *name, fft_kernel_t *kernel);
+int parse_output(const char *name, fft_output_mode_t *output);
+int parse_spacing(const char *name, bands_spacing_t *spacing);
+
+#endif
@@ -0,0 +1,707 @@
+/**
+ * Offline renderer, turns a whole track into a show file (show/show.h) the
+ * firmware plays back instead of analyzing live. Same path as the simulator,
+ * frame for frame, only spread over a pool of threads.
+ *
+ * The WAV is mapped and cut into chunks of whole blocks. Workers take the
+ * next chunk as they free up, each with its own audio_t and bands, and code
+ * its frames into a buffer of their own while the main thread writes the
+ * finished chunks out in order. A worker starts a chunk one window early so
+ * the ring of the STFT holds exactly what a serial pass would have put there,
+ * the output is the same whatever the number of threads.
+ *
+ * With -u it goes the other way, a show file back to the frame file of the
+ * simulator, through the same reader as the firmware.
+ */
+
+#include "audio.h"
+#include "bands.h"
+#include "parse.h"
+#include "show.h"
+#include "renderer.h"
+#include "wav.h"
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <pico/stdlib.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DEFAULT_AUDIO_SAMPLE_COUNT 64
+#define DEFAULT_LED_COUNT 300
+#define DEFAULT_GAIN 1.5f
+#define DEFAULT_BAND_COUNT 32
+#define DEFAULT_MIN_HZ 40.f
+#define DEFAULT_MAX_HZ 16000.f
+
+// Blocks a worker takes at once, enough to make the early start cheap
+#define CHUNK_BLOCKS 16
+// Chunks in flight per worker, bounds the memory whatever the track length
+#define SLOTS_PER_WORKER 2
+
+#define FRAME_FILE_MAGIC "LPFR"
+#define FRAME_FILE_HEADER_SIZE 16
+
+typedef struct {
+    const char *input_path;
+    const char *output_path;
+    size_t audio_sample_count;
+    size_t hop_count;
+    size_t led_count;
+    audio_engine_t engine;
+    audio_window_t window;
+    fft_kernel_t kernel;
+    fft_output_mode_t output;
+    float floor_db;
+    bands_spacing_t spacing;
+    size_t band_count;
+    float gain;
+    renderer_kind_t renderer;
+    size_t thread_count;
+    size_t block_frames;
+    // Show file back to a frame file
+    bool unpack;
+} options_t;
+
+typedef struct {
+    uint8_t *bytes;
+    size_t size;
+    // Where each block starts in bytes
+    size_t block_offsets[CHUNK_BLOCKS];
+    size_t block_count;
+    bool done;
+} chunk_t;
+
+typedef struct {
+    const options_t *options;
+    const wav_t *wav;
+    bands_config_t bands_config;
+    uint32_t frame_count;
+    size_t chunk_frames;
+    uint32_t chunk_count;
+    // Chunk c goes to slot c % slot_count
+    chunk_t *slots;
+    size_t slot_count;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    // Next chunk for a worker to take, chunks written out so far
+    uint32_t next_chunk;
+    uint32_t written_count;
+    bool failed;
+} job_t;
+
+typedef struct {
+    job_t *job;
+    audio_t audio;
+    bands_t bands;
+    renderer_t renderer;
+    int32_t *words;
+    uint32_t *pixels[2];
+    pthread_t thread;
+} worker_t;
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-n samples] [-h hop] [-l leds] [-e float|q15|q31] "
+            "[-w rect|hann|blackman-harris|flat-top] "
+            "[-k radix2|radix4|split|staged|planar] "
+            "[-o magnitude|power|approx|log] [-f floor_db] "
+            "[-s log|octave|third|mel] [-b bands] [-g gain] "
+            "[-r spectrum|mirror|vu|pulse] [-j threads] "
+            "[-B block_frames] <input.wav> <output.lps>\n"
+            "       %s -u <input.lps> <output.lpf>\n",
+            name, name);
+}
+
+static int parse_options(options_t *options, int argc, char *argv[]) {
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    int option;
+
+    *options = (options_t){
+        .audio_sample_count = DEFAULT_AUDIO_SAMPLE_COUNT,
+        .led_count = DEFAULT_LED_COUNT,
+        .engine = AUDIO_ENGINE_Q15,
+        .window = AUDIO_WINDOW_HANN,
+        .kernel = FFT_KERNEL_RADIX2,
+        .output = FFT_OUTPUT_MAGNITUDE,
+        .floor_db = FFT_OUTPUT_DEFAULT_FLOOR_DB,
+        .spacing = BANDS_SPACING_MEL,
+        .band_count = DEFAULT_BAND_COUNT,
+        .gain = DEFAULT_GAIN,
+        .renderer = RENDERER_SPECTRUM,
+        .thread_count = cpu_count > 0 ? (size_t)cpu_count : 1,
+        .block_frames = SHOW_DEFAULT_BLOCK_FRAMES,
+    };
+
+    while ((option = getopt(argc, argv, "n:h:l:e:w:k:o:f:s:b:g:r:j:B:u")) !=
+           -1) {
+        switch (option) {
+        case 'n':
+            options->audio_sample_count = strtoul(optarg, NULL, 0);
+            break;
+        case 'h':
+            options->hop_count = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            options->led_count = strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            if (parse_engine(optarg, &options->engine) < 0)
+                return -1;
+            break;
+        case 'w':
+            if (parse_window(optarg, &options->window) < 0)
+                return -1;
+            break;
+        case 'k':
+            if (parse_kernel(optarg, &options->kernel) < 0)
+                return -1;
+            break;
+        case 'o':
+            if (parse_output(optarg, &options->output) < 0)
+                return -1;
+            break;
+        case 'f':
+            options->floor_db = strtof(optarg, NULL);
+            break;
+        case 's':
+            if (parse_spacing(optarg, &options->spacing) < 0)
+                return -1;
+            break;
+        case 'b':
+            options->band_count = strtoul(optarg, NULL, 0);
+            break;
+        case 'g':
+            options->gain = strtof(optarg, NULL);
+            break;
+        case 'r':
+            if (renderer_find(optarg, &options->renderer) < 0)
+                return -1;
+            break;
+        case 'j':
+            options->thread_count = strtoul(optarg, NULL, 0);
+            break;
+        case 'B':
+            options->block_frames = strtoul(optarg, NULL, 0);
+            break;
+        case 'u':
+            options->unpack = true;
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    if (argc - optind != 2)
+        return -1;
+
+    options->input_path = argv[optind];
+    options->output_path = argv[optind + 1];
+
+    if (options->unpack)
+        return 1;
+
+    if (options->audio_sample_count < 4 ||
+        (options->audio_sample_count & (options->audio_sample_count - 1)) != 0)
+        return -1;
+
+    if (options->hop_count == 0)
+        options->hop_count = options->audio_sample_count;
+
+    if (options->audio_sample_count % options->hop_count != 0)
+        return -1;
+
+    if (options->led_count == 0 || options->led_count > UINT16_MAX ||
+        options->thread_count == 0 ||
+        options->block_frames == 0 || options->block_frames > UINT32_MAX)
+        return -1;
+
+    if (!(options->floor_db < 0.f))
+        return -1;
+
+    return 1;
+}
+
+static inline int32_t to_i2s_word(int32_t sample) {
+    return (int32_t)(((uint32_t)sample << 7) & 0x7FFFFF80u);
+}
+
+static void write_u32(uint8_t *bytes, uint32_t value) {
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+static void deinit_worker(worker_t *worker) {
+    free(worker->pixels[1]);
+    free(worker->pixels[0]);
+    free(worker->words);
+    renderer_deinit(&worker->renderer);
+    bands_deinit(&worker->bands);
+    audio_deinit(&worker->audio);
+}
+
+static int init_worker(worker_t *worker, job_t *job) {
+    const options_t *options = job->options;
+    bands_config_t bands_config = job->bands_config;
+    renderer_geometry_t geometry = {.pixel_count = options->led_count};
+
+    *worker = (worker_t){.job = job};
+
+    if (audio_init_stft(&worker->audio, NULL, options->audio_sample_count,
+                        options->hop_count, options->engine,
+                        options->window) < 0)
+        return -1;
+
+    audio_set_output(&worker->audio, options->output, options->floor_db);
+
+    bands_config.bin_count = audio_get_frequency_bin_count(&worker->audio);
+
+    if (audio_set_kernel(&worker->audio, options->kernel) < 0 ||
+        bands_init(&worker->bands, NULL, &bands_config) < 0) {
+        audio_deinit(&worker->audio);
+        return -1;
+    }
+
+    // Each worker its own, they keep no state but cost little. This also
+    // builds the default palette before any worker runs
+    geometry.band_count = bands_get_count(&worker->bands);
+
+    if (renderer_init(&worker->renderer, NULL, options->renderer,
+                      &geometry) < 0) {
+        bands_deinit(&worker->bands);
+        audio_deinit(&worker->audio);
+        return -1;
+    }
+
+    worker->words = calloc(options->hop_count, sizeof(int32_t));
+    worker->pixels[0] = calloc(options->led_count, sizeof(uint32_t));
+    worker->pixels[1] = calloc(options->led_count, sizeof(uint32_t));
+
+    if (worker->words == NULL || worker->pixels[0] == NULL ||
+        worker->pixels[1] == NULL) {
+        deinit_worker(worker);
+        return -1;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Push hop number hop through the front end, zeros before the track
+ * like the ring a serial run starts with.
+ */
+static void feed_hop(worker_t *worker, long hop) {
+    const options_t *options = worker->job->options;
+
+    if (hop < 0) {
+        memset(worker->words, 0, options->hop_count * sizeof(int32_t));
+    } else {
+        wav_read_mono_24_at(worker->job->wav, (size_t)hop * options->hop_count,
+                            worker->words, options->hop_count);
+
+        for (size_t i = 0; i < options->hop_count; i++)
+            worker->words[i] = to_i2s_word(worker->words[i]);
+    }
+
+    audio_feed_i2s(&worker->audio, worker->words, options->gain);
+}
+
+static void render_chunk(worker_t *worker, uint32_t index, chunk_t *chunk) {
+    job_t *job = worker->job;
+    const options_t *options = job->options;
+    size_t first = index * job->chunk_frames, end = first + job->chunk_frames;
+    long warm_up = (long)(options->audio_sample_count / options->hop_count) - 1;
+    uint32_t *pixels = worker->pixels[0], *previous = worker->pixels[1], *swap;
+
+    if (end > job->frame_count)
+        end = job->frame_count;
+
+    chunk->size = 0;
+    chunk->block_count = 0;
+
+    // The hops still in the ring at the first frame of the chunk
+    for (long hop = (long)first - warm_up; hop < (long)first; hop++)
+        feed_hop(worker, hop);
+
+    for (size_t frame = first; frame < end; frame++) {
+        feed_hop(worker, (long)frame);
+        audio_fft(&worker->audio);
+        bands_aggregate(&worker->bands,
+                        audio_get_frequency_bins(&worker->audio));
+        renderer_render(&worker->renderer, bands_get(&worker->bands), pixels);
+
+        // Blocks stand on their own, their first frame is coded alone
+        if ((frame - first) % options->block_frames == 0)
+            chunk->block_offsets[chunk->block_count++] = chunk->size;
+
+        chunk->size += show_encode_frame(
+            pixels, (frame - first) % options->block_frames ? previous : NULL,
+            options->led_count, chunk->bytes + chunk->size);
+
+        swap = previous;
+        previous = pixels;
+        pixels = swap;
+    }
+}
+
+static void *run_worker(void *context) {
+    worker_t *worker = context;
+    job_t *job = worker->job;
+    uint32_t index;
+    chunk_t *chunk;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+
+        // Wait for the slot to be written out
+        while (!job->failed && job->next_chunk < job->chunk_count &&
+               job->next_chunk >= job->written_count + job->slot_count)
+            pthread_cond_wait(&job->changed, &job->lock);
+
+        if (job->failed || job->next_chunk >= job->chunk_count) {
+            pthread_mutex_unlock(&job->lock);
+            return NULL;
+        }
+
+        index = job->next_chunk++;
+        pthread_mutex_unlock(&job->lock);
+
+        chunk = &job->slots[index % job->slot_count];
+        render_chunk(worker, index, chunk);
+
+        pthread_mutex_lock(&job->lock);
+        chunk->done = true;
+        pthread_cond_broadcast(&job->changed);
+        pthread_mutex_unlock(&job->lock);
+    }
+}
+
+/**
+ * @brief Chunks out to the file in order as the workers finish them.
+ *
+ * @param offsets Gets the file offset of every block
+ * @return uint64_t Offset just past the last block, 0 on failure
+ */
+static uint64_t write_chunks(job_t *job, FILE *file, uint64_t *offsets) {
+    uint64_t offset = SHOW_HEADER_SIZE;
+    size_t block = 0;
+
+    for (uint32_t index = 0; index < job->chunk_count; index++) {
+        chunk_t *chunk = &job->slots[index % job->slot_count];
+
+        pthread_mutex_lock(&job->lock);
+
+        while (!chunk->done)
+            pthread_cond_wait(&job->changed, &job->lock);
+
+        pthread_mutex_unlock(&job->lock);
+
+        if (fwrite(chunk->bytes, 1, chunk->size, file) != chunk->size)
+            return 0;
+
+        for (size_t i = 0; i < chunk->block_count; i++)
+            offsets[block++] = offset + chunk->block_offsets[i];
+
+        offset += chunk->size;
+
+        pthread_mutex_lock(&job->lock);
+        chunk->done = false;
+        job->written_count++;
+        pthread_cond_broadcast(&job->changed);
+        pthread_mutex_unlock(&job->lock);
+    }
+
+    return offset;
+}
+
+static int write_index(FILE *file, const uint64_t *offsets, size_t count) {
+    uint8_t entry[8];
+
+    for (size_t i = 0; i < count; i++) {
+        write_u32(entry, (uint32_t)offsets[i]);
+        write_u32(entry + 4, (uint32_t)(offsets[i] >> 32));
+
+        if (fwrite(entry, sizeof(entry), 1, file) != 1)
+            return -1;
+    }
+
+    return 1;
+}
+
+static int write_show_header(FILE *file, const show_header_t *header) {
+    uint8_t bytes[SHOW_HEADER_SIZE];
+
+    show_write_header(bytes, header);
+
+    if (fseek(file, 0, SEEK_SET) != 0)
+        return -1;
+
+    return fwrite(bytes, sizeof(bytes), 1, file) == 1 ? 1 : -1;
+}
+
+static int render(const options_t *options) {
+    wav_t wav;
+    job_t job = {.options = options, .wav = &wav};
+    worker_t *workers = NULL;
+    show_header_t header = {0};
+    uint64_t *offsets = NULL, end = 0, start_us, wall_us;
+    size_t worker_count = 0, started = 0, slot_size;
+    FILE *file = NULL;
+    double frame_count, raw_size;
+    int status = -1;
+
+    if (options->engine == AUDIO_ENGINE_GOERTZEL) {
+        // The resonators remember the whole track, no starting mid way
+        fprintf(stderr, "The goertzel engine cannot be split up\n");
+        return -1;
+    }
+
+    if (wav_map(&wav, options->input_path) < 0) {
+        fprintf(stderr, "Could not map %s as WAV\n", options->input_path);
+        return -1;
+    }
+
+    if (wav.frame_count / options->hop_count > UINT32_MAX) {
+        fprintf(stderr, "Too many frames for a show file\n");
+        wav_close(&wav);
+        return -1;
+    }
+
+    job.bands_config = (bands_config_t){
+        .spacing = options->spacing,
+        .band_count = options->band_count,
+        .min_hz = DEFAULT_MIN_HZ,
+        .max_hz = wav.sample_rate / 2.f < DEFAULT_MAX_HZ ? wav.sample_rate / 2.f
+                                                         : DEFAULT_MAX_HZ,
+        .sample_rate = (float)wav.sample_rate,
+    };
+    job.frame_count = (uint32_t)(wav.frame_count / options->hop_count);
+    job.chunk_frames = CHUNK_BLOCKS * options->block_frames;
+    job.chunk_count =
+        (uint32_t)((job.frame_count + job.chunk_frames - 1) / job.chunk_frames);
+    job.slot_count = SLOTS_PER_WORKER * options->thread_count;
+
+    header = (show_header_t){
+        .led_count = (uint32_t)options->led_count,
+        .frame_rate_mhz = (uint32_t)((uint64_t)wav.sample_rate * 1000u /
+                                     options->hop_count),
+        .frame_count = job.frame_count,
+        .block_frames = (uint32_t)options->block_frames,
+        .block_count = (uint32_t)((job.frame_count + options->block_frames -
+                                   1) /
+                                  options->block_frames),
+    };
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.changed, NULL);
+
+    slot_size = job.chunk_frames * SHOW_MAX_FRAME_SIZE(options->led_count);
+    job.slots = calloc(job.slot_count, sizeof(chunk_t));
+    workers = calloc(options->thread_count, sizeof(worker_t));
+    offsets = calloc(header.block_count ? header.block_count : 1,
+                     sizeof(uint64_t));
+    file = fopen(options->output_path, "wb");
+
+    if (job.slots == NULL || workers == NULL || offsets == NULL ||
+        file == NULL) {
+        fprintf(stderr, "Could not set up the render\n");
+        goto cleanup;
+    }
+
+    for (size_t i = 0; i < job.slot_count; i++)
+        if ((job.slots[i].bytes = malloc(slot_size)) == NULL) {
+            fprintf(stderr, "Could not set up the render\n");
+            goto cleanup;
+        }
+
+    for (; worker_count < options->thread_count; worker_count++)
+        if (init_worker(&workers[worker_count], &job) < 0) {
+            fprintf(stderr, "Could not initialize audio, only the float "
+                            "engine has other kernels\n");
+            goto cleanup;
+        }
+
+    // Placeholder, the header gets patched in at the end
+    if (write_show_header(file, &header) < 0)
+        goto write_failed;
+
+    start_us = time_us_64();
+
+    for (; started < worker_count; started++)
+        if (pthread_create(&workers[started].thread, NULL, run_worker,
+                           &workers[started]) != 0)
+            break;
+
+    if (started == 0) {
+        fprintf(stderr, "Could not start the workers\n");
+        goto cleanup;
+    }
+
+    end = write_chunks(&job, file, offsets);
+
+    if (end == 0) {
+        // Let the workers go, their chunks will never be written
+        pthread_mutex_lock(&job.lock);
+        job.failed = true;
+        pthread_cond_broadcast(&job.changed);
+        pthread_mutex_unlock(&job.lock);
+    }
+
+    for (size_t i = 0; i < started; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    wall_us = time_us_64() - start_us;
+
+    if (end == 0)
+        goto write_failed;
+
+    header.index_offset = end;
+
+    if (write_index(file, offsets, header.block_count) < 0 ||
+        write_show_header(file, &header) < 0)
+        goto write_failed;
+
+    frame_count = header.frame_count ? header.frame_count : 1;
+    raw_size = frame_count * 3 * options->led_count;
+    fprintf(stderr,
+            "%u frames on %u threads in %.2f s, %.0f frames/s, %.1fx "
+            "realtime\n",
+            (unsigned)header.frame_count, (unsigned)started, wall_us / 1e6,
+            wall_us ? header.frame_count * 1e6 / wall_us : 0.0,
+            wall_us ? (header.frame_count * 1e9 / header.frame_rate_mhz) /
+                          wall_us
+                    : 0.0);
+    fprintf(stderr, "%llu bytes in %u blocks, %.1f%% of the raw frames\n",
+            (unsigned long long)(end + 8ull * header.block_count),
+            (unsigned)header.block_count, end * 100.0 / raw_size);
+
+    status = 1;
+    goto cleanup;
+
+write_failed:
+    fprintf(stderr, "Could not write %s\n", options->output_path);
+
+cleanup:
+    if (file != NULL)
+        fclose(file);
+
+    for (size_t i = 0; i < worker_count; i++)
+        deinit_worker(&workers[i]);
+
+    for (size_t i = 0; job.slots != NULL && i < job.slot_count; i++)
+        free(job.slots[i].bytes);
+
+    free(offsets);
+    free(workers);
+    free(job.slots);
+    pthread_cond_destroy(&job.changed);
+    pthread_mutex_destroy(&job.lock);
+    wav_close(&wav);
+
+    return status;
+}
+
+/**
+ * @brief Show file back to the frame file of the simulator, to compare the
+ * two or feed the tools that read frame files.
+ */
+static int unpack(const options_t *options) {
+    show_reader_t reader;
+    struct stat status;
+    uint8_t header[FRAME_FILE_HEADER_SIZE], *frame = NULL;
+    const uint32_t *pixels;
+    uint32_t frame_count = 0;
+    void *map = MAP_FAILED;
+    size_t size = 0, led_count;
+    FILE *file = NULL;
+    int result = -1, fd = open(options->input_path, O_RDONLY);
+
+    if (fd >= 0 && fstat(fd, &status) == 0 && status.st_size > 0) {
+        size = (size_t)status.st_size;
+        map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    if (fd >= 0)
+        close(fd);
+
+    if (map == MAP_FAILED || show_reader_init(&reader, NULL, map, size) < 0) {
+        fprintf(stderr, "Could not read %s as a show\n", options->input_path);
+
+        if (map != MAP_FAILED)
+            munmap(map, size);
+
+        return -1;
+    }
+
+    led_count = reader.header.led_count;
+    frame = malloc(3 * led_count);
+    file = fopen(options->output_path, "wb");
+
+    if (frame == NULL || file == NULL)
+        goto write_failed;
+
+    memcpy(header, FRAME_FILE_MAGIC, 4);
+    write_u32(header + 4, (uint32_t)led_count);
+    write_u32(header + 8, reader.header.frame_rate_mhz);
+    write_u32(header + 12, reader.header.frame_count);
+
+    if (fwrite(header, sizeof(header), 1, file) != 1)
+        goto write_failed;
+
+    while ((pixels = show_reader_next(&reader)) != NULL) {
+        for (size_t i = 0; i < led_count; i++) {
+            frame[3 * i + 0] = (uint8_t)(pixels[i] >> 24);
+            frame[3 * i + 1] = (uint8_t)(pixels[i] >> 16);
+            frame[3 * i + 2] = (uint8_t)(pixels[i] >> 8);
+        }
+
+        if (fwrite(frame, 3, led_count, file) != led_count)
+            goto write_failed;
+
+        frame_count++;
+    }
+
+    if (frame_count != reader.header.frame_count) {
+        fprintf(stderr, "%s is corrupt past frame %u\n", options->input_path,
+                (unsigned)frame_count);
+        goto cleanup;
+    }
+
+    result = 1;
+    goto cleanup;
+
+write_failed:
+    fprintf(stderr, "Could not write %s\n", options->output_path);
+
+cleanup:
+    if (file != NULL)
+        fclose(file);
+
+    free(frame);
+    show_reader_deinit(&reader);
+    munmap(map, size);
+
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    options_t options;
+
+    if (parse_options(&options, argc, argv) < 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (options.unpack)
+        return unpack(&options) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    return render(&options) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
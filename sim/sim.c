@@ -0,0 +1,672 @@
+/**
+ * Host simulator of the light painting pipeline. Streams a WAV file through
+ * the exact firmware path and dumps every LED frame.
+ *
+ * Frame file layout, all integers little endian:
+ *
+ *  offset  size  field
+ *  0       4     magic "LPFR"
+ *  4       4     LED count
+ *  8       4     frame rate in mHz
+ *  12      4     frame count
+ *  16      ...   frames, LED count x (g, r, b) bytes each
+ */
+
+#include "audio.h"
+#include "bands.h"
+#include "chrome_trace.h"
+#include "output.h"
+#include "parse.h"
+#include "pipeline.h"
+#include "renderer.h"
+#include "trace.h"
+#include "wav.h"
+
+#include <getopt.h>
+#include <pico/stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_AUDIO_SAMPLE_COUNT 64
+#define DEFAULT_LED_COUNT 300
+#define DEFAULT_GAIN 1.5f
+#define DEFAULT_BAND_COUNT 32
+#define DEFAULT_MIN_HZ 40.f
+#define DEFAULT_MAX_HZ 16000.f
+
+#define FRAME_FILE_MAGIC "LPFR"
+#define FRAME_FILE_HEADER_SIZE 16
+
+typedef struct {
+    const char *input_path;
+    const char *output_path;
+    // Chrome trace of every stage, NULL for none
+    const char *trace_path;
+    size_t audio_sample_count;
+    size_t hop_count;
+    size_t led_count;
+    audio_engine_t engine;
+    audio_window_t window;
+    fft_kernel_t kernel;
+    fft_output_mode_t output;
+    float floor_db;
+    bands_spacing_t spacing;
+    size_t band_count;
+    float gain;
+    // Gamma, brightness and current limit, untouched pixels by default
+    output_config_t output_config;
+    renderer_kind_t renderer;
+    // Hops between switches to the next renderer, 0 to stay on one
+    size_t switch_interval;
+    // Front end and FFT on two threads, like the two cores of the firmware
+    bool pipelined;
+} options_t;
+
+typedef struct {
+    FILE *file;
+    output_t *output;
+    uint32_t *pixels;
+    uint8_t *frame;
+    size_t led_count;
+    uint32_t frame_count;
+    bool failed;
+} frame_writer_t;
+
+typedef struct {
+    uint32_t frame_count;
+    uint64_t front_end_us;
+    uint64_t back_end_us;
+    uint64_t latency_us;
+    uint64_t max_latency_us;
+} stats_t;
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-n samples] [-h hop] [-l leds] [-e float|q15|q31|goertzel] "
+            "[-w rect|hann|blackman-harris|flat-top] "
+            "[-k radix2|radix4|split|staged|planar] "
+            "[-o magnitude|power|approx|log] [-f floor_db] "
+            "[-s log|octave|third|mel] [-b bands] [-g gain] [-p] "
+            "[-G gamma] [-L brightness] [-C budget_ma] [-t trace.json] "
+            "[-r spectrum|mirror|vu|pulse] [-R hops] "
+            "<input.wav> <output.lpf>\n",
+            name);
+}
+
+static int parse_options(options_t *options, int argc, char *argv[]) {
+    unsigned long brightness;
+    int option;
+
+    *options = (options_t){
+        .audio_sample_count = DEFAULT_AUDIO_SAMPLE_COUNT,
+        .led_count = DEFAULT_LED_COUNT,
+        .engine = AUDIO_ENGINE_Q15,
+        .window = AUDIO_WINDOW_HANN,
+        .kernel = FFT_KERNEL_RADIX2,
+        .output = FFT_OUTPUT_MAGNITUDE,
+        .floor_db = FFT_OUTPUT_DEFAULT_FLOOR_DB,
+        .spacing = BANDS_SPACING_MEL,
+        .band_count = DEFAULT_BAND_COUNT,
+        .gain = DEFAULT_GAIN,
+        .output_config = output_default_config(),
+        .renderer = RENDERER_SPECTRUM,
+    };
+
+    while ((option = getopt(argc, argv,
+                            "n:h:l:e:w:k:o:f:s:b:g:pG:L:C:t:r:R:")) != -1) {
+        switch (option) {
+        case 'n':
+            options->audio_sample_count = strtoul(optarg, NULL, 0);
+            break;
+        case 'h':
+            options->hop_count = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            options->led_count = strtoul(optarg, NULL, 0);
+            break;
+        case 'e':
+            if (parse_engine(optarg, &options->engine) < 0)
+                return -1;
+            break;
+        case 'w':
+            if (parse_window(optarg, &options->window) < 0)
+                return -1;
+            break;
+        case 'k':
+            if (parse_kernel(optarg, &options->kernel) < 0)
+                return -1;
+            break;
+        case 'o':
+            if (parse_output(optarg, &options->output) < 0)
+                return -1;
+            break;
+        case 'f':
+            options->floor_db = strtof(optarg, NULL);
+            break;
+        case 's':
+            if (parse_spacing(optarg, &options->spacing) < 0)
+                return -1;
+            break;
+        case 'b':
+            options->band_count = strtoul(optarg, NULL, 0);
+            break;
+        case 'g':
+            options->gain = strtof(optarg, NULL);
+            break;
+        case 'p':
+            options->pipelined = true;
+            break;
+        case 'G':
+            options->output_config.gamma_r = strtof(optarg, NULL);
+            options->output_config.gamma_g = options->output_config.gamma_r;
+            options->output_config.gamma_b = options->output_config.gamma_r;
+            break;
+        case 'L':
+            brightness = strtoul(optarg, NULL, 0);
+            if (brightness > 255)
+                return -1;
+            options->output_config.brightness = (uint8_t)brightness;
+            break;
+        case 'C':
+            options->output_config.budget_ma = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            options->trace_path = optarg;
+            break;
+        case 'r':
+            if (renderer_find(optarg, &options->renderer) < 0)
+                return -1;
+            break;
+        case 'R':
+            options->switch_interval = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    if (argc - optind != 2)
+        return -1;
+
+    // Power of two windows only
+    if (options->audio_sample_count < 4 ||
+        (options->audio_sample_count & (options->audio_sample_count - 1)) != 0)
+        return -1;
+
+    // Defaults to no overlap
+    if (options->hop_count == 0)
+        options->hop_count = options->audio_sample_count;
+
+    if (options->audio_sample_count % options->hop_count != 0)
+        return -1;
+
+    // What the renderers index their tables with
+    if (options->led_count == 0 || options->led_count > UINT16_MAX)
+        return -1;
+
+    if (!(options->floor_db < 0.f))
+        return -1;
+
+    options->input_path = argv[optind];
+    options->output_path = argv[optind + 1];
+
+    return 1;
+}
+
+/**
+ * @brief Lay a signed 24-bit sample out the way the i2s PIO program shifts
+ * it in: one idle bit, 24 data bits MSB first, 7 padding bits.
+ */
+static inline int32_t to_i2s_word(int32_t sample) {
+    return (int32_t)(((uint32_t)sample << 7) & 0x7FFFFF80u);
+}
+
+static void write_u32(uint8_t *bytes, uint32_t value) {
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+static int write_header(FILE *file, const options_t *options,
+                        uint32_t frame_rate_mhz, uint32_t frame_count) {
+    uint8_t header[FRAME_FILE_HEADER_SIZE];
+
+    memcpy(header, FRAME_FILE_MAGIC, 4);
+    write_u32(header + 4, (uint32_t)options->led_count);
+    write_u32(header + 8, frame_rate_mhz);
+    write_u32(header + 12, frame_count);
+
+    if (fseek(file, 0, SEEK_SET) != 0)
+        return -1;
+
+    return fwrite(header, sizeof(header), 1, file) == 1 ? 1 : -1;
+}
+
+static void pack_frame(uint8_t *frame, const uint32_t *pixels, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        // GRB in the top three bytes, see color_neopixel_t
+        frame[3 * i + 0] = (uint8_t)(pixels[i] >> 24);
+        frame[3 * i + 1] = (uint8_t)(pixels[i] >> 16);
+        frame[3 * i + 2] = (uint8_t)(pixels[i] >> 8);
+    }
+}
+
+static void write_frame(frame_writer_t *writer) {
+    if (writer->failed)
+        return;
+
+    pack_frame(writer->frame, writer->pixels, writer->led_count);
+
+    if (fwrite(writer->frame, 3, writer->led_count, writer->file) !=
+        writer->led_count) {
+        writer->failed = true;
+        return;
+    }
+
+    writer->frame_count++;
+}
+
+static uint32_t *acquire_pixels(void *context) {
+    return ((frame_writer_t *)context)->pixels;
+}
+
+/**
+ * @brief Through the output stage and out to the file, writing the frame
+ * stands in for the LED transmission so the trace covers sound to light
+ * the way the firmware does.
+ */
+static void present_pixels(void *context) {
+    frame_writer_t *writer = context;
+
+    output_apply(writer->output, writer->pixels, writer->led_count);
+
+    TRACE(trace_event(TRACE_TRANSMIT_BEGIN));
+    write_frame(writer);
+    TRACE(trace_event(TRACE_TRANSMIT_END));
+    TRACE(trace_latency(trace_frame()));
+}
+
+/**
+ * @brief Empty the trace ring into trace, or nowhere without one. Once per
+ * hop, well before it wraps.
+ */
+static void drain_trace(chrome_trace_t *trace) {
+    trace_record_t records[64];
+    size_t count;
+
+    while ((count = trace_read(records, 64)) > 0)
+        if (trace != NULL)
+            chrome_trace_write(trace, records, count);
+}
+
+/**
+ * @brief A hop just came in, the sim has no capture interrupt to stamp it.
+ */
+static void trace_capture() {
+    trace_begin_frame(time_us_32());
+    trace_event(TRACE_CAPTURE);
+}
+
+/**
+ * @brief Switch to the next renderer every switch_interval hops, from the
+ * thread reading the WAV. Pipelined, core1 picks the switch up at whichever
+ * frame it draws next, the way a switch from core0 lands on the firmware.
+ */
+static void cycle_renderer(const options_t *options,
+                           renderer_set_t *renderers, size_t hop) {
+    if (options->switch_interval == 0 || hop % options->switch_interval != 0)
+        return;
+
+    renderer_set_select(
+        renderers,
+        (renderer_kind_t)((renderer_set_selected(renderers) + 1) %
+                          RENDERER_COUNT));
+}
+
+/**
+ * @brief Every stage back to back on the calling thread, the way the
+ * firmware runs on a single core.
+ */
+static void run_serial(const options_t *options, wav_t *wav, audio_t *audio,
+                       bands_t *bands, renderer_set_t *renderers,
+                       int32_t *i2s_words, frame_writer_t *writer,
+                       chrome_trace_t *trace, stats_t *stats) {
+    size_t hop = 0;
+
+    while (wav_read_mono_24(wav, i2s_words, options->hop_count) ==
+               options->hop_count &&
+           !writer->failed) {
+        uint64_t start, front_end_end, end;
+
+        for (size_t i = 0; i < options->hop_count; i++)
+            i2s_words[i] = to_i2s_word(i2s_words[i]);
+
+        cycle_renderer(options, renderers, ++hop);
+
+        TRACE(trace_capture());
+        start = time_us_64();
+        TRACE(trace_event(TRACE_FRONT_END_BEGIN));
+
+        audio_feed_i2s(audio, i2s_words, options->gain);
+
+        TRACE(trace_event(TRACE_FRONT_END_END));
+        front_end_end = time_us_64();
+        TRACE(trace_event(TRACE_FFT_BEGIN));
+
+        audio_fft(audio);
+
+        TRACE(trace_event(TRACE_FFT_END));
+        TRACE(trace_event(TRACE_MAP_BEGIN));
+
+        if (bands != NULL) {
+            bands_aggregate(bands, audio_get_frequency_bins(audio));
+            renderer_set_render(renderers, bands_get(bands), writer->pixels);
+        } else {
+            renderer_set_render(renderers, audio_get_frequency_bins(audio),
+                                writer->pixels);
+        }
+
+        TRACE(trace_event(TRACE_MAP_END));
+        TRACE(trace_event(TRACE_LED_SWAP));
+
+        present_pixels(writer);
+
+        end = time_us_64();
+        stats->front_end_us += front_end_end - start;
+        stats->back_end_us += end - front_end_end;
+        stats->latency_us += end - start;
+
+        if (end - start > stats->max_latency_us)
+            stats->max_latency_us = end - start;
+
+        drain_trace(trace);
+    }
+
+    stats->frame_count = writer->frame_count;
+}
+
+/**
+ * @brief Front end on this thread, FFT, mapping and frame output on the
+ * core1 thread of the pipeline.
+ */
+static int run_pipelined(const options_t *options, wav_t *wav,
+                         audio_t *audio, bands_t *bands,
+                         renderer_set_t *renderers, int32_t *i2s_words,
+                         frame_writer_t *writer, chrome_trace_t *trace,
+                         stats_t *stats) {
+    size_t hop = 0;
+    pipeline_t pipeline;
+    pipeline_sink_t sink = {
+        .acquire_pixels = acquire_pixels,
+        .present_pixels = present_pixels,
+        .context = writer,
+    };
+
+    if (pipeline_init(&pipeline, NULL, audio, bands, options->gain,
+                      renderers, &sink) < 0)
+        return -1;
+
+    pipeline_start(&pipeline);
+
+    while (wav_read_mono_24(wav, i2s_words, options->hop_count) ==
+           options->hop_count) {
+        for (size_t i = 0; i < options->hop_count; i++)
+            i2s_words[i] = to_i2s_word(i2s_words[i]);
+
+        cycle_renderer(options, renderers, ++hop);
+
+        TRACE(trace_capture());
+        pipeline_submit(&pipeline, i2s_words);
+        drain_trace(trace);
+    }
+
+    pipeline_stop(&pipeline);
+    drain_trace(trace);
+
+    *stats = (stats_t){
+        .frame_count = pipeline.frame_count,
+        .front_end_us = pipeline.front_end_us,
+        .back_end_us = pipeline.back_end_us,
+        .latency_us = pipeline.latency_us,
+        .max_latency_us = pipeline.max_latency_us,
+    };
+
+    pipeline_deinit(&pipeline);
+
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    options_t options;
+    wav_t wav;
+    audio_t audio;
+    bands_t bands, *active_bands = NULL;
+    bands_config_t bands_config;
+    float *centers_hz;
+    size_t center_count;
+    int init_status;
+    frame_writer_t writer = {0};
+    output_t output;
+    bool has_output = false;
+    renderer_set_t renderers;
+    renderer_geometry_t geometry;
+    bool has_renderers = false;
+    chrome_trace_t trace_file, *trace = NULL;
+    trace_summary_t summary;
+    stats_t stats = {0};
+    int32_t *i2s_words = NULL;
+    uint32_t frame_rate_mhz;
+    uint64_t start, wall_us;
+    double frame_count;
+    int status = EXIT_FAILURE;
+
+    if (parse_options(&options, argc, argv) < 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (options.trace_path != NULL && !TRACE_ENABLED) {
+        fprintf(stderr, "Built without LIGHT_PAINTING_TRACE\n");
+        return EXIT_FAILURE;
+    }
+
+    TRACE(trace_init());
+
+    if (wav_open(&wav, options.input_path) < 0) {
+        fprintf(stderr, "Could not open %s as WAV\n", options.input_path);
+        return EXIT_FAILURE;
+    }
+
+    bands_config = (bands_config_t){
+        .spacing = options.spacing,
+        .band_count = options.band_count,
+        .min_hz = DEFAULT_MIN_HZ,
+        .max_hz = wav.sample_rate / 2.f < DEFAULT_MAX_HZ ? wav.sample_rate / 2.f
+                                                         : DEFAULT_MAX_HZ,
+        .sample_rate = (float)wav.sample_rate,
+    };
+
+    if (options.engine == AUDIO_ENGINE_GOERTZEL) {
+        // One target per band, the bins are the bands
+        center_count = bands_centers(&bands_config, NULL);
+        centers_hz = malloc((center_count ? center_count : 1) * sizeof(float));
+        init_status = centers_hz == NULL
+                          ? -1
+                          : audio_init_goertzel(
+                                &audio, NULL, options.audio_sample_count,
+                                options.hop_count, options.window, centers_hz,
+                                bands_centers(&bands_config, centers_hz),
+                                (float)wav.sample_rate);
+        free(centers_hz);
+    } else {
+        init_status =
+            audio_init_stft(&audio, NULL, options.audio_sample_count,
+                            options.hop_count, options.engine, options.window);
+    }
+
+    if (init_status < 0) {
+        fprintf(stderr, "Could not initialize audio\n");
+        wav_close(&wav);
+        return EXIT_FAILURE;
+    }
+
+    if (audio_set_kernel(&audio, options.kernel) < 0) {
+        fprintf(stderr, "Only the float engine has that kernel\n");
+        audio_deinit(&audio);
+        wav_close(&wav);
+        return EXIT_FAILURE;
+    }
+
+    audio_set_output(&audio, options.output, options.floor_db);
+
+    bands_config.bin_count = audio_get_frequency_bin_count(&audio);
+
+    if (options.engine != AUDIO_ENGINE_GOERTZEL) {
+        if (bands_init(&bands, NULL, &bands_config) < 0) {
+            fprintf(stderr, "Could not initialize bands\n");
+            audio_deinit(&audio);
+            wav_close(&wav);
+            return EXIT_FAILURE;
+        }
+
+        active_bands = &bands;
+    }
+
+    if (output_init(&output, NULL, &options.output_config) < 0) {
+        fprintf(stderr, "Could not initialize the output stage\n");
+        goto cleanup;
+    }
+
+    has_output = true;
+
+    // The Goertzel bins are the bands
+    geometry = (renderer_geometry_t){
+        .pixel_count = options.led_count,
+        .band_count = active_bands != NULL
+                          ? bands_get_count(active_bands)
+                          : audio_get_frequency_bin_count(&audio),
+    };
+
+    if (renderer_set_init(&renderers, NULL, &geometry) < 0) {
+        fprintf(stderr, "Could not initialize the renderers\n");
+        goto cleanup;
+    }
+
+    has_renderers = true;
+    renderer_set_select(&renderers, options.renderer);
+
+    i2s_words = calloc(options.hop_count, sizeof(int32_t));
+    writer.output = &output;
+    writer.led_count = options.led_count;
+    writer.pixels = calloc(options.led_count, sizeof(uint32_t));
+    writer.frame = calloc(options.led_count, 3);
+    writer.file = fopen(options.output_path, "wb");
+
+    if (i2s_words == NULL || writer.pixels == NULL || writer.frame == NULL ||
+        writer.file == NULL) {
+        fprintf(stderr, "Could not set up the simulation\n");
+        goto cleanup;
+    }
+
+    if (options.trace_path != NULL) {
+        if (chrome_trace_open(&trace_file, options.trace_path) < 0) {
+            fprintf(stderr, "Could not open %s\n", options.trace_path);
+            goto cleanup;
+        }
+
+        trace = &trace_file;
+    }
+
+    // One frame per hop, exactly like the firmware
+    frame_rate_mhz =
+        (uint32_t)((uint64_t)wav.sample_rate * 1000u / options.hop_count);
+
+    // Placeholder, the frame count gets patched in at the end
+    if (write_header(writer.file, &options, frame_rate_mhz, 0) < 0)
+        goto cleanup;
+
+    start = time_us_64();
+
+    if (options.pipelined) {
+        if (run_pipelined(&options, &wav, &audio, active_bands, &renderers,
+                          i2s_words, &writer, trace, &stats) < 0) {
+            fprintf(stderr, "Could not set up the pipeline\n");
+            goto cleanup;
+        }
+    } else {
+        run_serial(&options, &wav, &audio, active_bands, &renderers, i2s_words,
+                   &writer, trace, &stats);
+    }
+
+    wall_us = time_us_64() - start;
+
+    if (writer.failed ||
+        write_header(writer.file, &options, frame_rate_mhz,
+                     writer.frame_count) < 0) {
+        fprintf(stderr, "Could not write %s\n", options.output_path);
+        goto cleanup;
+    }
+
+    // Wall clock covers WAV decoding and frame output too, in both modes, so
+    // the throughput of the serial and pipelined runs compare directly
+    frame_count = stats.frame_count ? stats.frame_count : 1;
+    fprintf(stderr, "%u frames, %.2f us/frame, %.1fx realtime\n",
+            (unsigned)stats.frame_count, wall_us / frame_count,
+            wall_us ? (stats.frame_count * 1e9 / frame_rate_mhz) / wall_us
+                    : 0.0);
+    fprintf(stderr,
+            "front end %.2f us, back end %.2f us, latency %.2f us mean, "
+            "%u us max\n",
+            stats.front_end_us / frame_count, stats.back_end_us / frame_count,
+            stats.latency_us / frame_count, (unsigned)stats.max_latency_us);
+
+    if (options.output_config.budget_ma != 0)
+        fprintf(stderr, "%u frames limited to %u mA, last one drew %u mA\n",
+                (unsigned)output.limited_count,
+                (unsigned)options.output_config.budget_ma,
+                (unsigned)output.current_ma);
+
+    if (trace != NULL) {
+        trace_summarize(&summary);
+        trace = NULL;
+
+        fprintf(stderr,
+                "sound to light p50 %u us, p90 %u us, p99 %u us, %u us max, "
+                "%u trace records lost\n",
+                summary.latency_p50_us, summary.latency_p90_us,
+                summary.latency_p99_us, summary.latency_max_us,
+                summary.counters[TRACE_COUNTER_LOST]);
+
+        if (chrome_trace_close(&trace_file, &summary) < 0) {
+            fprintf(stderr, "Could not write %s\n", options.trace_path);
+            goto cleanup;
+        }
+    }
+
+    status = EXIT_SUCCESS;
+
+cleanup:
+    if (trace != NULL)
+        chrome_trace_close(trace, &(trace_summary_t){0});
+
+    if (writer.file != NULL)
+        fclose(writer.file);
+
+    free(writer.frame);
+    free(writer.pixels);
+    free(i2s_words);
+    if (has_renderers)
+        renderer_set_deinit(&renderers);
+    if (has_output)
+        output_deinit(&output);
+    if (active_bands != NULL)
+        bands_deinit(active_bands);
+
+    audio_deinit(&audio);
+    wav_close(&wav);
+
+    return status;
+}
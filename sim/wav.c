@@ -0,0 +1,283 @@
+#include "wav.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WAV_FORMAT_PCM 0x0001
+#define WAV_FORMAT_FLOAT 0x0003
+#define WAV_FORMAT_EXTENSIBLE 0xFFFE
+
+#define SCRATCH_SIZE 4096
+
+static inline uint16_t read_u16(const uint8_t *bytes) {
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+static inline uint32_t read_u32(const uint8_t *bytes) {
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+           ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static bool parse_format(wav_t *this, const uint8_t *chunk, uint32_t size) {
+    if (size < 16)
+        return false;
+
+    this->format = read_u16(chunk);
+    this->channel_count = read_u16(chunk + 2);
+    this->sample_rate = read_u32(chunk + 4);
+    this->bits_per_sample = read_u16(chunk + 14);
+
+    // The actual format hides in the first two bytes of the sub-format GUID
+    if (this->format == WAV_FORMAT_EXTENSIBLE && size >= 26)
+        this->format = read_u16(chunk + 24);
+
+    if (this->channel_count == 0)
+        return false;
+
+    if (this->format == WAV_FORMAT_PCM)
+        return this->bits_per_sample == 16 || this->bits_per_sample == 24 ||
+               this->bits_per_sample == 32;
+
+    if (this->format == WAV_FORMAT_FLOAT)
+        return this->bits_per_sample == 32;
+
+    return false;
+}
+
+int wav_open(wav_t *this, const char *path) {
+    uint8_t header[12], chunk_header[8], format[40];
+    bool has_format = false;
+
+    *this = (wav_t){0};
+    this->file = fopen(path, "rb");
+
+    if (this->file == NULL)
+        return -1;
+
+    if (fread(header, 1, sizeof(header), this->file) != sizeof(header) ||
+        memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0)
+        goto fail;
+
+    // Walk the chunks until the samples show up
+    while (fread(chunk_header, 1, sizeof(chunk_header), this->file) ==
+           sizeof(chunk_header)) {
+        uint32_t size = read_u32(chunk_header + 4);
+
+        if (memcmp(chunk_header, "fmt ", 4) == 0) {
+            uint32_t kept = size < sizeof(format) ? size : sizeof(format);
+
+            if (fread(format, 1, kept, this->file) != kept)
+                goto fail;
+
+            if (!parse_format(this, format, kept))
+                goto fail;
+
+            // Chunks are padded to even sizes
+            if (fseek(this->file, (long)(size - kept + (size & 1)),
+                      SEEK_CUR) != 0)
+                goto fail;
+
+            has_format = true;
+        } else if (memcmp(chunk_header, "data", 4) == 0) {
+            if (!has_format)
+                goto fail;
+
+            this->frame_count =
+                size / (this->channel_count * (this->bits_per_sample / 8));
+            this->frames_left = this->frame_count;
+
+            return 1;
+        } else if (fseek(this->file, (long)(size + (size & 1)), SEEK_CUR) !=
+                   0) {
+            goto fail;
+        }
+    }
+
+fail:
+    fclose(this->file);
+    this->file = NULL;
+    return -1;
+}
+
+int wav_map(wav_t *this, const char *path) {
+    const uint8_t *chunk;
+    struct stat status;
+    bool has_format = false;
+    size_t left, padded;
+    int fd = open(path, O_RDONLY);
+
+    *this = (wav_t){0};
+
+    if (fd < 0)
+        return -1;
+
+    if (fstat(fd, &status) != 0 || status.st_size < 12) {
+        close(fd);
+        return -1;
+    }
+
+    this->map_size = (size_t)status.st_size;
+    this->map = mmap(NULL, this->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping holds on to the file by itself
+    close(fd);
+
+    if (this->map == MAP_FAILED) {
+        this->map = NULL;
+        return -1;
+    }
+
+    chunk = this->map;
+
+    if (memcmp(chunk, "RIFF", 4) != 0 || memcmp(chunk + 8, "WAVE", 4) != 0)
+        goto fail;
+
+    chunk += 12;
+    left = this->map_size - 12;
+
+    // Same walk as wav_open, over memory
+    while (left >= 8) {
+        size_t size = read_u32(chunk + 4);
+
+        left -= 8;
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            if (size > left || !parse_format(this, chunk + 8, (uint32_t)size))
+                goto fail;
+
+            has_format = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!has_format)
+                goto fail;
+
+            // Keep what made it to disk of a truncated file
+            if (size > left)
+                size = left;
+
+            this->data = chunk + 8;
+            this->frame_count =
+                size / (this->channel_count * (this->bits_per_sample / 8));
+            this->frames_left = this->frame_count;
+
+            return 1;
+        }
+
+        padded = size + (size & 1);
+
+        if (padded > left)
+            goto fail;
+
+        chunk += 8 + padded;
+        left -= padded;
+    }
+
+fail:
+    munmap(this->map, this->map_size);
+    this->map = NULL;
+    return -1;
+}
+
+static int32_t decode_24(const wav_t *this, const uint8_t *bytes) {
+    float value;
+
+    switch (this->bits_per_sample) {
+    case 16:
+        return (int32_t)(int16_t)read_u16(bytes) * (1 << 8);
+    case 24:
+        // Sign extend from the top byte
+        return (int32_t)((uint32_t)bytes[0] << 8 | (uint32_t)bytes[1] << 16 |
+                         (uint32_t)bytes[2] << 24) >>
+               8;
+    default:
+        if (this->format == WAV_FORMAT_FLOAT) {
+            memcpy(&value, bytes, sizeof(value));
+            value = fmaxf(-1.f, fminf(1.f, value));
+            return (int32_t)lrintf(value * 0x7FFFFF);
+        }
+
+        return (int32_t)read_u32(bytes) >> 8;
+    }
+}
+
+static void mix_to_mono(const wav_t *this, const uint8_t *bytes,
+                        size_t frame_count, int32_t *samples) {
+    size_t sample_bytes = this->bits_per_sample / 8;
+    size_t frame_bytes = sample_bytes * this->channel_count;
+
+    for (size_t frame = 0; frame < frame_count; frame++) {
+        int64_t sum = 0;
+
+        for (size_t channel = 0; channel < this->channel_count; channel++)
+            sum += decode_24(this, bytes + frame * frame_bytes +
+                                       channel * sample_bytes);
+
+        samples[frame] = (int32_t)(sum / this->channel_count);
+    }
+}
+
+size_t wav_read_mono_24(wav_t *this, int32_t *samples, size_t count) {
+    uint8_t scratch[SCRATCH_SIZE];
+    size_t frame_bytes = this->bits_per_sample / 8 * this->channel_count;
+    size_t frames_per_chunk = sizeof(scratch) / frame_bytes;
+    size_t total = 0;
+
+    if (this->data != NULL) {
+        total = wav_read_mono_24_at(
+            this, this->frame_count - this->frames_left, samples, count);
+        this->frames_left -= total;
+
+        return total;
+    }
+
+    if (count > this->frames_left)
+        count = this->frames_left;
+
+    while (total < count) {
+        size_t wanted = count - total, read;
+
+        if (wanted > frames_per_chunk)
+            wanted = frames_per_chunk;
+
+        read = fread(scratch, frame_bytes, wanted, this->file);
+        mix_to_mono(this, scratch, read, samples + total);
+        total += read;
+
+        if (read < wanted)
+            break;
+    }
+
+    this->frames_left -= total;
+
+    return total;
+}
+
+size_t wav_read_mono_24_at(const wav_t *this, size_t first, int32_t *samples,
+                           size_t count) {
+    size_t frame_bytes = this->bits_per_sample / 8 * this->channel_count;
+
+    if (this->data == NULL || first >= this->frame_count)
+        return 0;
+
+    if (count > this->frame_count - first)
+        count = this->frame_count - first;
+
+    mix_to_mono(this, this->data + first * frame_bytes, count, samples);
+
+    return count;
+}
+
+void wav_close(wav_t *this) {
+    if (this->file != NULL)
+        fclose(this->file);
+
+    if (this->map != NULL)
+        munmap(this->map, this->map_size);
+
+    this->file = NULL;
+    this->map = NULL;
+    this->data = NULL;
+}
@@ -0,0 +1,46 @@
+#ifndef WAV_H
+#define WAV_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Minimal WAV reader. Integer PCM (16/24/32-bit) and 32-bit float, any
+ * channel count, mixed down to mono on read. Either streamed off the file or
+ * mapped whole, a mapped one also reads at random from any number of threads.
+ */
+typedef struct {
+    FILE *file;
+    // Start of the samples when mapped, NULL when streamed
+    const uint8_t *data;
+    void *map;
+    size_t map_size;
+    uint32_t sample_rate;
+    uint16_t channel_count;
+    uint16_t bits_per_sample;
+    uint16_t format;
+    // Frames left in the data chunk
+    size_t frames_left;
+    size_t frame_count;
+} wav_t;
+
+int wav_open(wav_t *this, const char *path);
+int wav_map(wav_t *this, const char *path);
+
+/**
+ * @brief Read up to count frames, mixed down to mono signed 24-bit.
+ *
+ * @return size_t Frames actually read, 0 at the end of the stream
+ */
+size_t wav_read_mono_24(wav_t *this, int32_t *samples, size_t count);
+
+/**
+ * @brief Same from any frame on, mapped files only. Leaves the stream
+ * position alone.
+ */
+size_t wav_read_mono_24_at(const wav_t *this, size_t first, int32_t *samples,
+                           size_t count);
+
+void wav_close(wav_t *this);
+
+#endif
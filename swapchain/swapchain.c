@@ -4,39 +4,143 @@
 #define SHARED_INDEX 1
 #define CONSUMER_INDEX 2
 
-static inline void swap_elements(void *arr[], size_t first, size_t second) {
-    void *temp = arr[first];
-    arr[first] = arr[second];
-    arr[second] = temp;
+#define LATEST_INDEX_MASK ((uint32_t)0x3)
+#define LATEST_SEQUENCE_SHIFT 2
+
+// Sequence numbers wrap at 30 bits, differences are taken modulo that
+#define SEQUENCE_MASK ((uint32_t)0x3FFFFFFF)
+
+/**
+ * Sequentially consistent 32-bit loads and stores. Both compile to a plain
+ * ldr/str plus a dmb on the M0+, no interrupt masking and no library call,
+ * and they order each side's store before its subsequent load of the other
+ * side's word.
+ */
+static inline uint32_t load(const uint32_t *word) {
+    return __atomic_load_n(word, __ATOMIC_SEQ_CST);
+}
+
+static inline void store(uint32_t *word, uint32_t value) {
+    __atomic_store_n(word, value, __ATOMIC_SEQ_CST);
 }
 
-int swapchain_init(swapchain_t *this, size_t buffer_size) {
-    void *alloc = malloc(DEFAULT_BUFFER_COUNT * buffer_size);
+static inline uint32_t pack_latest(uint32_t sequence, uint32_t index) {
+    return ((sequence & SEQUENCE_MASK) << LATEST_SEQUENCE_SHIFT) | index;
+}
+
+int swapchain_init(swapchain_t *this, arena_t *arena, size_t buffer_size) {
+    size_t stride = SWAPCHAIN_BUFFER_STRIDE(buffer_size);
+    void *alloc =
+        arena_alloc(arena, DEFAULT_BUFFER_COUNT * stride, ARENA_DMA_ALIGN);
     if (alloc == NULL)
         return -1;
 
-    for (size_t i = 0; i < DEFAULT_BUFFER_COUNT; i++)
-        this->buffer_chain[i] = (void *)((size_t)alloc + (i * buffer_size));
+    for (size_t i = 0; i < DEFAULT_BUFFER_COUNT; i++) {
+        this->buffer_chain[i] = (void *)((size_t)alloc + (i * stride));
+        this->tags[i] = 0;
+    }
 
     this->mem = alloc;
+    this->arena = arena;
+
+    // Nothing published yet, sequence 0 counts as already consumed
+    this->latest = pack_latest(0, SHARED_INDEX);
+    this->reading = CONSUMER_INDEX;
+    this->producer_index = PRODUCER_INDEX;
+    this->producer_sequence = 0;
+    this->consumer_sequence = 0;
+    this->dropped_count = 0;
+    this->reused_count = 0;
+    // No frame to go on with before the first one
+    this->is_reused = true;
 
     return 1;
 }
 
 void *swapchain_producer_buffer(swapchain_t *this) {
-    return this->buffer_chain[PRODUCER_INDEX];
+    return this->buffer_chain[this->producer_index];
 }
 
 void swapchain_producer_swap(swapchain_t *this) {
-    swap_elements(this->buffer_chain, SHARED_INDEX, PRODUCER_INDEX);
+    uint32_t published = this->producer_index, reading, next;
+
+    this->producer_sequence = (this->producer_sequence + 1) & SEQUENCE_MASK;
+    store(&this->latest, pack_latest(this->producer_sequence, published));
+
+    // Any buffer that is neither the one just published nor the one being
+    // read. Reading after the publish guarantees a consumer that claimed
+    // the previous latest is seen, see swapchain_consumer_swap
+    reading = load(&this->reading);
+
+    for (next = 0; next == published || next == reading; next++)
+        ;
+
+    this->producer_index = next;
+}
+
+void swapchain_producer_set_tag(swapchain_t *this, uint32_t tag) {
+    this->tags[this->producer_index] = tag;
 }
 
 const void *swapchain_consumer_buffer(swapchain_t *this) {
-    return this->buffer_chain[CONSUMER_INDEX];
+    return this->buffer_chain[this->reading];
 }
 
-void swapchain_consumer_swap(swapchain_t *this) {
-    swap_elements(this->buffer_chain, SHARED_INDEX, CONSUMER_INDEX);
+bool swapchain_consumer_swap(swapchain_t *this) {
+    uint32_t latest, sequence, missed;
+
+    latest = load(&this->latest);
+    sequence = latest >> LATEST_SEQUENCE_SHIFT;
+
+    if (sequence == this->consumer_sequence) {
+        if (!this->is_reused)
+            this->reused_count++;
+
+        this->is_reused = true;
+        return false;
+    }
+
+    // Claim the buffer, then make sure it was not superseded in between.
+    // If it was, the producer may already be writing into it, so claim the
+    // newer one instead. Only a producer publishing faster than these few
+    // instructions can keep this going
+    for (;;) {
+        store(&this->reading, latest & LATEST_INDEX_MASK);
+
+        uint32_t current = load(&this->latest);
+
+        if (current == latest)
+            break;
+
+        latest = current;
+    }
+
+    sequence = latest >> LATEST_SEQUENCE_SHIFT;
+    missed = (sequence - this->consumer_sequence - 1) & SEQUENCE_MASK;
+    this->dropped_count += missed;
+    this->consumer_sequence = sequence;
+    this->is_reused = false;
+
+    return true;
+}
+
+bool swapchain_consumer_poll(swapchain_t *this) {
+    return load(&this->latest) >> LATEST_SEQUENCE_SHIFT !=
+           this->consumer_sequence;
 }
 
-void swapchain_deinit(swapchain_t *this) { free(this->mem); }
+uint32_t swapchain_consumer_tag(swapchain_t *this) {
+    return this->tags[this->reading];
+}
+
+uint32_t swapchain_dropped_count(swapchain_t *this) {
+    return this->dropped_count;
+}
+
+uint32_t swapchain_reused_count(swapchain_t *this) {
+    return this->reused_count;
+}
+
+void swapchain_deinit(swapchain_t *this) {
+    arena_free(this->arena, this->mem);
+}
@@ -1,26 +1,70 @@
 #ifndef SWAPCHAIN_H
 #define SWAPCHAIN_H
 
+#include "arena.h"
+
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #define DEFAULT_BUFFER_COUNT 3
 #define DEFAULT_RING_SIZE 2
 
+// Every buffer starts on a DMA boundary, the DMA reads and writes them
+#define SWAPCHAIN_BUFFER_STRIDE(buffer_size)                                   \
+    (((size_t)(buffer_size) + ARENA_DMA_ALIGN - 1) &                           \
+     ~(size_t)(ARENA_DMA_ALIGN - 1))
+
+// Arena bytes swapchain_init takes
+#define SWAPCHAIN_FOOTPRINT(buffer_size)                                       \
+    ARENA_FOOTPRINT_ALIGNED(DEFAULT_BUFFER_COUNT *                             \
+                                SWAPCHAIN_BUFFER_STRIDE(buffer_size),          \
+                            ARENA_DMA_ALIGN)
+
+/**
+ * Lock-free triple buffer for exactly one producer and one consumer, each
+ * of which may be an IRQ handler or the other core. Neither side ever
+ * blocks or masks interrupts.
+ *
+ * The Cortex-M0+ has no exclusive load/store, so there is no atomic
+ * exchange to build the usual single state word on. Instead every shared
+ * word has a single writer: the producer publishes the latest finished
+ * buffer along with a sequence number, the consumer publishes the buffer it
+ * is reading. Plain aligned 32-bit loads and stores are atomic, the
+ * consumer re-validates its claim against a concurrent publish.
+ */
 typedef struct {
-    // This amazing quote by Herb Sutter guarantees correct alignment for
-    // arbitrary data.
-    //      "Alignment. Any memory Alignment. Any memory that's allocated
-    //      dynamically via new or malloc is guaranteed to be properly aligned
-    //      for objects of **any type**, but buffers that are not allocated
-    //      dynamically have no such guarantee."
+    // Aligned to ARENA_DMA_ALIGN, so is every buffer
     void *mem;
+    arena_t *arena;
     void *buffer_chain[DEFAULT_BUFFER_COUNT];
+    // Travels with its buffer, written by the producer before the publish
+    uint32_t tags[DEFAULT_BUFFER_COUNT];
+
+    // Written by the producer only, sequence << 2 | buffer index
+    uint32_t latest;
+    // Written by the consumer only, buffer index
+    uint32_t reading;
+
+    // Producer private
+    uint32_t producer_index;
+    uint32_t producer_sequence;
+
+    // Consumer private
+    uint32_t consumer_sequence;
+    // Published frames the consumer never got to see
+    uint32_t dropped_count;
+    // Frames the consumer went on with after they were consumed, once per
+    // frame however often it swaps before the next one is published
+    uint32_t reused_count;
+    // Whether the consumer frame is already counted as reused
+    bool is_reused;
 } swapchain_t;
 
 /**
  * Instantiates a swap-
  */
-int swapchain_init(swapchain_t *this, size_t buffer_size);
+int swapchain_init(swapchain_t *this, arena_t *arena, size_t buffer_size);
 
 /**
  * Producer side
@@ -28,12 +72,40 @@ int swapchain_init(swapchain_t *this, size_t buffer_size);
 void *swapchain_producer_buffer(swapchain_t *this);
 void swapchain_producer_swap(swapchain_t *this);
 
+/**
+ * @brief Attach a word to the producer buffer, the consumer gets it back
+ * along with the buffer. Used to tag frames with their capture time.
+ */
+void swapchain_producer_set_tag(swapchain_t *this, uint32_t tag);
+
 /**
  * Consumer side
  */
 const void *swapchain_consumer_buffer(swapchain_t *this);
-void swapchain_consumer_swap(swapchain_t *this);
+
+/**
+ * @brief Move on to the latest published buffer.
+ *
+ * @return true A new frame arrived since the last swap
+ * @return false Nothing new, the consumer buffer is the same stale frame
+ */
+bool swapchain_consumer_swap(swapchain_t *this);
+
+/**
+ * @brief Whether a frame was published since the last swap, without taking
+ * it or counting anything. For a consumer waiting on the producer.
+ */
+bool swapchain_consumer_poll(swapchain_t *this);
+
+// Tag of the consumer buffer, 0 until anything is published
+uint32_t swapchain_consumer_tag(swapchain_t *this);
+
+/**
+ * Counters, consumer side only
+ */
+uint32_t swapchain_dropped_count(swapchain_t *this);
+uint32_t swapchain_reused_count(swapchain_t *this);
 
 void swapchain_deinit(swapchain_t *this);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,92 @@
+#include "arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+void arena_init(arena_t *this, void *region, size_t size) {
+    *this = (arena_t){
+        .base = region,
+        .size = size,
+    };
+}
+
+static void *heap_alloc(size_t size, size_t align) {
+    if (align <= ARENA_ALIGN)
+        return malloc(size);
+
+    // aligned_alloc wants a whole number of alignments
+    return aligned_alloc(align, align_up(size ? size : 1, align));
+}
+
+void *arena_alloc(arena_t *this, size_t size, size_t align) {
+    size_t start, end;
+
+    if (align < ARENA_ALIGN)
+        align = ARENA_ALIGN;
+
+    if (this == NULL)
+        return heap_alloc(size, align);
+
+    // The region may start anywhere when set up by arena_init
+    start = align_up((size_t)this->base + this->used, align) -
+            (size_t)this->base;
+    end = start + align_up(size, ARENA_ALIGN);
+
+    if (end < start || end > this->size) {
+        this->failed_count++;
+        return NULL;
+    }
+
+    this->used = end;
+
+    if (this->used > this->high_water)
+        this->high_water = this->used;
+
+    return this->base + start;
+}
+
+void *arena_calloc(arena_t *this, size_t size, size_t align) {
+    void *ptr = arena_alloc(this, size, align);
+
+    if (ptr != NULL)
+        memset(ptr, 0, size);
+
+    return ptr;
+}
+
+void arena_free(arena_t *this, void *ptr) {
+    uint8_t *start = ptr;
+
+    if (this == NULL) {
+        free(ptr);
+        return;
+    }
+
+    // The alignment padding before ptr stays until an earlier free
+    if (start == NULL || start < this->base ||
+        start >= this->base + this->used)
+        return;
+
+    this->used = (size_t)(start - this->base);
+}
+
+void arena_reset(arena_t *this) { this->used = 0; }
+
+size_t arena_used(const arena_t *this) { return this->used; }
+
+size_t arena_remaining(const arena_t *this) {
+    return this->size - this->used;
+}
+
+size_t arena_high_water(const arena_t *this) { return this->high_water; }
+
+void arena_print_report(const arena_t *this, const char *name) {
+    printf("Arena %s: %u of %u bytes used, high water %u, %u failed\n", name,
+           (unsigned)this->used, (unsigned)this->size,
+           (unsigned)this->high_water, (unsigned)this->failed_count);
+}
@@ -0,0 +1,82 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Every allocation starts on this boundary, enough for any scalar type
+#define ARENA_ALIGN 8
+// For buffers the DMA walks, the region itself starts on it
+#define ARENA_DMA_ALIGN 32
+
+// Arena bytes an allocation takes, the padding up to ARENA_ALIGN included
+#define ARENA_FOOTPRINT(size)                                                  \
+    (((size_t)(size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+// Same with a stricter alignment, counting the worst case padding to it
+#define ARENA_FOOTPRINT_ALIGNED(size, align)                                   \
+    (ARENA_FOOTPRINT(size) +                                                   \
+     ((size_t)(align) > ARENA_ALIGN ? (size_t)(align) - ARENA_ALIGN : 0))
+
+/**
+ * Bump allocator over a fixed region, everything the firmware allocates at
+ * init comes out of one of these, so the SRAM it takes is known up front and
+ * a failed init cannot fragment anything.
+ *
+ * Memory is given back all at once by arena_reset, or like a stack by
+ * arena_free, which takes back an allocation and everything after it. Enough
+ * for an init to undo itself on failure and for a deinit to hand back what
+ * its init took, latest first.
+ * Not thread safe, only one core may allocate at a time.
+ *
+ * Every function taking an arena also takes NULL, the allocations then go to
+ * the heap and arena_free frees them. The host tools run that way.
+ */
+typedef struct {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    // Most used at any point, survives arena_reset
+    size_t high_water;
+    // Allocations that did not fit
+    uint32_t failed_count;
+} arena_t;
+
+/**
+ * Arena over a statically sized region in .bss, aligned for the DMA.
+ */
+#define ARENA_DEFINE(name, region_size)                                        \
+    static uint8_t name##_region[ARENA_FOOTPRINT(region_size)]                 \
+        __attribute__((aligned(ARENA_DMA_ALIGN)));                             \
+    static arena_t name = {                                                    \
+        .base = name##_region,                                                 \
+        .size = sizeof(name##_region),                                         \
+    }
+
+void arena_init(arena_t *this, void *region, size_t size);
+
+/**
+ * @param align Power of two, ARENA_ALIGN or stricter, e.g. ARENA_DMA_ALIGN
+ * @return void* NULL if it does not fit
+ */
+void *arena_alloc(arena_t *this, size_t size, size_t align);
+// Zeroed
+void *arena_calloc(arena_t *this, size_t size, size_t align);
+
+/**
+ * @brief Takes back ptr and everything allocated after it. NULL and memory
+ * already taken back are ignored.
+ */
+void arena_free(arena_t *this, void *ptr);
+void arena_reset(arena_t *this);
+
+size_t arena_used(const arena_t *this);
+size_t arena_remaining(const arena_t *this);
+size_t arena_high_water(const arena_t *this);
+
+/**
+ * @brief One line of use, high-water mark and failures over stdout.
+ */
+void arena_print_report(const arena_t *this, const char *name);
+
+#endif
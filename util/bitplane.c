@@ -0,0 +1,62 @@
+#include "bitplane.h"
+
+/**
+ * @brief 8x8 bit transpose of two words, Hacker's Delight 7-3 split in 32
+ * bit halves for a core without 64 bit registers. Row r is byte 3 - r of hi
+ * for r < 4 and of lo after, bit 7 of a row is column 0.
+ */
+static inline void transpose_8x8(uint32_t *hi, uint32_t *lo) {
+    uint32_t x = *hi, y = *lo, t;
+
+    t = (x ^ (x >> 7)) & 0x00AA00AAu;
+    x = x ^ t ^ (t << 7);
+    t = (y ^ (y >> 7)) & 0x00AA00AAu;
+    y = y ^ t ^ (t << 7);
+
+    t = (x ^ (x >> 14)) & 0x0000CCCCu;
+    x = x ^ t ^ (t << 14);
+    t = (y ^ (y >> 14)) & 0x0000CCCCu;
+    y = y ^ t ^ (t << 14);
+
+    *hi = (x & 0xF0F0F0F0u) | ((y >> 4) & 0x0F0F0F0Fu);
+    *lo = ((x << 4) & 0xF0F0F0F0u) | (y & 0x0F0F0F0Fu);
+}
+
+/**
+ * @brief One color byte of eight strips into its eight planes. Strip 7 goes
+ * in as row 0, so after the transpose strip s lands on bit s of every plane
+ * and the planes come out MSB first, already packed.
+ */
+static inline void transpose_channel(const uint32_t *p, unsigned shift,
+                                     uint32_t *planes) {
+    uint32_t hi = (p[7] >> shift & 0xFFu) << 24 |
+                  (p[6] >> shift & 0xFFu) << 16 |
+                  (p[5] >> shift & 0xFFu) << 8 | (p[4] >> shift & 0xFFu);
+    uint32_t lo = (p[3] >> shift & 0xFFu) << 24 |
+                  (p[2] >> shift & 0xFFu) << 16 |
+                  (p[1] >> shift & 0xFFu) << 8 | (p[0] >> shift & 0xFFu);
+
+    transpose_8x8(&hi, &lo);
+
+    planes[0] = hi;
+    planes[1] = lo;
+}
+
+void bitplane_transpose(const uint32_t *pixels, size_t stride,
+                        size_t strip_count, size_t count, uint32_t *planes) {
+    // Missing strips read as black
+    uint32_t p[BITPLANE_MAX_STRIPS] = {0};
+
+    if (strip_count > BITPLANE_MAX_STRIPS)
+        strip_count = BITPLANE_MAX_STRIPS;
+
+    for (size_t i = 0; i < count; i++) {
+        for (size_t s = 0; s < strip_count; s++)
+            p[s] = pixels[s * stride + i];
+
+        transpose_channel(p, 24, planes);
+        transpose_channel(p, 16, planes + 2);
+        transpose_channel(p, 8, planes + 4);
+        planes += BITPLANE_WORDS_PER_PIXEL;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef BITPLANE_H
+#define BITPLANE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bit planes for driving up to 8 WS2812 strips in parallel off consecutive
+ * pins. Every bit slot on the wire carries one bit of each strip, so pixel i
+ * of all strips goes out as 24 bytes, one per bit from g7 down to b0, bit s
+ * of each the bit of strip s. The bytes are packed four to a word, first one
+ * on top, the way the parallel PIO program shifts them out.
+ */
+
+#define BITPLANE_MAX_STRIPS 8
+// 24 one byte planes per pixel, four to a word
+#define BITPLANE_WORDS_PER_PIXEL 6
+#define BITPLANE_SIZE(pixel_count)                                             \
+    ((size_t)(pixel_count) * BITPLANE_WORDS_PER_PIXEL * sizeof(uint32_t))
+
+/**
+ * @brief Transpose the first count pixels of every strip into planes.
+ *
+ * @param pixels GRB in the top three bytes (see color_neopixel_t), strip s
+ * starting at pixels + s * stride
+ * @param strip_count Up to BITPLANE_MAX_STRIPS, the pins of the missing
+ * strips stay low
+ * @param planes BITPLANE_WORDS_PER_PIXEL words per pixel
+ */
+void bitplane_transpose(const uint32_t *pixels, size_t stride,
+                        size_t strip_count, size_t count, uint32_t *planes);
+
+#endif
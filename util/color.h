@@ -1,6 +1,8 @@
 #ifndef COLOR_H
 #define COLOR_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 typedef union {
@@ -131,4 +133,128 @@ static color_neopixel_t color_neopixel_add(color_neopixel_t left,
     };
 }
 
+/**
+ * Palettes trade the per pixel color math for a table lookup. The table is
+ * caller owned, 256 entries (1KB) are plenty for a strip, 1024 give smoother
+ * gradients. Build it once, or again whenever the palette should change.
+ */
+#define COLOR_PALETTE_SIZE_SMALL 256
+#define COLOR_PALETTE_SIZE_LARGE 1024
+
+typedef struct {
+    color_neopixel_t *entries;
+    size_t size;
+    // size - 1, maps [0, 1] onto the entries
+    float scale;
+} color_palette_t;
+
+// One gradient stop, position in [0, 1]
+typedef struct {
+    float position;
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} color_stop_t;
+
+static inline void color_palette_init(color_palette_t *this,
+                                      color_neopixel_t *entries, size_t size) {
+    this->entries = entries;
+    this->size = size;
+    this->scale = (float)(size - 1);
+}
+
+/**
+ * @brief Fill the palette with a hue sweep, entry 0 at hue_start and the
+ * last one at hue_end, in degrees.
+ */
+static void color_palette_from_hsv(color_palette_t *this, float hue_start,
+                                   float hue_end, float s, float v) {
+    for (size_t i = 0; i < this->size; i++)
+        this->entries[i] = color_neopixel_from_hsv_f(
+            hue_start + (hue_end - hue_start) * i / this->scale, s, v);
+}
+
+/**
+ * @brief Fill the palette with linear RGB gradients between stops, which
+ * must be sorted by position. Before the first and past the last stop the
+ * end colors hold.
+ *
+ * @return int -1 without stops, 1 otherwise
+ */
+static int color_palette_from_stops(color_palette_t *this,
+                                    const color_stop_t *stops, size_t count) {
+    size_t stop = 0;
+
+    if (count == 0)
+        return -1;
+
+    for (size_t i = 0; i < this->size; i++) {
+        float position = i / this->scale, t;
+        const color_stop_t *from, *to;
+
+        while (stop + 1 < count && stops[stop + 1].position <= position)
+            stop++;
+
+        from = &stops[stop];
+        to = stop + 1 < count ? &stops[stop + 1] : from;
+
+        if (position <= from->position || to == from)
+            t = 0.f;
+        else
+            t = (position - from->position) / (to->position - from->position);
+
+        this->entries[i] = color_neopixel_from_rgb(
+            (uint8_t)(from->r + (to->r - from->r) * t + 0.5f),
+            (uint8_t)(from->g + (to->g - from->g) * t + 0.5f),
+            (uint8_t)(from->b + (to->b - from->b) * t + 0.5f));
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Palette index of a magnitude, clamped to [0, 1].
+ */
+static inline uint32_t color_palette_quantize(const color_palette_t *this,
+                                              float magnitude) {
+    if (!(magnitude > 0.f))
+        return 0;
+
+    if (magnitude >= 1.f)
+        return (uint32_t)this->size - 1;
+
+    return (uint32_t)(magnitude * this->scale + 0.5f);
+}
+
+static inline color_neopixel_t
+color_palette_lookup(const color_palette_t *this, float magnitude) {
+    return this->entries[color_palette_quantize(this, magnitude)];
+}
+
+/**
+ * @brief Batch conversion of already quantized magnitudes, no float math
+ * at all. Indices past the end clamp to the last entry.
+ */
+static void color_palette_map(const color_palette_t *this,
+                              const uint16_t *indices, uint32_t *pixels,
+                              size_t count) {
+    const color_neopixel_t *entries = this->entries;
+    uint32_t last = (uint32_t)this->size - 1;
+
+    for (size_t i = 0; i < count; i++)
+        pixels[i] = entries[indices[i] < last ? indices[i] : last].value;
+}
+
+/**
+ * @brief Batch quantize and convert magnitudes in one pass.
+ */
+static void color_palette_map_f(const color_palette_t *this,
+                                const float *magnitudes, uint32_t *pixels,
+                                size_t count) {
+    const color_neopixel_t *entries = this->entries;
+
+    for (size_t i = 0; i < count; i++)
+        pixels[i] = entries[color_palette_quantize(this, magnitudes[i])].value;
+}
+
 #endif
@@ -0,0 +1,225 @@
+#include "trace.h"
+
+#include <pico/critical_section.h>
+#include <pico/platform.h>
+#include <pico/stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CORE_COUNT 2
+#define RING_MASK (TRACE_RING_SIZE - 1)
+
+static const char base64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static critical_section_t lock;
+static bool initialized = false;
+
+// Ever increasing, the ring holds [tail, head)
+static trace_record_t ring[TRACE_RING_SIZE];
+static uint32_t head, tail;
+
+static uint32_t current_frame[CORE_COUNT];
+static uint32_t counters[TRACE_COUNTER_COUNT];
+
+static uint32_t latency_buckets[TRACE_LATENCY_BUCKET_COUNT];
+static uint32_t latency_count, latency_max;
+
+static uint64_t irq_latency_sum;
+static uint32_t irq_latency_count, irq_latency_max;
+
+void trace_init(void) {
+    if (!initialized) {
+        critical_section_init(&lock);
+        initialized = true;
+    }
+
+    critical_section_enter_blocking(&lock);
+
+    head = tail = 0;
+    latency_count = latency_max = 0;
+    irq_latency_sum = 0;
+    irq_latency_count = irq_latency_max = 0;
+    memset(current_frame, 0, sizeof(current_frame));
+    memset(counters, 0, sizeof(counters));
+    memset(latency_buckets, 0, sizeof(latency_buckets));
+
+    critical_section_exit(&lock);
+}
+
+void trace_begin_frame(uint32_t capture_us) {
+    current_frame[get_core_num()] = capture_us;
+}
+
+uint32_t trace_frame(void) { return current_frame[get_core_num()]; }
+
+void trace_event(trace_event_t event) {
+    trace_event_frame(event, trace_frame());
+}
+
+void trace_event_frame(trace_event_t event, uint32_t capture_us) {
+    trace_record_t record = {
+        .time_us = time_us_32(),
+        .frame = (uint16_t)capture_us,
+        .event = (uint8_t)event,
+        .core = (uint8_t)get_core_num(),
+    };
+
+    critical_section_enter_blocking(&lock);
+
+    if (head - tail == TRACE_RING_SIZE) {
+        tail++;
+        counters[TRACE_COUNTER_LOST]++;
+    }
+
+    ring[head++ & RING_MASK] = record;
+
+    critical_section_exit(&lock);
+}
+
+void trace_count(trace_counter_t counter, uint32_t amount) {
+    critical_section_enter_blocking(&lock);
+    counters[counter] += amount;
+    critical_section_exit(&lock);
+}
+
+void trace_latency(uint32_t capture_us) {
+    uint32_t latency = time_us_32() - capture_us;
+    uint32_t bucket = latency / TRACE_LATENCY_BUCKET_US;
+
+    if (bucket >= TRACE_LATENCY_BUCKET_COUNT)
+        bucket = TRACE_LATENCY_BUCKET_COUNT - 1;
+
+    critical_section_enter_blocking(&lock);
+
+    latency_buckets[bucket]++;
+    latency_count++;
+
+    if (latency > latency_max)
+        latency_max = latency;
+
+    critical_section_exit(&lock);
+}
+
+void trace_irq_latency(uint32_t latency_us) {
+    critical_section_enter_blocking(&lock);
+
+    irq_latency_sum += latency_us;
+    irq_latency_count++;
+
+    if (latency_us > irq_latency_max)
+        irq_latency_max = latency_us;
+
+    critical_section_exit(&lock);
+}
+
+size_t trace_read(trace_record_t *records, size_t count) {
+    size_t taken = 0;
+
+    critical_section_enter_blocking(&lock);
+
+    while (taken < count && tail != head)
+        records[taken++] = ring[tail++ & RING_MASK];
+
+    critical_section_exit(&lock);
+
+    return taken;
+}
+
+// Upper edge of the bucket holding the rank-th latency, never past the max
+static uint32_t percentile(uint32_t rank) {
+    uint32_t seen = 0, edge;
+
+    for (size_t i = 0; i < TRACE_LATENCY_BUCKET_COUNT - 1; i++) {
+        seen += latency_buckets[i];
+        edge = (uint32_t)(i + 1) * TRACE_LATENCY_BUCKET_US;
+
+        if (seen > rank)
+            return edge < latency_max ? edge : latency_max;
+    }
+
+    return latency_max;
+}
+
+void trace_summarize(trace_summary_t *summary) {
+    critical_section_enter_blocking(&lock);
+
+    memcpy(summary->counters, counters, sizeof(counters));
+    summary->frame_count = latency_count;
+    summary->latency_p50_us = percentile(latency_count / 2);
+    summary->latency_p90_us = percentile(latency_count * 9 / 10);
+    summary->latency_p99_us = percentile(latency_count * 99 / 100);
+    summary->latency_max_us = latency_max;
+    summary->irq_latency_mean_us =
+        irq_latency_count == 0
+            ? 0
+            : (uint32_t)(irq_latency_sum / irq_latency_count);
+    summary->irq_latency_max_us = irq_latency_max;
+
+    critical_section_exit(&lock);
+
+    // Nothing measured, not a latency of 0
+    if (latency_count == 0)
+        summary->latency_p50_us = summary->latency_p90_us =
+            summary->latency_p99_us = 0;
+}
+
+static void put_u32(uint8_t *bytes, uint32_t value) {
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+static void print_base64(const uint8_t *bytes, size_t size) {
+    char line[4 * TRACE_DRAIN_RECORDS * sizeof(trace_record_t) / 3 + 4];
+    size_t length = 0;
+    uint32_t triple;
+
+    for (size_t i = 0; i < size; i += 3) {
+        triple = (uint32_t)bytes[i] << 16;
+
+        if (i + 1 < size)
+            triple |= (uint32_t)bytes[i + 1] << 8;
+        if (i + 2 < size)
+            triple |= bytes[i + 2];
+
+        line[length++] = base64[triple >> 18 & 63];
+        line[length++] = base64[triple >> 12 & 63];
+        line[length++] = i + 1 < size ? base64[triple >> 6 & 63] : '=';
+        line[length++] = i + 2 < size ? base64[triple & 63] : '=';
+    }
+
+    printf("T %.*s\n", (int)length, line);
+}
+
+void trace_drain(void) {
+    trace_record_t records[TRACE_DRAIN_RECORDS];
+    uint8_t bytes[TRACE_DRAIN_RECORDS * sizeof(trace_record_t)];
+    trace_summary_t summary;
+    size_t count;
+
+    while ((count = trace_read(records, TRACE_DRAIN_RECORDS)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            put_u32(bytes + 8 * i, records[i].time_us);
+            bytes[8 * i + 4] = (uint8_t)records[i].frame;
+            bytes[8 * i + 5] = (uint8_t)(records[i].frame >> 8);
+            bytes[8 * i + 6] = records[i].event;
+            bytes[8 * i + 7] = records[i].core;
+        }
+
+        print_base64(bytes, 8 * count);
+    }
+
+    trace_summarize(&summary);
+
+    printf("S frames=%u overruns=%u stale=%u lost=%u p50=%u p90=%u p99=%u "
+           "max=%u irq_mean=%u irq_max=%u\n",
+           summary.frame_count, summary.counters[TRACE_COUNTER_DMA_OVERRUN],
+           summary.counters[TRACE_COUNTER_STALE_FRAME],
+           summary.counters[TRACE_COUNTER_LOST], summary.latency_p50_us,
+           summary.latency_p90_us, summary.latency_p99_us,
+           summary.latency_max_us, summary.irq_latency_mean_us,
+           summary.irq_latency_max_us);
+}
@@ -0,0 +1,142 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Per stage timing of the frames on their way from the microphone to the
+ * LEDs, plus health counters of the drivers. Timestamps go into a ring
+ * shared by both cores and their interrupts, drained over USB on the device
+ * and written as a Chrome trace (chrome://tracing, Perfetto) by the host
+ * tools.
+ *
+ * A frame is named after the time its hop of audio was captured, which ties
+ * its events together across the cores and the swapchains. The sound to
+ * light latency runs from there to the end of the LED transmission, when
+ * the strip latches the frame.
+ *
+ * Everything wrapped in TRACE() compiles to nothing unless TRACE_ENABLED is
+ * set, by the LIGHT_PAINTING_TRACE option. It is on by default on the host
+ * only.
+ */
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+#if TRACE_ENABLED
+#define TRACE(stmt)                                                            \
+    do {                                                                       \
+        stmt;                                                                  \
+    } while (0)
+#else
+#define TRACE(stmt)                                                            \
+    do {                                                                       \
+    } while (0)
+#endif
+
+// Records kept until drained, a power of two. About 50 frames of events
+#define TRACE_RING_SIZE 512
+
+// Latency histogram, 100 us buckets up to 25.6 ms, the last one open ended
+#define TRACE_LATENCY_BUCKET_US 100
+#define TRACE_LATENCY_BUCKET_COUNT 256
+
+// Records per line of trace_drain, 48 bytes are 64 base64 characters
+#define TRACE_DRAIN_RECORDS 6
+
+typedef enum {
+    // Hop of audio published by the i2s interrupt
+    TRACE_CAPTURE,
+    TRACE_FRONT_END_BEGIN,
+    TRACE_FRONT_END_END,
+    TRACE_FFT_BEGIN,
+    TRACE_FFT_END,
+    // Band aggregation and pixel mapping
+    TRACE_MAP_BEGIN,
+    TRACE_MAP_END,
+    // Pixels handed over to the LED driver
+    TRACE_LED_SWAP,
+    TRACE_TRANSMIT_BEGIN,
+    TRACE_TRANSMIT_END,
+    TRACE_EVENT_COUNT,
+} trace_event_t;
+
+typedef enum {
+    // i2s buffers overwritten before they were published
+    TRACE_COUNTER_DMA_OVERRUN,
+    // Frames superseded in the LED swapchain before the strip got them
+    TRACE_COUNTER_STALE_FRAME,
+    // Records overwritten before they were drained
+    TRACE_COUNTER_LOST,
+    TRACE_COUNTER_COUNT,
+} trace_counter_t;
+
+/**
+ * On the wire as 8 bytes little endian, in this order.
+ */
+typedef struct {
+    uint32_t time_us;
+    // Low bits of the capture time of the frame
+    uint16_t frame;
+    uint8_t event;
+    uint8_t core;
+} trace_record_t;
+
+typedef struct {
+    uint32_t counters[TRACE_COUNTER_COUNT];
+    // Frames that made it to the LEDs, the latency figures cover these
+    uint32_t frame_count;
+    // Upper edges of the histogram buckets, the max is exact
+    uint32_t latency_p50_us;
+    uint32_t latency_p90_us;
+    uint32_t latency_p99_us;
+    uint32_t latency_max_us;
+    // Interrupt entry after the hardware event that raised it
+    uint32_t irq_latency_mean_us;
+    uint32_t irq_latency_max_us;
+} trace_summary_t;
+
+/**
+ * @brief Empty the ring and zero every counter. Before anything traces.
+ */
+void trace_init(void);
+
+/**
+ * @brief Events of this core belong to the frame captured at capture_us
+ * from now on.
+ */
+void trace_begin_frame(uint32_t capture_us);
+uint32_t trace_frame(void);
+
+// For the current frame of this core
+void trace_event(trace_event_t event);
+// For any frame, interrupts work on frames of their own
+void trace_event_frame(trace_event_t event, uint32_t capture_us);
+
+void trace_count(trace_counter_t counter, uint32_t amount);
+
+/**
+ * @brief The frame captured at capture_us just got to the LEDs.
+ */
+void trace_latency(uint32_t capture_us);
+void trace_irq_latency(uint32_t latency_us);
+
+/**
+ * @brief Take up to count records out of the ring, oldest first.
+ *
+ * @return size_t Records taken
+ */
+size_t trace_read(trace_record_t *records, size_t count);
+
+void trace_summarize(trace_summary_t *summary);
+
+/**
+ * @brief Everything in the ring and a summary over stdout, USB on the
+ * device. One line per TRACE_DRAIN_RECORDS records, "T " and the records
+ * in base64, then "S " and the summary as key=value pairs.
+ */
+void trace_drain(void);
+
+#endif
@@ -0,0 +1,106 @@
+#include "output.h"
+
+#include <math.h>
+
+#define LEVEL_MAX (OUTPUT_LEVEL_COUNT - 1)
+
+// Green and blue of a pixel shifted down a byte, 16 bits apart
+#define GB_MASK 0x00FF00FFu
+
+static void build_lut(uint8_t *lut, float gamma, uint8_t brightness) {
+    for (size_t i = 0; i < OUTPUT_LEVEL_COUNT; i++)
+        lut[i] = (uint8_t)(powf((float)i / LEVEL_MAX, gamma) * brightness +
+                           0.5f);
+}
+
+int output_init(output_t *this, arena_t *arena, const output_config_t *config) {
+    uint8_t *mem = arena_alloc(arena, 3 * OUTPUT_LEVEL_COUNT, ARENA_ALIGN);
+
+    if (mem == NULL)
+        return -1;
+
+    this->lut_r = mem;
+    this->lut_g = mem + OUTPUT_LEVEL_COUNT;
+    this->lut_b = mem + 2 * OUTPUT_LEVEL_COUNT;
+    this->current_ma = 0;
+    this->limited_count = 0;
+    this->mem = mem;
+    this->arena = arena;
+
+    if (output_configure(this, config) < 0) {
+        arena_free(arena, mem);
+        return -1;
+    }
+
+    return 1;
+}
+
+int output_configure(output_t *this, const output_config_t *config) {
+    if (!(config->gamma_r > 0.f) || !(config->gamma_g > 0.f) ||
+        !(config->gamma_b > 0.f))
+        return -1;
+
+    build_lut(this->lut_r, config->gamma_r, config->brightness);
+    build_lut(this->lut_g, config->gamma_g, config->brightness);
+    build_lut(this->lut_b, config->gamma_b, config->brightness);
+
+    this->channel_ma = config->channel_ma;
+    this->idle_ma = config->idle_ma;
+    this->budget_ma = config->budget_ma;
+
+    return 1;
+}
+
+/**
+ * @brief Every channel times scale / 256, green and blue in one multiply.
+ * 255 x 255 still fits the 16 bits between them.
+ */
+static void scale_frame(uint32_t *pixels, size_t count, uint32_t scale) {
+    uint32_t pixel, gb, r;
+
+    for (size_t i = 0; i < count; i++) {
+        pixel = pixels[i];
+        gb = ((pixel >> 8 & GB_MASK) * scale >> 8) & GB_MASK;
+        r = (pixel >> 16 & LEVEL_MAX) * scale >> 8;
+        pixels[i] = gb << 8 | r << 16;
+    }
+}
+
+uint32_t output_apply(output_t *this, uint32_t *pixels, size_t count) {
+    const uint8_t *lut_r = this->lut_r, *lut_g = this->lut_g,
+                  *lut_b = this->lut_b;
+    uint32_t pixel, g, r, b, levels = 0, idle_ma, scale;
+    uint64_t channel_ma, allowed_ma;
+
+    for (size_t i = 0; i < count; i++) {
+        pixel = pixels[i];
+        g = lut_g[pixel >> 24];
+        r = lut_r[pixel >> 16 & LEVEL_MAX];
+        b = lut_b[pixel >> 8 & LEVEL_MAX];
+
+        levels += g + r + b;
+        pixels[i] = g << 24 | r << 16 | b << 8;
+    }
+
+    // Compared times LEVEL_MAX, what divisions there are run once a frame
+    idle_ma = this->idle_ma * (uint32_t)count;
+    channel_ma = (uint64_t)levels * this->channel_ma;
+    allowed_ma = this->budget_ma > idle_ma ? this->budget_ma - idle_ma : 0;
+
+    if (this->budget_ma == 0 || channel_ma <= allowed_ma * LEVEL_MAX) {
+        this->current_ma = idle_ma + (uint32_t)(channel_ma / LEVEL_MAX);
+        return this->current_ma;
+    }
+
+    // Rounded down, the frame ends up under the budget rather than on it
+    scale = (uint32_t)((allowed_ma * LEVEL_MAX << 8) / channel_ma);
+    scale_frame(pixels, count, scale);
+
+    this->limited_count++;
+    this->current_ma =
+        idle_ma + (uint32_t)((channel_ma * scale >> 8) / LEVEL_MAX);
+
+    return this->current_ma;
+}
+
+void output_deinit(output_t *this) { arena_free(this->arena, this->mem); }
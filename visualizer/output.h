@@ -0,0 +1,95 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "arena.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Levels of one channel, 8 bits on the wire
+#define OUTPUT_LEVEL_COUNT 256
+
+// WS2812B figures, a channel at full scale and an LED with everything off
+#define OUTPUT_DEFAULT_CHANNEL_MA 20
+#define OUTPUT_DEFAULT_IDLE_MA 1
+
+// Arena bytes output_init takes, a table per channel
+#define OUTPUT_FOOTPRINT ARENA_FOOTPRINT(3 * OUTPUT_LEVEL_COUNT)
+
+typedef struct {
+    // 1 is linear, WS2812s look even around 2.2 to 2.8
+    float gamma_r;
+    float gamma_g;
+    float gamma_b;
+    // Global, 255 is full
+    uint8_t brightness;
+    // Draw of one channel at 255 and of a dark LED
+    uint32_t channel_ma;
+    uint32_t idle_ma;
+    // What the supply can give the strip, 0 for no limit
+    uint32_t budget_ma;
+} output_config_t;
+
+/**
+ * Last stage before the LEDs: gamma, global brightness and a current limit
+ * in a single integer pass over the frame. Gamma and brightness fold into
+ * one lookup table per channel, built once, and the strip current is
+ * estimated from the looked up levels on the way. Only a frame over the
+ * budget takes a second pass, scaling every channel down by the same 8-bit
+ * factor so the frame keeps its hues.
+ *
+ * The estimate is linear in the levels, which is how WS2812s draw: a fixed
+ * current per channel, PWM'd at the level.
+ */
+typedef struct {
+    uint8_t *lut_r;
+    uint8_t *lut_g;
+    uint8_t *lut_b;
+    uint32_t channel_ma;
+    uint32_t idle_ma;
+    uint32_t budget_ma;
+
+    // Of the last frame, after the limit
+    uint32_t current_ma;
+    // Frames scaled down to the budget
+    uint32_t limited_count;
+
+    void *mem;
+    arena_t *arena;
+} output_t;
+
+// Linear, full brightness and no limit, pixels go through untouched
+static inline output_config_t output_default_config(void) {
+    return (output_config_t){
+        .gamma_r = 1.f,
+        .gamma_g = 1.f,
+        .gamma_b = 1.f,
+        .brightness = 255,
+        .channel_ma = OUTPUT_DEFAULT_CHANNEL_MA,
+        .idle_ma = OUTPUT_DEFAULT_IDLE_MA,
+        .budget_ma = 0,
+    };
+}
+
+int output_init(output_t *this, arena_t *arena, const output_config_t *config);
+
+/**
+ * @brief Rebuild the tables for a new config, e.g. another brightness. Not
+ * while output_apply runs on another core.
+ *
+ * @return int -1 on a gamma that is not positive, the tables are left as
+ * they were
+ */
+int output_configure(output_t *this, const output_config_t *config);
+
+/**
+ * @brief Run the frame through the stage in place, GRB in the top three
+ * bytes (see color_neopixel_t). The padding byte comes out 0.
+ *
+ * @return uint32_t Estimated strip current in mA, within the budget
+ */
+uint32_t output_apply(output_t *this, uint32_t *pixels, size_t count);
+
+void output_deinit(output_t *this);
+
+#endif
@@ -0,0 +1,264 @@
+#include "renderer.h"
+#include "color.h"
+#include "visualizer.h"
+
+#include <math.h>
+#include <string.h>
+
+// Positions of the VU bar, 16 bits of fraction
+#define POSITION_ONE 65535u
+
+static void render_spectrum(renderer_t *this, const float *bands,
+                            uint32_t *pixels) {
+    const color_palette_t *colors = visualizer_get_palette();
+    const uint16_t *band_end = this->band_end;
+    size_t pixel = 0, end;
+    uint32_t color;
+
+    // A color per band rather than per pixel, then plain fills
+    for (size_t band = 0; band < this->geometry.band_count; band++) {
+        end = band_end[band];
+        color = color_palette_lookup(colors, bands[band]).value;
+
+        for (; pixel < end; pixel++)
+            pixels[pixel] = color;
+    }
+}
+
+static int init_spectrum(renderer_t *this) {
+    size_t pixel_count = this->geometry.pixel_count,
+           band_count = this->geometry.band_count;
+
+    for (size_t band = 0; band < band_count; band++)
+        this->band_end[band] =
+            (uint16_t)((band + 1) * pixel_count / band_count);
+
+    return 1;
+}
+
+// The upper half holds the middle pixel of an odd strip
+static void render_mirrored_spectrum(renderer_t *this, const float *bands,
+                                     uint32_t *pixels) {
+    const color_palette_t *colors = visualizer_get_palette();
+    const uint16_t *band_end = this->band_end;
+    size_t center = this->geometry.pixel_count / 2, offset = 0, end;
+    uint32_t color;
+
+    for (size_t band = 0; band < this->geometry.band_count; band++) {
+        end = band_end[band];
+        color = color_palette_lookup(colors, bands[band]).value;
+
+        for (; offset < end; offset++) {
+            pixels[center + offset] = color;
+
+            if (offset < center)
+                pixels[center - 1 - offset] = color;
+        }
+    }
+}
+
+static int init_mirrored_spectrum(renderer_t *this) {
+    size_t half = this->geometry.pixel_count - this->geometry.pixel_count / 2,
+           band_count = this->geometry.band_count;
+
+    for (size_t band = 0; band < band_count; band++)
+        this->band_end[band] = (uint16_t)((band + 1) * half / band_count);
+
+    return 1;
+}
+
+static void render_vu(renderer_t *this, const float *bands, uint32_t *pixels) {
+    const color_palette_t *colors = visualizer_get_palette();
+    const color_neopixel_t *entries = colors->entries;
+    const uint16_t *position = this->position;
+    size_t pixel_count = this->geometry.pixel_count, lit;
+    uint32_t last = (uint32_t)colors->size - 1;
+    float level = 0.f;
+
+    for (size_t band = 0; band < this->geometry.band_count; band++)
+        level += bands[band];
+
+    level *= this->scale;
+    lit = level >= 1.f  ? pixel_count
+          : level > 0.f ? (size_t)(level * pixel_count)
+                        : 0;
+
+    // Along the palette from the start of the bar to the far end
+    for (size_t i = 0; i < lit; i++)
+        pixels[i] = entries[(position[i] * last + 32768u) >> 16].value;
+
+    memset(pixels + lit, 0, (pixel_count - lit) * sizeof(uint32_t));
+}
+
+static int init_vu(renderer_t *this) {
+    size_t pixel_count = this->geometry.pixel_count;
+
+    for (size_t i = 0; i < pixel_count; i++)
+        this->position[i] =
+            pixel_count > 1 ? (uint16_t)(i * POSITION_ONE / (pixel_count - 1))
+                            : 0;
+
+    this->scale = 1.f / this->geometry.band_count;
+
+    return 1;
+}
+
+static void render_pulse(renderer_t *this, const float *bands,
+                         uint32_t *pixels) {
+    const color_palette_t *colors = visualizer_get_palette();
+    const float *distance = this->distance;
+    float level = 0.f, magnitude;
+
+    for (size_t band = 0; band < this->bass_count; band++)
+        level += bands[band];
+
+    level *= this->scale;
+
+    // Fades from the level in the middle down to dark one level out
+    for (size_t i = 0; i < this->geometry.pixel_count; i++) {
+        magnitude = level - distance[i];
+        pixels[i] = magnitude > 0.f
+                        ? color_palette_lookup(colors, magnitude).value
+                        : 0;
+    }
+}
+
+static int init_pulse(renderer_t *this) {
+    float half = this->geometry.pixel_count / 2.f;
+
+    for (size_t i = 0; i < this->geometry.pixel_count; i++)
+        this->distance[i] = fabsf(i + 0.5f - half) / half;
+
+    // The low quarter of the bands, where the beat is
+    this->bass_count = this->geometry.band_count / 4;
+
+    if (this->bass_count == 0)
+        this->bass_count = 1;
+
+    this->scale = 1.f / this->bass_count;
+
+    return 1;
+}
+
+static const renderer_ops_t registry[RENDERER_COUNT] = {
+    [RENDERER_SPECTRUM] =
+        {
+            .name = "spectrum",
+            .init = init_spectrum,
+            .render = render_spectrum,
+        },
+    [RENDERER_MIRRORED_SPECTRUM] =
+        {
+            .name = "mirror",
+            .init = init_mirrored_spectrum,
+            .render = render_mirrored_spectrum,
+        },
+    [RENDERER_VU] =
+        {
+            .name = "vu",
+            .init = init_vu,
+            .render = render_vu,
+        },
+    [RENDERER_PULSE] =
+        {
+            .name = "pulse",
+            .init = init_pulse,
+            .render = render_pulse,
+        },
+};
+
+const renderer_ops_t *renderer_get_ops(renderer_kind_t kind) {
+    return kind < RENDERER_COUNT ? &registry[kind] : NULL;
+}
+
+int renderer_find(const char *name, renderer_kind_t *kind) {
+    for (size_t i = 0; i < RENDERER_COUNT; i++) {
+        if (strcmp(name, registry[i].name) == 0) {
+            *kind = (renderer_kind_t)i;
+            return 1;
+        }
+    }
+
+    return -1;
+}
+
+int renderer_init(renderer_t *this, arena_t *arena, renderer_kind_t kind,
+                  const renderer_geometry_t *geometry) {
+    size_t size = RENDERER_FOOTPRINT(kind, geometry->pixel_count,
+                                     geometry->band_count);
+    void *mem;
+
+    if (kind >= RENDERER_COUNT || geometry->pixel_count == 0 ||
+        geometry->pixel_count > UINT16_MAX || geometry->band_count == 0)
+        return -1;
+
+    if ((mem = arena_alloc(arena, size, ARENA_ALIGN)) == NULL)
+        return -1;
+
+    *this = (renderer_t){
+        .ops = &registry[kind],
+        .geometry = *geometry,
+        .band_end = kind == RENDERER_SPECTRUM ||
+                            kind == RENDERER_MIRRORED_SPECTRUM
+                        ? mem
+                        : NULL,
+        .position = kind == RENDERER_VU ? mem : NULL,
+        .distance = kind == RENDERER_PULSE ? mem : NULL,
+        .mem = mem,
+        .arena = arena,
+    };
+
+    // The default palette gets built here, not on the first frame
+    visualizer_get_palette();
+
+    if (this->ops->init(this) < 0) {
+        arena_free(arena, mem);
+        return -1;
+    }
+
+    return 1;
+}
+
+void renderer_deinit(renderer_t *this) { arena_free(this->arena, this->mem); }
+
+int renderer_set_init(renderer_set_t *this, arena_t *arena,
+                      const renderer_geometry_t *geometry) {
+    for (size_t i = 0; i < RENDERER_COUNT; i++) {
+        if (renderer_init(&this->renderers[i], arena, (renderer_kind_t)i,
+                          geometry) < 0) {
+            while (i-- > 0)
+                renderer_deinit(&this->renderers[i]);
+
+            return -1;
+        }
+    }
+
+    this->selected = RENDERER_SPECTRUM;
+
+    return 1;
+}
+
+void renderer_set_select(renderer_set_t *this, renderer_kind_t kind) {
+    if (kind < RENDERER_COUNT)
+        __atomic_store_n(&this->selected, (uint32_t)kind, __ATOMIC_RELAXED);
+}
+
+renderer_kind_t renderer_set_selected(renderer_set_t *this) {
+    return (renderer_kind_t)__atomic_load_n(&this->selected, __ATOMIC_RELAXED);
+}
+
+void renderer_set_render(renderer_set_t *this, const float *bands,
+                         uint32_t *pixels) {
+    renderer_render(&this->renderers[renderer_set_selected(this)], bands,
+                    pixels);
+}
+
+size_t renderer_set_pixel_count(renderer_set_t *this) {
+    return this->renderers[RENDERER_SPECTRUM].geometry.pixel_count;
+}
+
+void renderer_set_deinit(renderer_set_t *this) {
+    // Backwards, the arena frees its last allocation only
+    for (size_t i = RENDERER_COUNT; i-- > 0;)
+        renderer_deinit(&this->renderers[i]);
+}
@@ -0,0 +1,130 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "arena.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    // The bands side by side along the strip, lowest first
+    RENDERER_SPECTRUM,
+    // Lowest band in the middle, the spectrum spreading out both ways
+    RENDERER_MIRRORED_SPECTRUM,
+    // One bar from the start of the strip, as long as the mean level
+    RENDERER_VU,
+    // Glow out of the middle of the strip, as wide as the low bands are loud
+    RENDERER_PULSE,
+    RENDERER_COUNT,
+} renderer_kind_t;
+
+typedef struct {
+    size_t pixel_count;
+    // Bands per frame, or frequency bins when the engine makes the bands
+    size_t band_count;
+} renderer_geometry_t;
+
+typedef struct renderer renderer_t;
+
+/**
+ * What a renderer brings along. init works out whatever tables the geometry
+ * calls for, render then draws every frame off them with no allocation and
+ * no division. Colors come from the visualizer palette, see
+ * visualizer_set_palette.
+ */
+typedef struct {
+    const char *name;
+    int (*init)(renderer_t *this);
+    void (*render)(renderer_t *this, const float *bands, uint32_t *pixels);
+} renderer_ops_t;
+
+struct renderer {
+    const renderer_ops_t *ops;
+    renderer_geometry_t geometry;
+    // Spectra, pixel past the last one of every band. Mirrored, on one half
+    uint16_t *band_end;
+    // VU, the palette position of every pixel along the bar, 0 to 65535
+    uint16_t *position;
+    // Pulse, distance of every pixel from the middle, 0 to 1
+    float *distance;
+    // VU 1 / band_count, pulse 1 / bass_count
+    float scale;
+    // Pulse, the low bands it follows
+    size_t bass_count;
+    void *mem;
+    arena_t *arena;
+};
+
+// Arena bytes renderer_init takes for kind
+#define RENDERER_FOOTPRINT(kind, pixel_count, band_count)                      \
+    ((kind) == RENDERER_VU                                                     \
+         ? ARENA_FOOTPRINT((size_t)(pixel_count) * sizeof(uint16_t))           \
+     : (kind) == RENDERER_PULSE                                                \
+         ? ARENA_FOOTPRINT((size_t)(pixel_count) * sizeof(float))              \
+         : ARENA_FOOTPRINT((size_t)(band_count) * sizeof(uint16_t)))
+
+/**
+ * @brief The built-in renderers, indexed by renderer_kind_t.
+ */
+const renderer_ops_t *renderer_get_ops(renderer_kind_t kind);
+
+/**
+ * @brief Look a built-in renderer up by name, e.g. from a command line.
+ *
+ * @return int -1 if there is none by that name, 1 otherwise
+ */
+int renderer_find(const char *name, renderer_kind_t *kind);
+
+/**
+ * @return int -1 on an empty geometry or more than 65535 pixels
+ */
+int renderer_init(renderer_t *this, arena_t *arena, renderer_kind_t kind,
+                  const renderer_geometry_t *geometry);
+
+/**
+ * @brief Draw one frame of geometry.band_count bands in [0, 1] into
+ * geometry.pixel_count pixels.
+ */
+static inline void renderer_render(renderer_t *this, const float *bands,
+                                   uint32_t *pixels) {
+    this->ops->render(this, bands, pixels);
+}
+
+void renderer_deinit(renderer_t *this);
+
+/**
+ * Every built-in renderer set up for the same geometry, so switching from
+ * one to the next is a single store. The switch may come from the other
+ * core or an interrupt, it takes effect at the next frame and no frame is
+ * ever dropped or drawn half and half.
+ */
+typedef struct {
+    renderer_t renderers[RENDERER_COUNT];
+    // Written by whoever switches, read once per frame
+    uint32_t selected;
+} renderer_set_t;
+
+#define RENDERER_SET_FOOTPRINT(pixel_count, band_count)                        \
+    (RENDERER_FOOTPRINT(RENDERER_SPECTRUM, pixel_count, band_count) +          \
+     RENDERER_FOOTPRINT(RENDERER_MIRRORED_SPECTRUM, pixel_count,               \
+                        band_count) +                                          \
+     RENDERER_FOOTPRINT(RENDERER_VU, pixel_count, band_count) +                \
+     RENDERER_FOOTPRINT(RENDERER_PULSE, pixel_count, band_count))
+
+/**
+ * @brief Initialize every built-in renderer, the spectrum selected.
+ */
+int renderer_set_init(renderer_set_t *this, arena_t *arena,
+                      const renderer_geometry_t *geometry);
+
+void renderer_set_select(renderer_set_t *this, renderer_kind_t kind);
+renderer_kind_t renderer_set_selected(renderer_set_t *this);
+
+void renderer_set_render(renderer_set_t *this, const float *bands,
+                         uint32_t *pixels);
+
+size_t renderer_set_pixel_count(renderer_set_t *this);
+
+void renderer_set_deinit(renderer_set_t *this);
+
+#endif
@@ -0,0 +1,58 @@
+#include "visualizer.h"
+#include "color.h"
+
+static color_neopixel_t default_entries[COLOR_PALETTE_SIZE_SMALL];
+static color_palette_t default_palette;
+static const color_palette_t *palette = NULL;
+
+const color_palette_t *visualizer_get_palette(void) {
+    // The full hue circle, what the mapper always drew
+    if (palette == NULL) {
+        color_palette_init(&default_palette, default_entries,
+                           COLOR_PALETTE_SIZE_SMALL);
+        color_palette_from_hsv(&default_palette, 0.f, 360.f, 1.f, 1.f);
+        palette = &default_palette;
+    }
+
+    return palette;
+}
+
+static inline color_neopixel_t magnitude_to_color(float magnitude) {
+    return color_palette_lookup(visualizer_get_palette(), magnitude);
+}
+
+void visualizer_set_palette(const color_palette_t *new_palette) {
+    palette = new_palette;
+}
+
+void visualizer_map_frequency_bins_to_pixels(const float *frequency_bins,
+                                             size_t frequency_bin_count,
+                                             uint32_t *pixel_buffer,
+                                             size_t pixel_count) {
+    if (frequency_bin_count > pixel_count) {
+        float pitch = (float)frequency_bin_count / pixel_count;
+
+        for (size_t pixel = 0; pixel < pixel_count; pixel++) {
+            float index = pixel * pitch;
+            size_t index_i = (size_t)index;
+            float index_f = index - index_i;
+
+            pixel_buffer[pixel] =
+                color_neopixel_add(
+                    magnitude_to_color((1.f - index_f) *
+                                       frequency_bins[index_i]),
+                    magnitude_to_color(index_f * frequency_bins[index_i + 1]))
+                    .value;
+        }
+    } else if (frequency_bin_count < pixel_count) {
+        float pitch = (float)frequency_bin_count / pixel_count;
+
+        for (size_t i = 0; i < pixel_count; i++) {
+            size_t bin = i * pitch;
+            pixel_buffer[i] = magnitude_to_color(frequency_bins[bin]).value;
+        }
+    } else {
+        color_palette_map_f(visualizer_get_palette(), frequency_bins,
+                            pixel_buffer, pixel_count);
+    }
+}
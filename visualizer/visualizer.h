@@ -0,0 +1,26 @@
+#ifndef VISUALIZER_H
+#define VISUALIZER_H
+
+#include "color.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Swap the palette magnitudes are drawn with, takes effect on the
+ * next frame. The palette must outlive its use, NULL restores the default
+ * hue sweep.
+ */
+void visualizer_set_palette(const color_palette_t *palette);
+
+/**
+ * @brief The palette in use, the default one built on the first call.
+ */
+const color_palette_t *visualizer_get_palette(void);
+
+void visualizer_map_frequency_bins_to_pixels(const float *frequency_bins,
+                                             size_t frequency_bin_count,
+                                             uint32_t *pixel_buffer,
+                                             size_t pixel_count);
+
+#endif